@@ -14,9 +14,14 @@ void arduinoDelay (unsigned long waitTimeInMs) {
 	delay(waitTimeInMs);
 }
 
+unsigned long arduinoMicros (){
+	return micros();
+}
+
 TimerInterface arduinoTimerImpl =
 {
 		timerInit,
 		arduinoMillis,
-		arduinoDelay
+		arduinoDelay,
+		arduinoMicros
 };
@@ -20,6 +20,8 @@
 #include "src/timer/TimerInterface.h"
 #include "src/serial/SerialInterface.h"
 #include "src/traceDebug/DebugInterface.h"
+#include "src/traceDebug/TraceInterface.h"
+#include "src/persistence/PersistenceInterface.h"
 
 
 #endif /* __LiveBooster_h */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include "AtMatcher.h"
+#include <string.h>
+
+/* Return the child of state s for character c, or 0 */
+static unsigned char _child(const struct _AtMatcher* const obj, unsigned char s, char c) {
+    unsigned char n = obj->_n[s].child;
+    while (n && (obj->_n[n].c != c)) {
+        n = obj->_n[n].sibling;
+    }
+    return n;
+}
+
+void AtMatcher_Init(struct _AtMatcher* const obj) {
+    memset(&obj->_n[0], 0, sizeof(obj->_n[0]));
+    obj->_count = 1;
+    obj->_state = 0;
+}
+
+int AtMatcher_Add(struct _AtMatcher* const obj, const char* pattern, unsigned char id) {
+    unsigned char s = 0;
+
+    if ((pattern == 0) || (*pattern == 0) || (id == 0)) {
+        return 0;
+    }
+    for (; *pattern; pattern++) {
+        unsigned char n = _child(obj, s, *pattern);
+        if (!n) {
+            if (obj->_count >= AT_MATCHER_MAX_STATES) {
+                return 0;
+            }
+            n = obj->_count++;
+            obj->_n[n].c = *pattern;
+            obj->_n[n].child = 0;
+            obj->_n[n].fail = 0;
+            obj->_n[n].out = 0;
+            obj->_n[n].sibling = obj->_n[s].child;
+            obj->_n[s].child = n;
+        }
+        s = n;
+    }
+    if (!obj->_n[s].out || (id < obj->_n[s].out)) {
+        obj->_n[s].out = id;
+    }
+    return 1;
+}
+
+void AtMatcher_Build(struct _AtMatcher* const obj) {
+    unsigned char queue[AT_MATCHER_MAX_STATES];
+    int head = 0;
+    int tail = 0;
+    unsigned char n;
+
+    /* Breadth-first walk: the failure state of a node is always shallower, thus already built */
+    for (n = obj->_n[0].child; n; n = obj->_n[n].sibling) {
+        obj->_n[n].fail = 0;
+        queue[tail++] = n;
+    }
+    while (head < tail) {
+        unsigned char u = queue[head++];
+        for (n = obj->_n[u].child; n; n = obj->_n[n].sibling) {
+            unsigned char f = obj->_n[u].fail;
+            unsigned char g = _child(obj, f, obj->_n[n].c);
+            while (!g && f) {
+                f = obj->_n[f].fail;
+                g = _child(obj, f, obj->_n[n].c);
+            }
+            obj->_n[n].fail = g;
+            /* a pattern ending at the failure state also ends here */
+            if (obj->_n[g].out && (!obj->_n[n].out || (obj->_n[g].out < obj->_n[n].out))) {
+                obj->_n[n].out = obj->_n[g].out;
+            }
+            queue[tail++] = n;
+        }
+    }
+    obj->_state = 0;
+}
+
+void AtMatcher_Reset(struct _AtMatcher* const obj) {
+    obj->_state = 0;
+}
+
+int AtMatcher_Idle(struct _AtMatcher* const obj) {
+    return obj->_state == 0;
+}
+
+int AtMatcher_Feed(struct _AtMatcher* const obj, const char* data, int len, int* used) {
+    unsigned char s = obj->_state;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        char c = data[i];
+        unsigned char n;
+        if (c == 0) {
+            continue; // Skip 0x00 bytes, just in case
+        }
+        n = _child(obj, s, c);
+        while (!n && s) {
+            s = obj->_n[s].fail;
+            n = _child(obj, s, c);
+        }
+        s = n;
+        if (obj->_n[s].out) {
+            obj->_state = s;
+            if (used) {
+                *used = i + 1;
+            }
+            return obj->_n[s].out;
+        }
+    }
+    obj->_state = s;
+    if (used) {
+        *used = len;
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __AtMatcher_h
+#define __AtMatcher_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Incremental matcher of the modem responses (Aho-Corasick automaton).
+ *
+ * The expected responses and the URC prefixes are added as patterns, then the
+ * received bytes are fed as they come: each byte costs one transition, whatever
+ * the number of patterns and the length of the current line.
+ * The automaton is stored sparse (first child / next sibling) to stay small.
+ */
+
+#ifndef AT_MATCHER_MAX_STATES
+#define AT_MATCHER_MAX_STATES   192   /* at most 255 (byte indexes) */
+#endif
+
+typedef struct _AtMatcherNode {
+    char c;                  /* transition character from the parent */
+    unsigned char child;     /* first child (0 = none) */
+    unsigned char sibling;   /* next child of the parent (0 = none) */
+    unsigned char fail;      /* longest proper suffix also in the automaton */
+    unsigned char out;       /* id of the prior pattern ending here (0 = none) */
+} AtMatcherNode;
+
+typedef struct _AtMatcher {
+    AtMatcherNode _n[AT_MATCHER_MAX_STATES];
+    unsigned char _count;
+    unsigned char _state;
+} AtMatcher;
+
+/**
+ * Remove all patterns.
+ */
+void AtMatcher_Init(struct _AtMatcher* const obj);
+
+/**
+ * Add a pattern (non empty string) identified by "id" (1..255).
+ * The lowest id wins when several patterns end on the same byte.
+ * Return 1 on success, 0 if the automaton is full.
+ */
+int AtMatcher_Add(struct _AtMatcher* const obj, const char* pattern, unsigned char id);
+
+/**
+ * Compute the failure links; shall be called after the last AtMatcher_Add() and before feeding data.
+ */
+void AtMatcher_Build(struct _AtMatcher* const obj);
+
+/**
+ * Restart matching from an empty input.
+ */
+void AtMatcher_Reset(struct _AtMatcher* const obj);
+
+/**
+ * Return 1 if the bytes fed since the last reset end on no pattern prefix, else 0.
+ */
+int AtMatcher_Idle(struct _AtMatcher* const obj);
+
+/**
+ * Feed "len" received bytes, stopping on the first matched pattern.
+ * "used" (optional) is set to the number of bytes consumed, including the last byte of the match.
+ * Return the id of the matched pattern, or 0 if no pattern ends in this data.
+ */
+int AtMatcher_Feed(struct _AtMatcher* const obj, const char* data, int len, int* used);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
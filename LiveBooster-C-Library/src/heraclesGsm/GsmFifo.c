@@ -46,6 +46,31 @@ int GsmFifo_Put(struct _GsmFifo* const obj, const unsigned char c) {
     return 1;
 }
 
+int GsmFifo_Write(struct _GsmFifo* const obj, const unsigned char* p, int n) {
+    int c = n;
+    while (c) {
+        int f = GsmFifo_FreeSize(obj);
+        if (!f) {
+            return n - c; // fifo is full
+        }
+        // check free space
+        if (c < f) {
+            f = c;
+        }
+        int w = obj->_w;
+        int m = FIFO_SIZE - w;
+        // check wrap
+        if (f > m) {
+            f = m;
+        }
+        memcpy(&(obj->_b[w]), p, f);
+        obj->_w = _inc(w, f);
+        c -= f;
+        p += f;
+    }
+    return n - c;
+}
+
 int GsmFifo_Get(struct _GsmFifo* const obj, unsigned char* p, int n) {
     int c = n;
     while (c) {
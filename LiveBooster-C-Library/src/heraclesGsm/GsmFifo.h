@@ -41,6 +41,11 @@ int GsmFifo_FreeSize(struct _GsmFifo* const obj);
  */
 int GsmFifo_Put(struct _GsmFifo* const obj, const unsigned char c);
 
+/**
+ * Put n chars in the FIFO. Return the number of chars put (limited by the free size).
+ */
+int GsmFifo_Write(struct _GsmFifo* const obj, const unsigned char* p, const int n);
+
 /**
  * Get n chars from the FIFO.
  */
@@ -0,0 +1,504 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include <string.h>
+
+#include "GsmMux.h"
+
+#if GSM_MUX_ENABLE
+
+/*
+ * Basic option frame: F9 | address | control | length (1 or 2 bytes) | information | FCS | F9
+ */
+
+#define MUX_FLAG  0xF9
+#define MUX_EA    0x01
+#define MUX_CR    0x02
+#define MUX_PF    0x10
+
+// Frame types (control field without the P/F bit)
+#define MUX_SABM  0x2F
+#define MUX_UA    0x63
+#define MUX_DM    0x0F
+#define MUX_DISC  0x43
+#define MUX_UIH   0xEF
+#define MUX_UI    0x03
+
+// Control channel messages (type field without the C/R bit)
+#define MUX_MSG_CLD  0xC1
+#define MUX_MSG_MSC  0xE1
+
+// MSC V.24 signals: EA, FC (flow control), RTC, RTR
+#define MUX_V24_FC      0x02
+#define MUX_V24_READY   (0x01 | 0x04 | 0x08)
+
+// A channel is flow controlled below this free room, and released above twice as much
+#define MUX_RX_LOW  (GSM_MUX_RX_SZ / 4)
+
+// Room for a few frames, sent in one serial write
+#define MUX_TX_SZ  (4 * (GSM_MUX_N1 + 7))
+
+enum MuxState {
+    MUX_HUNT = 0, MUX_ADDR, MUX_CTRL, MUX_LEN, MUX_LEN2, MUX_INFO, MUX_FCS, MUX_END
+};
+
+typedef struct _GsmMuxChannel {
+    unsigned char rx[GSM_MUX_RX_SZ];
+    int rxR;
+    int rxCount;
+    int open;
+    int flowOff;     // the modem was asked to stop sending on this channel
+} GsmMuxChannel;
+
+typedef struct _GsmMux {
+    SerialInterface* serial;
+    TimerInterface* timer;
+    int open;
+    int closed;      // CLD response received
+    int controlOpen;
+    GsmMuxChannel channels[GSM_MUX_CHANNELS];       // index = DLCI - 1 (no ring for the control channel)
+    SerialInterface itf[GSM_MUX_CHANNELS];
+    unsigned long lost;                             // received bytes dropped, a ring being full
+
+    // frame being received
+    enum MuxState state;
+    unsigned char hdr[4];
+    int hdrLen;
+    int len;
+    int got;
+    unsigned char info[GSM_MUX_N1];
+
+    // frames to be sent
+    unsigned char tx[MUX_TX_SZ];
+    int txLen;
+} GsmMux;
+
+static struct _GsmMux mux;
+
+static unsigned char muxFcs(const unsigned char* p, int len) {
+    unsigned char fcs = 0xFF;
+    int i;
+    while (len--) {
+        fcs ^= *p++;
+        for (i = 0; i < 8; i++) {
+            fcs = (fcs & 1) ? (unsigned char)((fcs >> 1) ^ 0xE0) : (unsigned char)(fcs >> 1);
+        }
+    }
+    return (unsigned char)(0xFF - fcs);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Transmission */
+
+static void muxFlush() {
+    if (mux.txLen) {
+        mux.serial->write((const char*)mux.tx, mux.txLen);
+        mux.txLen = 0;
+    }
+}
+
+/* Start a frame of "len" information bytes in the transmit buffer */
+static unsigned char* muxFrameBegin(unsigned int dlci, unsigned char ctrl, int len) {
+    unsigned char* f;
+    int hdrLen = (len > 127) ? 4 : 3;
+
+    if (mux.txLen + 1 + hdrLen + len + 2 > MUX_TX_SZ) {
+        muxFlush();
+    }
+    f = mux.tx + mux.txLen;
+    f[0] = MUX_FLAG;
+    f[1] = (unsigned char)((dlci << 2) | MUX_CR | MUX_EA);   // commands from the TE
+    f[2] = ctrl;
+    if (hdrLen == 3) {
+        f[3] = (unsigned char)((len << 1) | MUX_EA);
+    }
+    else {
+        f[3] = (unsigned char)((len & 0x7F) << 1);
+        f[4] = (unsigned char)(len >> 7);
+    }
+    mux.txLen += 1 + hdrLen;
+    return f;
+}
+
+/* End the frame started at "f" (information field already appended) */
+static void muxFrameEnd(const unsigned char* f) {
+    // UIH frames: the FCS only covers the address, control and length fields
+    mux.tx[mux.txLen++] = muxFcs(f + 1, (f[3] & MUX_EA) ? 3 : 4);
+    mux.tx[mux.txLen++] = MUX_FLAG;
+}
+
+static void muxControl(unsigned int dlci, unsigned char ctrl) {
+    muxFrameEnd(muxFrameBegin(dlci, ctrl, 0));
+    muxFlush();
+}
+
+/* Send a message on the control channel (DLCI 0) */
+static void muxMessage(unsigned char type, const unsigned char* value, int len) {
+    unsigned char* f = muxFrameBegin(0, MUX_UIH, len + 2);
+    mux.tx[mux.txLen++] = type;
+    mux.tx[mux.txLen++] = (unsigned char)((len << 1) | MUX_EA);
+    if (len > 0) {
+        memcpy(mux.tx + mux.txLen, value, len);
+        mux.txLen += len;
+    }
+    muxFrameEnd(f);
+    muxFlush();
+}
+
+static void muxFlowControl(unsigned int dlci, int off) {
+    unsigned char value[2];
+    value[0] = (unsigned char)((dlci << 2) | MUX_CR | MUX_EA);
+    value[1] = MUX_V24_READY | (off ? MUX_V24_FC : 0);
+    mux.channels[dlci - 1].flowOff = off;
+    muxMessage(MUX_MSG_MSC | MUX_CR, value, 2);
+}
+
+/* Send the concatenation of "chunks" on channel "dlci", in frames of at most N1 bytes */
+static void muxSend(unsigned int dlci, const SerialChunk* chunks, int count) {
+    int total = 0;
+    int i = 0;
+    int offset = 0;
+
+    for (i = 0; i < count; i++) {
+        total += chunks[i].size;
+    }
+    i = 0;
+    while (total > 0) {
+        int len = (total < GSM_MUX_N1) ? total : GSM_MUX_N1;
+        unsigned char* f = muxFrameBegin(dlci, MUX_UIH, len);
+        total -= len;
+        while (len > 0) {
+            int n = chunks[i].size - offset;
+            if (n > len) {
+                n = len;
+            }
+            memcpy(mux.tx + mux.txLen, chunks[i].buffer + offset, n);
+            mux.txLen += n;
+            len -= n;
+            offset += n;
+            if (offset == chunks[i].size) {
+                i++;
+                offset = 0;
+            }
+        }
+        muxFrameEnd(f);
+    }
+    muxFlush();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Reception */
+
+static void muxPush(GsmMuxChannel* ch, unsigned int dlci, const unsigned char* data, int len) {
+    while (len > 0) {
+        int w = (ch->rxR + ch->rxCount) % GSM_MUX_RX_SZ;
+        int n = GSM_MUX_RX_SZ - w;
+        if (n > GSM_MUX_RX_SZ - ch->rxCount) {
+            n = GSM_MUX_RX_SZ - ch->rxCount;
+        }
+        if (n > len) {
+            n = len;
+        }
+        if (n <= 0) {
+            mux.lost += len;   // overflow: the modem did not honour the flow control
+            break;
+        }
+        memcpy(ch->rx + w, data, n);
+        ch->rxCount += n;
+        data += n;
+        len -= n;
+    }
+    if (!ch->flowOff && (GSM_MUX_RX_SZ - ch->rxCount < MUX_RX_LOW)) {
+        muxFlowControl(dlci, 1);
+    }
+}
+
+static void muxControlMessage(const unsigned char* msg, int len) {
+    unsigned char type;
+    int valueLen;
+    if (len < 2) {
+        return;
+    }
+    type = msg[0];
+    valueLen = msg[1] >> 1;
+    if ((type & ~MUX_CR) == MUX_MSG_CLD) {
+        mux.closed = 1;
+    }
+    else if (((type & ~MUX_CR) == MUX_MSG_MSC) && (type & MUX_CR) && (valueLen <= len - 2) && (valueLen <= 6)) {
+        // MSC command of the modem: acknowledged as is
+        muxMessage(MUX_MSG_MSC, msg + 2, valueLen);
+    }
+}
+
+static int* muxOpenState(unsigned int dlci) {
+    return dlci ? &mux.channels[dlci - 1].open : &mux.controlOpen;
+}
+
+static void muxDispatch() {
+    unsigned int dlci = mux.hdr[0] >> 2;
+    unsigned char type = (unsigned char)(mux.hdr[1] & ~MUX_PF);
+
+    if (dlci > GSM_MUX_CHANNELS) {
+        return;
+    }
+    switch (type) {
+        case MUX_UIH:
+        case MUX_UI:
+            if (dlci == 0) {
+                muxControlMessage(mux.info, mux.len);
+            }
+            else {
+                muxPush(&mux.channels[dlci - 1], dlci, mux.info, mux.len);
+            }
+            break;
+        case MUX_UA:
+            *muxOpenState(dlci) = 1;
+            break;
+        case MUX_DM:
+            *muxOpenState(dlci) = 0;
+            break;
+        case MUX_DISC:
+            *muxOpenState(dlci) = 0;
+            muxControl(dlci, MUX_UA | MUX_PF);
+            break;
+        default:
+            break;
+    }
+}
+
+static void muxParse(const unsigned char* data, int len) {
+    int i;
+    for (i = 0; i < len; i++) {
+        unsigned char c = data[i];
+        switch (mux.state) {
+            case MUX_HUNT:
+                if (c == MUX_FLAG) {
+                    mux.state = MUX_ADDR;
+                }
+                break;
+            case MUX_ADDR:
+                if (c != MUX_FLAG) {   // flags between frames
+                    mux.hdr[0] = c;
+                    mux.state = MUX_CTRL;
+                }
+                break;
+            case MUX_CTRL:
+                mux.hdr[1] = c;
+                mux.state = MUX_LEN;
+                break;
+            case MUX_LEN:
+                mux.hdr[2] = c;
+                mux.hdrLen = 3;
+                mux.len = c >> 1;
+                mux.got = 0;
+                if (!(c & MUX_EA)) {
+                    mux.state = MUX_LEN2;
+                }
+                else if (mux.len > GSM_MUX_N1) {
+                    mux.state = MUX_HUNT;
+                }
+                else {
+                    mux.state = mux.len ? MUX_INFO : MUX_FCS;
+                }
+                break;
+            case MUX_LEN2:
+                mux.hdr[3] = c;
+                mux.hdrLen = 4;
+                mux.len |= c << 7;
+                if (mux.len > GSM_MUX_N1) {
+                    mux.state = MUX_HUNT;
+                }
+                else {
+                    mux.state = mux.len ? MUX_INFO : MUX_FCS;
+                }
+                break;
+            case MUX_INFO: {
+                int n = mux.len - mux.got;
+                if (n > len - i) {
+                    n = len - i;
+                }
+                memcpy(mux.info + mux.got, data + i, n);
+                mux.got += n;
+                i += n - 1;
+                if (mux.got == mux.len) {
+                    mux.state = MUX_FCS;
+                }
+                break;
+            }
+            case MUX_FCS:
+                mux.state = (c == muxFcs(mux.hdr, mux.hdrLen)) ? MUX_END : MUX_HUNT;
+                break;
+            case MUX_END:
+                if (c == MUX_FLAG) {
+                    muxDispatch();
+                    mux.state = MUX_ADDR;
+                }
+                else {
+                    mux.state = MUX_HUNT;
+                }
+                break;
+        }
+    }
+}
+
+/* Demultiplex the bytes received on the physical line, waiting at most "timeout" for the first one */
+static void muxPoll(unsigned long timeout) {
+    unsigned char buffer[128];
+    int n = 0;
+
+    if (mux.serial->read) {
+        n = mux.serial->read((char*)buffer, sizeof(buffer), timeout);
+    }
+    else {
+        unsigned long startMillis = mux.timer->millis();
+        while (!mux.serial->available() && (mux.timer->millis() - startMillis < timeout)) {
+        }
+        while ((n < (int)sizeof(buffer)) && mux.serial->available()) {
+            buffer[n++] = (unsigned char)mux.serial->get();
+        }
+    }
+    if (n > 0) {
+        muxParse(buffer, n);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Virtual serial interfaces */
+
+static int muxCount(unsigned int dlci) {
+    if (mux.channels[dlci - 1].rxCount == 0) {
+        muxPoll(0);
+    }
+    return mux.channels[dlci - 1].rxCount;
+}
+
+static int muxRead(unsigned int dlci, char* buffer, int size, unsigned long timeout) {
+    GsmMuxChannel* ch = &mux.channels[dlci - 1];
+    unsigned long startMillis = mux.timer->millis();
+    int n = 0;
+
+    if (ch->rxCount == 0) {
+        muxPoll(0);
+    }
+    while (ch->rxCount == 0) {
+        unsigned long elapsed = mux.timer->millis() - startMillis;
+        if (elapsed >= timeout) {
+            return 0;
+        }
+        muxPoll(timeout - elapsed);
+    }
+    while ((n < size) && (ch->rxCount > 0)) {
+        int c = GSM_MUX_RX_SZ - ch->rxR;
+        if (c > ch->rxCount) {
+            c = ch->rxCount;
+        }
+        if (c > size - n) {
+            c = size - n;
+        }
+        memcpy(buffer + n, ch->rx + ch->rxR, c);
+        ch->rxR = (ch->rxR + c) % GSM_MUX_RX_SZ;
+        ch->rxCount -= c;
+        n += c;
+    }
+    if (ch->flowOff && (GSM_MUX_RX_SZ - ch->rxCount > 2 * MUX_RX_LOW)) {
+        muxFlowControl(dlci, 0);
+    }
+    return n;
+}
+
+static char muxGet(unsigned int dlci) {
+    char c;
+    if (muxRead(dlci, &c, 1, 0) != 1) {
+        return -1;
+    }
+    return c;
+}
+
+static void muxWrite(unsigned int dlci, const char* buffer, int size) {
+    SerialChunk chunk;
+    chunk.buffer = buffer;
+    chunk.size = size;
+    muxSend(dlci, &chunk, 1);
+}
+
+static void muxOpenChannel() {
+}
+
+#define GSM_MUX_CHANNEL(dlci) \
+    static int muxAvailable##dlci() { return muxCount(dlci) > 0; } \
+    static char muxGet##dlci() { return muxGet(dlci); } \
+    static void muxWrite##dlci(const char* buffer, int size) { muxWrite(dlci, buffer, size); } \
+    static int muxRead##dlci(char* buffer, int size, unsigned long timeout) { return muxRead(dlci, buffer, size, timeout); } \
+    static int muxCount##dlci() { return muxCount(dlci); } \
+    static void muxWriteChunks##dlci(const SerialChunk* chunks, int count) { muxSend(dlci, chunks, count); }
+
+#define GSM_MUX_ITF(dlci) \
+    (SerialInterface) { muxOpenChannel, muxAvailable##dlci, muxGet##dlci, muxWrite##dlci, \
+                        muxRead##dlci, muxCount##dlci, muxWriteChunks##dlci }
+
+GSM_MUX_CHANNEL(1)
+GSM_MUX_CHANNEL(2)
+
+/* ------------------------------------------------------------------------- */
+/* Public API */
+
+int GsmMux_Open(SerialInterface* serialItf, TimerInterface* timerItf) {
+    unsigned int dlci;
+
+    memset(&mux, 0, sizeof(mux));
+    mux.serial = serialItf;
+    mux.timer = timerItf;
+    mux.itf[GSM_MUX_DLCI_AT - 1] = GSM_MUX_ITF(1);
+    mux.itf[GSM_MUX_DLCI_DATA - 1] = GSM_MUX_ITF(2);
+
+    // control channel first, then the channels
+    for (dlci = 0; dlci <= GSM_MUX_CHANNELS; dlci++) {
+        unsigned long startMillis = mux.timer->millis();
+        muxControl(dlci, MUX_SABM | MUX_PF);
+        while (!*muxOpenState(dlci) && (mux.timer->millis() - startMillis < GSM_MUX_TIMEOUT_MS)) {
+            muxPoll(GSM_MUX_TIMEOUT_MS);
+        }
+        if (!*muxOpenState(dlci)) {
+            return 0;
+        }
+    }
+    mux.open = 1;
+    return 1;
+}
+
+void GsmMux_Close() {
+    unsigned long startMillis;
+    if (!mux.open) {
+        return;
+    }
+    muxMessage(MUX_MSG_CLD | MUX_CR, 0, 0);
+    for (startMillis = mux.timer->millis();
+         !mux.closed && (mux.timer->millis() - startMillis < GSM_MUX_TIMEOUT_MS);) {
+        muxPoll(GSM_MUX_TIMEOUT_MS);
+    }
+    mux.open = 0;
+}
+
+int GsmMux_IsOpen() {
+    return mux.open;
+}
+
+SerialInterface* GsmMux_Channel(unsigned int dlci) {
+    if (!mux.open || (dlci == 0) || (dlci > GSM_MUX_CHANNELS)) {
+        return 0;
+    }
+    return &mux.itf[dlci - 1];
+}
+
+unsigned long GsmMux_TakeLost() {
+    unsigned long lost = mux.lost;
+    mux.lost = 0;
+    return lost;
+}
+
+#endif // GSM_MUX_ENABLE
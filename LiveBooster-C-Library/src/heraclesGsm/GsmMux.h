@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __GsmMux_h
+#define __GsmMux_h
+
+#include "../serial/SerialInterface.h"
+#include "../timer/TimerInterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @startuml
+ *
+ * interface serial
+ *
+ * class GsmMux {
+ *    +int open (serial, timer)
+ *    +void close ()
+ *    +serial channel (dlci)
+ *    -rx : one receive ring per channel
+ * }
+ * serial "1" --o GsmMux : physical line
+ * GsmMux o-- "2" serial : virtual channels
+ *
+ * @enduml
+ */
+
+/**
+ * 3GPP TS 27.010 multiplexer (basic option) of the modem serial line.
+ *
+ * Once the modem is in multiplexer mode (AT+CMUX=0), each data link connection (DLC) is
+ * a SerialInterface of its own: AT commands on one channel, the data of a transparent
+ * connection on another one. The frames received for a channel are queued in its ring
+ * whichever channel is read, so that a long exchange on one channel does not stall the other.
+ * A channel whose ring fills up is flow controlled (MSC command) until it is read.
+ *
+ * The multiplexer takes about 3 KB of RAM (GSM_MUX_CHANNELS rings, the frame buffers):
+ * it is only built when GSM_MUX_ENABLE is set to 1.
+ */
+
+#ifndef GSM_MUX_ENABLE
+#define GSM_MUX_ENABLE  0
+#endif
+
+#define GSM_MUX_DLCI_AT    1   // AT commands and URCs
+#define GSM_MUX_DLCI_DATA  2   // transparent connection
+#define GSM_MUX_CHANNELS   2
+
+// Maximum information field length (N1), the SIM800 default
+#ifndef GSM_MUX_N1
+#define GSM_MUX_N1  127
+#endif
+
+// Receive ring of each channel (a few frames beyond the flow control threshold)
+#ifndef GSM_MUX_RX_SZ
+#define GSM_MUX_RX_SZ  1024
+#endif
+
+#if GSM_MUX_RX_SZ < 4 * GSM_MUX_N1
+#error "GSM_MUX_RX_SZ shall hold at least 4 frames of GSM_MUX_N1 bytes"
+#endif
+
+// Wait of the modem answer to a SABM / CLD (T1)
+#ifndef GSM_MUX_TIMEOUT_MS
+#define GSM_MUX_TIMEOUT_MS  1000
+#endif
+
+/**
+ * Establish the control channel and the channels 1 .. GSM_MUX_CHANNELS on "serialItf",
+ * the modem being already in multiplexer mode.
+ * Return 1 on success, else 0 (the line is left as is).
+ */
+int GsmMux_Open(SerialInterface* serialItf, TimerInterface* timerItf);
+
+/**
+ * Close down the multiplexer (CLD): the modem is back to AT commands on the physical line.
+ */
+void GsmMux_Close();
+
+/**
+ * Return 1 while the multiplexer is open.
+ */
+int GsmMux_IsOpen();
+
+/**
+ * Return the serial interface of channel "dlci" (1 .. GSM_MUX_CHANNELS), or 0.
+ */
+SerialInterface* GsmMux_Channel(unsigned int dlci);
+
+/**
+ * Return the number of received bytes dropped since the previous call, a ring being full
+ * (the modem did not honour the flow control).
+ */
+unsigned long GsmMux_TakeLost();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
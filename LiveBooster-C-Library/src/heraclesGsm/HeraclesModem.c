@@ -12,6 +12,10 @@
 
 #include "HeraclesModem.h"
 #include "HeraclesTcpClient.h"
+#include "HeraclesTransparentTcpClient.h"
+#include "AtMatcher.h"
+#include "GsmMux.h"
+#include "../traceDebug/TraceSpan.h"
 
 #define DEFAULT_TIMEOUT  10000
 
@@ -19,12 +23,41 @@
 
 #define GSM_MUX_COUNT 2
 
-typedef struct _HeraclesModem {
+// Staging buffer of the bytes read in bulk (only used when the serial interface provides read())
+#ifndef GSM_RX_STAGING_SZ
+#define GSM_RX_STAGING_SZ 128
+#endif
+
+// One serial line to the modem: the physical line, or a channel of the multiplexer
+typedef struct _GsmLine {
     SerialInterface* serial;
+    char in[GSM_RX_STAGING_SZ];          // bytes read in bulk, not yet consumed
+    int inR;
+    int inW;
+} GsmLine;
+
+typedef struct _HeraclesModem {
+    SerialInterface* serial;             // physical line
     TimerInterface* timer;
     DebugInterface* debug;
     struct _HeraclesTcpClient* sockets[GSM_MUX_COUNT];
     int prev_check;
+    struct _AtMatcher matcher;           // automaton of the responses expected by waitResponse()
+    const char* matcherResponses[5];     // responses of this automaton
+    struct _GsmLine lines[GSM_MUX_CHANNELS];
+    struct _GsmLine* line;               // line of the AT commands being sent
+    struct _GsmLine* ctrl;               // line of the AT commands and URCs
+    struct _GsmLine* data;               // line of the transparent connection (the same one without multiplexer)
+    int useMux;                          // 27.010 multiplexer requested
+    int transparent;                     // IP stack in single connection transparent mode (CIPMODE=1)
+    int dataMode;                        // the data line carries the data of the transparent connection
+    int hold;                            // command mode kept by the HTTP application
+    unsigned long lastWriteMs;           // last data written (escape sequence guard time)
+    struct _HeraclesTransparentTcpClient* link;
+    unsigned char atPending;             // an AT command waits for its first expected response
+    unsigned char atFamily;              // family of this command
+    unsigned long atStartMs;             // time it was sent
+    HeraclesModemStats stats;
 } HeraclesModem;
 
 static struct _HeraclesModem modem;
@@ -41,18 +74,180 @@ enum RegStatus {
 
 static const char* defaultReponses[5] = { "OK" GSM_NL, "ERROR" GSM_NL, 0, 0, 0 };
 
+// Pattern ids of the URCs watched by waitResponse() (after the 5 responses ids)
+#define URC_CIPRXGET  6
+#define URC_CLOSED    7   // "<mux>, CLOSED": one id per mux
+#define URC_DATA_ACCEPT  (URC_CLOSED + GSM_MUX_COUNT)       // "DATA ACCEPT:<mux>,<len>"
+#define URC_SEND_FAIL    (URC_DATA_ACCEPT + 1)              // "<mux>, SEND FAIL": one id per mux
+
+// Silence required before and after the "+++" escape sequence
+#ifndef GSM_ESCAPE_GUARD_MS
+#define GSM_ESCAPE_GUARD_MS  1000
+#endif
+
+// Period of the fallback polling of the sockets (data and close are normally notified by URC)
+#ifndef GSM_POLL_PERIOD_MS
+#define GSM_POLL_PERIOD_MS  10000
+#endif
+
+/* Make "line" the line of the next AT commands; return the previous one */
+static struct _GsmLine* selectLine(struct _GsmLine* line) {
+    struct _GsmLine* previous = modem.line;
+    modem.line = line;
+    return previous;
+}
+
+/* Return 1 if at least one received byte is available */
+static int modemAvailable() {
+    struct _GsmLine* line = modem.line;
+    if (line->inR < line->inW) {
+        return 1;
+    }
+    if (line->serial->read) {
+        int n = GSM_RX_STAGING_SZ;
+        if (line->serial->count) {
+            n = line->serial->count();
+            if (n <= 0) {
+                return 0;
+            }
+            if (n > GSM_RX_STAGING_SZ) {
+                n = GSM_RX_STAGING_SZ;
+            }
+        }
+        line->inR = 0;
+        line->inW = line->serial->read(line->in, n, 0);
+        if (line->inW < 0) {
+            line->inW = 0;
+        }
+        modem.stats.serialIn += line->inW;
+        return (line->inW > 0);
+    }
+    return line->serial->available();
+}
+
+/* Return the next received byte (to be called when modemAvailable() is true) */
+static char modemGet() {
+    struct _GsmLine* line = modem.line;
+    if ((line->inR < line->inW) || (line->serial->read && modemAvailable())) {
+        return line->in[line->inR++];
+    }
+    modem.stats.serialIn++;
+    return line->serial->get();
+}
+
+/* Read "size" bytes, waiting at most "timeout"; return the number of bytes read */
+static int modemRead(char* buffer, int size, unsigned long timeout) {
+    struct _GsmLine* line = modem.line;
+    int n = 0;
+    unsigned long startMillis = modem.timer->millis();
+
+    // Bytes already staged
+    while ((n < size) && (line->inR < line->inW)) {
+        buffer[n++] = line->in[line->inR++];
+    }
+    while ((n < size) && (modem.timer->millis() - startMillis < timeout)) {
+        if (line->serial->read) {
+            int r = line->serial->read(buffer + n, size - n, 10);
+            if (r > 0) {
+                n += r;
+                modem.stats.serialIn += r;
+            }
+        }
+        else if (line->serial->available()) {
+            buffer[n++] = line->serial->get();
+            modem.stats.serialIn++;
+        }
+        else {
+            GSM_YIELD;
+        }
+    }
+    return n;
+}
+
+/* Send the buffers in order, with one serial write when the interface allows it */
+static void modemWrite(const SerialChunk* chunks, int count) {
+    SerialInterface* serial = modem.line->serial;
+    int i;
+    for (i = 0; i < count; i++) {
+        modem.stats.serialOut += chunks[i].size;
+    }
+    if (serial->writeChunks) {
+        serial->writeChunks(chunks, count);
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        serial->write(chunks[i].buffer, chunks[i].size);
+    }
+}
+
+/* Family of an AT command, from its format */
+static unsigned char atFamily(const char* cmd) {
+    if (!strncmp(cmd, "+CIP", 4)) {
+        cmd += 4;
+        if (!strncmp(cmd, "SEND", 4)) {
+            return AT_FAMILY_CIPSEND;
+        }
+        if (!strncmp(cmd, "RXGET", 5)) {
+            return AT_FAMILY_CIPRXGET;
+        }
+        if (!strncmp(cmd, "STATUS", 6)) {
+            return AT_FAMILY_CIPSTATUS;
+        }
+        if (!strncmp(cmd, "START", 5) || !strncmp(cmd, "CLOSE", 5) || !strncmp(cmd, "SSL", 3)) {
+            return AT_FAMILY_SOCKET;
+        }
+    }
+    else if (!strncmp(cmd, "+SSLOPT", 7)) {
+        return AT_FAMILY_SOCKET;
+    }
+    else if (!strncmp(cmd, "+HTTP", 5)) {
+        return AT_FAMILY_HTTP;
+    }
+    return AT_FAMILY_OTHER;
+}
+
+/* End of the round trip of the pending AT command: "responded", or timed out */
+static void atDone(int responded) {
+    if (!modem.atPending) {
+        return;
+    }
+    modem.atPending = 0;
+    if (responded) {
+        StatsHistogram_Add(&modem.stats.rtt[modem.atFamily], modem.timer->millis() - modem.atStartMs);
+    }
+    else {
+        modem.stats.timeouts[modem.atFamily]++;
+    }
+}
+
 void HeraclesModem__sendAT(const char * cmdFormat, ...) {
     char buffer[128];
+    int len;
 
     va_list ap;
 
+    if (modem.dataMode && (modem.line == modem.data)) {
+        HeraclesModem__Escape();
+    }
+
+    // "AT<command>\r\n" in one serial write
+    buffer[0] = 'A';
+    buffer[1] = 'T';
     va_start(ap, cmdFormat);
-    vsprintf(buffer, cmdFormat, ap);
+    len = 2 + vsnprintf(buffer + 2, sizeof(buffer) - 2 - strlen(GSM_NL), cmdFormat, ap);
     va_end(ap);
+    if (len > (int)(sizeof(buffer) - strlen(GSM_NL) - 1)) {
+        len = sizeof(buffer) - strlen(GSM_NL) - 1;
+    }
+    memcpy(buffer + len, GSM_NL, strlen(GSM_NL));
+    len += strlen(GSM_NL);
 
-    modem.serial->write("AT", 2);
-    modem.serial->write(buffer, strlen(buffer));
-    modem.serial->write(GSM_NL, strlen(GSM_NL));
+    modem.atFamily = atFamily(cmdFormat);
+    modem.atPending = 1;
+    modem.stats.commands[modem.atFamily]++;
+    modem.stats.serialOut += len;
+    modem.atStartMs = modem.timer->millis();
+    modem.line->serial->write(buffer, len);
 
     GSM_YIELD;
 }
@@ -63,18 +258,18 @@ int HeraclesModem__readInt() {
     char buffer[9];
     char *bufptr = buffer;
 
-    while (!modem.serial->available()) {
+    while (!modemAvailable()) {
         GSM_YIELD;
     }
-    char c = modem.serial->get();
+    char c = modemGet();
 
     while (((signed char)c >= 0) && (c != ',') && (c != '\n') && (bufptr < buffer + sizeof(buffer)-1)) {
         *bufptr++ = c;
 
-        while (!modem.serial->available()) {
+        while (!modemAvailable()) {
             GSM_YIELD;
         }
-        c = modem.serial->get();
+        c = modemGet();
    }
     *bufptr = 0;
 
@@ -84,11 +279,9 @@ int HeraclesModem__readInt() {
 }
 
 unsigned int waitResponse(unsigned long timeout, unsigned int numResponses, ...) {
-    char dataBuffer[100];
-    char *data = dataBuffer;
-
     unsigned int i;
     const char *responses[5];
+    int urcOnly = 1;
 
     va_list ap;
     va_start(ap, numResponses);
@@ -99,55 +292,109 @@ unsigned int waitResponse(unsigned long timeout, unsigned int numResponses, ...)
     for (; i < 5; i++) {
         responses[i] = defaultReponses[i];
     }
+    for (i = 0; i < 5; i++) {
+        urcOnly = urcOnly && !responses[i];
+    }
+
+    // Responses are string constants: the automaton is only rebuilt when the expected set changes
+    if (memcmp(modem.matcherResponses, responses, sizeof(responses)) != 0) {
+        int added = 1;
+        memcpy(modem.matcherResponses, responses, sizeof(responses));
+        AtMatcher_Init(&modem.matcher);
+        for (i = 0; i < 5; i++) {
+            if (responses[i]) {
+                added &= AtMatcher_Add(&modem.matcher, responses[i], (unsigned char)(i + 1));
+            }
+        }
+        added &= AtMatcher_Add(&modem.matcher, "+CIPRXGET: 1,", URC_CIPRXGET);
+        added &= AtMatcher_Add(&modem.matcher, "DATA ACCEPT:", URC_DATA_ACCEPT);
+        for (i = 0; i < GSM_MUX_COUNT; i++) {
+            char closed[] = "0, CLOSED" GSM_NL;
+            char sendFail[] = "0, SEND FAIL" GSM_NL;
+            closed[0] += i;
+            sendFail[0] += i;
+            added &= AtMatcher_Add(&modem.matcher, closed, (unsigned char)(URC_CLOSED + i));
+            added &= AtMatcher_Add(&modem.matcher, sendFail, (unsigned char)(URC_SEND_FAIL + i));
+        }
+        AtMatcher_Build(&modem.matcher);
+        if (!added) {
+            // a response could never be matched: fail instead of waiting for it
+            modem.debug->print("Expected AT responses larger than AT_MATCHER_MAX_STATES\n");
+            memset(modem.matcherResponses, 0, sizeof(modem.matcherResponses));
+            atDone(0);
+            return 0;
+        }
+    }
+    AtMatcher_Reset(&modem.matcher);
 
     unsigned long startMillis = modem.timer->millis();
     do {
         GSM_YIELD;
-        while (modem.serial->available() > 0) {
-            char a = modem.serial->get();
-            if (a <= 0) {
-                continue; // Skip 0x00 bytes, just in case
-            }
-            // robustness on dataBuffer
-            if (strlen(dataBuffer) == sizeof(dataBuffer)) {
-               data = dataBuffer;
-            }
-
-            *data++ = a;
-            *data = 0;
-            if (responses[0] && (strstr(dataBuffer, responses[0]) != 0)) {
-               return 1;
+        while (modemAvailable()) {
+            int id;
+            struct _GsmLine* line = modem.line;
+            if (line->inR < line->inW) {
+                // bulk: the bytes following the match stay staged for the caller
+                int used;
+                id = AtMatcher_Feed(&modem.matcher, &line->in[line->inR], line->inW - line->inR, &used);
+                line->inR += used;
             }
-            else if (responses[1] && (strstr(dataBuffer, responses[1]) != 0)) {
-                return 2;
+            else {
+                char a = line->serial->get();
+                modem.stats.serialIn++;
+                id = AtMatcher_Feed(&modem.matcher, &a, 1, 0);
             }
-            else if (responses[2] && (strstr(dataBuffer, responses[2]) != 0)) {
-                return 3;
-            }
-            else if (responses[3] && (strstr(dataBuffer, responses[3]) != 0)) {
-                return 4;
+            if (id == URC_CIPRXGET) {
+                // "+CIPRXGET: 1,<mux>": data received, amount given by the next AT+CIPRXGET=2
+                int mux = HeraclesModem__readInt();
+                if (mux >= 0 && mux < GSM_MUX_COUNT && modem.sockets[mux]
+                        && (modem.sockets[mux]->sock_available <= 0)) {
+                    modem.sockets[mux]->sock_available = 1;
+                }
+                AtMatcher_Reset(&modem.matcher);
             }
-            else if (responses[4] && (strstr(dataBuffer, responses[4]) != 0)) {
-                return 5;
+            else if (id == URC_DATA_ACCEPT) {
+                // "DATA ACCEPT:<mux>,<len>": a pipelined AT+CIPSEND was accepted
+                int mux = HeraclesModem__readInt();
+                HeraclesModem__readInt();
+                if (mux >= 0 && mux < GSM_MUX_COUNT && modem.sockets[mux]
+                        && (modem.sockets[mux]->send_pending > 0)) {
+                    modem.sockets[mux]->send_pending--;
+                }
+                AtMatcher_Reset(&modem.matcher);
             }
-            else if (strstr(dataBuffer, "+CIPRXGET:" GSM_NL) != 0) {
-                int mode = HeraclesModem__readInt();
-                if (mode == 1) {
-                    int mux = HeraclesModem__readInt();
-                    if (mux >= 0 && mux < GSM_MUX_COUNT && modem.sockets[mux]) {
-                    	modem.prev_check = 0;
+            else if (id >= URC_SEND_FAIL) {
+                // "<mux>, SEND FAIL": reported by the next write
+                int mux = id - URC_SEND_FAIL;
+                if (modem.sockets[mux]) {
+                    if (modem.sockets[mux]->send_pending > 0) {
+                        modem.sockets[mux]->send_pending--;
                     }
-                    data = dataBuffer;
-                    *data = 0;
+                    modem.sockets[mux]->send_failed = 1;
+                }
+                AtMatcher_Reset(&modem.matcher);
+            }
+            else if (id >= URC_CLOSED) {
+                // "<mux>, CLOSED": connection closed by the remote peer
+                int mux = id - URC_CLOSED;
+                if (modem.sockets[mux]) {
+                    modem.sockets[mux]->sock_connected = 0;
+                    modem.sockets[mux]->sock_available = 0;
+                    modem.sockets[mux]->send_pending = 0;
                 }
+                AtMatcher_Reset(&modem.matcher);
             }
-            else if (strstr(dataBuffer, "CLOSED" GSM_NL) != 0) {
-                data = dataBuffer;
-                *data = 0;
+            else if (id) {
+                atDone(1);
+                return id;
             }
         }
+        if (urcOnly && AtMatcher_Idle(&modem.matcher)) {
+            return 0;   // no response expected: done once the received URCs are handled
+        }
     } while (modem.timer->millis() - startMillis < timeout);
 
+    atDone(0);
     return 0;
 }
 
@@ -190,10 +437,10 @@ enum SimStatus getSimStatus(unsigned long timeout) {
 void streamSkipUntil(const char terminator) {
     unsigned long startMillis = modem.timer->millis();
 	while (modem.timer->millis() - startMillis < DEFAULT_TIMEOUT) {
-        while (!modem.serial->available()) {
+        while (!modemAvailable()) {
             GSM_YIELD;
         }
-        if (modem.serial->get() == terminator) {
+        if (modemGet() == terminator) {
             break;
         }
     }
@@ -226,6 +473,84 @@ int waitForNetwork() {
     return 0;
 }
 
+/* Configure the IP application: multiple connections read manually, or a single transparent connection */
+int setupIpStack(int transparent) {
+
+    // Set mode TCP
+    HeraclesModem__sendAT("+CIPMODE=%d", transparent);
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+
+    // Set to multiple-IP (single IP in transparent mode)
+    HeraclesModem__sendAT("+CIPMUX=%d", !transparent);
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+
+    if (!transparent) {
+        // Put in "quick send" mode (thus no extra "Send OK")
+        HeraclesModem__sendAT("+CIPQSEND=1");
+        if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+            return 0;
+        }
+    }
+
+    // Set to get data manually (pushed on the line in transparent mode)
+    HeraclesModem__sendAT("+CIPRXGET=%d", !transparent);
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+
+    // Default configuration for Heracles board: just AT+CSTT
+    HeraclesModem__sendAT("+CSTT");
+    if (waitResponse(60000, 0) != 1) {
+        return 0;
+    }
+
+    // Bring Up Wireless Connection with GPRS or CSD
+    HeraclesModem__sendAT("+CIICR");
+    if (waitResponse(60000, 0) != 1) {
+        return 0;
+    }
+
+    // Get Local IP Address, only assigned after connection
+    HeraclesModem__sendAT("+CIFSR;E0");
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+
+    modem.transparent = transparent;
+    return 1;
+}
+
+/* Shut the current connections down and reconfigure the IP application if needed */
+int switchIpStack(int transparent) {
+    unsigned int mux;
+
+    if (modem.transparent == transparent) {
+        return 1;
+    }
+
+    HeraclesModem__sendAT("+CIPSHUT");
+    if (waitResponse(DEFAULT_TIMEOUT, 1, "SHUT OK" GSM_NL) != 1) {
+        return 0;
+    }
+    for (mux = 0; mux < GSM_MUX_COUNT; mux++) {
+        if (modem.sockets[mux]) {
+            modem.sockets[mux]->sock_connected = 0;
+            modem.sockets[mux]->sock_available = 0;
+            modem.sockets[mux]->send_pending = 0;
+            modem.sockets[mux] = 0;
+        }
+    }
+    if (modem.link) {
+        modem.link->sock_connected = 0;
+        modem.link = 0;
+    }
+    return setupIpStack(transparent);
+}
+
 int attachGPRS() {
 
     // Set the connection type to GPRS
@@ -252,54 +577,71 @@ int attachGPRS() {
         return 0;
     }
 
-    // Set mode TCP
-    HeraclesModem__sendAT("+CIPMODE=0");
-    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+    if (setupIpStack(0) != 1) {
         return 0;
     }
 
-    // Set to multiple-IP
-    HeraclesModem__sendAT("+CIPMUX=1");
+    // Configure Domain Name Server (DNS)
+    HeraclesModem__sendAT("+CDNSCFG=\"8.8.8.8\",\"8.8.4.4\"");
     if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
         return 0;
     }
 
-    // Put in "quick send" mode (thus no extra "Send OK")
-    HeraclesModem__sendAT("+CIPQSEND=1");
-    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
-        return 0;
-    }
+    return 1;
+}
+
+/* AT commands and data on the physical line */
+static void useSingleLine() {
+    memset(modem.lines, 0, sizeof(modem.lines));
+    modem.lines[0].serial = modem.serial;
+    modem.ctrl = &modem.lines[0];
+    modem.data = &modem.lines[0];
+    modem.line = modem.ctrl;
+}
 
-    // Set to get data manually
-    HeraclesModem__sendAT("+CIPRXGET=1");
+#if GSM_MUX_ENABLE
+/* Switch to the 27.010 multiplexer: AT commands on one channel, transparent connection on another */
+static int startMux() {
+    HeraclesModem__sendAT("+CMUX=0");
     if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
         return 0;
     }
-
-    // Default configuration for Heracles board: just AT+CSTT
-    HeraclesModem__sendAT("+CSTT");
-    if (waitResponse(60000, 0) != 1) {
+    if (!GsmMux_Open(modem.serial, modem.timer)) {
         return 0;
     }
+    memset(modem.lines, 0, sizeof(modem.lines));
+    modem.lines[0].serial = GsmMux_Channel(GSM_MUX_DLCI_AT);
+    modem.lines[1].serial = GsmMux_Channel(GSM_MUX_DLCI_DATA);
+    modem.ctrl = &modem.lines[0];
+    modem.data = &modem.lines[1];
+    modem.line = modem.ctrl;
+    return testAT(DEFAULT_TIMEOUT);
+}
 
-    // Bring Up Wireless Connection with GPRS or CSD
-    HeraclesModem__sendAT("+CIICR");
-    if (waitResponse(60000, 0) != 1) {
-        return 0;
+static void stopMux() {
+    if (GsmMux_IsOpen()) {
+        modem.stats.muxLost += GsmMux_TakeLost();
+        GsmMux_Close();
     }
+    useSingleLine();
+}
+#else
+static int startMux() {
+    return 0;
+}
 
-    // Get Local IP Address, only assigned after connection
-    HeraclesModem__sendAT("+CIFSR;E0");
-    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
-        return 0;
-    }
+static void stopMux() {
+    useSingleLine();
+}
+#endif
 
-    // Configure Domain Name Server (DNS)
-    HeraclesModem__sendAT("+CDNSCFG=\"8.8.8.8\",\"8.8.4.4\"");
-    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+int HeraclesModem__SetMultiplexing(int enable) {
+#if !GSM_MUX_ENABLE
+    if (enable) {
         return 0;
     }
-
+#endif
+    modem.useMux = enable;
     return 1;
 }
 
@@ -317,6 +659,11 @@ int HeraclesModem__Init(SerialInterface* serialItf, TimerInterface* timerItf, De
     modem.timer->timerInit();
     modem.debug->print("Timer interface initialized\n");
 
+    // The modem reset leaves the multiplexer mode
+    if (doReset || !modem.line) {
+        stopMux();
+    }
+
     if (!testAT(DEFAULT_TIMEOUT)) {
         return 0;
     }
@@ -325,6 +672,10 @@ int HeraclesModem__Init(SerialInterface* serialItf, TimerInterface* timerItf, De
     	modem.debug->print("Reset Heracles modem\n");
 
     	memset(modem.sockets, 0, sizeof(modem.sockets));
+    	modem.link = 0;
+    	modem.transparent = 0;
+    	modem.dataMode = 0;
+    	modem.hold = 0;
 
         HeraclesModem__sendAT("+CFUN=0");
         if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
@@ -360,6 +711,10 @@ int HeraclesModem__Init(SerialInterface* serialItf, TimerInterface* timerItf, De
         if (attachGPRS() != 1) {
             return 0;
         }
+
+        if (modem.useMux && (startMux() != 1)) {
+            return 0;
+        }
     }
 
     return 1; // Success
@@ -377,8 +732,7 @@ unsigned int modemGetAvailable(unsigned int mux) {
     HeraclesModem__sendAT("+CIPRXGET=4,%d", mux);
 
     unsigned int result = 0;
-    if (waitResponse(DEFAULT_TIMEOUT, 1, "+CIPRXGET:") == 1) {
-        streamSkipUntil(','); // Skip mode 4
+    if (waitResponse(DEFAULT_TIMEOUT, 1, "+CIPRXGET: 4,") == 1) {
         streamSkipUntil(','); // Skip mux
         result = HeraclesModem__readInt();
         waitResponse(DEFAULT_TIMEOUT, 0);
@@ -391,7 +745,11 @@ unsigned int modemGetAvailable(unsigned int mux) {
 
 void HeraclesModem__Maintain() {
     unsigned int mux;
-    if (modem.timer->millis() - modem.prev_check > 500) {
+    if (modem.dataMode && (modem.ctrl == modem.data)) {
+        return; // the received bytes belong to the transparent connection
+    }
+    // Fallback only: incoming data and closing are signaled by URCs, consumed below
+    if (modem.timer->millis() - modem.prev_check > GSM_POLL_PERIOD_MS) {
         modem.prev_check = modem.timer->millis();
         for (mux = 0; mux < GSM_MUX_COUNT; mux++) {
             struct _HeraclesTcpClient* sock = modem.sockets[mux];
@@ -401,7 +759,7 @@ void HeraclesModem__Maintain() {
         }
     }
 
-    while (modem.serial->available()) {
+    while (modemAvailable()) {
         waitResponse(10, 2, 0, 0);
     }
 }
@@ -422,8 +780,14 @@ int HeraclesModem__Connect(struct _HeraclesTcpClient* client,
 		}
 	}
 
+	if ((*mux != INVALID_MUX) && (switchIpStack(0) != 1)) {
+		*mux = INVALID_MUX;
+	}
+
 	if (*mux != INVALID_MUX) {
 		modem.sockets[*mux] = client;
+		client->send_pending = 0;
+		client->send_failed = 0;
 
 		HeraclesModem__sendAT("+SSLOPT=0,0"); // enable root certificate
 		int rsp = waitResponse(DEFAULT_TIMEOUT, 0);
@@ -448,6 +812,7 @@ int HeraclesModem__Connect(struct _HeraclesTcpClient* client,
 }
 
 void HeraclesModem__Disconnect(unsigned int mux) {
+    HeraclesModem__Flush(mux);
     HeraclesModem__sendAT("+CIPCLOSE=%d", mux);
     waitResponse(DEFAULT_TIMEOUT, 0);
 
@@ -455,37 +820,381 @@ void HeraclesModem__Disconnect(unsigned int mux) {
 }
 
 int HeraclesModem__Send(const unsigned char* buff, int len, unsigned int mux) {
+    SerialChunk chunk;
+    chunk.buffer = (const char*)buff;
+    chunk.size = len;
+    return HeraclesModem__SendChunks(&chunk, 1, mux);
+}
+
+/* Wait until at most "window" sends of "sock" are pending; return 0 on timeout or connection loss */
+static int waitSendWindow(struct _HeraclesTcpClient* sock, int window) {
+    unsigned long startMillis;
+    if (sock->send_pending <= window) {
+        return 1;
+    }
+    TRACE_SPAN_BEGIN("DATA ACCEPT");
+    startMillis = modem.timer->millis();
+    while (sock->send_pending > window) {
+        if (!sock->sock_connected || (modem.timer->millis() - startMillis > DEFAULT_TIMEOUT)) {
+            sock->send_pending = 0;
+            TRACE_SPAN_END("DATA ACCEPT");
+            return 0;
+        }
+        if (modemAvailable()) {
+            waitResponse(10, 2, 0, 0);   // URCs only
+        }
+        else {
+            modem.timer->delay(1);
+        }
+    }
+    TRACE_SPAN_END("DATA ACCEPT");
+    return 1;
+}
+
+int HeraclesModem__Flush(unsigned int mux) {
+    struct _HeraclesTcpClient* sock = (mux < GSM_MUX_COUNT) ? modem.sockets[mux] : 0;
+    if (!sock) {
+        return 0;
+    }
+    return waitSendWindow(sock, 0) && !sock->send_failed;
+}
+
+int HeraclesModem__SendChunks(const SerialChunk* chunks, int count, unsigned int mux) {
+    struct _HeraclesTcpClient* sock = (mux < GSM_MUX_COUNT) ? modem.sockets[mux] : 0;
+    int i;
+    int len = 0;
+
+    if (!sock || sock->send_failed) {
+        return -1;
+    }
+    // Room for this send in the window
+    if (!waitSendWindow(sock, (GSM_SEND_WINDOW > 0) ? GSM_SEND_WINDOW - 1 : 0)) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        len += chunks[i].size;
+    }
+    TRACE_SPAN_BEGIN("AT+CIPSEND");
     HeraclesModem__sendAT("+CIPSEND=%d,%d", mux, len);
     if (waitResponse(DEFAULT_TIMEOUT, 1, ">") != 1) {
+        TRACE_SPAN_END("AT+CIPSEND");
         return -1;
     }
-    modem.serial->write((const char*)buff, len);
-    if (waitResponse(DEFAULT_TIMEOUT, 1, "DATA ACCEPT:") != 1) {
-    	return -1;
+    modemWrite(chunks, count);
+    TRACE_SPAN_END("AT+CIPSEND");
+    modem.stats.sentBytes += len;
+    sock->send_pending++;   // "DATA ACCEPT" is consumed as an URC
+    if ((GSM_SEND_WINDOW == 0) && !waitSendWindow(sock, 0)) {
+        return -1;
     }
-    streamSkipUntil(','); // Skip mux
-    return  HeraclesModem__readInt();
+    return sock->send_failed ? -1 : len;
 }
 
-int HeraclesModem__Read(int size, unsigned int mux) {
-    int i;
+int HeraclesModem__Read(unsigned char* buffer, int room, int size, unsigned int mux) {
+    char overflow[FIFO_SIZE];
+    int n;
+    if (size > GSM_MAX_RXGET) {
+        size = GSM_MAX_RXGET;
+    }
+    TRACE_SPAN_BEGIN("AT+CIPRXGET");
     HeraclesModem__sendAT("+CIPRXGET=2,%d,%d", mux, size);
-    if (waitResponse(DEFAULT_TIMEOUT, 1, "+CIPRXGET:") != 1) {
+    if (waitResponse(DEFAULT_TIMEOUT, 1, "+CIPRXGET: 2,") != 1) {
+        modem.sockets[mux]->sock_available = 0;
+        TRACE_SPAN_END("AT+CIPRXGET");
         return 0;
     }
 
-    streamSkipUntil(','); // Skip mode 2
     streamSkipUntil(','); // Skip mux
     int len = HeraclesModem__readInt();
     modem.sockets[mux]->sock_available = HeraclesModem__readInt();
 
-    for (i = 0; i < len; i++) {
-        while (!modem.serial->available()) {
+    // The payload lands in the caller buffer, the FIFO only gets the overflow
+    if (room > len) {
+        room = len;
+    }
+    n = modemRead((char*)buffer, room, DEFAULT_TIMEOUT);
+    if (n == room) {
+        int left = len - room;
+        while (left > 0) {
+            int chunk = (left < (int)sizeof(overflow)) ? left : (int)sizeof(overflow);
+            int r = modemRead(overflow, chunk, DEFAULT_TIMEOUT);
+            GsmFifo_Write(&modem.sockets[mux]->rx, (const unsigned char*)overflow, r);
+            if (r < chunk) {
+                break;
+            }
+            left -= r;
+        }
+    }
+    waitResponse(DEFAULT_TIMEOUT, 0);
+    TRACE_SPAN_END("AT+CIPRXGET");
+    modem.stats.receivedBytes += n;
+    return n;
+}
+
+int HeraclesModem__ConnectTransparent(struct _HeraclesTransparentTcpClient* const client,
+                                      const char* host,
+                                      unsigned short port,
+                                      unsigned int sslEnabled) {
+    struct _GsmLine* previous;
+    int rsp;
+
+    if (switchIpStack(1) != 1) {
+        return 0;
+    }
+    if (modem.link) {
+        HeraclesModem__DisconnectTransparent();
+    }
+
+    HeraclesModem__sendAT("+SSLOPT=0,0"); // enable root certificate
+    waitResponse(DEFAULT_TIMEOUT, 0);
+
+    HeraclesModem__sendAT("+SSLOPT=1,1"); // enable client authentication
+    waitResponse(DEFAULT_TIMEOUT, 0);
+
+    HeraclesModem__sendAT("+CIPSSL=%d", sslEnabled);
+    rsp = waitResponse(DEFAULT_TIMEOUT, 0);
+    if (sslEnabled && (rsp != 1)) {
+        return 0;
+    }
+
+    // The line of the command is the one switched to data mode
+    previous = selectLine(modem.data);
+    HeraclesModem__sendAT("+CIPSTART=\"TCP\",\"%s\",%d", host, port);
+    rsp = waitResponse(75000, 5, "CONNECT" GSM_NL, "CONNECT FAIL" GSM_NL, "ALREADY CONNECT" GSM_NL,
+            "ERROR" GSM_NL, "CLOSE OK" GSM_NL);
+    selectLine(previous);
+    if (rsp != 1) {
+        return 0;
+    }
+
+    // From now on, the data line is a raw pipe to host:port
+    client->rxLen = 0;
+    client->rxPos = 0;
+    modem.link = client;
+    modem.dataMode = 1;
+    modem.lastWriteMs = modem.timer->millis();
+    return 1;
+}
+
+// Close the transparent connection, the line being in command mode
+static void closeTransparent() {
+    HeraclesModem__sendAT("+CIPCLOSE");
+    waitResponse(DEFAULT_TIMEOUT, 2, "CLOSE OK" GSM_NL, "ERROR" GSM_NL);
+    modem.dataMode = 0;
+    modem.link->sock_connected = 0;
+    modem.link = 0;
+}
+
+void HeraclesModem__DisconnectTransparent() {
+    if (modem.link && modem.dataMode && (modem.line == modem.data)) {
+        HeraclesModem__Escape();   // closes the connection itself when data was lost
+    }
+    if (modem.link) {
+        closeTransparent();
+    }
+}
+
+int HeraclesModem__Escape() {
+    static const char okLine[] = GSM_NL "OK" GSM_NL;
+    char window[sizeof(okLine) - 1];
+    unsigned long windowMs[sizeof(okLine) - 1];
+    int windowLen = 0;
+    int lost = 0;
+    int rsp = 0;
+    unsigned long startMillis;
+    unsigned long escapeMs;
+    struct _HeraclesTransparentTcpClient* link = modem.link;
+    struct _GsmLine* previous;
+
+    if (!modem.dataMode) {
+        return 1;
+    }
+    previous = selectLine(modem.data);
+
+    // "+++" must be surrounded by silences on the line
+    while (modem.timer->millis() - modem.lastWriteMs < GSM_ESCAPE_GUARD_MS) {
+        modem.timer->delay(GSM_ESCAPE_GUARD_MS - (modem.timer->millis() - modem.lastWriteMs));
+    }
+    modem.line->serial->write("+++", 3);
+    modem.stats.serialOut += 3;
+    modem.dataMode = 0;
+    escapeMs = modem.timer->millis();
+
+    // The data received until "OK" still belongs to the connection: keep it for the client.
+    // The modem answers only once the guard time after "+++" has passed: an "OK" line received before
+    // is connection data.
+    startMillis = escapeMs;
+    while (modem.timer->millis() - startMillis < 2 * GSM_ESCAPE_GUARD_MS + DEFAULT_TIMEOUT) {
+        if (!modemAvailable()) {
             GSM_YIELD;
+            continue;
+        }
+        if (windowLen == sizeof(window)) {
+            if (link && (link->rxLen < (int)sizeof(link->rx))) {
+                link->rx[link->rxLen++] = (unsigned char)window[0];
+            }
+            else {
+                lost = 1;
+            }
+            memmove(window, window + 1, sizeof(window) - 1);
+            memmove(windowMs, windowMs + 1, sizeof(windowMs) - sizeof(windowMs[0]));
+            windowLen--;
         }
-        char c = modem.serial->get();
-        GsmFifo_Put(&modem.sockets[mux]->rx, c);
+        windowMs[windowLen] = modem.timer->millis();
+        window[windowLen++] = modemGet();
+        if ((windowLen == sizeof(window)) && (windowMs[0] - escapeMs >= GSM_ESCAPE_GUARD_MS)
+                && !memcmp(window, okLine, sizeof(window))) {
+            rsp = 1;
+            break;
+        }
+    }
+    // No answer: the line is assumed in command mode anyway, the bytes still in the window are data.
+    if (!rsp && link && windowLen > 0) {
+        if (link->rxLen + windowLen <= (int)sizeof(link->rx)) {
+            memcpy(link->rx + link->rxLen, window, windowLen);
+            link->rxLen += windowLen;
+        }
+        else {
+            lost = 1;
+        }
+    }
+    // Data lost (client buffer full): the stream of the connection is broken, close it.
+    if (lost && link) {
+        modem.debug->print("Data lost on escape, connection closed\n");
+        closeTransparent();
+        rsp = 0;
+    }
+    selectLine(previous);
+    return rsp;
+}
+
+int HeraclesModem__Resume() {
+    struct _GsmLine* previous;
+    int rsp;
+    if (modem.dataMode) {
+        return 1;
+    }
+    if (!modem.link) {
+        return 0;
+    }
+    previous = selectLine(modem.data);
+    HeraclesModem__sendAT("O");
+    rsp = waitResponse(DEFAULT_TIMEOUT, 3, "CONNECT" GSM_NL, "NO CARRIER" GSM_NL, "ERROR" GSM_NL);
+    selectLine(previous);
+    if (rsp != 1) {
+        modem.link->sock_connected = 0;
+        modem.link = 0;
+        return 0;
+    }
+    modem.dataMode = 1;
+    modem.lastWriteMs = modem.timer->millis();
+    return 1;
+}
+
+int HeraclesModem__IsDataMode() {
+    return modem.dataMode;
+}
+
+int HeraclesModem__IsHeld() {
+    return modem.hold;
+}
+
+int HeraclesModem__RawAvailable() {
+    struct _GsmLine* previous;
+    int available;
+    if (!modem.dataMode) {
+        return 0;
+    }
+    previous = selectLine(modem.data);
+    available = modemAvailable();
+    selectLine(previous);
+    return available;
+}
+
+int HeraclesModem__RawRead(unsigned char* buffer, int size, unsigned long timeout) {
+    struct _GsmLine* previous = selectLine(modem.data);
+    int n = modemRead((char*)buffer, size, timeout);
+    selectLine(previous);
+    return n;
+}
+
+void HeraclesModem__RawWrite(const SerialChunk* chunks, int count) {
+    struct _GsmLine* previous = selectLine(modem.data);
+    modemWrite(chunks, count);
+    selectLine(previous);
+    modem.lastWriteMs = modem.timer->millis();
+}
+
+/*
+ * HTTP application of the modem: it runs in command mode, beside a transparent connection left open
+ * (in data mode on its own channel when the multiplexer is used).
+ */
+
+int HeraclesModem__HttpGet(const char* url, int* status, unsigned long* length) {
+    modem.hold = 1;
+
+    HeraclesModem__sendAT("+HTTPTERM");  // in case of a previous session
+    waitResponse(DEFAULT_TIMEOUT, 0);
+
+    HeraclesModem__sendAT("+HTTPINIT");
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+    HeraclesModem__sendAT("+HTTPPARA=\"CID\",1");
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+    HeraclesModem__sendAT("+HTTPPARA=\"URL\",\"%s\"", url);
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+    HeraclesModem__sendAT("+HTTPACTION=0");
+    if (waitResponse(DEFAULT_TIMEOUT, 0) != 1) {
+        return 0;
+    }
+    // "+HTTPACTION: <method>,<status>,<length>" once the response is received
+    if (waitResponse(120000, 1, "+HTTPACTION:") != 1) {
+        return 0;
+    }
+    streamSkipUntil(','); // Skip method
+    *status = HeraclesModem__readInt();
+    *length = (unsigned long)HeraclesModem__readInt();
+    return 1;
+}
+
+int HeraclesModem__HttpRead(unsigned long offset, unsigned char* buffer, int size) {
+    int len;
+    int n;
+
+    HeraclesModem__sendAT("+HTTPREAD=%lu,%d", offset, size);
+    if (waitResponse(DEFAULT_TIMEOUT, 1, "+HTTPREAD:") != 1) {
+        return -1;
     }
+    len = HeraclesModem__readInt();
+    if (len > size) {
+        return -1;
+    }
+    n = modemRead((char*)buffer, len, DEFAULT_TIMEOUT);
+    waitResponse(DEFAULT_TIMEOUT, 0);
+    return n;
+}
+
+void HeraclesModem__HttpTerm() {
+    HeraclesModem__sendAT("+HTTPTERM");
     waitResponse(DEFAULT_TIMEOUT, 0);
-    return len;
+    modem.hold = 0;
+}
+
+void HeraclesModem__GetStats(HeraclesModemStats* stats) {
+#if GSM_MUX_ENABLE
+    modem.stats.muxLost += GsmMux_TakeLost();
+#endif
+    *stats = modem.stats;
+}
+
+void HeraclesModem__ResetStats() {
+#if GSM_MUX_ENABLE
+    GsmMux_TakeLost();
+#endif
+    memset(&modem.stats, 0, sizeof(modem.stats));
 }
@@ -13,6 +13,7 @@
 #include "../timer/TimerInterface.h"
 #include "../traceDebug/DebugInterface.h"
 #include "HeraclesTcpClient.h"
+#include "../stats/StatsHistogram.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,12 +21,59 @@ extern "C" {
 
 #define INVALID_MUX  255
 
+struct _HeraclesTransparentTcpClient;
+
+// AT+CIPSEND which may wait for their "DATA ACCEPT" when HeraclesModem__Send() returns
+// (0: each send waits for its acceptance)
+#ifndef GSM_SEND_WINDOW
+#define GSM_SEND_WINDOW  4
+#endif
+
+// Largest payload of one AT+CIPSEND
+#ifndef GSM_MAX_SEND
+#define GSM_MAX_SEND  1460
+#endif
+
+// Largest payload returned by one AT+CIPRXGET=2
+#ifndef GSM_MAX_RXGET
+#define GSM_MAX_RXGET  1460
+#endif
+
+// Families of AT commands of the statistics
+enum AtFamily {
+    AT_FAMILY_OTHER = 0,     // initialization, network registration...
+    AT_FAMILY_CIPSEND,       // AT+CIPSEND
+    AT_FAMILY_CIPRXGET,      // AT+CIPRXGET
+    AT_FAMILY_CIPSTATUS,     // AT+CIPSTATUS
+    AT_FAMILY_SOCKET,        // AT+CIPSTART, AT+CIPCLOSE, AT+CIPSSL, AT+SSLOPT
+    AT_FAMILY_HTTP,          // AT+HTTP...
+    AT_FAMILY_COUNT
+};
+
+typedef struct _HeraclesModemStats {
+    unsigned long commands[AT_FAMILY_COUNT];   // AT commands sent
+    unsigned long timeouts[AT_FAMILY_COUNT];   // without any of the expected responses
+    StatsHistogram rtt[AT_FAMILY_COUNT];       // ms from the command to its first expected response
+    unsigned long sentBytes;                   // payload of the AT+CIPSEND
+    unsigned long receivedBytes;               // payload of the AT+CIPRXGET=2
+    unsigned long serialOut;                   // bytes written to the modem (without the 27.010 framing)
+    unsigned long serialIn;                    // bytes read from the modem (without the 27.010 framing)
+    unsigned long muxLost;                     // bytes dropped by the 27.010 multiplexer, a channel being full
+} HeraclesModemStats;
+
 /**
  * Initialize modem instance, optionally including restarting of Heracles modem.
  * Return 1 on operation success, else 0.
  */
 int HeraclesModem__Init(SerialInterface* serialItf, TimerInterface* timerItf, DebugInterface* debugItf, int doReset);
 
+/**
+ * Use the 27.010 multiplexer (AT+CMUX) from the next HeraclesModem__Init() with reset:
+ * AT commands then run on their own channel, beside the transparent connection left in data mode.
+ * Return 1, or 0 if the multiplexer is requested but not built (GSM_MUX_ENABLE).
+ */
+int HeraclesModem__SetMultiplexing(int enable);
+
 /**
  * Maintain opened connections state. Shall be called periodically, and before any read() sequence.
  */
@@ -45,13 +93,102 @@ void HeraclesModem__Disconnect(unsigned int mux);
 
 /**
  * Send data to server.
+ * Up to GSM_SEND_WINDOW sends are pipelined: the return does not wait for the "DATA ACCEPT" of the modem,
+ * which is tracked as an unsolicited result code. A rejected send is reported by the next one.
+ * Return "len" if the data was handed to the modem, -1 on error.
  */
 int HeraclesModem__Send(const unsigned char* buff, int len, unsigned int mux);
 
 /**
- * Get data from server.
+ * Send the concatenation of "count" buffers to server, in one AT+CIPSEND (pipelined as HeraclesModem__Send()).
+ */
+int HeraclesModem__SendChunks(const SerialChunk* chunks, int count, unsigned int mux);
+
+/**
+ * Wait for the acceptance of the pending sends of connection "mux".
+ * Return 1 if all were accepted, else 0.
+ */
+int HeraclesModem__Flush(unsigned int mux);
+
+/**
+ * Get up to "size" bytes (at most GSM_MAX_RXGET) from server.
+ * The first "room" bytes are stored in "buffer", the next ones in the FIFO of the socket.
+ * Return the number of bytes stored in "buffer".
+ */
+int HeraclesModem__Read(unsigned char* buffer, int room, int size, unsigned int mux);
+
+/**
+ * Open a transparent connection (AT+CIPMODE=1) to host:port, optionally enabling SSL.
+ * The IP application is switched to single connection mode first (the other connections are shut).
+ * On success the serial line is a raw pipe to the server (data mode).
+ * Return 1 if success, else 0.
+ */
+int HeraclesModem__ConnectTransparent(struct _HeraclesTransparentTcpClient* const client, const char* host, unsigned short port, unsigned int sslEnabled);
+
+/**
+ * Close the transparent connection.
+ */
+void HeraclesModem__DisconnectTransparent();
+
+/**
+ * Leave data mode with the "+++" escape sequence: the connection is kept open and AT commands can be sent.
+ * The data received meanwhile is kept in the client buffer.
+ * The "OK" of the modem is only accepted once the guard time after "+++" has passed.
+ * If the data received meanwhile does not fit in the client buffer, the connection is closed.
+ * Any AT command sent in data mode escapes first (never needed with the multiplexer).
+ * Return 1 if the modem acknowledged, else 0 (no answer, or connection closed).
+ */
+int HeraclesModem__Escape();
+
+/**
+ * Return to data mode (ATO). Return 1 if success, else 0 (connection lost).
+ */
+int HeraclesModem__Resume();
+
+/**
+ * Return 1 if the data line carries the data of the transparent connection.
+ */
+int HeraclesModem__IsDataMode();
+
+/**
+ * Return 1 while command mode shall be kept (HTTP application in use).
+ */
+int HeraclesModem__IsHeld();
+
+/**
+ * Raw access to the data line in data mode.
+ */
+int HeraclesModem__RawAvailable();
+int HeraclesModem__RawRead(unsigned char* buffer, int size, unsigned long timeout);
+void HeraclesModem__RawWrite(const SerialChunk* chunks, int count);
+
+/**
+ * Get "url" with the HTTP application of the modem (command mode is kept until HeraclesModem__HttpTerm()).
+ * "status" and "length" are set from the response.
+ * Return 1 if a response was received, else 0.
+ */
+int HeraclesModem__HttpGet(const char* url, int* status, unsigned long* length);
+
+/**
+ * Read up to "size" bytes of the HTTP response body from "offset".
+ * Return the number of bytes read, or -1 on error.
+ */
+int HeraclesModem__HttpRead(unsigned long offset, unsigned char* buffer, int size);
+
+/**
+ * End the HTTP session and release command mode.
+ */
+void HeraclesModem__HttpTerm();
+
+/**
+ * Get the counters of the AT commands and of the serial line (kept across HeraclesModem__Init()).
+ */
+void HeraclesModem__GetStats(HeraclesModemStats* stats);
+
+/**
+ * Clear these counters.
  */
-int HeraclesModem__Read(int size, unsigned int mux);
+void HeraclesModem__ResetStats();
 
 #ifdef __cplusplus
 }
@@ -6,8 +6,42 @@
  * in this package distribution.
  */
 
+#include <string.h>
+
 #include "HeraclesTcpClient.h"
 
+// Buffers of a gather write sent in one AT+CIPSEND (the caller writes the next ones)
+#define HERACLES_TCP_MAX_CHUNKS  8
+
+#if GSM_TX_COALESCE_SZ > GSM_MAX_SEND
+#error "The coalescing buffer shall fit in one AT+CIPSEND"
+#endif
+
+/* Send the coalescing buffer in one AT+CIPSEND. Return 1 if successful, else 0. */
+static int sendBuffered(struct _HeraclesTcpClient* const self) {
+#if GSM_TX_COALESCE_SZ > 0
+    int len = self->txLen;
+    if (len == 0) {
+        return 1;
+    }
+    self->txLen = 0;
+    self->stats.sends++;
+    if (HeraclesModem__Send(self->tx, len, self->mux) != len) {
+        return 0;
+    }
+    self->stats.bytes += len;
+#endif
+    return 1;
+}
+
+/* Time threshold of the coalescing buffer */
+static int sendBufferedIfDue(struct _HeraclesTcpClient* const self) {
+    if (self->txLen && (self->timer->millis() - self->txStartMs >= GSM_TX_COALESCE_MS)) {
+        return sendBuffered(self);
+    }
+    return 1;
+}
+
 /**
  * interface implementation
  */
@@ -34,6 +68,7 @@
 int HeraclesTcpClient__Connect(struct _TcpClientInterface* const obj, const char *host, unsigned short port,  unsigned int sslEnabled) {
     struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
     GsmFifo_Clear(&self->rx);
+    self->txLen = 0;
 
     self->sock_connected = HeraclesModem__Connect(self, host, port, &self->mux, sslEnabled);
     return self->sock_connected;
@@ -55,6 +90,10 @@ int HeraclesTcpClient__Connect(struct _TcpClientInterface* const obj, const char
  */
 void HeraclesTcpClient__Stop(struct _TcpClientInterface* const obj) {
     struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
+    if (self->sock_connected) {
+        sendBuffered(self);
+    }
+    self->txLen = 0;
     HeraclesModem__Disconnect(self->mux);
     self->sock_connected = 0;
     GsmFifo_Clear(&self->rx);
@@ -66,29 +105,93 @@ void HeraclesTcpClient__Stop(struct _TcpClientInterface* const obj) {
  *    participant UserApp as "Upper software\nlayer"
  *    participant TcpClient as "HeraclesTcpClient"
  *    participant HeraclesModem as "HeraclesModem"
- *    UserApp -> TcpClient : write(<buf>, <size>)
+ *    UserApp -> TcpClient : write(<buf>, <size>) or writeChunks(<chunks>, <count>)
+ *    note right : Kept in the coalescing buffer while it fits:\nsent by flush(), by the write which does not fit,\nor after GSM_TX_COALESCE_MS
+ *    UserApp -> TcpClient : flush()
  *    TcpClient -> HeraclesModem : maintain()
- *    TcpClient -> HeraclesModem : send(<buf>, <size>, <mux>)
+ *    TcpClient -> HeraclesModem : send(<tx>, <txLen>, <mux>)
  *    HeraclesModem -> Serial : "AT+CIPSEND=<mux>,<size>"
  *    note right : Write command
  *    HeraclesModem <-- Serial : ">"
  *    HeraclesModem -> Serial : write(<buf>, <size>)
  *    note right : Provide data to send
  *    HeraclesModem -> Serial : flush()
- *    HeraclesModem <-- Serial : "DATA ACCEPT:"
- *    note left : Sending is successful
+ *    note right : No wait for "DATA ACCEPT"\nwhile less than GSM_SEND_WINDOW\nsends are pending
  *    TcpClient <-- HeraclesModem : status
  *    UserApp <-- TcpClient : status
+ *    ...
+ *    HeraclesModem <-- Serial : "DATA ACCEPT:<mux>,<size>"
+ *    note left : URC: one pending send less\n("<mux>, SEND FAIL" fails the next write)
  * @enduml
  */
+int HeraclesTcpClient__WriteChunks(struct _TcpClientInterface* const obj, const SerialChunk* chunks, int count) {
+    struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
+    SerialChunk part[HERACLES_TCP_MAX_CHUNKS];
+    int size = 0;
+    int n;
+    int i;
+    int rc;
+
+    if (!self->sock_connected) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        size += chunks[i].size;
+    }
+    self->stats.writes++;
+#if GSM_TX_COALESCE_SZ > 0
+    // Size threshold
+    if ((self->txLen + size > GSM_TX_COALESCE_SZ) && !sendBuffered(self)) {
+        return -1;
+    }
+    if (size < GSM_TX_COALESCE_SZ) {
+        if (self->txLen == 0) {
+            self->txStartMs = self->timer->millis();
+        }
+        for (i = 0; i < count; i++) {
+            memcpy(self->tx + self->txLen, chunks[i].buffer, chunks[i].size);
+            self->txLen += chunks[i].size;
+        }
+        return sendBufferedIfDue(self) ? size : -1;
+    }
+#endif
+    // Straight from the caller buffers, up to GSM_MAX_SEND bytes
+    size = 0;
+    for (n = 0; (n < count) && (n < HERACLES_TCP_MAX_CHUNKS) && (size < GSM_MAX_SEND); n++) {
+        part[n] = chunks[n];
+        if (size + part[n].size > GSM_MAX_SEND) {
+            part[n].size = GSM_MAX_SEND - size;
+        }
+        size += part[n].size;
+    }
+    HeraclesModem__Maintain();
+    self->stats.sends++;
+    rc = HeraclesModem__SendChunks(part, n, self->mux);
+    if (rc > 0) {
+        self->stats.bytes += rc;
+    }
+    return rc;
+}
+
 int HeraclesTcpClient__Write(struct _TcpClientInterface* const obj, const unsigned char *data, int size) {
+    SerialChunk chunk;
+    chunk.buffer = (const char*)data;
+    chunk.size = size;
+    return HeraclesTcpClient__WriteChunks(obj, &chunk, 1);
+}
+
+int HeraclesTcpClient__Flush(struct _TcpClientInterface* const obj) {
     struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
+    if (!self->txLen) {
+        return 1;
+    }
     HeraclesModem__Maintain();
-    return HeraclesModem__Send(data, size, self->mux);
+    return sendBuffered(self);
 }
 
 int HeraclesTcpClient__Available(struct _TcpClientInterface* const obj) {
     struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
+    sendBufferedIfDue(self);
     if (!GsmFifo_Size(&self->rx) && self->sock_connected) {
         HeraclesModem__Maintain();
     }
@@ -106,11 +209,10 @@ int HeraclesTcpClient__Available(struct _TcpClientInterface* const obj) {
  *    TcpClient -> HeraclesModem : maintain()
  *    TcpClient -> HeraclesModem : read(...)
  *    HeraclesModem -> Serial : "AT+CIPRXGET=2,<mux>,<size>"
- *    note right : Get Data from Network Manually
- *    loop while a char is available
- *      HeraclesModem -> Serial : Serial.read()
- *      HeraclesModem <-- Serial : received char
- *    end loop
+ *    note right : Get Data from Network Manually\n(up to 1460 bytes)
+ *    HeraclesModem -> Serial : Serial.read(<buf>, ...)
+ *    HeraclesModem <-- Serial : received data
+ *    note left : Stored in the caller buffer,\nthe overflow goes to the FIFO
  *    HeraclesModem <-- Serial : "OK"
  *    TcpClient <-- HeraclesModem : number of bytes read
  *    UserApp <-- TcpClient : number of bytes read
@@ -119,6 +221,7 @@ int HeraclesTcpClient__Available(struct _TcpClientInterface* const obj) {
 int HeraclesTcpClient__Read(struct _TcpClientInterface* const obj, unsigned char *buffer, int maxSize, int timeoutInMs) {
     struct _HeraclesTcpClient* const self = (struct _HeraclesTcpClient* const) obj;
 
+    sendBufferedIfDue(self);
     HeraclesModem__Maintain();
 
     int cnt = 0;
@@ -136,7 +239,10 @@ int HeraclesTcpClient__Read(struct _TcpClientInterface* const obj, unsigned char
         }
         HeraclesModem__Maintain();
         if (self->sock_available > 0) {
-            HeraclesModem__Read(GsmFifo_FreeSize(&self->rx), self->mux);
+            // Ask for the room left in the caller buffer plus what the FIFO can hold
+            int n = HeraclesModem__Read(buffer, maxSize - cnt, maxSize - cnt + GsmFifo_FreeSize(&self->rx), self->mux);
+            buffer += n;
+            cnt += n;
         }
         else {
             break;
@@ -176,14 +282,22 @@ void HeraclesTcpClient__Init(struct _HeraclesTcpClient* client,
         HeraclesTcpClient__Connected,
         HeraclesTcpClient__Available,
         HeraclesTcpClient__Read,
-        HeraclesTcpClient__Write
+        HeraclesTcpClient__Write,
+        HeraclesTcpClient__WriteChunks,
+        HeraclesTcpClient__Flush
     };
 
     /* Private attributes initialization */
     client->mux = INVALID_MUX;
     client->sock_available = 0;
     client->sock_connected = 0;
+    client->txLen = 0;
+    memset(&client->stats, 0, sizeof(client->stats));
     client->debug = debugItf;
     client->timer = timerItf;
 
 }
+
+void HeraclesTcpClient__GetStats(const struct _HeraclesTcpClient* client, HeraclesTcpClientStats* stats) {
+    *stats = client->stats;
+}
@@ -31,8 +31,11 @@ extern "C" {
  *    +int available ()
  *    +int read (buffer, maxSize, timeoutInMs)
  *    +int write (data, size, timeoutInMs)
+ *    +int writeChunks (chunks, count)
+ *    +int flush ()
  *    -at : HeraclesModem
  *    -rx : GsmFifo
+ *    -tx : coalescing buffer
  * }
  * TcpClient <|-- HeraclesTcpClient
  *
@@ -52,6 +55,29 @@ extern "C" {
  * @enduml
  */
 
+/*
+ * Write coalescing: the small packets written are merged in one AT+CIPSEND.
+ * The buffer is sent by flush(), when the next packet does not fit (size threshold),
+ * or once its first byte is older than GSM_TX_COALESCE_MS (time threshold, checked on each call).
+ * GSM_TX_COALESCE_SZ = 0 sends each write at once.
+ */
+#ifndef GSM_TX_COALESCE_SZ
+#define GSM_TX_COALESCE_SZ  512
+#endif
+
+#ifndef GSM_TX_COALESCE_MS
+#define GSM_TX_COALESCE_MS  20
+#endif
+
+/**
+ * Counters of the write coalescing: "writes - sends" AT+CIPSEND were saved.
+ */
+typedef struct _HeraclesTcpClientStats {
+    unsigned long writes;      /* calls of write() */
+    unsigned long sends;       /* AT+CIPSEND issued */
+    unsigned long bytes;       /* bytes sent */
+} HeraclesTcpClientStats;
+
 typedef struct _HeraclesTcpClient {
 
     /* public */
@@ -61,7 +87,15 @@ typedef struct _HeraclesTcpClient {
     unsigned int mux;
     unsigned int sock_available;
     int sock_connected;
+    int send_pending;      /* AT+CIPSEND not yet acknowledged by "DATA ACCEPT" */
+    int send_failed;       /* a sent packet was rejected ("SEND FAIL"), reported by the next write */
     GsmFifo rx;
+#if GSM_TX_COALESCE_SZ > 0
+    unsigned char tx[GSM_TX_COALESCE_SZ];
+#endif
+    int txLen;
+    unsigned long txStartMs;   /* when the first buffered byte was written */
+    HeraclesTcpClientStats stats;
     DebugInterface* debug;
     TimerInterface* timer;
 } HeraclesTcpClient;
@@ -72,6 +106,11 @@ void HeraclesTcpClient__Init(struct _HeraclesTcpClient* client,
 							 DebugInterface* debugItf,
 							 int doReset);
 
+/**
+ * Get the write coalescing counters (since HeraclesTcpClient__Init).
+ */
+void HeraclesTcpClient__GetStats(const struct _HeraclesTcpClient* client, HeraclesTcpClientStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
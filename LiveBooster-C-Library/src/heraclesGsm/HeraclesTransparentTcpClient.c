@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include <string.h>
+
+#include "HeraclesTransparentTcpClient.h"
+
+/**
+ * interface implementation
+ */
+
+/*
+ * @startuml
+ *    hide footbox
+ *    participant UserApp as "Upper software\nlayer"
+ *    participant TcpClient as "HeraclesTransparentTcpClient"
+ *    participant HeraclesModem as "HeraclesModem"
+ *    UserApp -> TcpClient : connect(<host>, <port>)
+ *    TcpClient -> HeraclesModem : connectTransparent(<host>, <port>, <ssl>)
+ *    HeraclesModem -> Serial : "AT+CIPSHUT", "AT+CIPMODE=1", "AT+CIPMUX=0", ...
+ *    note right : Only when the IP application\nis in multi connection mode
+ *    HeraclesModem -> Serial : "AT+CIPSTART=TCP,<host>,<port>"
+ *    HeraclesModem <-- Serial : "CONNECT"
+ *    note left : Data mode: the serial line\nis a raw pipe to the server
+ *    TcpClient <-- HeraclesModem : status
+ *    UserApp <-- TcpClient : status
+ * @enduml
+ */
+int HeraclesTransparentTcpClient__Connect(struct _TcpClientInterface* const obj, const char *host, unsigned short port,  unsigned int sslEnabled) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    self->rxLen = 0;
+    self->rxPos = 0;
+
+    self->sock_connected = HeraclesModem__ConnectTransparent(self, host, port, sslEnabled);
+    return self->sock_connected;
+}
+
+void HeraclesTransparentTcpClient__Stop(struct _TcpClientInterface* const obj) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    HeraclesModem__DisconnectTransparent();
+    self->sock_connected = 0;
+    self->rxLen = 0;
+    self->rxPos = 0;
+}
+
+/*
+ * @startuml
+ *    hide footbox
+ *    participant UserApp as "Upper software\nlayer"
+ *    participant TcpClient as "HeraclesTransparentTcpClient"
+ *    participant HeraclesModem as "HeraclesModem"
+ *    UserApp -> TcpClient : write(<buf>, <size>)
+ *    opt command mode
+ *      TcpClient -> HeraclesModem : resume()
+ *      HeraclesModem -> Serial : "ATO"
+ *      HeraclesModem <-- Serial : "CONNECT"
+ *    end
+ *    TcpClient -> HeraclesModem : rawWrite(<buf>, <size>)
+ *    HeraclesModem -> Serial : write(<buf>, <size>)
+ *    UserApp <-- TcpClient : size
+ * @enduml
+ */
+int HeraclesTransparentTcpClient__WriteChunks(struct _TcpClientInterface* const obj, const SerialChunk* chunks, int count) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    int size = 0;
+    int i;
+
+    if (!self->sock_connected || !HeraclesModem__Resume()) {
+        self->sock_connected = 0;
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        size += chunks[i].size;
+    }
+    HeraclesModem__RawWrite(chunks, count);
+    return size;
+}
+
+int HeraclesTransparentTcpClient__Write(struct _TcpClientInterface* const obj, const unsigned char *data, int size) {
+    SerialChunk chunk;
+    chunk.buffer = (const char*)data;
+    chunk.size = size;
+    return HeraclesTransparentTcpClient__WriteChunks(obj, &chunk, 1);
+}
+
+int HeraclesTransparentTcpClient__Available(struct _TcpClientInterface* const obj) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    return (self->rxLen - self->rxPos) + HeraclesModem__RawAvailable();
+}
+
+int HeraclesTransparentTcpClient__Read(struct _TcpClientInterface* const obj, unsigned char *buffer, int maxSize, int timeoutInMs) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    int cnt = 0;
+
+    // Data received while escaping first
+    if (self->rxPos < self->rxLen) {
+        cnt = self->rxLen - self->rxPos;
+        if (cnt > maxSize) {
+            cnt = maxSize;
+        }
+        memcpy(buffer, self->rx + self->rxPos, cnt);
+        self->rxPos += cnt;
+        if (self->rxPos == self->rxLen) {
+            self->rxPos = 0;
+            self->rxLen = 0;
+        }
+        if (cnt == maxSize) {
+            return cnt;
+        }
+    }
+
+    if (!self->sock_connected) {
+        return cnt;
+    }
+    if (!HeraclesModem__IsDataMode()) {
+        // The modem keeps the data while the HTTP application runs
+        if (HeraclesModem__IsHeld() || !HeraclesModem__Resume()) {
+            return cnt;
+        }
+    }
+    return cnt + HeraclesModem__RawRead(buffer + cnt, maxSize - cnt, timeoutInMs);
+}
+
+int HeraclesTransparentTcpClient__Connected(struct _TcpClientInterface* const obj) {
+    struct _HeraclesTransparentTcpClient* const self = (struct _HeraclesTransparentTcpClient* const) obj;
+    if (self->rxPos < self->rxLen) {
+        return 1;
+    }
+    return self->sock_connected;
+}
+
+/**
+ * public initializer
+ */
+
+void HeraclesTransparentTcpClient__Init(struct _HeraclesTransparentTcpClient* client,
+                                        SerialInterface* serialItf,
+                                        TimerInterface* timerItf,
+                                        DebugInterface* debugItf,
+                                        int doReset) {
+
+    /* Heracles Modem initialisation */
+    int res = HeraclesModem__Init(serialItf, timerItf, debugItf, doReset);
+    debugItf->print("HeraclesModem  ");
+    res==1 ? debugItf->print("initialized\n") :debugItf->print("not initialized\n");
+
+    /* Interface implementation */
+    client->_ = (struct _TcpClientInterface) {
+        HeraclesTransparentTcpClient__Connect,
+        HeraclesTransparentTcpClient__Stop,
+        HeraclesTransparentTcpClient__Connected,
+        HeraclesTransparentTcpClient__Available,
+        HeraclesTransparentTcpClient__Read,
+        HeraclesTransparentTcpClient__Write,
+        HeraclesTransparentTcpClient__WriteChunks,
+        NULL        /* flush : each write goes out at once */
+    };
+
+    /* Private attributes initialization */
+    client->sock_connected = 0;
+    client->rxLen = 0;
+    client->rxPos = 0;
+    client->debug = debugItf;
+    client->timer = timerItf;
+}
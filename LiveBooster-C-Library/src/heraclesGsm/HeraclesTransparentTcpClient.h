@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __HeraclesTransparentTcpClient_h
+#define __HeraclesTransparentTcpClient_h
+
+#include "HeraclesModem.h"
+#include "TcpClientInterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @startuml
+ *
+ * interface TcpClient {
+ *    [...]
+ * }
+ *
+ * class HeraclesTransparentTcpClient {
+ *    +int connect (host, port)
+ *    +void stop ()
+ *    +int connected ()
+ *    +int available ()
+ *    +int read (buffer, maxSize, timeoutInMs)
+ *    +int write (data, size, timeoutInMs)
+ *    +int writeChunks (chunks, count)
+ *    -at : HeraclesModem
+ *    -rx : data received while escaping
+ * }
+ * TcpClient <|-- HeraclesTransparentTcpClient
+ *
+ * class HeraclesModem {
+ *    +connectTransparent()
+ *    +escape()
+ *    +resume()
+ *    +rawRead()
+ *    +rawWrite()
+ * }
+ * HeraclesTransparentTcpClient "0..1" --o "1" HeraclesModem
+ *
+ * @enduml
+ */
+
+/**
+ * TCP client using the transparent mode of the modem (AT+CIPMODE=1): once connected, the bytes
+ * are exchanged as is on the serial line, without AT+CIPSEND / AT+CIPRXGET exchanges.
+ * Only one such connection can be opened, and not together with HeraclesTcpClient connections.
+ * The modem is switched back to command mode ("+++") by any AT command, and back to data mode (ATO)
+ * by the next read or write.
+ */
+
+// Data received between the "+++" escape sequence and its "OK" (beyond, the connection is closed)
+#ifndef GSM_ESCAPE_RX_SZ
+#define GSM_ESCAPE_RX_SZ 300
+#endif
+
+typedef struct _HeraclesTransparentTcpClient {
+
+    /* public */
+    struct _TcpClientInterface _;
+
+    /* private */
+    int sock_connected;
+    unsigned char rx[GSM_ESCAPE_RX_SZ];
+    int rxLen;
+    int rxPos;
+    DebugInterface* debug;
+    TimerInterface* timer;
+} HeraclesTransparentTcpClient;
+
+void HeraclesTransparentTcpClient__Init(struct _HeraclesTransparentTcpClient* client,
+                                        SerialInterface* serialItf,
+                                        TimerInterface* timerItf,
+                                        DebugInterface* debugItf,
+                                        int doReset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
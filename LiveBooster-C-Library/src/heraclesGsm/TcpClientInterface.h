@@ -9,6 +9,8 @@
 #ifndef __TcpClientInterface_h
 #define __TcpClientInterface_h
 
+#include "../serial/SerialInterface.h"
+
 /**
  * @startuml
  * interface TcpClient {
@@ -18,6 +20,8 @@
  *    +int available ()
  *    +int read (buffer, maxSize, timeoutInMs)
  *    +int write (data, size, timeoutInMs)
+ *    +int writeChunks (chunks, count) (optional)
+ *    +int flush () (optional)
  * }
  * @enduml
  */
@@ -60,6 +64,19 @@ typedef struct _TcpClientInterface
      */
     int (* write) (struct _TcpClientInterface* const obj, const unsigned char *data, int size);
 
+    /**
+     * Optional (NULL: write() is called for each buffer). Send the concatenation of the "count" buffers of "chunks".
+     * Return the number of bytes effectively sent, which may be less than the total (the caller sends the rest),
+     * or -1 if an error occurred.
+     */
+    int (* writeChunks) (struct _TcpClientInterface* const obj, const SerialChunk* chunks, int count);
+
+    /**
+     * Optional (NULL if write() sends at once). Send the data kept by write() to be merged with the next writes.
+     * Return 1 if successful, 0 if an error occurred.
+     */
+    int (* flush) (struct _TcpClientInterface* const obj);
+
 } TcpClientInterface;
 
 #endif
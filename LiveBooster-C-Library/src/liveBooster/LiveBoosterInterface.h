@@ -17,10 +17,13 @@
 #include "liveBoosterPacket/LiveBooster_http.h"
 
 #include "../mqttClient/MqttClient.h"
+#include "../heraclesGsm/HeraclesModem.h"
 
 #include "../serial/SerialInterface.h"
 #include "../timer/TimerInterface.h"
 #include "../traceDebug/DebugInterface.h"
+#include "../traceDebug/TraceInterface.h"
+#include "../persistence/PersistenceInterface.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -54,6 +57,34 @@ int LiveBooster_Init(char* ptrDeviceId,
                      TimerInterface* timer,
                      DebugInterface* debug);
 
+/**
+ * @brief Select the transport of the MQTT connection (to be called before LiveBooster_Connect).
+ *
+ * In transparent mode (AT+CIPMODE=1), the serial line is a raw pipe to the server once connected:
+ * no AT+CIPSEND / AT+CIPRXGET exchange per MQTT packet. It suits a device connected to the broker only.
+ * The resources are then downloaded with the HTTP application of the modem, the MQTT connection
+ * being kept open in command mode ("+++" escape sequence) meanwhile.
+ *
+ * @param enable  1 to use the transparent mode, 0 (default) to use the multi-connection mode.
+ *
+ * @return 0 if successful, otherwise a negative value when error occurs.
+ */
+int LiveBooster_SetTransparentMode(int enable);
+
+/**
+ * @brief Run the serial line through the 3GPP TS 27.010 multiplexer (to be called before LiveBooster_Connect).
+ *
+ * The AT commands then use a channel of their own: with the transparent mode, the status queries and
+ * the resource downloads no longer interrupt the MQTT connection ("+++" / ATO), at the cost of
+ * 6 bytes of framing per frame of at most 127 bytes.
+ * The multiplexer takes about 3 KB of RAM: it is only built with GSM_MUX_ENABLE set to 1.
+ *
+ * @param enable  1 to use the multiplexer (AT+CMUX=0), 0 (default) to use the line as is.
+ *
+ * @return 0 if successful, otherwise a negative value (multiplexer not built).
+ */
+int LiveBooster_SetMultiplexing(int enable);
+
 /* @} group end : Init */
 
 /* ================================================================== */
@@ -87,6 +118,76 @@ int LiveBooster_Cycle(int timeout_ms);
  */
 void LiveBooster_Close(void);
 
+/**
+ * @brief Get the write coalescing counters of the MQTT connection (AT+CIPSEND mode, zero in transparent mode).
+ *
+ * The packets written during a LiveBooster_Cycle pass are merged in one AT+CIPSEND.
+ *
+ * @param packets  MQTT packets written
+ * @param sends    AT+CIPSEND used to send them ("packets - sends" AT+CIPSEND saved)
+ */
+void LiveBooster_GetSendStats(unsigned long* packets, unsigned long* sends);
+
+/**
+ * @brief Format and print the traces recorded by the library (LB_TRACE_DEFERRED = 1, otherwise nothing to do).
+ *
+ * To be called from a low priority path of the application (idle loop, ...), out of the publish path.
+ *
+ * @return Number of printed traces
+ */
+int LiveBooster_FlushTraces(void);
+
+/**
+ * @brief Set the trace interface receiving the spans of the publish and receive pipelines (to be called after LiveBooster_Init).
+ *
+ * LiveBooster_PushData() : "encode", "serialize", "AT+CIPSEND", "DATA ACCEPT" (send window full) and "PUBACK" (QoS 1).
+ * LiveBooster_Cycle() : "read" (with "AT+CIPRXGET"), "decode", "callback" (user callbacks) and "response".
+ * The timestamps are in microseconds when the timer interface provides micros(), else in milliseconds * 1000.
+ *
+ * @param trace  Trace interface, or NULL to stop the spans
+ */
+void LiveBooster_SetTrace(TraceInterface* trace);
+
+/**
+ * @brief Counters of the LiveBooster client
+ */
+typedef struct {
+	unsigned long connects;           /*!< Successful LiveBooster_Connect() */
+	unsigned long reconnects;         /*!< Successful LiveBooster_Connect() after the first one */
+	unsigned long connect_failures;   /*!< Failed LiveBooster_Connect() */
+	unsigned long http_downloads;     /*!< Resource downloads ended (completed or not) */
+	unsigned long http_bytes;         /*!< Bytes received by these downloads */
+	unsigned long http_ms;            /*!< Time of these downloads (ms) */
+	StatsHistogram http_throughput;   /*!< Bytes per second of each download */
+	StatsHistogram json_encode;       /*!< Encoding time of the published messages (us) */
+	StatsHistogram json_decode;       /*!< Decoding time of the received messages (us) */
+} LiveBooster_ClientStats_t;
+
+/**
+ * @brief Statistics of the library, read by LiveBooster_GetStats()
+ */
+typedef struct {
+	LiveBooster_ClientStats_t client;  /*!< Connections, resource downloads and JSON messages */
+	MQTTStats mqtt;                    /*!< Publications (publish to send and PUBACK latencies) and keep alive failures */
+	HeraclesModemStats modem;          /*!< AT commands (round-trip time per family, AT+CIPSEND / AT+CIPRXGET) and serial bytes */
+} LiveBooster_Stats_t;
+
+/**
+ * @brief Get the statistics of the library, counted since the start of the application or LiveBooster_ResetStats().
+ *
+ * The counters are only incremented on the way (no computation), and read with one copy : the application may poll
+ * them and publish a summary as a device status (StatsHistogram_Percentile() gives the percentiles of the histograms).
+ * The JSON encoding and decoding times are measured when the timer interface provides micros().
+ *
+ * @param stats  Copy of the statistics
+ */
+void LiveBooster_GetStats(LiveBooster_Stats_t* stats);
+
+/**
+ * @brief Clear the statistics of the library.
+ */
+void LiveBooster_ResetStats(void);
+
 /* @} group end : DynamicOpe */
 
 /* ================================================================== */
@@ -115,6 +216,9 @@ void LiveBooster_Close(void);
  * @param data_ptr    Pointer to an array of LiveObjects IoT Data
  * @param data_nb     Number of elements in this array.
  *
+ * The JSON text which does not depend on the values (stream id, model, tags, data names) is
+ * pre-rendered here : the names, types and dimensions of the data elements shall not change afterwards.
+ *
  * @return an handle value >= 0  if successful, otherwise a negative value when error occurs.
  */
 int LiveBooster_AttachData(const char* stream_id,
@@ -125,27 +229,89 @@ int LiveBooster_AttachData(const char* stream_id,
 		                   const LiveBooster_Data_t* data_ptr,
 						   int32_t data_nb);
 
+/**
+ * @brief Limit the decimals of the float values of a set of collected data (GPS position excepted).
+ *
+ * By default, the floats are written in their shortest form which reads back as the same value
+ * ("21.5", "0.1"). A sensor with a known resolution can save bytes with fewer decimals.
+ *
+ * @param handle      Handle of collected data set
+ * @param decimals    Max number of decimals (0..9), or -1 for the shortest round-trip form
+ *
+ * @return 0 if successful, otherwise a negative value when error occurs.
+ */
+int LiveBooster_SetDataPrecision(int handle, int decimals);
+
+/**
+ * @brief Set the MQTT QoS of the collected data (QoS 0 by default).
+ *
+ * In QoS 1, LiveBooster_PushData() returns once the message is sent, with a message identifier : the message
+ * is kept (LB_MQTT_INFLIGHT_SZ, 0 by default : PushData then waits for the PUBACK) until its PUBACK is received by LiveBooster_Cycle(), which calls the callback.
+ * A message not acknowledged within MQTT_RETRY_TIMEOUT_IN_MS is sent again (DUP flag), up to MQTT_RETRY_MAX times.
+ * At most MQTT_INFLIGHT_WINDOW messages are in flight : LiveBooster_PushData() then returns ERR_MQTT_INFLIGHT_FULL,
+ * and the connection goes on. The messages in flight are kept when the connection is lost : LiveBooster_Connect()
+ * sends them again all together (DUP flag), right after the CONNACK.
+ *
+ * @param qos         0 or 1
+ * @param callback    Optional, user callback function called when a QoS 1 publication is completed.
+ *
+ * @return 0 if successful, otherwise a negative value when error occurs.
+ */
+int LiveBooster_SetDataQos(int qos, LiveBooster_CallbackDataAck_t callback);
+
+/**
+ * @brief Set the persistence of the QoS 1 messages in flight (to be called after LiveBooster_Init, before LiveBooster_Connect).
+ *
+ * Each message is saved before it is sent, and removed once acknowledged or given up. The messages saved by a
+ * previous run of the application are restored, and sent again by LiveBooster_Connect() : their completion is given
+ * to the callback of LiveBooster_SetDataQos() with their message identifier of that run.
+ * Without in-flight buffer (LB_MQTT_INFLIGHT_SZ set to 0), it has no effect.
+ *
+ * @param persistence  Persistence interface, or NULL (messages in flight kept in memory only)
+ *
+ * @return Number of restored messages, otherwise a negative value when error occurs (connected).
+ */
+int LiveBooster_SetPersistence(PersistenceInterface* persistence);
+
 /**
  * @brief Define a set of user parameters as the LiveObjects IoT Configuration parameters.
  *
+ * The callback receives a string or binary value NUL terminated, in a buffer of the library valid until it returns
+ * (at most LB_PARAM_VALUE_SZ bytes with the NUL), and its length.
+ *
  * @param ptrParam    Pointer to an array of Configuration Parameters
- * @param nbPparam    Number of elements in this array.
+ * @param nbPparam    Number of elements in this array, at most LB_MAX_OF_CFG_PARAMS (any number when it is set to 0 :
+ *                    the index of their names is then allocated by malloc()).
  * @param callback    User callback function, called to check the parameter to be updated.
  *
- * @return always  0  (SUCCESS).
+ * @return 0 (SUCCESS), or ERR_LB_ATTACH_PARAMS if there are more than LB_MAX_OF_CFG_PARAMS parameters,
+ *         their index can not be allocated or a parameter name is longer than 255 characters.
  */
 int LiveBooster_AttachCfgParameters  (const LiveBooster_Param_t* ptrParam,
 		                              uint32_t  nbPparam,
 									  LiveBooster_CallbackParams_t callback);
 
+/**
+ * @brief Give the string values of the configuration parameters to the callback without copying them.
+ *
+ * The value is then a pointer into the received message and its length : it is not NUL terminated,
+ * and its size is not limited by LB_PARAM_VALUE_SZ. The callback must not use strcpy() or strlen() on it.
+ *
+ * @param enable  1 to give the string values in place, 0 (default) to give them NUL terminated.
+ *
+ * @return 0 (SUCCESS).
+ */
+int LiveBooster_SetCfgParamsZeroCopy(int enable);
+
 /**
  * @brief Define the set of user commands.
  *
  * @param ptrCmd      Pointer to an array of LiveObjects IoT Commands
- * @param nbCcmd      Number of elements in this array.
+ * @param nbCcmd      Number of elements in this array (at most LB_MAX_OF_COMMANDS).
  * @param callback    User callback function, called when a command is received from LiveObjects server.
  *
- * @return always  0  (SUCCESS).
+ * @return 0 (SUCCESS), or ERR_LB_ATTACH_COMMANDS if there are more than LB_MAX_OF_COMMANDS commands
+ *         or a command name is longer than 255 characters.
  */
 int LiveBooster_AttachCommands (const LiveBooster_Command_t* ptrCmd,
 		                        int32_t nbCcmd,
@@ -155,11 +321,12 @@ int LiveBooster_AttachCommands (const LiveBooster_Command_t* ptrCmd,
  * @brief Define the set of user resources
  *
  * @param rsc_ptr     Pointer to an array of LiveObjects IoT Resources
- * @param rsc_nb      Number of elements in this array.
+ * @param rsc_nb      Number of elements in this array (at most LB_MAX_OF_RESOURCES).
  * @param ntfyCB      User callback function, called when download operation is requested or completed by LiveObjects server.
  * @param dataCB      User callback function, called when data is ready to be read.
  *
- * @return always  0  (SUCCESS).
+ * @return 0 (SUCCESS), or ERR_LB_ATTACH_RESOURCES if there are more than LB_MAX_OF_RESOURCES resources
+ *         or a resource name is longer than 255 characters.
  */
 int LiveBooster_AttachResources(const LiveBooster_Resource_t* rsc_ptr,
 		                        int32_t rsc_nb,
@@ -183,7 +350,8 @@ int LiveBooster_AttachResources(const LiveBooster_Resource_t* rsc_ptr,
  *
  * @param handle      Handle of collected data set
  *
- * @return 0 if successful, otherwise a negative value when error occurs.
+ * @return 0 if successful (in QoS 1, the message identifier > 0, see LiveBooster_SetDataQos),
+ *         otherwise a negative value when error occurs.
  */
 int LiveBooster_PushData(int handle);
 
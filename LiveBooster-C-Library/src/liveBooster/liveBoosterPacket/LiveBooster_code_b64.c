@@ -21,153 +21,152 @@
 
 #include "LiveBooster_code_b64.h"
 
-const char b64chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-int b64invs[] ={ 62, -1, -1, -1, 63, 52, 53, 54, 55, 56, 57, 58,
-                 59, 60, 61, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 5,
-                 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20,
-                 21, 22, 23, 24, 25, -1, -1, -1, -1, -1, -1, 26, 27, 28,
-                 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42,
-                 43, 44, 45, 46, 47, 48, 49, 50, 51 };
-
-size_t b64_encoded_size(size_t inlen)
+#define B64_PAD  0x40  /* '=' */
+#define B64_INV  0x80  /* not a base64 character */
+
+static const char b64chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Value of each character : 0..63, B64_PAD or B64_INV */
+static const uint8_t b64invs[256] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x80, 0x80, 0x80, 0x40, 0x80, 0x80,
+	0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+size_t b64_encoded_size(size_t len)
 {
-    size_t ret;
-
-    ret = inlen;
-    if (inlen % 3 != 0)
-        ret += 3 - (inlen % 3);
-    ret /= 3;
-    ret *= 4;
-
-    return ret;
+    return (len + 2) / 3 * 4;
 }
 
-void b64_encode(const char *in, char *out, size_t len)
+size_t b64_encode_chunk(const uint8_t *in, size_t len, char *out)
 {
-    size_t  elen;
+    char   *o = out;
     size_t  i;
-    size_t  j;
-    size_t  v;
+    uint32_t v;
+
+    for (i = 0; i + 3 <= len; i += 3, o += 4) {
+        v = ((uint32_t) in[i] << 16) | ((uint32_t) in[i+1] << 8) | in[i+2];
+        o[0] = b64chars[(v >> 18) & 0x3F];
+        o[1] = b64chars[(v >> 12) & 0x3F];
+        o[2] = b64chars[(v >> 6) & 0x3F];
+        o[3] = b64chars[v & 0x3F];
+    }
+    if (i < len) {
+        v = (uint32_t) in[i] << 16;
+        if (i + 1 < len)
+            v |= (uint32_t) in[i+1] << 8;
+        o[0] = b64chars[(v >> 18) & 0x3F];
+        o[1] = b64chars[(v >> 12) & 0x3F];
+        o[2] = (i + 1 < len) ? b64chars[(v >> 6) & 0x3F] : '=';
+        o[3] = '=';
+        o += 4;
+    }
+    return (size_t) (o - out);
+}
 
+void b64_encode(const char *in, char *out, size_t len)
+{
     if (in == NULL || len == 0) {
         out[0] = '\0';
     }
-    else
-    {
-
-		elen = b64_encoded_size(len);
-		out[elen] = '\0';
-
-		for (i=0, j=0; i<len; i+=3, j+=4) {
-			v = in[i];
-			v = i+1 < len ? v << 8 | in[i+1] : v << 8;
-			v = i+2 < len ? v << 8 | in[i+2] : v << 8;
-
-			out[j]   = b64chars[(v >> 18) & 0x3F];
-			out[j+1] = b64chars[(v >> 12) & 0x3F];
-			if (i+1 < len) {
-				out[j+2] = b64chars[(v >> 6) & 0x3F];
-			} else {
-				out[j+2] = '=';
-			}
-			if (i+2 < len) {
-				out[j+3] = b64chars[v & 0x3F];
-			} else {
-				out[j+3] = '=';
-			}
-		}
+    else {
+        out[b64_encode_chunk((const uint8_t *) in, len, out)] = '\0';
     }
 }
 
-
-size_t b64_decoded_size(const char *in)
+void b64_decode_init(b64_decoder_t *d)
 {
-    size_t len;
-    size_t ret;
-    size_t i;
-
-    if (in == NULL)
-        return 0;
-
-    len = strlen(in);
-    ret = len / 4 * 3;
-
-    for (i=len; i-->0; ) {
-        if (in[i] == '=') {
-            ret--;
-        } else {
-            break;
-        }
-    }
-
-    return ret;
+    d->bits = 0;
+    d->nb = 0;
+    d->pad = 0;
 }
 
-void b64_generate_decode_table()
+int b64_decode_chunk(b64_decoder_t *d, const char *in, size_t len, char *out)
 {
-    int    inv[80];
-    size_t i;
+    const uint8_t *p = (const uint8_t *) in;
+    const uint8_t *end = p + len;
+    char    *o = out;
+    uint32_t v;
+    uint8_t  c;
+
+    while (p < end) {
+        /* whole quanta without padding */
+        if (d->nb == 0) {
+            if (d->pad)  /* data after the padding */
+                return -1;
+            while (end - p >= 4) {
+                uint8_t c0 = b64invs[p[0]];
+                uint8_t c1 = b64invs[p[1]];
+                uint8_t c2 = b64invs[p[2]];
+                uint8_t c3 = b64invs[p[3]];
+                if ((c0 | c1 | c2 | c3) & (B64_PAD | B64_INV))
+                    break;
+                v = ((uint32_t) c0 << 18) | ((uint32_t) c1 << 12) | ((uint32_t) c2 << 6) | c3;
+                p += 4;
+                o[0] = (char) (v >> 16);
+                o[1] = (char) (v >> 8);
+                o[2] = (char) v;
+                o += 3;
+            }
+            if (p == end)
+                break;
+        }
 
-    memset(inv, -1, sizeof(inv));
-    for (i=0; i<sizeof(b64chars)-1; i++) {
-        inv[b64chars[i]-43] = i;
+        c = b64invs[*p++];
+        if (c == B64_INV)
+            return -1;
+        if (c == B64_PAD) {
+            if (d->nb < 2)
+                return -1;
+            d->pad++;
+            c = 0;
+        }
+        else if (d->pad) {
+            return -1;
+        }
+        d->bits = (d->bits << 6) | c;
+        if (++d->nb == 4) {
+            *o++ = (char) (d->bits >> 16);
+            if (d->pad < 2)
+                *o++ = (char) (d->bits >> 8);
+            if (d->pad < 1)
+                *o++ = (char) d->bits;
+            d->bits = 0;
+            d->nb = 0;
+        }
     }
+    return (int) (o - out);
 }
 
-int b64_isvalidchar(char c)
+int b64_decode_end(const b64_decoder_t *d)
 {
-    if (c >= '0' && c <= '9')
-        return 1;
-    if (c >= 'A' && c <= 'Z')
-        return 1;
-    if (c >= 'a' && c <= 'z')
-        return 1;
-    if (c == '+' || c == '/' || c == '=')
-        return 1;
-    return 0;
+    return (d->nb == 0) ? 0 : -1;
 }
 
-int b64_decode(const char *in, char *out, size_t outlen)
+int b64_decode(const char *in, size_t len, char *out, size_t outlen)
 {
-    size_t len;
-    size_t i;
-    size_t j;
-    int    v;
-
-
-    if (in == NULL || out == NULL)
-         return 0;
+    b64_decoder_t d;
+    int n;
 
-    len = strlen(in);
-    if (outlen < b64_decoded_size(in) || len % 4 != 0)
-        return 0;
+    if (in == NULL || out == NULL || (len + 3) / 4 * 3 > outlen)
+        return -1;
 
-    for (i=0; i<len; i++) {
-        if (!b64_isvalidchar(in[i])) {
-           return 0;
-        }
-    }
-
-    for (i=0, j=0; i<len; i+=4, j+=3) {
-        v = b64invs[in[i]-43];
-        v = (v << 6) | b64invs[in[i+1]-43];
-        v = in[i+2]=='=' ? v << 6 : (v << 6) | b64invs[in[i+2]-43];
-        v = in[i+3]=='=' ? v << 6 : (v << 6) | b64invs[in[i+3]-43];
-
-        out[j] = (v >> 16) & 0xFF;
-        if (in[i+2] != '=')
-            out[j+1] = (v >> 8) & 0xFF;
-        else
-        	out[j+1] = '\0';
-        if (in[i+3] != '=')
-            out[j+2] = v & 0xFF;
-        else
-        	out[j+2] = '\0';
-    }
-	out[j] = '\0';
-
-    return 1;
+    b64_decode_init(&d);
+    n = b64_decode_chunk(&d, in, len, out);
+    if (n < 0 || b64_decode_end(&d))
+        return -1;
+    return n;
 }
-
-
@@ -26,11 +26,41 @@
 extern "C" {
 #endif
 
-#include <string.h>
+#include <stdint.h>
 #include <stddef.h>
 
+/**
+ * @brief Decoder state, kept between the chunks of a same base64 text.
+ */
+typedef struct {
+    uint32_t bits;  /*!< Bits of the incomplete quantum */
+    uint8_t  nb;    /*!< Number of characters in the incomplete quantum (0..3) */
+    uint8_t  pad;   /*!< Number of '=' met (then the text must end) */
+} b64_decoder_t;
+
+/* Number of base64 characters (with padding) to encode "len" bytes */
+size_t b64_encoded_size(size_t len);
+
+/* Encode "len" bytes of "in" into "out" : b64_encoded_size(len) characters, not NUL terminated */
+size_t b64_encode_chunk(const uint8_t *in, size_t len, char *out);
+
+/* Encode "len" bytes of "in" into "out", NUL terminated (b64_encoded_size(len) + 1 bytes) */
 void b64_encode(const char *in, char *out, size_t len);
-int b64_decode(const char *in, char *out, size_t outlen);
+
+void b64_decode_init(b64_decoder_t *d);
+
+/**
+ * Decode "len" characters of "in" (not NUL terminated) : the incomplete quantum is kept in "d" for the next chunk.
+ * "out" may be "in" (decoding in place) : at most 3 bytes are written for each 4 characters read.
+ * @return the number of bytes written in "out", or -1 if the text is not valid base64.
+ */
+int b64_decode_chunk(b64_decoder_t *d, const char *in, size_t len, char *out);
+
+/* End of the base64 text : return 0, or -1 if the last quantum is incomplete */
+int b64_decode_end(const b64_decoder_t *d);
+
+/* Decode the "len" characters of "in" into "out" (at most "outlen" bytes) : return the decoded length, or -1 */
+int b64_decode(const char *in, size_t len, char *out, size_t outlen);
 
 #if defined(__cplusplus)
 }
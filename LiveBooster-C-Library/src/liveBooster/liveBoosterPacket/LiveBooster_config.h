@@ -22,12 +22,34 @@
  * Tunable parameters:
 
  * - LB_MAX_OF_DATA_SET  Max Number of collected data streams (or also named 'data sets')  (default: 5 data streams)
- * - LB_MAX_OF_PARSED_PARAMS Max Number of parsed parameters in a same received update param request (default: 5)
+ * - LB_MAX_OF_CFG_PARAMS Max Number of configuration parameters given to LiveBooster_AttachCfgParameters() (default: 32), indexed in static memory.
+ *   A larger set is refused (ERR_LB_ATTACH_PARAMS). It can be set to 0 : the index is then allocated by malloc() at attach time, for any number of them.
+ *   Any number of them can be updated by a same request.
+ * - LB_MAX_OF_COMMANDS Max Number of commands given to LiveBooster_AttachCommands() (default: 16)
+ * - LB_MAX_OF_RESOURCES Max Number of resources given to LiveBooster_AttachResources() (default: 8)
+ *   For each of these 3 sets, a hash index of 2 x 4 bytes per entry is built at attach time, to find a received name.
  * - LB_JSON_BUF_SZ  Size (in bytes) of static JSON buffer used to encode the JSON payload to be sent (default: 1 K bytes)
- * - LB_BIN64_BUF_SZ  Size (in bytes) of Bin64 configuration parameter buffer used to decode the JSON payload to be receive (default: 550 bytes)
+ * - LB_CMD_BLOCK_SZ Size (in bytes) of the static block given to the command callback (header, arguments and their text) (default: 1 K bytes).
+ *   A larger command is answered with the error -7 "Too large". It can be set to 0 : the block is then allocated by malloc() for each command.
+ *   Otherwise the library does not use the heap.
+ * - LB_PARAM_VALUE_SZ Size (in bytes) of the static buffer receiving the value of a string or binary configuration parameter, with its ending NUL (default: 512 bytes).
+ *   A larger value is refused : by default, strings of at most 511 characters and binary values of at most 511 decoded bytes
+ *   (see LiveBooster_SetCfgParamsZeroCopy() for the strings). It can be set to 0 : the buffer is then allocated by malloc() for each value.
  * - LB_SETOFDATA_STREAM_ID_SZ Max Size(in bytes) of Data Stream Id (default: 80 bytes)
  * - LB_SETOFDATA_MODEL_SZ Max Size(in bytes) of Data Model field (default: 80 bytes). It can be set to 0 : disabled.
  * - LB_SETOFDATA_TAGS_SZ Max Size(in bytes) of Data Tag field (default: 80 bytes). It can be set to 0 : disabled.
+ * - LB_JSON_TMPL_SZ Size (in bytes) of the static JSON fragments pre-rendered for each data stream at LiveBooster_AttachData() (default: 256 bytes). It can be set to 0 : disabled, the message is fully encoded at each push.
+ * - LB_JSON_TMPL_SLOTS Max Number of value slots of a pre-rendered data stream : number of data elements + 2 (default: 12)
+ * - LB_LOG_LEVEL Traces of the library compiled in : 0 = none, 1 = errors, 2 = + warnings, 3 = + connection steps and requests,
+ *   4 = + dumps of the sent and received payloads (default: 3). The other traces compile to nothing.
+ * - LB_TRACE_DEFERRED Set to 1 to only record the traces (format address and raw arguments) in a ring buffer,
+ *   formatted later by LiveBooster_FlushTraces() (default: 0, formatted and printed at once).
+ * - LB_TRACE_RING_SZ Size (in bytes) of the deferred traces ring buffer (default: 512 bytes)
+ * - LB_TRACE_MAX_ARGS Max Number of recorded arguments of a deferred trace (default: 16)
+ * - LB_MQTT_LARGE_RECV_SZ Size (in bytes) of static buffer receiving the MQTT messages larger than the MQTT receive buffer (default: 1 K bytes). It can be set to 0 : disabled, these messages are skipped.
+ * - LB_MQTT_INFLIGHT_SZ Size (in bytes) of static buffer keeping the QoS 1 collected data until their PUBACK, at most MQTT_INFLIGHT_WINDOW messages
+ *   (default: 0 : disabled, LiveBooster_PushData() waits for each PUBACK, and LiveBooster_SetPersistence() has no effect).
+ *   With QoS 1 data, 2 K bytes keep a window of a few messages of the size of the JSON buffer.
  *
  */
 
@@ -38,16 +60,44 @@
 #define LB_MAX_OF_DATA_SET                  5
 #endif
 
-#ifndef LB_MAX_OF_PARSED_PARAMS
-#define LB_MAX_OF_PARSED_PARAMS             5
+#ifndef LB_MAX_OF_CFG_PARAMS
+#define LB_MAX_OF_CFG_PARAMS                32
+#endif
+
+#ifndef LB_MAX_OF_COMMANDS
+#define LB_MAX_OF_COMMANDS                  16
+#endif
+
+#ifndef LB_MAX_OF_RESOURCES
+#define LB_MAX_OF_RESOURCES                 8
 #endif
 
 #ifndef LB_JSON_BUF_SZ
 #define LB_JSON_BUF_SZ                      1024
 #endif
 
-#ifndef LB_BIN64_BUF_SZ
-#define LB_BIN64_BUF_SZ                      550
+#ifndef LB_LOG_LEVEL
+#define LB_LOG_LEVEL                        3
+#endif
+
+#ifndef LB_TRACE_DEFERRED
+#define LB_TRACE_DEFERRED                   0
+#endif
+
+#ifndef LB_TRACE_RING_SZ
+#define LB_TRACE_RING_SZ                    512
+#endif
+
+#ifndef LB_TRACE_MAX_ARGS
+#define LB_TRACE_MAX_ARGS                   16
+#endif
+
+#ifndef LB_CMD_BLOCK_SZ
+#define LB_CMD_BLOCK_SZ                     1024
+#endif
+
+#ifndef LB_PARAM_VALUE_SZ
+#define LB_PARAM_VALUE_SZ                   512
 #endif
 
 #ifndef LB_SETOFDATA_STREAM_ID_SZ
@@ -62,5 +112,21 @@
 #define LB_SETOFDATA_TAGS_SZ                 80
 #endif
 
+#ifndef LB_JSON_TMPL_SZ
+#define LB_JSON_TMPL_SZ                      256
+#endif
+
+#ifndef LB_JSON_TMPL_SLOTS
+#define LB_JSON_TMPL_SLOTS                   12
+#endif
+
+#ifndef LB_MQTT_LARGE_RECV_SZ
+#define LB_MQTT_LARGE_RECV_SZ                1024
+#endif
+
+#ifndef LB_MQTT_INFLIGHT_SZ
+#define LB_MQTT_INFLIGHT_SZ                  0
+#endif
+
 
 #endif /* __LiveBooster_Config_H_ */
@@ -6,12 +6,15 @@
  * in this package distribution.
  */
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <inttypes.h>
 
 #include "../LiveBoosterInterface.h"
 #include "LiveBooster_core.h"
+#include "LiveBooster_num_fmt.h"
+#include "LiveBooster_trace.h"
 
 #define APIKEY_LENGTH  33
 
@@ -55,6 +58,17 @@ LB_TopicSub_t LB_TopicSub[3] = {
 
 static LiveBooster_Instance_t liveBooster;
 static MQTTClient mqttClient;
+#if LB_MQTT_LARGE_RECV_SZ > 0
+static unsigned char mqttLargeBuf[LB_MQTT_LARGE_RECV_SZ];
+#endif
+#if LB_MQTT_INFLIGHT_SZ > 0
+static unsigned char mqttInflightBuf[LB_MQTT_INFLIGHT_SZ];
+static MQTTInflightStore mqttInflight;   /* kept from a connection to the next one */
+#endif
+
+static LiveBooster_ClientStats_t lbStats;
+static unsigned long httpStartMs;      /* start of the running resource download */
+static uint32_t httpStartOffset;
 
 /* data use to debug <... */
 char traceDebug[500];
@@ -68,6 +82,10 @@ static int processConfig(void);
 static void messageHandlerDevCfgUpd (MessageData* msg);
 static void messageHandlerDevCmd (MessageData* msg);
 static void messageHandlerDevRscUpd (MessageData* msg);
+static void publishCompleteData(unsigned short id, int rc);
+static unsigned long statsStartUs(void);
+static void statsEndUs(StatsHistogram* histogram, unsigned long start);
+static void statsHttpEnd(void);
 
 
 /* --------------------------------------------------------------------------------- */
@@ -88,6 +106,31 @@ int LiveBooster_Init(char *deviceId,
 	/* define to debug encoded/decoded msg */
 	msgDebug = debug;
 
+#if LB_MQTT_INFLIGHT_SZ > 0
+	MQTTInflightStoreInit(&mqttInflight, mqttInflightBuf, sizeof(mqttInflightBuf), NULL);
+#endif
+
+
+	return OK;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetTransparentMode(int enable) {
+
+	liveBooster.transparent = enable ? 1 : 0;
+	LiveBooster_http_set_transparent(liveBooster.transparent);
+
+	return OK;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetMultiplexing(int enable) {
+
+	if (!HeraclesModem__SetMultiplexing(enable ? 1 : 0)) {
+		return FAILURE;
+	}
 
 	return OK;
 }
@@ -99,10 +142,22 @@ int LiveBooster_Connect(void) {
 	int res;
 	unsigned int index;
     const char* pMsg;
+    unsigned long t0;
 
 	/* 1 - Initializing client */
-	msgDebug->print("  ... MQTTClientInit\n");
-	MQTTClientInit(&mqttClient, liveBooster.serial, liveBooster.timer, liveBooster.debug);
+	LB_TRACE_INFO("  ... MQTTClientInit\n");
+	if (liveBooster.transparent) {
+		MQTTClientInitTransparent(&mqttClient, liveBooster.serial, liveBooster.timer, liveBooster.debug);
+	}
+	else {
+		MQTTClientInit(&mqttClient, liveBooster.serial, liveBooster.timer, liveBooster.debug);
+	}
+#if LB_MQTT_LARGE_RECV_SZ > 0
+	MQTTSetLargeBuffer(&mqttClient, mqttLargeBuf, sizeof(mqttLargeBuf));
+#endif
+#if LB_MQTT_INFLIGHT_SZ > 0
+	MQTTSetInflightStore(&mqttClient, &mqttInflight, MQTT_INFLIGHT_WINDOW, publishCompleteData);
+#endif
 
     /* 2 - Connecting to MQTT server */
     MQTTPacket_connectData connectData = MQTTPacket_connectToLo_initializer;
@@ -114,17 +169,21 @@ int LiveBooster_Connect(void) {
 			(unsigned long)(liveBooster.apiKeyP2>>32), (unsigned long)liveBooster.apiKeyP2);
     connectData.password.cstring = password;
 
-    msgDebug->print("  ... MQTTConnect\n");
+    LB_TRACE_INFO("  ... MQTTConnect\n");
     res = MQTTConnect(&mqttClient, &connectData, LB_SERV_HOST_NAME, LB_SERV_PORT, SSL_ENABLE);
 
     if (!(res == OK)) {
+    	lbStats.connect_failures++;
     	return res;
     }
+    if (lbStats.connects++) {
+    	lbStats.reconnects++;
+    }
     /* 3 - Subscribe Topic */
     index=0;
     for (index=0;index < SET_TOPIC_NB; index++) {
        if (LB_TopicSub[index].callback != NULL) {
-    	    msgDebug->print("  ... MQTTSubscribe\n");
+    	    LB_TRACE_INFO("  ... MQTTSubscribe\n");
     	   res = MQTTSubscribe(&mqttClient, LB_TopicSub[index].topicName, QOS0, LB_TopicSub[index].callback);
            if (!(res == OK)) {
     	      return res;
@@ -134,17 +193,21 @@ int LiveBooster_Connect(void) {
 
 	/* 4 - Publish Msg on topic "dev/cfg" and dev/rsc*/
 	if (liveBooster.SetParam.param_set.param_ptr != NULL) {
-		msgDebug->print("  ... mqttPublish (dev/cfg)\n");
+		LB_TRACE_INFO("  ... mqttPublish (dev/cfg)\n");
+		t0 = statsStartUs();
 		pMsg = LiveBooster_msg_encode_params_all(&liveBooster.SetParam.param_set, 0);
+		statsEndUs(&lbStats.json_encode, t0);
 		res = mqttPublish(QOS0, "dev/cfg", pMsg);
-		sprintf(traceDebug,">> Publish on \"dev/cfg\":  %s\n",pMsg); msgDebug->print(traceDebug);
+		LB_TRACE_DEBUG(">> Publish on \"dev/cfg\":  %s\n",pMsg);
 	}
 
 	if (liveBooster.SetRsc.rsc_ptr != NULL) {
-		msgDebug->print("  ... mqttPublish (dev/rsc\n");
+		LB_TRACE_INFO("  ... mqttPublish (dev/rsc\n");
+		t0 = statsStartUs();
 		pMsg = LiveBooster_msg_encode_resources(&liveBooster.SetRsc);
+		statsEndUs(&lbStats.json_encode, t0);
 		res = mqttPublish(QOS0, "dev/rsc", pMsg);
-		sprintf(traceDebug,">> Publish on \"dev/rsc\":  %s\n",pMsg); msgDebug->print(traceDebug);
+		LB_TRACE_DEBUG(">> Publish on \"dev/rsc\":  %s\n",pMsg);
     }
 
     return res;
@@ -156,9 +219,10 @@ int LiveBooster_Cycle(int timeout_ms) {
 	int ret;
 
 	if (!MQTTIsConnected(&mqttClient)) {
-		msgDebug->print("MQTT Is not Connected\n");
+		LB_TRACE_ERROR("MQTT Is not Connected\n");
 		return ERR_LB_CYCLE;
 	}
+	TRACE_SPAN_BEGIN("LiveBooster_Cycle");
 
     if (LB_TopicSub[TOPIC_CFG_UPD].callback != NULL) {
 	   /* Something to update ?  */
@@ -168,11 +232,12 @@ int LiveBooster_Cycle(int timeout_ms) {
 
     ret = processGetRsc();
 	if (ret < 0) {
-       msgDebug->print("WARNING: Problem on connection HTTP\n");
+       LB_TRACE_WARN("WARNING: Problem on connection HTTP\n");
 	}
 
 	/* Get and process some MQTT messages received from the LiveObject Server */
     ret = MQTTYield(&mqttClient, timeout_ms);
+	TRACE_SPAN_END("LiveBooster_Cycle");
 	if (ret < 0) {
         return ret;
 	}
@@ -187,13 +252,69 @@ void LiveBooster_Close(void) {
 	int ret;
 
 	ret = MQTTIsConnected(&mqttClient);
-	sprintf(traceDebug,"MQTT is connected: %d %s\n",ret, ret==0 ? " =>Non" : " =>Oui"); msgDebug->print(traceDebug);
+	LB_TRACE_INFO("MQTT is connected: %d %s\n",ret, ret==0 ? " =>Non" : " =>Oui");
 	if (ret) {
 		MQTTDisconnect(&mqttClient);
 		liveBooster.debug->print ("Disconnected !\n");
 	}
 }
 
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_GetSendStats(unsigned long* packets, unsigned long* sends) {
+
+	HeraclesTcpClientStats stats;
+
+	HeraclesTcpClient__GetStats(&mqttClient.heraclesTcpClient, &stats);
+	*packets = stats.writes;
+	*sends = stats.sends;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_FlushTraces(void) {
+	LiveBooster_TraceRecord_t rec;
+	uint32_t lost;
+	int nb = 0;
+
+	while (LiveBooster_trace_pop(&rec) == 0) {
+		LiveBooster_trace_format(&rec, traceDebug, sizeof(traceDebug));
+		msgDebug->print(traceDebug);
+		nb++;
+	}
+	lost = LiveBooster_trace_dropped();
+	if (lost) {
+		snprintf(traceDebug, sizeof(traceDebug), "... %" PRIu32 " traces lost (ring full)\n", lost);
+		msgDebug->print(traceDebug);
+	}
+	return nb;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_SetTrace(TraceInterface* trace) {
+
+	TraceSpan_Set(trace, liveBooster.timer);
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_GetStats(LiveBooster_Stats_t* stats) {
+
+	stats->client = lbStats;
+	MQTTGetStats(&mqttClient, &stats->mqtt);
+	HeraclesModem__GetStats(&stats->modem);
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_ResetStats(void) {
+
+	memset(&lbStats, 0, sizeof(lbStats));
+	MQTTResetStats(&mqttClient);
+	HeraclesModem__ResetStats();
+}
+
 /* --------------------------------------------------------------------------------- */
 /*  */
 int LiveBooster_AttachData(const char* stream_id,
@@ -253,28 +374,91 @@ int LiveBooster_AttachData(const char* stream_id,
 		}
 
 		p_dataSet->gps_ptr = gps_ptr;
+		p_dataSet->precision = -1;
 
 		p_dataSet->data_set.data_ptr = data_ptr;
 		p_dataSet->data_set.data_nb = data_nb;
 
+		/* static part of the message pre-rendered once (else fully encoded at each push) */
+		LiveBooster_msg_template_data(p_dataSet);
+
 		return data_hdl;
 	}
 	return ERR_LB_ATTACH_DATA;
 }
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetDataPrecision(int data_hdl, int decimals) {
+	if ((data_hdl < 0) || (data_hdl >= LB_MAX_OF_DATA_SET) || (liveBooster.SetData[data_hdl].stream_id[0] == 0)
+			|| (decimals < -1) || (decimals > LB_FMT_MAX_DECIMALS)) {
+		return ERR_LB_ATTACH_DATA;
+	}
+	liveBooster.SetData[data_hdl].precision = (int8_t)decimals;
+	return LB_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetDataQos(int qos, LiveBooster_CallbackDataAck_t callback) {
+	if ((qos != QOS0) && (qos != QOS1)) {
+		return ERR_LB_PUSH_DATA;
+	}
+	liveBooster.dataQos = qos;
+	liveBooster.dataAckCB = callback;
+	return LB_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetPersistence(PersistenceInterface* persistence) {
+#if LB_MQTT_INFLIGHT_SZ > 0
+	int restored;
+
+	if (MQTTIsConnected(&mqttClient)) {
+		return ERR_LB_PUSH_DATA;
+	}
+	restored = MQTTInflightStoreInit(&mqttInflight, mqttInflightBuf, sizeof(mqttInflightBuf), persistence);
+	if (restored > 0) {
+		LB_TRACE_INFO("  ... %d data messages restored\n", restored);
+	}
+	return restored;
+#else
+	(void)persistence;
+	return 0;
+#endif
+}
+
 /* --------------------------------------------------------------------------------- */
 /*  */
 int LiveBooster_PushData(int data_hdl) {
 	if ((data_hdl >= 0) && (data_hdl < LB_MAX_OF_DATA_SET)
 			&& liveBooster.SetData[data_hdl].stream_id[0] && liveBooster.SetData[data_hdl].data_set.data_ptr) {
 
-		const char *pMsg = LiveBooster_msg_encode_data(&liveBooster.SetData[data_hdl]);
+		unsigned long t0;
+		const char *pMsg;
+		int res;
+		TRACE_SPAN_BEGIN("LiveBooster_PushData");
+		TRACE_SPAN_BEGIN("encode");
+		t0 = statsStartUs();
+		pMsg = LiveBooster_msg_encode_data(&liveBooster.SetData[data_hdl]);
+		statsEndUs(&lbStats.json_encode, t0);
+		TRACE_SPAN_END("encode");
 		if (pMsg) {
-			sprintf(traceDebug,"=> PUBLISH Data %s\n",pMsg); msgDebug->print(traceDebug);
+			LB_TRACE_DEBUG("=> PUBLISH Data %s\n",pMsg);
 			/* Publish now because it is LiveObjects Client thread */
-			return mqttPublish(QOS0, "dev/data", pMsg);
+			res = mqttPublish((enum QoS)liveBooster.dataQos, "dev/data", pMsg);
+#if LB_MQTT_INFLIGHT_SZ == 0
+			if (res > 0) {
+				/* QoS 1 without in-flight store : already acknowledged */
+				publishCompleteData((unsigned short)res, 0);
+			}
+#endif
+			TRACE_SPAN_END("LiveBooster_PushData");
+			return res;
 		}
+		TRACE_SPAN_END("LiveBooster_PushData");
 	}
-	msgDebug->print("ERROR while publishing data !\n");
+	LB_TRACE_ERROR("ERROR while publishing data !\n");
 	return ERR_LB_PUSH_DATA;
 }
 
@@ -285,13 +469,27 @@ int LiveBooster_AttachCfgParameters  (const LiveBooster_Param_t* ptrParam,
 		                              uint32_t  nbParam,
 									  LiveBooster_CallbackParams_t callback) {
 
+	if (LiveBooster_msg_index_params(&liveBooster.SetParam, &liveBooster.SetUpdatedParam, ptrParam, nbParam)) {
+		return ERR_LB_ATTACH_PARAMS;
+	}
+
 	liveBooster.SetParam.param_set.param_ptr = ptrParam;
 	liveBooster.SetParam.param_set.param_nb = nbParam;
 	liveBooster.SetParam.param_callback = callback;
 
 	LB_TopicSub[TOPIC_CFG_UPD].callback = messageHandlerDevCfgUpd;
 
-	memset(&liveBooster.SetUpdatedParam, 0, sizeof(liveBooster.SetUpdatedParam));
+	liveBooster.SetUpdatedParam.cid = 0;
+	liveBooster.SetUpdatedParam.nb_of_params = 0;
+
+	return LB_SUCCESS;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_SetCfgParamsZeroCopy(int enable) {
+
+	liveBooster.SetParam.param_zero_copy = enable ? 1 : 0;
 
 	return LB_SUCCESS;
 }
@@ -301,6 +499,11 @@ int LiveBooster_AttachCfgParameters  (const LiveBooster_Param_t* ptrParam,
 int LiveBooster_AttachCommands(const LiveBooster_Command_t* ptrCmd,
 		                       int32_t cmd_nb,
 		                       LiveBooster_CallbackCommand_t callback) {
+	if ((cmd_nb < 0) || LiveBooster_msg_index_names(liveBooster.SetCmd.cmd_index, 2 * LB_MAX_OF_COMMANDS,
+			ptrCmd, sizeof(LiveBooster_Command_t), offsetof(LiveBooster_Command_t, cmd_name), cmd_nb)) {
+		return ERR_LB_ATTACH_COMMANDS;
+	}
+
 	liveBooster.SetCmd.cmd_ptr = ptrCmd;
 	liveBooster.SetCmd.cmd_nb = cmd_nb;
 	liveBooster.SetCmd.cmd_callback = callback;
@@ -317,6 +520,11 @@ int LiveBooster_AttachResources(const LiveBooster_Resource_t* rsc_ptr,
 		                        LiveBooster_CallbackResourceNotify_t ntfyCB,
 								LiveBooster_CallbackResourceData_t dataCB) {
 
+	if ((rsc_nb < 0) || LiveBooster_msg_index_names(liveBooster.SetRsc.rsc_index, 2 * LB_MAX_OF_RESOURCES,
+			rsc_ptr, sizeof(LiveBooster_Resource_t), offsetof(LiveBooster_Resource_t, rsc_name), rsc_nb)) {
+		return ERR_LB_ATTACH_RESOURCES;
+	}
+
 	liveBooster.SetRsc.rsc_ptr = rsc_ptr;
 	liveBooster.SetRsc.rsc_nb = rsc_nb;
 	liveBooster.SetRsc.rsc_cb_ntfy = ntfyCB;
@@ -345,20 +553,18 @@ int LiveBooster_GetResources(const LiveBooster_Resource_t* rsc_ptr,
 			liveBooster.SetUpdatedRsc.ursc_offset += ret;
 		}
 		else if (ret == 0) {
-			sprintf(traceDebug,
-					"No byte while reading %d bytes (offset=%"PRIu32"/%"PRIu32" of  %s)\n",
+			LB_TRACE_WARN("No byte while reading %d bytes (offset=%"PRIu32"/%"PRIu32" of  %s)\n",
 					data_len, liveBooster.SetUpdatedRsc.ursc_offset, liveBooster.SetUpdatedRsc.ursc_size,
-					rsc_ptr->rsc_name); msgDebug->print(traceDebug);
+					rsc_ptr->rsc_name);
 		}
 		else {
-			sprintf(traceDebug,
-					"ERROR(%d) while reading %d bytes (offset=%"PRIu32"/%"PRIu32" of  %s)",
+			LB_TRACE_ERROR("ERROR(%d) while reading %d bytes (offset=%"PRIu32"/%"PRIu32" of  %s)",
 					ret, data_len, liveBooster.SetUpdatedRsc.ursc_offset, liveBooster.SetUpdatedRsc.ursc_size,
-					rsc_ptr->rsc_name); msgDebug->print(traceDebug);
+					rsc_ptr->rsc_name);
 		}
 	}
 	else {
-		sprintf(traceDebug,"ERROR - No running resource download !\n"); msgDebug->print(traceDebug);
+		LB_TRACE_ERROR("ERROR - No running resource download !\n");
 		LiveBooster_http_close();
 		ret = ERR_LB_GET_RESOURCES;
 	}
@@ -399,19 +605,41 @@ static int mqttPublish(enum QoS qos, const char* topic_name, const char* payload
 	mqttMsg.payloadlen = strlen(payload_data);
 
 	res = MQTTPublish(&mqttClient, topic_name, &mqttMsg);
+	if ((res == 0) && (qos != QOS0)) {
+		res = mqttMsg.id;
+	}
 
 	return res;
 }
 
+/* --------------------------------------------------------------------------------- */
+/*  */
+static void publishCompleteData(unsigned short id, int rc) {
+
+	if (rc != 0) {
+		LB_TRACE_WARN("WARNING: data message %u not acknowledged (%d)\n", id, rc);
+	}
+	if (liveBooster.dataAckCB != NULL) {
+		TRACE_SPAN_BEGIN("callback");
+		liveBooster.dataAckCB(id, rc);
+		TRACE_SPAN_END("callback");
+	}
+}
+
 
 /* --------------------------------------------------------------------------------- */
 /*  */
 static void messageHandlerDevCfgUpd (MessageData* msg) {
 
+	unsigned long t0;
+	TRACE_SPAN_BEGIN("decode");
+	t0 = statsStartUs();
 	LiveBooster_msg_decode_params_req((const char*) msg->message->payload,
 			                           msg->message->payloadlen,
 									   &liveBooster.SetParam,
 			                           &liveBooster.SetUpdatedParam);
+	statsEndUs(&lbStats.json_decode, t0);
+	TRACE_SPAN_END("decode");
 }
 
 /* --------------------------------------------------------------------------------- */
@@ -419,20 +647,29 @@ static void messageHandlerDevCfgUpd (MessageData* msg) {
 static void messageHandlerDevCmd (MessageData* msg)  {
 	int ret;
 	int32_t cid = 0;
+	unsigned long t0;
 
+	TRACE_SPAN_BEGIN("decode");
+	t0 = statsStartUs();
 	ret = LiveBooster_msg_decode_cmd_req((const char*) msg->message->payload,
 			                             msg->message->payloadlen,
 									     &liveBooster.SetCmd,
 			                             &cid);
+	statsEndUs(&lbStats.json_decode, t0);
+	TRACE_SPAN_END("decode");
 	if (cid) {
 		const char* pMsg;
 		/* send immediately a command response */
+		TRACE_SPAN_BEGIN("response");
+		t0 = statsStartUs();
 		pMsg = LiveBooster_msg_encode_cmd_result(cid, ret);
+		statsEndUs(&lbStats.json_encode, t0);
 		if (pMsg) {
 
-			sprintf(traceDebug,"=> Publish  %s\n",pMsg); msgDebug->print(traceDebug);
+			LB_TRACE_DEBUG("=> Publish  %s\n",pMsg);
             ret = mqttPublish(QOS0, "dev/cmd/res", pMsg);
 		}
+		TRACE_SPAN_END("response");
 	}
 
 }
@@ -444,18 +681,27 @@ static void messageHandlerDevRscUpd (MessageData* msg)  {
 	LiveBooster_ResourceRespCode_t rsc_result;
 	const char* pMsg;
 	int32_t cid = 0;
+	unsigned long t0;
 
+	TRACE_SPAN_BEGIN("decode");
+	t0 = statsStartUs();
 	rsc_result = LiveBooster_msg_decode_rsc_req((const char*) msg->message->payload,
 			                                     (uint32_t)msg->message->payloadlen,
 												 &liveBooster.SetRsc,
 			                                     &liveBooster.SetUpdatedRsc,
 												 &cid);
+	statsEndUs(&lbStats.json_decode, t0);
+	TRACE_SPAN_END("decode");
 
+	TRACE_SPAN_BEGIN("response");
+	t0 = statsStartUs();
 	pMsg = LiveBooster_msg_encode_rsc_result(cid, rsc_result);
-	sprintf(traceDebug,"=> Publish Resource %s\n",pMsg); msgDebug->print(traceDebug);
+	statsEndUs(&lbStats.json_encode, t0);
+	LB_TRACE_DEBUG("=> Publish Resource %s\n",pMsg);
 	if (pMsg) {
 		mqttPublish(QOS0, "dev/rsc/upd/res", pMsg);
 	}
+	TRACE_SPAN_END("response");
 }
 
 /* --------------------------------------------------------------------------------- */
@@ -467,10 +713,12 @@ static int processGetRsc(void) {
 	if ((liveBooster.SetUpdatedRsc.ursc_cid) && (liveBooster.SetUpdatedRsc.ursc_obj_ptr)) {
 		if (liveBooster.SetRsc.rsc_cb_data) {
 			if (liveBooster.SetUpdatedRsc.ursc_connected) {
+				TRACE_SPAN_BEGIN("callback");
 				rc = liveBooster.SetRsc.rsc_cb_data(liveBooster.SetUpdatedRsc.ursc_obj_ptr,
 						                            liveBooster.SetUpdatedRsc.ursc_offset);
+				TRACE_SPAN_END("callback");
 				if (rc < 0) {
-					sprintf(traceDebug,"ERROR returned by User callback function\n"); msgDebug->print(traceDebug);
+					LB_TRACE_WARN("ERROR returned by User callback function\n");
 					rc = ERR_LB_HANDLER_PROCESS_GET_RSC;
 				}
 				else if (rc == 0) {
@@ -484,13 +732,11 @@ static int processGetRsc(void) {
 					/* Check computed MD5 value with the value given by the LO server */
 					for (i = 0; i < sizeof(computedMd5); i++) {
 						if (computedMd5[i] != liveBooster.SetUpdatedRsc.ursc_md5[i]) {
-							sprintf(traceDebug,
-									"Computed MD5 %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
+							LB_TRACE_DEBUG("Computed MD5 %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
 									computedMd5[0], computedMd5[1], computedMd5[2], computedMd5[3], computedMd5[4], computedMd5[5], computedMd5[6],
 									computedMd5[7], computedMd5[8], computedMd5[9], computedMd5[10], computedMd5[11], computedMd5[12], computedMd5[13],
-									computedMd5[14], computedMd5[15]); msgDebug->print(traceDebug);
-							sprintf(traceDebug,
-									"LO Server MD5 %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
+									computedMd5[14], computedMd5[15]);
+							LB_TRACE_DEBUG("LO Server MD5 %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
 									liveBooster.SetUpdatedRsc.ursc_md5[0], liveBooster.SetUpdatedRsc.ursc_md5[1],
 									liveBooster.SetUpdatedRsc.ursc_md5[2], liveBooster.SetUpdatedRsc.ursc_md5[3],
 									liveBooster.SetUpdatedRsc.ursc_md5[4], liveBooster.SetUpdatedRsc.ursc_md5[5],
@@ -498,9 +744,9 @@ static int processGetRsc(void) {
 									liveBooster.SetUpdatedRsc.ursc_md5[8], liveBooster.SetUpdatedRsc.ursc_md5[9],
 									liveBooster.SetUpdatedRsc.ursc_md5[10], liveBooster.SetUpdatedRsc.ursc_md5[11],
 									liveBooster.SetUpdatedRsc.ursc_md5[12], liveBooster.SetUpdatedRsc.ursc_md5[13],
-									liveBooster.SetUpdatedRsc.ursc_md5[14], liveBooster.SetUpdatedRsc.ursc_md5[15]); msgDebug->print(traceDebug);
-							sprintf(traceDebug,"MD5 ERROR - [%d] %02x != %02x\n", i, computedMd5[i],
-									liveBooster.SetUpdatedRsc.ursc_md5[i]); msgDebug->print(traceDebug);
+									liveBooster.SetUpdatedRsc.ursc_md5[14], liveBooster.SetUpdatedRsc.ursc_md5[15]);
+							LB_TRACE_ERROR("MD5 ERROR - [%d] %02x != %02x\n", i, computedMd5[i],
+									liveBooster.SetUpdatedRsc.ursc_md5[i]);
 							break;
 						}
 					}
@@ -515,14 +761,16 @@ static int processGetRsc(void) {
 
 						if (rsc_ntfy == RSC_RSP_OK) {
 						    if (liveBooster.SetRsc.rsc_ptr != NULL) {
+						        unsigned long t0 = statsStartUs();
 						        pMsg = LiveBooster_msg_encode_resources(&liveBooster.SetRsc);
-								sprintf(traceDebug,">> Publish on \"dev/rsc\":  %s\n",pMsg); msgDebug->print(traceDebug);
+						        statsEndUs(&lbStats.json_encode, t0);
+								LB_TRACE_DEBUG(">> Publish on \"dev/rsc\":  %s\n",pMsg);
 								rc = mqttPublish(QOS0, "dev/rsc", pMsg);
 						    }
 						}
 						else {
 							pMsg = LiveBooster_msg_encode_rsc_error("INVALID_RESSOURCE", "md5 error");
-							sprintf(traceDebug,"=> Publish Resource %s\n",pMsg); msgDebug->print(traceDebug);
+							LB_TRACE_DEBUG("=> Publish Resource %s\n",pMsg);
 							if (pMsg) {
 								rc = mqttPublish(QOS0, "dev/rsc/upd/err", pMsg);
 							}
@@ -532,28 +780,29 @@ static int processGetRsc(void) {
 				}
 			}
 			else {
-				sprintf(traceDebug,
-						"PROCESS PENDING RESOURCE %s - cid=%" PRIi32" retry=%d offset=%" PRIu32" => connect to %s ...\n",
+				LB_TRACE_INFO("PROCESS PENDING RESOURCE %s - cid=%" PRIi32" retry=%d offset=%" PRIu32" => connect to %s ...\n",
 						liveBooster.SetUpdatedRsc.ursc_obj_ptr->rsc_name, liveBooster.SetUpdatedRsc.ursc_cid,
 						liveBooster.SetUpdatedRsc.ursc_retry, liveBooster.SetUpdatedRsc.ursc_offset,
-						liveBooster.SetUpdatedRsc.ursc_uri); msgDebug->print(traceDebug);
+						liveBooster.SetUpdatedRsc.ursc_uri);
 
 				rc = LiveBooster_http_start(liveBooster.SetUpdatedRsc.ursc_uri,
 						                    liveBooster.SetUpdatedRsc.ursc_size,
 						                    liveBooster.SetUpdatedRsc.ursc_offset);
 				if (rc == LB_SUCCESS) {
-					sprintf(traceDebug,"PROCESS RESOURCE %s - cid=%" PRIi32" uri='%s'\n",
+					LB_TRACE_INFO("PROCESS RESOURCE %s - cid=%" PRIi32" uri='%s'\n",
 							liveBooster.SetUpdatedRsc.ursc_obj_ptr->rsc_name,
 							liveBooster.SetUpdatedRsc.ursc_cid,
-							liveBooster.SetUpdatedRsc.ursc_uri); msgDebug->print(traceDebug);
+							liveBooster.SetUpdatedRsc.ursc_uri);
 					liveBooster.SetUpdatedRsc.ursc_connected = 1;
+					httpStartMs = liveBooster.timer->millis();
+					httpStartOffset = liveBooster.SetUpdatedRsc.ursc_offset;
 					if (liveBooster.SetUpdatedRsc.ursc_offset == 0) {
 					    MD5Init(&liveBooster.SetUpdatedRsc.md5_ctx);
 					}
 				}
 				else {
 					pMsg = LiveBooster_msg_encode_rsc_error("ERROR HTTP", "Failure HTTP connection or data not received");
-					sprintf(traceDebug,"=> Publish Resource %s\n",pMsg); msgDebug->print(traceDebug);
+					LB_TRACE_DEBUG("=> Publish Resource %s\n",pMsg);
 					if (pMsg) {
 						// keep rc value
 						mqttPublish(QOS0, "dev/rsc/upd/err", pMsg);
@@ -562,17 +811,17 @@ static int processGetRsc(void) {
 			}
 		}
 		else {
-			sprintf(traceDebug,
-					"PROCESS PENDING RESOURCE cid=%" PRIi32" - %s => NO USER Callback => ABORT !\n",
-					liveBooster.SetUpdatedRsc.ursc_cid, liveBooster.SetUpdatedRsc.ursc_obj_ptr->rsc_name); msgDebug->print(traceDebug);
+			LB_TRACE_WARN("PROCESS PENDING RESOURCE cid=%" PRIi32" - %s => NO USER Callback => ABORT !\n",
+					liveBooster.SetUpdatedRsc.ursc_cid, liveBooster.SetUpdatedRsc.ursc_obj_ptr->rsc_name);
 		}
 
 		if (rc < LB_SUCCESS) {
 			if (liveBooster.SetUpdatedRsc.ursc_connected) {
 				LiveBooster_http_close();
+				statsHttpEnd();
 				if ((rc == -50) && (liveBooster.SetUpdatedRsc.ursc_offset != liveBooster.SetUpdatedRsc.ursc_size)) {
 				    pMsg = LiveBooster_msg_encode_rsc_error("ERROR HTTP", "All data not received");
-					sprintf(traceDebug,"=> Publish Resource %s\n",pMsg); msgDebug->print(traceDebug);
+					LB_TRACE_DEBUG("=> Publish Resource %s\n",pMsg);
 				    if (pMsg) {
 						rc = mqttPublish(QOS0, "dev/rsc/upd/err", pMsg);
 				    }
@@ -597,9 +846,13 @@ static int processConfig(void) {
 
 	if (liveBooster.SetParam.param_set.param_ptr != NULL) {
 		const char* pMsg;
+		unsigned long t0;
 		if (liveBooster.SetUpdatedParam.cid != 0) {
-			if ((liveBooster.SetUpdatedParam.nb_of_params) && (liveBooster.SetUpdatedParam.tab_of_param_ptr[0])) {
-				pMsg = LiveBooster_msg_encode_params_update(&liveBooster.SetUpdatedParam);
+			TRACE_SPAN_BEGIN("response");
+			t0 = statsStartUs();
+			if (liveBooster.SetUpdatedParam.nb_of_params) {
+				pMsg = LiveBooster_msg_encode_params_update(&liveBooster.SetParam.param_set, &liveBooster.SetUpdatedParam);
+				statsEndUs(&lbStats.json_encode, t0);
 				if (pMsg) {
 					rc = mqttPublish(QOS0, "dev/cfg", pMsg);
 					if (rc == 0) {
@@ -612,6 +865,7 @@ static int processConfig(void) {
 			}
 			else {
 				pMsg = LiveBooster_msg_encode_params_all(&liveBooster.SetParam.param_set, liveBooster.SetUpdatedParam.cid);
+				statsEndUs(&lbStats.json_encode, t0);
 				if (pMsg) {
 					rc = mqttPublish(QOS0, "dev/cfg", pMsg);
 					if (rc == 0) {
@@ -622,14 +876,34 @@ static int processConfig(void) {
 					liveBooster.SetUpdatedParam.cid = 0;
 				}
 			}
+			TRACE_SPAN_END("response");
 		}
 	}
 	return rc;
 }
 
+/* --------------------------------------------------------------------------------- */
+/* Start of a measure of the JSON encoding or decoding time (timer providing micros() only) */
+static unsigned long statsStartUs(void) {
+	return (liveBooster.timer->micros) ? liveBooster.timer->micros() : 0;
+}
 
+/* --------------------------------------------------------------------------------- */
+/*  */
+static void statsEndUs(StatsHistogram* histogram, unsigned long start) {
+	if (liveBooster.timer->micros) {
+		StatsHistogram_Add(histogram, liveBooster.timer->micros() - start);
+	}
+}
 
-
-
-
-
+/* --------------------------------------------------------------------------------- */
+/* End of the running resource download (completed or not) */
+static void statsHttpEnd(void) {
+	unsigned long ms = liveBooster.timer->millis() - httpStartMs;
+	unsigned long bytes = liveBooster.SetUpdatedRsc.ursc_offset - httpStartOffset;
+
+	lbStats.http_downloads++;
+	lbStats.http_bytes += bytes;
+	lbStats.http_ms += ms;
+	StatsHistogram_Add(&lbStats.http_throughput, (unsigned long) (((unsigned long long) bytes * 1000) / (ms ? ms : 1)));
+}
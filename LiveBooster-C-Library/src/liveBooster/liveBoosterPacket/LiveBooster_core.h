@@ -34,6 +34,10 @@ typedef struct {
     TimerInterface *timer;
     DebugInterface *debug;
 
+    int transparent;                     /* MQTT over a transparent connection */
+    int dataQos;                         /* QoS of the collected data */
+    LiveBooster_CallbackDataAck_t dataAckCB;
+
     LiveBooster_SetOfParams_t SetParam;
     LiveBooster_SetofUpdatedParams_t SetUpdatedParam;
     LiveBooster_SetofCommands_t SetCmd;
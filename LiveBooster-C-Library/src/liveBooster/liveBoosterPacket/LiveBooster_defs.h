@@ -44,6 +44,9 @@ enum returnCodeLiveBooster {
 					  ERR_LB_HTTP_READ_LINE = -42,
 					  ERR_LB_HTTP_READ_LINE_SMALL_BUFFER = -41,
 					  ERR_LB_HTTP_READ_LINE_NULL = -40,
+					  ERR_LB_ATTACH_RESOURCES = -37,
+					  ERR_LB_ATTACH_COMMANDS = -36,
+					  ERR_LB_ATTACH_PARAMS = -35,
 					  ERR_LB_HANDLER_PROCESS_GET_RSC = -34,
 					  ERR_LB_GET_RESOURCES = -33,
 					  ERR_LB_PUSH_DATA = -32,
@@ -124,7 +127,7 @@ typedef struct {
  * @brief Define command request header (block without argument)
  */
 typedef struct {
-	unsigned int cmd_blk_len;   /*!< Size of this allocated  memory block (including this header and all command arguments, nested just after this header) */
+	unsigned int cmd_blk_len;   /*!< Size of this memory block, only valid during the command callback (including this header and all command arguments, nested just after this header) */
 	const LiveBooster_Command_t* cmd_ptr;  /*!< Pointer to the user command */
 	int cmd_cid;               /*!< Correlation Id (required to set in command response) */
 	unsigned int cmd_args_nb;  /*!< Number of arguments (see LiveBooster_CommandRequestBlock_t if there is at least one argument) */
@@ -245,6 +248,16 @@ typedef LiveBooster_ResourceRespCode_t (*LiveBooster_CallbackResourceNotify_t)(
 typedef int (*LiveBooster_CallbackResourceData_t)(const LiveBooster_Resource_t* rsc_ptr,
 		                                          uint32_t rsc_offset);
 
+/**
+ * @brief  Type of a user callback function.
+ *         This function is called when a QoS 1 publication of collected data is completed.
+ *
+ * @param msg_id      Message identifier returned by LiveBooster_PushData()
+ * @param result      0 : acknowledged by the LiveObjects server, otherwise a negative value
+ *                    (not acknowledged after the retransmissions, connections included).
+ */
+typedef void (*LiveBooster_CallbackDataAck_t)(uint16_t msg_id, int result);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -28,6 +28,10 @@ static HeraclesTcpClient heraclesTcpClient;
 static TcpClientInterface *tcpLayer = (TcpClientInterface*)&heraclesTcpClient;
 static TimerInterface* httpTimer;
 
+/* Transparent mode: the modem HTTP application is used, the MQTT connection staying open */
+static int httpTransparent = 0;
+static uint32_t httpOffset;
+
 static char httpBuf[400];
 
 void LiveBooster_http_init(SerialInterface* serial, TimerInterface* timer, DebugInterface *debug) {
@@ -36,6 +40,10 @@ void LiveBooster_http_init(SerialInterface* serial, TimerInterface* timer, Debug
     httpTimer = timer;
 }
 
+void LiveBooster_http_set_transparent(int enable) {
+    httpTransparent = enable;
+}
+
 
 /* --------------------------------------------------------------------------------- */
 /*  */
@@ -120,6 +128,9 @@ static int http_query(const char* pURL, const char* pHost, uint32_t rsc_size, ui
 	http_build_get_query(httpBuf, sizeof(httpBuf) - 1, pURL, pHost, rsc_offset);
 
 	len = tcpLayer->write(tcpLayer, (unsigned char*)httpBuf, strlen(httpBuf));
+	if ((len == (int)strlen(httpBuf)) && tcpLayer->flush && !tcpLayer->flush(tcpLayer)) {
+		len = -1;
+	}
 	if (len != (int)strlen(httpBuf)) {
 		return ERR_LB_HTTP_QUERY_WRITE;
 	}
@@ -178,10 +189,42 @@ static int http_query(const char* pURL, const char* pHost, uint32_t rsc_size, ui
 /* --------------------------------------------------------------------------------- */
 /*  */
 void LiveBooster_http_close(void) {
+	if (httpTransparent) {
+		HeraclesModem__HttpTerm();
+		return;
+	}
 	tcpLayer->stop(tcpLayer);
 }
 
 
+/* --------------------------------------------------------------------------------- */
+/* Get the resource with the HTTP application of the modem */
+static int http_query_modem(const char* uri, uint32_t rsc_size, uint32_t rsc_offset) {
+	int http_value = 0;
+	unsigned long http_content_length = 0;
+
+	if (!HeraclesModem__HttpGet(uri, &http_value, &http_content_length)) {
+		HeraclesModem__HttpTerm();
+		return ERR_LB_HTTP_START_FAIL_CONNEXION;
+	}
+	if (http_value != 200) {
+		HeraclesModem__HttpTerm();
+		return ERR_LB_HTTP_QUERY_INCORRECT_CODE;
+	}
+	if (http_content_length == 0) {
+		HeraclesModem__HttpTerm();
+		return ERR_LB_HTTP_NULL_CONTENT_LENGTH;
+	}
+	/* the whole resource is received by the modem, the reading starts at the offset */
+	if (http_content_length != rsc_size) {
+		HeraclesModem__HttpTerm();
+		return ERR_LB_HTTP_INCORRECT_CONTENT_LENGTH;
+	}
+	httpOffset = rsc_offset;
+	return LB_SUCCESS;
+}
+
+
 /* --------------------------------------------------------------------------------- */
 /*  */
 int  LiveBooster_http_start(const char* uri, uint32_t rsc_size, uint32_t rsc_offset) {
@@ -225,6 +268,10 @@ int  LiveBooster_http_start(const char* uri, uint32_t rsc_size, uint32_t rsc_off
 		return ERR_LB_HTTP_START_URL_NOT_FOUND;
 	}
 
+	if (httpTransparent) {
+		return http_query_modem(uri, rsc_size, rsc_offset);
+	}
+
     ret = tcpLayer->connect(tcpLayer, host_name, HTTP_SERV_PORT, SSL_NOT_ENABLE);
 
 	if (ret <= 0) {
@@ -246,6 +293,16 @@ int  LiveBooster_http_start(const char* uri, uint32_t rsc_size, uint32_t rsc_off
 int  LiveBooster_http_data(char* pData, int len) {
 	int ret;
 
+	if (httpTransparent) {
+		ret = HeraclesModem__HttpRead(httpOffset, (unsigned char*)pData, len);
+		if (ret < 0) {
+			HeraclesModem__HttpTerm();
+			return ERR_LB_HTTP_STOPPED;
+		}
+		httpOffset += ret;
+		return ret;
+	}
+
 	if (!tcpLayer->connected(tcpLayer)) {
 		return ERR_LB_HTTP_DATA_DISCONNECTED;
 	}
@@ -28,6 +28,8 @@ extern "C" {
 
 void LiveBooster_http_init(SerialInterface* serial, TimerInterface* timer, DebugInterface *debug);
 
+void LiveBooster_http_set_transparent(int enable);
+
 int LiveBooster_http_start(const char* uri, uint32_t rsc_size, uint32_t rsc_offset);
 
 int  LiveBooster_http_data(char* pData, int len);
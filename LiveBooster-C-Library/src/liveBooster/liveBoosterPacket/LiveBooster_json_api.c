@@ -17,6 +17,7 @@
 
 #include "LiveBooster_json_api.h"
 #include "LiveBooster_code_b64.h"
+#include "LiveBooster_num_fmt.h"
 
 static const char* _LiveBooster_json_dataTypeStr[LB_TYPE_MAX_NOT_USED] = {
 		"unknown", "i32", "u32", "str", "f64", "bin"
@@ -82,300 +83,519 @@ LiveBooster_Type_t LB_getDataTypeFromStrL(const char* p, uint32_t len) {
 	return LB_TYPE_UNKNOWN;
 }
 
+/* --------------------------------------------------------------------------------- */
+/* Escape of the string characters: 0 = copied as is, 'u' = \u00XX, else \<char> */
+static const char _LiveBooster_json_escape[128] = {
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+	0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\', 0,  0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0
+};
+
+/* --------------------------------------------------------------------------------- */
+/* Room left before the ending NUL */
+static uint32_t json_room(const LiveBooster_JsonWriter_t* w) {
+	return (w->overflow) ? 0 : w->sz - 1 - w->len;
+}
+
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_begin(char *pbuf, uint32_t sz) {
-	int rc;
-	rc = snprintf(pbuf, sz, "{");
-	if (rc != 1) {
-		return -1;
+static void json_put(LiveBooster_JsonWriter_t* w, const char* p, uint32_t n) {
+	if (n > json_room(w)) {
+		w->overflow = 1;
+		return;
 	}
-	return 0;
+	memcpy(w->buf + w->len, p, n);
+	w->len += n;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_end(char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
-	if (*(pcur - 1) == ',') {
-		pcur--;
-		len++;
+static void json_put_char(LiveBooster_JsonWriter_t* w, char c) {
+	if (json_room(w) == 0) {
+		w->overflow = 1;
+		return;
 	}
-	rc = snprintf(pcur, sz, "}");
-	if (rc != 1) {
-		return -1;
+	w->buf[w->len++] = c;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Quoted and escaped string */
+static void json_put_string(LiveBooster_JsonWriter_t* w, const char* s) {
+	const char* run;
+	json_put_char(w, '"');
+	while (*s) {
+		unsigned char c;
+		char esc;
+		/* longest run copied as is */
+		for (run = s; (c = (unsigned char)*s) && ((c >= 0x80) || !_LiveBooster_json_escape[c]); s++) {
+		}
+		json_put(w, run, (uint32_t)(s - run));
+		if (c == 0) {
+			break;
+		}
+		esc = _LiveBooster_json_escape[c];
+		if (esc == 'u') {
+			static const char hex[] = "0123456789abcdef";
+			char seq[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+			json_put(w, seq, sizeof(seq));
+		}
+		else {
+			char seq[2] = { '\\', esc };
+			json_put(w, seq, sizeof(seq));
+		}
+		s++;
 	}
-	return 0;
+	json_put_char(w, '"');
 }
 
 /* --------------------------------------------------------------------------------- */
-/*  */
-int LiveBooster_json_add_section_start(const char* section_name, char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
-	rc = snprintf(pcur, len, "\"%s\": {", section_name);
-	if (rc < 0) {
-		return -1;
+/* Quoted base64 text, encoded straight into the output buffer (no character to escape) */
+static void json_put_b64(LiveBooster_JsonWriter_t* w, const uint8_t* p, uint32_t n) {
+	if (b64_encoded_size(n) + 2 > json_room(w)) {
+		w->overflow = 1;
+		return;
 	}
-	return 0;
+	w->buf[w->len++] = '"';
+	w->len += (uint32_t) b64_encode_chunk(p, n, w->buf + w->len);
+	w->buf[w->len++] = '"';
+}
+
+/* --------------------------------------------------------------------------------- */
+/* "name": */
+static void json_put_name(LiveBooster_JsonWriter_t* w, const char* name) {
+	json_put_string(w, name);
+	json_put_char(w, ':');
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_section_end(char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
-	if (*(pcur - 1) == ',') {
-		pcur--;
-		len++;
-	}
-	rc = snprintf(pcur, len, "},");
-	if (rc != 2) {
-		return -1;
-	}
-	return 0;
+static void json_put_i32(LiveBooster_JsonWriter_t* w, int32_t value) {
+	char tmp[LB_FMT_INT_SZ];
+	json_put(w, tmp, LiveBooster_fmt_i32(tmp, value));
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_begin_section(char *pbuf, uint32_t sz, const char* section_name) {
-	int rc;
-	rc = snprintf(pbuf, sz, "{\"%s\":{", section_name);
-	if (rc <= 0) {
-		return -1;
-	}
-	if (rc == (int) sz) {
-		return -1;
+static void json_put_u32(LiveBooster_JsonWriter_t* w, uint32_t value) {
+	char tmp[LB_FMT_INT_SZ];
+	json_put(w, tmp, LiveBooster_fmt_u32(tmp, value));
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Close an object or an array, dropping the comma of its last member */
+static void json_close(LiveBooster_JsonWriter_t* w, char c) {
+	if ((w->len > 0) && (w->buf[w->len - 1] == ',')) {
+		w->len--;
 	}
-	return 0;
+	json_put_char(w, c);
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_end_section(char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
-	if (*(pcur - 1) == ',') {
-		pcur--;
-		len++;
-	}
-	rc = snprintf(pcur, len, "}}");
-	if (rc != 2) {
-		return -1;
+int LiveBooster_json_finish(LiveBooster_JsonWriter_t* w) {
+	w->buf[w->len] = 0;
+	return (w->overflow) ? -1 : 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_json_init(LiveBooster_JsonWriter_t* w, char *pbuf, uint32_t sz) {
+	w->buf = pbuf;
+	w->sz = sz;
+	w->len = 0;
+	w->overflow = (sz == 0);
+	w->precision = -1;
+	if (sz) {
+		pbuf[0] = 0;
 	}
-	return 0;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_name_int(const char* name, int32_t value, char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
+void LiveBooster_json_begin(LiveBooster_JsonWriter_t* w) {
+	json_put_char(w, '{');
+}
 
-	rc = snprintf(pcur, len, "\"%s\":%"PRIi32",", name, value);
-	if (rc < 0) {
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_end(LiveBooster_JsonWriter_t* w) {
+	if (w->sz == 0) {
 		return -1;
 	}
-	return 0;
+	json_close(w, '}');
+	return LiveBooster_json_finish(w);
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_json_add_section_start(LiveBooster_JsonWriter_t* w, const char* section_name) {
+	json_put_name(w, section_name);
+	json_put_char(w, '{');
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_name_str(const char* name, const char* value, char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
+void LiveBooster_json_add_section_end(LiveBooster_JsonWriter_t* w) {
+	json_close(w, '}');
+	json_put_char(w, ',');
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_json_begin_section(LiveBooster_JsonWriter_t* w, const char* section_name) {
+	json_put_char(w, '{');
+	LiveBooster_json_add_section_start(w, section_name);
+}
 
-	rc = snprintf(pcur, len, "\"%s\":\"%s\",", name, value);
-	if (rc < 0) {
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_end_section(LiveBooster_JsonWriter_t* w) {
+	if (w->sz == 0) {
 		return -1;
 	}
-	return 0;
+	json_close(w, '}');
+	json_put_char(w, '}');
+	return LiveBooster_json_finish(w);
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_name_array(const char* name, const char* array, char *pbuf, uint32_t sz) {
-	int rc;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
+void LiveBooster_json_add_name_int(LiveBooster_JsonWriter_t* w, const char* name, int32_t value) {
+	json_put_name(w, name);
+	json_put_i32(w, value);
+	json_put_char(w, ',');
+}
 
-	rc = snprintf(pcur, len, "\"%s\":[%s],", name, array);
-	if (rc < 0) {
-		return -1;
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_json_add_name_str(LiveBooster_JsonWriter_t* w, const char* name, const char* value) {
+	json_put_name(w, name);
+	json_put_string(w, value);
+	json_put_char(w, ',');
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_json_add_name_array(LiveBooster_JsonWriter_t* w, const char* name, const char* array) {
+	json_put_name(w, name);
+	json_put_char(w, '[');
+	json_put(w, array, strlen(array));
+	json_put(w, "],", 2);
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+static void json_put_float(LiveBooster_JsonWriter_t* w, float value, int flags) {
+#if defined(ARDUINO_ARCH_AVR)
+	/* Need 1 for sign + 1 digit + 1 decimal-point + 6 digits + 'e' + sign + 2 for exponent */
+	char* pcur = w->buf + w->len;
+	if (json_room(w) < 13) {
+		w->overflow = 1;
+		return;
 	}
-	return 0;
+	if (dtostre((double)value, pcur, 6, flags) != pcur) {
+		w->overflow = 1;
+		return;
+	}
+	w->len += strlen(pcur);
+#else
+	char tmp[LB_FMT_FLOAT_SZ];
+	(void)flags;
+	json_put(w, tmp, LiveBooster_fmt_float(tmp, value, w->precision));
+#endif
+}
+
+/* --------------------------------------------------------------------------------- */
+/* "name":[lat,long], at the float precision whatever the writer precision */
+void LiveBooster_json_add_name_gps(LiveBooster_JsonWriter_t* w, const char* name, float lat, float lon) {
+	int8_t precision = w->precision;
+	w->precision = -1;
+	json_put_name(w, name);
+	json_put_char(w, '[');
+	json_put_float(w, lat, 0);
+	json_put_char(w, ',');
+	json_put_float(w, lon, 0);
+	json_put(w, "],", 2);
+	w->precision = precision;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_item(const LiveBooster_Data_t* data_ptr, char *pbuf, uint32_t sz) {
-	int rc;
-	short i;
-	short dim;
-	char* data_value_ptr;
-	int len = sz - strlen(pbuf);
-	char* pcur = pbuf + strlen(pbuf);
+void LiveBooster_json_add_raw(LiveBooster_JsonWriter_t* w, const char* p, uint32_t len) {
+	json_put(w, p, len);
+}
 
-	/* Check input parameters */
+/* --------------------------------------------------------------------------------- */
+/*  */
+static int json_check_item(const LiveBooster_Data_t* data_ptr) {
 	if (data_ptr == NULL) {
 		return -1;
 	}
 	if ((data_ptr->data_name == NULL) || (data_ptr->data_value == NULL) || (data_ptr->data_dim <= 0)) {
 		return -1;
 	}
-	
-	/* Add data name */
-	rc = snprintf(pcur, len, "\"%s\":", data_ptr->data_name);
-	if (rc < 0) {
-		return -1;
-	}
-	len = sz - strlen(pbuf);
-	pcur = pbuf + strlen(pbuf);
-	if (len < 4) { /* at least 4 free bytes remaining in buffer */
+	if ((data_ptr->data_type != LB_TYPE_INT32) && (data_ptr->data_type != LB_TYPE_UINT32) &&
+		(data_ptr->data_type != LB_TYPE_FLOAT) && (data_ptr->data_type != LB_TYPE_STRING_C)) {
 		return -1;
 	}
+	return 0;
+}
 
-	/* Open array if needed */
-	dim = data_ptr->data_dim;
-	if (dim > 1) {
-		*pcur++ = '[';
-		len--;
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_add_item_name(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* data_ptr) {
+	if (json_check_item(data_ptr)) {
+		return -1;
 	}
-	else if (dim <= 0) {
-		dim = 1;
+	json_put_name(w, data_ptr->data_name);
+	if (data_ptr->data_dim > 1) {
+		json_put_char(w, '[');
 	}
+	return 0;
+}
 
-	data_value_ptr = (char*)data_ptr->data_value;
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_add_item_values(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* data_ptr) {
+	short i;
+	const char* data_value_ptr;
 
-	/* Add value(s) */
-	for (i=0; i<dim; i++) {
+	if (json_check_item(data_ptr)) {
+		return -1;
+	}
+	data_value_ptr = (const char*)data_ptr->data_value;
+	for (i = 0; (i < data_ptr->data_dim) && !w->overflow; i++) {
+		if (i > 0) {
+			json_put_char(w, ',');
+		}
 		switch (data_ptr->data_type) {
 		case LB_TYPE_INT32:
-			rc = snprintf(pcur, len, "%"PRIi32",", *((int32_t*) data_value_ptr));
+			json_put_i32(w, *((const int32_t*) data_value_ptr));
 			data_value_ptr += sizeof(int32_t);
 			break;
 		case LB_TYPE_UINT32:
-			rc = snprintf(pcur, len, "%"PRIu32",", *((uint32_t*)data_value_ptr));
+			json_put_u32(w, *((const uint32_t*)data_value_ptr));
 			data_value_ptr += sizeof(uint32_t);
 			break;
 		case LB_TYPE_FLOAT:
-#if defined(ARDUINO_ARCH_AVR)
-		    /* Need 1 for sign + 1 digit + 1 decimal-point + 6 digits + 'e' + sign + 2 for exponent */
-		    if (len < 13) {
-		        return -1;
-		    }
-	        if (dtostre((double)(*((float*)data_value_ptr)), pcur, 6, 0) != pcur) {
-	            return -1;
-	        }
-#else
-            rc = snprintf(pcur, len, "%f,", *((float*)data_value_ptr));
-#endif
-            data_value_ptr += sizeof(float);
-		    break;
-		case LB_TYPE_STRING_C:
-			rc = snprintf(pcur, len, "\"%s\",", (const char*)data_value_ptr);
+			json_put_float(w, *((const float*)data_value_ptr), 0);
+			data_value_ptr += sizeof(float);
+			break;
+		default: /* LB_TYPE_STRING_C */
+			json_put_string(w, data_value_ptr);
 			data_value_ptr += sizeof(char*);
 			break;
-		default:
-			return -1;
-		}
-		/* Update remaining buffer size */
-		if (dim > 1) {
-			len = sz - strlen(pbuf);
-			pcur = pbuf + strlen(pbuf);
-			if (len < 2) { /* at least 2 free bytes remaining in buffer */
-				return -1;
-			}		
 		}
 	}
+	return 0;
+}
 
-	/* Close array if needed */
-	if (dim > 1) {
-		pcur--;
-		if ((*pcur != ',')  || (len < 2)){
-			return -1;
-		}
-		*pcur++ = ']';
-		*pcur++ = ',';
-		*pcur = 0;
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_add_item(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* data_ptr) {
+	if (LiveBooster_json_add_item_name(w, data_ptr)) {
+		return -1;
 	}
-
+	LiveBooster_json_add_item_values(w, data_ptr);
+	if (data_ptr->data_dim > 1) {
+		json_put_char(w, ']');
+	}
+	json_put_char(w, ',');
 	return 0;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-int LiveBooster_json_add_param(const LiveBooster_Data_t* data_ptr, char *pbuf, uint32_t sz) {
-
-    if ((data_ptr->data_type == LB_TYPE_INT32) || (data_ptr->data_type == LB_TYPE_UINT32) ||
-        (data_ptr->data_type == LB_TYPE_STRING_C) || (data_ptr->data_type == LB_TYPE_FLOAT) ||
-        (data_ptr->data_type == LB_TYPE_BIN))
-    {
-        int rc;
-        int len = sz - strlen(pbuf);
-        char* pcur = pbuf + strlen(pbuf);
-
-    	char bufB64[550];
-    	char *pbufB64 = bufB64;
-
-        /* Add param name */
-        rc = snprintf(pcur, len, "\"%s\":{", data_ptr->data_name);
-        if (rc < 0) {
-            return -1;
-        }
-
-        len = sz - strlen(pbuf);
-        pcur = pbuf + strlen(pbuf);
-
-        /* Add param type and value */
-        switch (data_ptr->data_type) {
-        case LB_TYPE_INT32:
-            rc = snprintf(pcur, len, "\"t\":\"i32\",\"v\":%d},", *((int*) data_ptr->data_value));
-            break;
-        case LB_TYPE_UINT32:
-            rc = snprintf(pcur, len, "\"t\":\"u32\",\"v\":%u},", *((unsigned int*) data_ptr->data_value));
-            break;
-        case LB_TYPE_FLOAT:
+int LiveBooster_json_add_param(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* data_ptr) {
+	if (data_ptr->data_name == NULL) {
+		return -1;
+	}
+
+	/* Add param name, type and value */
+	switch (data_ptr->data_type) {
+	case LB_TYPE_INT32:
+		json_put_name(w, data_ptr->data_name);
+		json_put(w, "{\"t\":\"i32\",\"v\":", 15);
+		json_put_i32(w, *((int32_t*) data_ptr->data_value));
+		json_put(w, "},", 2);
+		break;
+	case LB_TYPE_UINT32:
+		json_put_name(w, data_ptr->data_name);
+		json_put(w, "{\"t\":\"u32\",\"v\":", 15);
+		json_put_u32(w, *((uint32_t*) data_ptr->data_value));
+		json_put(w, "},", 2);
+		break;
+	case LB_TYPE_FLOAT:
+		json_put_name(w, data_ptr->data_name);
+		json_put(w, "{\"t\":\"f64\",\"v\":", 15);
 #if defined(ARDUINO_ARCH_AVR)
-            /* Need 14 for param type
-             *     + 1 for sign + 1 digit + 1 decimal-point + 6 digits + 'e' + sign + 2 for exponent
-             *     + 2 for ending brace and comma */
-            if (len < (14+13+2)) {
-                return -1;
-            }
-
-            strcpy(pcur, "\"t\":\"f64\",\"v\":");
-            pcur += 14;
-            len -= 14;
-            if (dtostre((double)(*((float*) data_ptr->data_value)), pcur, 6, DTOSTR_ALWAYS_SIGN) != pcur) {
-                return -1;
-            }
-            pcur += 13;
-            len -= 13;
-            strcpy(pcur, "},");
+		json_put_float(w, *((float*) data_ptr->data_value), DTOSTR_ALWAYS_SIGN);
 #else
-           rc = snprintf(pcur, len, "\"t\":\"f64\",\"v\":%f},", *((float*) data_ptr->data_value));
+		json_put_float(w, *((float*) data_ptr->data_value), 0);
 #endif
-            break;
-        case LB_TYPE_STRING_C:
-            rc = snprintf(pcur, len, "\"t\":\"str\",\"v\":\"%s\"},", (const char*) data_ptr->data_value);
-            break;
-        case LB_TYPE_BIN:
-        	b64_encode((const char*)data_ptr->data_value, bufB64, strlen(data_ptr->data_value));
-            rc = snprintf(pcur, len, "\"t\":\"bin\",\"v\":\"%s\"},", bufB64);
-            break;
-        default:
-            return -1;
-        }
-        return 0;
-    }
-    return -1;
+		json_put(w, "},", 2);
+		break;
+	case LB_TYPE_STRING_C:
+		json_put_name(w, data_ptr->data_name);
+		json_put(w, "{\"t\":\"str\",\"v\":", 15);
+		json_put_string(w, (const char*) data_ptr->data_value);
+		json_put(w, "},", 2);
+		break;
+	case LB_TYPE_BIN:
+		json_put_name(w, data_ptr->data_name);
+		json_put(w, "{\"t\":\"bin\",\"v\":", 15);
+		json_put_b64(w, (const uint8_t*) data_ptr->data_value, strlen((const char*) data_ptr->data_value));
+		json_put(w, "},", 2);
+		break;
+	default:
+		return -1;
+	}
+	return 0;
 }
 
+/* --------------------------------------------------------------------------------- */
+/*  */
+static const char* json_skip_ws(const char* p, const char* end) {
+	while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+		p++;
+	}
+	return p;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* "p" on the opening quote : return the closing one, or NULL */
+static const char* json_scan_string(const char* p, const char* end) {
+	for (p++; p < end; p++) {
+		if (*p == '"') {
+			return p;
+		}
+		if (*p == '\\') {
+			p++;
+		}
+	}
+	return NULL;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_json_parse(const char* p, uint32_t len, LiveBooster_JsonHandler_t handler, void* ctx) {
+	const char* end = p + len;
+	char stack[LB_JSON_MAX_DEPTH];  /* '{' or '[' of each open container */
+	uint8_t depth = 0;
+	LiveBooster_JsonItem_t item;
+	int ret;
+
+	if ((p == NULL) || (handler == NULL)) {
+		return -1;
+	}
+	p = json_skip_ws(p, end);
+	if (p == end) {
+		return 0;
+	}
+
+	for (;;) {
+		/* member name */
+		item.key = NULL;
+		item.key_len = 0;
+		if ((depth > 0) && (stack[depth - 1] == '{')) {
+			const char* q;
+			p = json_skip_ws(p, end);
+			if ((p == end) || (*p != '"') || ((q = json_scan_string(p, end)) == NULL)) {
+				return -1;
+			}
+			item.key = p + 1;
+			item.key_len = (uint32_t)(q - p - 1);
+			p = json_skip_ws(q + 1, end);
+			if ((p == end) || (*p != ':')) {
+				return -1;
+			}
+			p++;
+		}
+
+		/* value */
+		p = json_skip_ws(p, end);
+		if (p == end) {
+			return -1;
+		}
+		item.depth = depth;
+		item.val = p;
+		if ((*p == '{') || (*p == '[')) {
+			if (depth == LB_JSON_MAX_DEPTH) {
+				return -1;
+			}
+			stack[depth++] = *p;
+			item.val_len = 1;
+			ret = handler(ctx, (*p == '{') ? LB_JSON_OBJECT : LB_JSON_ARRAY, &item);
+			if (ret) {
+				return ret;
+			}
+			p = json_skip_ws(p + 1, end);
+			if ((p == end) || (*p != ((stack[depth - 1] == '{') ? '}' : ']'))) {
+				continue;   /* first member */
+			}
+		}
+		else if (*p == '"') {
+			const char* q = json_scan_string(p, end);
+			if (q == NULL) {
+				return -1;
+			}
+			item.val = p + 1;
+			item.val_len = (uint32_t)(q - p - 1);
+			ret = handler(ctx, LB_JSON_STRING, &item);
+			if (ret) {
+				return ret;
+			}
+			p = q + 1;
+		}
+		else {
+			const char* q = p;
+			while ((q < end) && (((*q >= '0') && (*q <= '9')) || ((*q >= 'a') && (*q <= 'z')) ||
+					(*q == '-') || (*q == '+') || (*q == '.') || (*q == 'E'))) {
+				q++;
+			}
+			if (q == p) {
+				return -1;
+			}
+			item.val_len = (uint32_t)(q - p);
+			ret = handler(ctx, LB_JSON_PRIMITIVE, &item);
+			if (ret) {
+				return ret;
+			}
+			p = q;
+		}
+
+		/* after a value : ",", or the end of the enclosing containers */
+		for (;;) {
+			p = json_skip_ws(p, end);
+			if (depth == 0) {
+				return (p == end) ? 0 : -1;
+			}
+			if (p == end) {
+				return -1;
+			}
+			if (*p == ',') {
+				p++;
+				break;
+			}
+			if (*p != ((stack[depth - 1] == '{') ? '}' : ']')) {
+				return -1;
+			}
+			depth--;
+			item.key = NULL;
+			item.key_len = 0;
+			item.val = p;
+			item.val_len = 1;
+			item.depth = depth;
+			ret = handler(ctx, (*p == '}') ? LB_JSON_OBJECT_END : LB_JSON_ARRAY_END, &item);
+			if (ret) {
+				return ret;
+			}
+			p++;
+		}
+	}
+}
@@ -25,27 +25,99 @@ const char* LB_getDataTypeToStr(LiveBooster_Type_t objType);
 
 LiveBooster_Type_t LB_getDataTypeFromStrL(const char* p, uint32_t len);
 
-int LiveBooster_json_begin(char *pbuf, uint32_t sz);
+/**
+ * @brief JSON writer : cursor and remaining space in the output buffer.
+ *
+ * The members are written in a single pass, each one followed by a comma (dropped when its
+ * object or array is closed). When the buffer is full, the next writes are ignored and the
+ * overflow is reported once by LiveBooster_json_end() or LiveBooster_json_end_section().
+ */
+typedef struct {
+	char*    buf;       /*!< Output buffer */
+	uint32_t sz;        /*!< Size of the output buffer (including the ending NUL) */
+	uint32_t len;       /*!< Written bytes */
+	uint8_t  overflow;  /*!< Set when a write did not fit */
+	int8_t   precision; /*!< Max decimals of the float values, -1 (default) = shortest round-trip form */
+} LiveBooster_JsonWriter_t;
+
+void LiveBooster_json_init(LiveBooster_JsonWriter_t* w, char *pbuf, uint32_t sz);
+
+/* "{" ... "}" : return 0, or -1 if the buffer overflowed */
+void LiveBooster_json_begin(LiveBooster_JsonWriter_t* w);
+
+int LiveBooster_json_end(LiveBooster_JsonWriter_t* w);
+
+/* "{"name":{" ... "}}" : return 0, or -1 if the buffer overflowed */
+void LiveBooster_json_begin_section(LiveBooster_JsonWriter_t* w, const char* name);
+
+int LiveBooster_json_end_section(LiveBooster_JsonWriter_t* w);
+
+/* Terminate the written text as it is : return 0, or -1 if the buffer overflowed */
+int LiveBooster_json_finish(LiveBooster_JsonWriter_t* w);
+
+void LiveBooster_json_add_section_start(LiveBooster_JsonWriter_t* w, const char* section_name);
+
+void LiveBooster_json_add_section_end(LiveBooster_JsonWriter_t* w);
 
-int LiveBooster_json_end(char *pbuf, uint32_t sz);
+void LiveBooster_json_add_name_int(LiveBooster_JsonWriter_t* w, const char* name, int32_t value);
 
-int LiveBooster_json_begin_section(char *pbuf, uint32_t sz, const char* name);
+/* "value" is escaped */
+void LiveBooster_json_add_name_str(LiveBooster_JsonWriter_t* w, const char* name, const char* value);
 
-int LiveBooster_json_end_section(char *pbuf, uint32_t sz);
+/* "array" is already JSON formatted */
+void LiveBooster_json_add_name_array(LiveBooster_JsonWriter_t* w, const char* name, const char* array);
 
-int LiveBooster_json_add_section_start(const char* section_name, char *pbuf, uint32_t sz);
+void LiveBooster_json_add_name_gps(LiveBooster_JsonWriter_t* w, const char* name, float lat, float lon);
 
-int LiveBooster_json_add_section_end(char *pbuf, uint32_t sz);
+/* "p" is already JSON formatted */
+void LiveBooster_json_add_raw(LiveBooster_JsonWriter_t* w, const char* p, uint32_t len);
 
-int LiveBooster_json_add_name_int(const char* name, int32_t value, char *pbuf, uint32_t sz);
+/* "name":value, or "name":[values] : return -1 if the data is invalid, else 0 */
+int LiveBooster_json_add_item(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* p);
 
-int LiveBooster_json_add_name_str(const char* name, const char* value, char *pbuf, uint32_t sz);
+/* Same as LiveBooster_json_add_item(), in two parts : "name": (and "[" for an array) ... */
+int LiveBooster_json_add_item_name(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* p);
 
-int LiveBooster_json_add_name_array(const char* name, const char* array, char *pbuf, uint32_t sz);
+/* ... then the value(s), separated by commas, without the ending one */
+int LiveBooster_json_add_item_values(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* p);
 
-int LiveBooster_json_add_item(const LiveBooster_Data_t* p, char *pbuf, uint32_t sz);
+int LiveBooster_json_add_param(LiveBooster_JsonWriter_t* w, const LiveBooster_Data_t* p);
 
-int LiveBooster_json_add_param(const LiveBooster_Data_t* p, char *pbuf, uint32_t sz);
+/**
+ * @brief JSON reader events, in the order of the text.
+ */
+typedef enum {
+	LB_JSON_STRING = 0,   /*!< String value : "val" is the text between the quotes (escapes not decoded) */
+	LB_JSON_PRIMITIVE,    /*!< Number, true, false or null : "val" is the text of the value */
+	LB_JSON_OBJECT,       /*!< "{" */
+	LB_JSON_OBJECT_END,   /*!< "}" */
+	LB_JSON_ARRAY,        /*!< "[" */
+	LB_JSON_ARRAY_END     /*!< "]" */
+} LiveBooster_JsonEvent_t;
+
+/**
+ * @brief JSON reader item : pointers into the parsed text, which is neither copied nor modified.
+ */
+typedef struct {
+	const char* key;   /*!< Member name (without the quotes), NULL for an array element or the root value */
+	uint32_t key_len;  /*!< Length of the member name */
+	const char* val;   /*!< Value text (see LiveBooster_JsonEvent_t) */
+	uint32_t val_len;  /*!< Length of the value text */
+	uint8_t depth;     /*!< Number of enclosing objects and arrays : 1 for a member of the root object */
+} LiveBooster_JsonItem_t;
+
+/* Called for each event : return 0 to continue, otherwise the parse stops and returns this value */
+typedef int (*LiveBooster_JsonHandler_t)(void* ctx, LiveBooster_JsonEvent_t ev, const LiveBooster_JsonItem_t* item);
+
+/* Max nesting of objects and arrays accepted by LiveBooster_json_parse() */
+#define LB_JSON_MAX_DEPTH  8
+
+/**
+ * Parse the "len" bytes of "p" (not NUL terminated) in a single pass, calling "handler" for each
+ * value, without token array nor limit on the number of members.
+ * @return 0 if ok (or empty text), -1 on a syntax error, or the first non zero value returned by the handler.
+ */
+int LiveBooster_json_parse(const char* p, uint32_t len, LiveBooster_JsonHandler_t handler, void* ctx);
 
 #if defined(__cplusplus)
 }
@@ -41,6 +41,15 @@ typedef struct {
 	int param_nb;                           /*!< Number of elements in array */
 } LiveBooster_ArrayOfParams_t;
 
+/**
+ * @brief Slot of a hash index of names (open addressing, 2 slots per entry)
+ */
+typedef struct {
+	uint16_t entry;  /*!< Index of the entry in the user array + 1, 0 = free slot */
+	uint8_t len;     /*!< Length of its name */
+	uint8_t tag;     /*!< High byte of the hash of its name */
+} LiveBooster_NameSlot_t;
+
 /**
  * @brief Define a set of user 'status' to be published to the LiveObjects server
  */
@@ -48,6 +57,29 @@ typedef struct {
 	LiveBooster_ArrayOfData_t data_set;  /*!< Array of data : 'status' elements */
 } LiveBooster_SetOfStatus_t;
 
+#if LB_JSON_TMPL_SZ > 0
+#define LB_TMPL_SLOT_GPS  (-1)
+#define LB_TMPL_SLOT_END  (-2)
+
+/**
+ * @brief Value slot of a pre-rendered data message
+ */
+typedef struct {
+	uint16_t text_len;  /*!< Length of the static text before the slot */
+	int8_t slot;        /*!< Index of the data element, LB_TMPL_SLOT_GPS or LB_TMPL_SLOT_END */
+} LiveBooster_TmplSlot_t;
+
+/**
+ * @brief Pre-rendered data message : static JSON fragments (stream id, model, tags, data names)
+ *        cut by the value slots filled at each push
+ */
+typedef struct {
+	char text[LB_JSON_TMPL_SZ];                        /*!< Static fragments, one after the other */
+	LiveBooster_TmplSlot_t slots[LB_JSON_TMPL_SLOTS];  /*!< Value slots, in order */
+	uint8_t slot_nb;                                   /*!< Number of slots, 0 = no template */
+} LiveBooster_DataTemplate_t;
+#endif
+
 /**
  * @brief Define a set of user data to be published to the LiveBooster_ server
  *        in a same stream flow (and also in the same time)
@@ -59,6 +91,10 @@ typedef struct {
 	char model[LB_SETOFDATA_MODEL_SZ];          /*!< model */
 	char tags[LB_SETOFDATA_TAGS_SZ];            /*!< tags in JSON format */
 	char timestamp[24];                         /*!< Time to ISO 8601 format */
+	int8_t precision;                           /*!< Max decimals of the float values, -1 = shortest round-trip form */
+#if LB_JSON_TMPL_SZ > 0
+	LiveBooster_DataTemplate_t tmpl;            /*!< Pre-rendered message (see LiveBooster_msg_template_data) */
+#endif
 } LiveBooster_SetOfData_t;
 
 /**
@@ -68,6 +104,9 @@ typedef struct {
 typedef struct {
 	LiveBooster_ArrayOfParams_t param_set;                 /*!< Array of configuration parameters */
 	LiveBooster_CallbackParams_t param_callback; /*!< User callback function, called when parameter is updated */
+	LiveBooster_NameSlot_t* param_index;         /*!< Parameter names (see LiveBooster_msg_index_params) */
+	uint32_t param_slot_nb;                      /*!< Number of slots of param_index */
+	uint8_t param_zero_copy;                     /*!< 1 : string values given in the received message, not NUL terminated */
 } LiveBooster_SetOfParams_t;
 
 /**
@@ -76,8 +115,8 @@ typedef struct {
  */
 typedef struct {
 	int32_t cid;                      /*!< Correlation Identifier */
-	int32_t nb_of_params;             /*!< Number of elements in tab_of_param_ptr */
-	const LiveBooster_Param_t* tab_of_param_ptr[LB_MAX_OF_PARSED_PARAMS]; /*!< array of configuration parameters */
+	int32_t nb_of_params;             /*!< Number of updated parameters */
+	uint32_t* updated_mask;           /*!< Bit i set : parameter i of the attached array is updated (see LiveBooster_msg_index_params) */
 } LiveBooster_SetofUpdatedParams_t;
 
 /**
@@ -88,6 +127,7 @@ typedef struct {
 	const LiveBooster_Command_t* cmd_ptr;         /*!< Address of the first LiveObjects command element in array */
 	int cmd_nb;                                    /*!< Number of elements in array */
 	LiveBooster_CallbackCommand_t cmd_callback;   /*!< User callback function called to process the received command */
+	LiveBooster_NameSlot_t cmd_index[2 * LB_MAX_OF_COMMANDS]; /*!< Command names (see LiveBooster_msg_index_names) */
 } LiveBooster_SetofCommands_t;
 
 /**
@@ -100,6 +140,7 @@ typedef struct {
 	LiveBooster_CallbackResourceNotify_t rsc_cb_ntfy; /*!< User callback function called to notify begin/end of transfer */
 	LiveBooster_CallbackResourceData_t rsc_cb_data;   /*!< User callback function called to notify that data can be read */
 	uint8_t pushtoLBServer;
+	LiveBooster_NameSlot_t rsc_index[2 * LB_MAX_OF_RESOURCES]; /*!< Resource names (see LiveBooster_msg_index_names) */
 } LiveBooster_SetOfResources_t;
 
 /**
@@ -128,6 +169,13 @@ const char* LiveBooster_msg_encode_status(const LiveBooster_ArrayOfData_t* p);
 
 const char* LiveBooster_msg_encode_data(const LiveBooster_SetOfData_t* p);
 
+/**
+ * @brief Pre-render the static part of the data message (names and types of the data elements are then fixed).
+ *        Return 0, or -1 if it does not fit in LB_JSON_TMPL_SZ / LB_JSON_TMPL_SLOTS :
+ *        the message is then fully encoded by LiveBooster_msg_encode_data()
+ */
+int LiveBooster_msg_template_data(LiveBooster_SetOfData_t* p);
+
 const char* LiveBooster_msg_encode_resources(const LiveBooster_SetOfResources_t* p);
 
 const char* LiveBooster_msg_encode_params_all(const LiveBooster_ArrayOfParams_t* p, int32_t cid);
@@ -138,7 +186,7 @@ const char* LiveBooster_msg_encode_rsc_result(int32_t cid, LiveBooster_ResourceR
 
 const char* LiveBooster_msg_encode_rsc_error(char* error, char* errorDetails);
 
-const char* LiveBooster_msg_encode_params_update(const LiveBooster_SetofUpdatedParams_t* p);
+const char* LiveBooster_msg_encode_params_update(const LiveBooster_ArrayOfParams_t* p, const LiveBooster_SetofUpdatedParams_t* u);
 
 const char* LiveBooster_msg_encode_cmd_result(int32_t cid, int result);
 
@@ -151,12 +199,38 @@ LiveBooster_ResourceRespCode_t LiveBooster_msg_decode_rsc_req(const char* payloa
 /**
  * @brief Decode a received JSON message to update configuration parameters
  *
+ * The string values (unless param_zero_copy) and the binary (base64) values are copied or decoded into a buffer
+ * of the library, NUL terminated (see LB_PARAM_VALUE_SZ) : the payload is not modified.
  */
 int LiveBooster_msg_decode_params_req(const char* payload_data, uint32_t payload_len, const LiveBooster_SetOfParams_t* p,
 		LiveBooster_SetofUpdatedParams_t* r);
 
 int LiveBooster_msg_decode_cmd_req(const char* payload_data, uint32_t payload_len, const LiveBooster_SetofCommands_t* p, int32_t* pCid);
 
+/**
+ * @brief Build the hash index of the names of a user array (parameters, commands or resources) :
+ *        "entry_sz" is the size of an element, "name_offset" the offset of its "const char*" name.
+ *        Return 0, or -1 if there are more than slot_nb / 2 elements or a name is longer than 255.
+ */
+int LiveBooster_msg_index_names(LiveBooster_NameSlot_t* index, uint32_t slot_nb,
+		const void* entries, uint32_t entry_sz, uint32_t name_offset, uint32_t nb);
+
+/**
+ * @brief Build the index of the names of the configuration parameters and the mask of their updates,
+ *        in static memory for at most LB_MAX_OF_CFG_PARAMS parameters, or allocated by malloc() for "nb" parameters
+ *        when LB_MAX_OF_CFG_PARAMS is 0 (freed by the next call). Only one set is indexed at a time.
+ *        Return 0, or -1 if there are too many parameters, the allocation fails or a name is longer than 255
+ *        (the previous index is kept).
+ */
+int LiveBooster_msg_index_params(LiveBooster_SetOfParams_t* p, LiveBooster_SetofUpdatedParams_t* r,
+		const LiveBooster_Param_t* params, uint32_t nb);
+
+/**
+ * @brief Find "name" (not NUL terminated) in an indexed user array : return its element index, or -1.
+ */
+int LiveBooster_msg_find_name(const LiveBooster_NameSlot_t* index, uint32_t slot_nb,
+		const void* entries, uint32_t entry_sz, uint32_t name_offset, const char* name, uint32_t len);
+
 extern DebugInterface *msgDebug;
 extern char traceDebug[500];
 
@@ -8,9 +8,13 @@
 /**
  * @file  LiveBooster_msg_decode.c
  * @brief Decode and process the received JSON messages
+ *
+ * The messages are read in a single pass by LiveBooster_json_parse() : each member is processed
+ * when it is met, in any order. The payload is read in place, it is never modified.
  */
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -18,157 +22,322 @@
 
 #include "LiveBooster_msg.h"
 #include "LiveBooster_json_api.h"
-
-#include "../../jsonParser/jsmn.h"
+#include "LiveBooster_num_fmt.h"
+#include "LiveBooster_trace.h"
 
 #include "LiveBooster_config.h"
 #include "LiveBooster_code_b64.h"
 
+#include "../../traceDebug/TraceSpan.h"
+
+/* Is the member name of "item" equal to the string literal "name" ? */
+#define IS_KEY(item, name)  (((item)->key_len == sizeof(name) - 1) && !memcmp((item)->key, name, sizeof(name) - 1))
 
 /* --------------------------------------------------------------------------------- */
-/*  */
-static int check_token(const char* payload_json, const jsmntok_t* token, const char* name) {
-	if ((payload_json == NULL) || (token == NULL) || (name == NULL) || (*name == 0)) {
-		return -1;
+/* FNV-1a */
+static uint32_t hash_name(const char* name, uint32_t len) {
+	uint32_t h = 2166136261UL;
+	while (len--) {
+		h = (h ^ (uint8_t) *name++) * 16777619UL;
 	}
-	if (token->type == JSMN_STRING) {
-		unsigned int tk_len = token->end - token->start;
-		const char* tk_ptr = payload_json + token->start;
-		if ((tk_len == strlen(name)) && !strncmp(tk_ptr, name, tk_len)) {
-			return 1;
-		}
-	}
-	return 0;
+	return h;
 }
 
+#define ENTRY_NAME(entries, entry_sz, name_offset, i) \
+	(*(const char* const*) ((const char*) (entries) + (i) * (entry_sz) + (name_offset)))
+
 /* --------------------------------------------------------------------------------- */
 /*  */
-static int isValidTokenPrimitive(const char* payload_json, const jsmntok_t* token) {
-	if ((payload_json == NULL) || (token == NULL)) {
+int LiveBooster_msg_index_names(LiveBooster_NameSlot_t* index, uint32_t slot_nb,
+		const void* entries, uint32_t entry_sz, uint32_t name_offset, uint32_t nb) {
+	uint32_t i;
+
+	if ((index == NULL) || (nb > slot_nb / 2) || (nb && (entries == NULL))) {
 		return -1;
 	}
-	if (token->type != JSMN_PRIMITIVE) {
-		return -1;
+	memset(index, 0, slot_nb * sizeof(LiveBooster_NameSlot_t));
+	for (i = 0; i < nb; i++) {
+		const char* name = ENTRY_NAME(entries, entry_sz, name_offset, i);
+		uint32_t len;
+		uint32_t h;
+		uint32_t s;
+
+		if (name == NULL) {
+			continue;
+		}
+		len = strlen(name);
+		if (len > 255) {
+			memset(index, 0, slot_nb * sizeof(LiveBooster_NameSlot_t));
+			return -1;
+		}
+		h = hash_name(name, len);
+		/* linear probing : the first element of a duplicated name stays the one found */
+		for (s = h % slot_nb; index[s].entry; s = (s + 1 == slot_nb) ? 0 : s + 1) {
+		}
+		index[s].entry = (uint16_t) (i + 1);
+		index[s].len = (uint8_t) len;
+		index[s].tag = (uint8_t) (h >> 24);
 	}
 	return 0;
 }
 
 /* --------------------------------------------------------------------------------- */
-/*  */
-static int getValueINT32(int32_t* value, const char* payload_json, const jsmntok_t* token) {
-	if (isValidTokenPrimitive(payload_json, token))
-		return -1;
-	if (1 != sscanf(payload_json + token->start, "%"SCNi32, value))
-		return -1;
-	return 0;
-}
+#if LB_MAX_OF_CFG_PARAMS > 0
+/* Index and update mask of a set of at most LB_MAX_OF_CFG_PARAMS parameters */
+static LiveBooster_NameSlot_t _LiveBooster_param_index[2 * LB_MAX_OF_CFG_PARAMS];
+static uint32_t _LiveBooster_param_mask[(LB_MAX_OF_CFG_PARAMS + 31) / 32];
+#endif
 
-static int getValueUINT32(uint32_t* value, const char* payload_json, const jsmntok_t* token) {
-	if (isValidTokenPrimitive(payload_json, token))
+int LiveBooster_msg_index_params(LiveBooster_SetOfParams_t* p, LiveBooster_SetofUpdatedParams_t* r,
+		const LiveBooster_Param_t* params, uint32_t nb) {
+	LiveBooster_NameSlot_t* index;
+	uint32_t slot_nb;
+	uint32_t* mask;
+
+	if ((p == NULL) || (r == NULL)) {
 		return -1;
-	if (1 != sscanf(payload_json + token->start, "%" SCNu32, value))
+	}
+#if LB_MAX_OF_CFG_PARAMS > 0
+	if (nb > LB_MAX_OF_CFG_PARAMS) {
+		LB_TRACE_ERROR("%u configuration parameters, more than LB_MAX_OF_CFG_PARAMS\n", (unsigned) nb);
 		return -1;
-	return 0;
-}
-
-static int getValueFLOAT(float* value, const char* payload_json, const jsmntok_t* token) {
-	if (isValidTokenPrimitive(payload_json, token)) {
+	}
+	index = _LiveBooster_param_index;
+	slot_nb = 2 * LB_MAX_OF_CFG_PARAMS;
+	mask = _LiveBooster_param_mask;
+#else
+	/* sized for the set : the mask follows the index in the same block */
+	slot_nb = 2 * (nb ? nb : 1);
+	index = (LiveBooster_NameSlot_t*) malloc(slot_nb * sizeof(LiveBooster_NameSlot_t) + (nb + 31) / 32 * sizeof(uint32_t));
+	if (index == NULL) {
+		LB_TRACE_ERROR("%u configuration parameters : allocation of their index failed\n", (unsigned) nb);
 		return -1;
 	}
-#ifdef ARDUINO
-	double df;
-	df = atof(payload_json + token->start);
-	*value = df;
+	mask = (uint32_t*) (index + slot_nb);
+#endif
+	if (LiveBooster_msg_index_names(index, slot_nb, params, sizeof(LiveBooster_Param_t),
+			offsetof(LiveBooster_Param_t, parm_data.data_name), nb)) {
+#if LB_MAX_OF_CFG_PARAMS > 0
+		if (p->param_index != NULL) {
+			/* the previous index was in the same memory : rebuilt from its parameters */
+			LiveBooster_msg_index_names(index, slot_nb, p->param_set.param_ptr, sizeof(LiveBooster_Param_t),
+					offsetof(LiveBooster_Param_t, parm_data.data_name), p->param_set.param_nb);
+		}
 #else
-	if (1 != sscanf(payload_json + token->start, "%f", value))
+		free(index);
+#endif
 		return -1;
+	}
+#if LB_MAX_OF_CFG_PARAMS == 0
+	free(p->param_index);
 #endif
+	memset(mask, 0, (nb + 31) / 32 * sizeof(uint32_t));
+	p->param_index = index;
+	p->param_slot_nb = slot_nb;
+	r->updated_mask = mask;
 	return 0;
 }
 
-
 /* --------------------------------------------------------------------------------- */
 /*  */
-static int get_CorrelationId(int32_t* pCid, const char* payload_data, const jsmntok_t* tokens, int32_t token_cnt) {
-	int idx;
-	if ((payload_data == NULL) || (tokens == NULL) || (pCid == NULL)) {
+int LiveBooster_msg_find_name(const LiveBooster_NameSlot_t* index, uint32_t slot_nb,
+		const void* entries, uint32_t entry_sz, uint32_t name_offset, const char* name, uint32_t len) {
+	uint32_t h;
+	uint8_t tag;
+	uint32_t s;
+
+	if ((index == NULL) || (slot_nb == 0) || (name == NULL) || (len > 255)) {
 		return -1;
 	}
+	h = hash_name(name, len);
+	tag = (uint8_t) (h >> 24);
+	/* at most half of the slots are used : a free slot ends the probe */
+	for (s = h % slot_nb; index[s].entry; s = (s + 1 == slot_nb) ? 0 : s + 1) {
+		if ((index[s].len == len) && (index[s].tag == tag)) {
+			uint32_t i = index[s].entry - 1;
+			if (!memcmp(ENTRY_NAME(entries, entry_sz, name_offset, i), name, len)) {
+				return (int) i;
+			}
+		}
+	}
+	return -1;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Copy a string value, truncated to the size of "dst" */
+static void copy_value(char* dst, uint32_t dst_sz, const LiveBooster_JsonItem_t* item) {
+	uint32_t len = (item->val_len < dst_sz) ? item->val_len : dst_sz - 1;
+	memcpy(dst, item->val, len);
+	dst[len] = 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* User callback of a configuration parameter, in its own span */
+static int callParamCallback(LiveBooster_CallbackParams_t cfgCB, const LiveBooster_Param_t* param_ptr,
+		const void* val_ptr, int val_len) {
+	int ret;
+	TRACE_SPAN_BEGIN("callback");
+	ret = cfgCB(param_ptr, val_ptr, val_len);
+	TRACE_SPAN_END("callback");
+	return ret;
+}
+
+#if LB_PARAM_VALUE_SZ > 0
+/* Value of a string or binary parameter given to the user callback, released when the callback returns */
+static char _LiveBooster_param_value[LB_PARAM_VALUE_SZ];
+#define PARAM_VALUE_ERROR_FMT "%s parameter %s : %u bytes, larger than LB_PARAM_VALUE_SZ\n"
+#else
+#define PARAM_VALUE_ERROR_FMT "%s parameter %s : allocation of %u bytes failed\n"
+#endif
 
-	token_cnt--;
-	for (idx = 0; idx < token_cnt; idx++) {
-		if ((tokens[idx].type == JSMN_STRING) && (tokens[idx].size == 1) && (3 == (tokens[idx].end - tokens[idx].start))
-				&& (!strncmp("cid", payload_data + tokens[idx].start, 3))) {
+static char* param_value_alloc(uint32_t len) {
+#if LB_PARAM_VALUE_SZ > 0
+	return (len <= sizeof(_LiveBooster_param_value)) ? _LiveBooster_param_value : NULL;
+#else
+	return (char*) malloc(len);
+#endif
+}
 
-			// Get next. Must be a primitive value (implicit, it is an integer)
-			idx++;
-			if ((tokens[idx].type == JSMN_PRIMITIVE) && (tokens[idx].size == 0)) {
-				int ret = getValueINT32(pCid, payload_data, &tokens[idx]);
-				return ret;
+static void param_value_free(char* p) {
+#if LB_PARAM_VALUE_SZ > 0
+	(void) p;
+#else
+	free(p);
+#endif
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Decode the base64 text of "value" into "bin" ("bin_sz" bytes), NUL terminated :
+ * return the decoded length, or -1 if it is not valid base64 or does not fit */
+static int decode_bin(const LiveBooster_JsonItem_t* value, char* bin, uint32_t bin_sz) {
+	b64_decoder_t dec;
+	uint32_t pos = 0;
+	uint32_t n = 0;
+
+	b64_decode_init(&dec);
+	while (pos < value->val_len) {
+		/* at most 3 bytes are written for 4 characters : the chunk fits before the NUL */
+		uint32_t chunk = (bin_sz - 1 - n) / 3 * 4;
+		int r;
+		if (chunk == 0) {
+			/* less than 3 bytes left : the next quantum is decoded aside, it may still fit */
+			char tail[3];
+			chunk = (value->val_len - pos < 4) ? value->val_len - pos : 4;
+			r = b64_decode_chunk(&dec, value->val + pos, chunk, tail);
+			if ((r < 0) || (n + (uint32_t) r > bin_sz - 1)) {
+				return -1;
 			}
-			return -1;
+			memcpy(bin + n, tail, r);
 		}
+		else {
+			if (chunk > value->val_len - pos) {
+				chunk = value->val_len - pos;
+			}
+			r = b64_decode_chunk(&dec, value->val + pos, chunk, bin + n);
+			if (r < 0) {
+				return -1;
+			}
+		}
+		pos += chunk;
+		n += (uint32_t) r;
 	}
-	return -1;
+	if (b64_decode_end(&dec)) {
+		return -1;
+	}
+	bin[n] = '\0';
+	return (int) n;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-static int updateCnfParam(const char* payload_json, const jsmntok_t* token, const LiveBooster_Param_t* param_ptr,
-		LiveBooster_CallbackParams_t cfgCB) {
-	int ret;
-	if ((payload_json == NULL) || (token == NULL) || (param_ptr == NULL)) {
+static int updateCnfParam(const LiveBooster_JsonItem_t* value, LiveBooster_JsonEvent_t value_ev,
+		const LiveBooster_Param_t* param_ptr, LiveBooster_CallbackParams_t cfgCB, uint8_t zero_copy) {
+	int ret = -1;
+	if ((value == NULL) || (param_ptr == NULL) || (cfgCB == NULL)) {
 		return -1;
 	}
 
 	if (param_ptr->parm_data.data_type == LB_TYPE_STRING_C) {
-		if (token->type != JSMN_STRING) {
+		if (value_ev != LB_JSON_STRING) {
 			return -1;
 		}
-		*((char *)(payload_json + token->end)) = '\0';
-		ret = cfgCB(param_ptr, (const void*) (payload_json + token->start), token->end - token->start);
+		if (zero_copy) {
+			/* in the received payload, not NUL terminated */
+			ret = callParamCallback(cfgCB, param_ptr, (const void*) value->val, value->val_len);
+		}
+		else {
+			char* str = param_value_alloc(value->val_len + 1);
+			if (str == NULL) {
+				LB_TRACE_ERROR(PARAM_VALUE_ERROR_FMT, "String", param_ptr->parm_data.data_name, (unsigned) value->val_len + 1);
+				return -1;
+			}
+			memcpy(str, value->val, value->val_len);
+			str[value->val_len] = '\0';
+			ret = callParamCallback(cfgCB, param_ptr, (const void*) str, value->val_len);
+			param_value_free(str);
+		}
 	}
 	else if (param_ptr->parm_data.data_type == LB_TYPE_BIN) {
-		if (token->type != JSMN_STRING) {
+		uint32_t bin_sz;
+		char* bin;
+		int n;
+		if (value_ev != LB_JSON_STRING) {
 			return -1;
 		}
-		char bin64[LB_BIN64_BUF_SZ];
-		char value[LB_BIN64_BUF_SZ];
-		memcpy(bin64,(const char *)(payload_json + token->start),token->end - token->start);
-		bin64[(token->end - token->start)]= '\0';
-		ret = b64_decode(bin64, value, token->end - token->start);
-		ret = cfgCB(param_ptr, (const void*) value, token->end - token->start);
+#if LB_PARAM_VALUE_SZ > 0
+		bin_sz = LB_PARAM_VALUE_SZ;
+#else
+		bin_sz = (value->val_len + 3) / 4 * 3 + 1;
+#endif
+		bin = param_value_alloc(bin_sz);
+		if (bin == NULL) {
+			LB_TRACE_ERROR(PARAM_VALUE_ERROR_FMT, "Binary", param_ptr->parm_data.data_name, (unsigned) bin_sz);
+			return -1;
+		}
+		n = decode_bin(value, bin, bin_sz);
+		if (n < 0) {
+#if LB_PARAM_VALUE_SZ > 0
+			LB_TRACE_ERROR("Binary parameter %s : invalid base64, or larger than LB_PARAM_VALUE_SZ\n",
+					param_ptr->parm_data.data_name);
+#else
+			LB_TRACE_ERROR("Binary parameter %s : invalid base64\n", param_ptr->parm_data.data_name);
+#endif
+			param_value_free(bin);
+			return -1;
+		}
+		ret = callParamCallback(cfgCB, param_ptr, (const void*) bin, n);
+		param_value_free(bin);
 	}
 	else {
-		if (token->type != JSMN_PRIMITIVE) {
+		if (value_ev != LB_JSON_PRIMITIVE) {
 			return -1;
 		}
 
 		if (param_ptr->parm_data.data_type == LB_TYPE_UINT32) {
-			uint32_t value;
-			ret = getValueUINT32(&value, payload_json, token);
+			uint32_t v;
+			ret = LiveBooster_parse_u32(value->val, value->val_len, &v);
 			if ((ret == 0) && (param_ptr->parm_data.data_value)) {
-				ret = cfgCB(param_ptr, (const void*) &value, sizeof(uint32_t));
+				ret = callParamCallback(cfgCB, param_ptr, (const void*) &v, sizeof(uint32_t));
 				if (ret == 0)
-					*((uint32_t*) param_ptr->parm_data.data_value) = value;
+					*((uint32_t*) param_ptr->parm_data.data_value) = v;
 			}
 		}
 		else if (param_ptr->parm_data.data_type == LB_TYPE_INT32) {
-			int32_t value;
-			ret = getValueINT32(&value, payload_json, token);
+			int32_t v;
+			ret = LiveBooster_parse_i32(value->val, value->val_len, &v);
 			if ((ret == 0) && (param_ptr->parm_data.data_value)) {
-				ret = cfgCB(param_ptr, (const void*) &value, sizeof(int32_t));
+				ret = callParamCallback(cfgCB, param_ptr, (const void*) &v, sizeof(int32_t));
 				if (ret == 0)
-					*((int32_t*) param_ptr->parm_data.data_value) = value;
+					*((int32_t*) param_ptr->parm_data.data_value) = v;
 			}
 		}
 		else if (param_ptr->parm_data.data_type == LB_TYPE_FLOAT) {
-			float value;
-			ret = getValueFLOAT(&value, payload_json, token);
+			float v;
+			ret = LiveBooster_parse_float(value->val, value->val_len, &v);
 			if ((ret == 0) && (param_ptr->parm_data.data_value)) {
-				ret = cfgCB(param_ptr, (const void*) &value, sizeof(float));
+				ret = callParamCallback(cfgCB, param_ptr, (const void*) &v, sizeof(float));
 				if (ret == 0)
-					*((float*) param_ptr->parm_data.data_value) = value;
+					*((float*) param_ptr->parm_data.data_value) = v;
 			}
 		}
 		else {
@@ -207,6 +376,84 @@ static int get_md5FromString(const unsigned char *s, unsigned char *buf_ptr, uin
 	return (0);
 }
 
+/* --------------------------------------------------------------------------------- */
+/* Resource update request :
+ * {"cid":N,"id":"name","old":"version","new":"version","m":{"size":N,"uri":"...","md5":"..."}}
+ */
+typedef struct {
+	const LiveBooster_SetOfResources_t* pSetRsc;
+	LiveBooster_SetOfUpdatedResource_t* pRscUpd;  /* NULL while a transfer is in progress : only "cid" is read */
+	int32_t* pCid;
+	uint8_t has_cid;
+	uint8_t in_m;     /* in the "m" object */
+	uint8_t err;      /* a member is invalid */
+} rsc_parser_t;
+
+static int rsc_item(void* ctx, LiveBooster_JsonEvent_t ev, const LiveBooster_JsonItem_t* item) {
+	rsc_parser_t* rp = (rsc_parser_t*) ctx;
+	LiveBooster_SetOfUpdatedResource_t* pRscUpd = rp->pRscUpd;
+
+	if (item->depth == 0) {
+		return ((ev == LB_JSON_OBJECT) || (ev == LB_JSON_OBJECT_END)) ? 0 : -1;
+	}
+	if (item->depth == 1) {
+		if (IS_KEY(item, "cid")) {
+			if ((ev != LB_JSON_PRIMITIVE) || LiveBooster_parse_i32(item->val, item->val_len, rp->pCid)) {
+				return -1;
+			}
+			rp->has_cid = 1;
+		}
+		else if (pRscUpd == NULL) {
+		}
+		else if (IS_KEY(item, "id")) {
+			int jw;
+			if (ev != LB_JSON_STRING) {
+				rp->err = 1;
+				return 0;
+			}
+			jw = LiveBooster_msg_find_name(rp->pSetRsc->rsc_index, 2 * LB_MAX_OF_RESOURCES,
+					rp->pSetRsc->rsc_ptr, sizeof(LiveBooster_Resource_t), offsetof(LiveBooster_Resource_t, rsc_name),
+					item->val, item->val_len);
+			if (jw >= 0) {
+				pRscUpd->ursc_obj_ptr = &rp->pSetRsc->rsc_ptr[jw];
+			}
+		}
+		else if (IS_KEY(item, "old") && (ev == LB_JSON_STRING)) {
+			copy_value(pRscUpd->ursc_vers_old, sizeof(pRscUpd->ursc_vers_old), item);
+		}
+		else if (IS_KEY(item, "new") && (ev == LB_JSON_STRING)) {
+			copy_value(pRscUpd->ursc_vers_new, sizeof(pRscUpd->ursc_vers_new), item);
+		}
+		else if (IS_KEY(item, "m")) {
+			if (ev != LB_JSON_OBJECT) {
+				rp->err = 1;
+				return 0;
+			}
+			rp->in_m = 1;
+		}
+		else if (ev == LB_JSON_OBJECT_END) {
+			rp->in_m = 0;
+		}
+	}
+	else if ((item->depth == 2) && rp->in_m && (pRscUpd != NULL)) {
+		if (IS_KEY(item, "size")) {
+			if (((ev != LB_JSON_PRIMITIVE) && (ev != LB_JSON_STRING))
+					|| LiveBooster_parse_u32(item->val, item->val_len, &pRscUpd->ursc_size)) {
+				rp->err = 1;
+			}
+		}
+		else if (IS_KEY(item, "uri") && (ev == LB_JSON_STRING)) {
+			copy_value(pRscUpd->ursc_uri, sizeof(pRscUpd->ursc_uri), item);
+		}
+		else if (IS_KEY(item, "md5") && (ev == LB_JSON_STRING)) {
+			if (item->val_len == sizeof(pRscUpd->ursc_md5) * 2) {
+				get_md5FromString((const unsigned char*) item->val, pRscUpd->ursc_md5, sizeof(pRscUpd->ursc_md5));
+			}
+		}
+	}
+	return 0;
+}
+
 /* --------------------------------------------------------------------------------- */
 /* Decode a received JSON message to download resource
  */
@@ -215,14 +462,8 @@ LiveBooster_ResourceRespCode_t LiveBooster_msg_decode_rsc_req(const char* payloa
                                                               const LiveBooster_SetOfResources_t* pSetRsc,
 															  LiveBooster_SetOfUpdatedResource_t* pRscUpd,
 															  int32_t* pCid) {
-
+	rsc_parser_t rp;
 	int ret;
-	int token_cnt;
-	jsmn_parser parser;
-	jsmntok_t tokens[20];
-	int idx;
-	int len;
-	int size;
 
 	if ((pSetRsc == NULL) || (payload_data == NULL) || (payload_len == 0) || (pRscUpd == NULL) || (pCid == NULL)) {
 		return RSC_RSP_ERR_INTERNAL_ERROR;
@@ -230,198 +471,41 @@ LiveBooster_ResourceRespCode_t LiveBooster_msg_decode_rsc_req(const char* payloa
 
 	*pCid = 0;
 
-	sprintf(traceDebug,"\nLiveBooster_msg_decode_rsc_req: %s\n",payload_data); msgDebug->print(traceDebug);
+	LB_TRACE_DEBUG("\nLiveBooster_msg_decode_rsc_req: %.*s\n", (int) payload_len, payload_data);
 
-	memset(&tokens, 0, sizeof(tokens));
-	jsmn_init(&parser);
-	token_cnt = jsmn_parse(&parser, payload_data, payload_len, tokens, 20);
-	if (token_cnt < 0) {
-		return RSC_RSP_ERR_INTERNAL_ERROR;
-	}
-	if (token_cnt == 0) {
-		return RSC_RSP_OK;
+	memset(&rp, 0, sizeof(rp));
+	rp.pSetRsc = pSetRsc;
+	rp.pCid = pCid;
+	if (pRscUpd->ursc_cid == 0) {
+		memset(pRscUpd, 0, sizeof(LiveBooster_SetOfUpdatedResource_t));
+		rp.pRscUpd = pRscUpd;
 	}
 
-	if (token_cnt < 1) {
-		return RSC_RSP_ERR_INTERNAL_ERROR;
-	}
+	ret = LiveBooster_json_parse(payload_data, payload_len, rsc_item, &rp);
 
-	if ((tokens[0].type != JSMN_OBJECT) || (tokens[0].size <= 0)) {
-		return RSC_RSP_ERR_INTERNAL_ERROR;
-	}
-
-	// Get the Correlation Id
-	ret = get_CorrelationId(pCid, payload_data, &tokens[1], token_cnt);
-	if (ret) {
-		return RSC_RSP_ERR_INTERNAL_ERROR;
-	}
-
-	if (pRscUpd->ursc_cid) {
+	if (rp.pRscUpd == NULL) {
+		if ((ret != 0) || (rp.has_cid == 0)) {
+			return RSC_RSP_ERR_INTERNAL_ERROR;
+		}
 		return RSC_RSP_ERR_NOT_AUTHORIZED; // RSC_RSP_ERR_BUSY
 	}
-
-	memset(pRscUpd, 0, sizeof(LiveBooster_SetOfUpdatedResource_t));
-
-	pRscUpd->ursc_cid = *pCid;
-
-	// get resource id
-	for (idx = 0; idx < (token_cnt - 1); idx++) {
-		if ((tokens[idx].type == JSMN_STRING) && (tokens[idx].size == 1) && (2 == (tokens[idx].end - tokens[idx].start))
-				&& (!strncmp("id", payload_data + tokens[idx].start, 2))) {
-			int jw;
-			const LiveBooster_Resource_t* rsc_ptr;
-
-			// Get next. Must be a string value
-			idx++;
-			if ((tokens[idx].type != JSMN_STRING) || (tokens[idx].size != 0)) {
-				return RSC_RSP_ERR_INTERNAL_ERROR;
-			}
-			// found
-			rsc_ptr = pSetRsc->rsc_ptr;
-			len = tokens[idx].end - tokens[idx].start;
-			for (jw = 0; jw < pSetRsc->rsc_nb; jw++, rsc_ptr++) {
-				if ((len == (int) strlen(rsc_ptr->rsc_name))
-						&& (!strncmp(rsc_ptr->rsc_name, payload_data + tokens[idx].start, len))) {
-					pRscUpd->ursc_obj_ptr = rsc_ptr;
-					break;
-				}
-			}
-			if (pRscUpd->ursc_obj_ptr == NULL)
-			break;
-		}
+	if ((ret != 0) || (rp.has_cid == 0) || rp.err) {
+		memset(pRscUpd, 0, sizeof(LiveBooster_SetOfUpdatedResource_t));
+		return RSC_RSP_ERR_INTERNAL_ERROR;
 	}
 	if (pRscUpd->ursc_obj_ptr == NULL) {
-		if (idx == token_cnt)
+		memset(pRscUpd, 0, sizeof(LiveBooster_SetOfUpdatedResource_t));
 		return RSC_RSP_ERR_INVALID_RESOURCE;
 	}
 
-	// Now, get each  parameter
-	size = tokens[0].size;
-	idx = 1;
-
-	while ((size > 0) && (token_cnt > 0)) {
-		int8_t val_type;
-		char* val_ptr;
-		int32_t val_len;
-		int len = tokens[idx].end - tokens[idx].start;
-		if ((tokens[idx].type != JSMN_STRING) || (tokens[idx].size != 1)) {
-			// error;
-			return RSC_RSP_ERR_INTERNAL_ERROR;
-		}
-		size--;
-
-		if ((len == 1) && !strncmp("m", payload_data + tokens[idx].start, len)) {
-			int ms;
-			if ((tokens[idx + 1].type != JSMN_OBJECT) || (tokens[idx + 1].size < 3)) {
-				return RSC_RSP_ERR_INTERNAL_ERROR;
-			}
-			ms = tokens[idx + 1].size;
-
-			idx += 2;
-			token_cnt -= 2;
-			while (ms > 0) {
-				if ((tokens[idx].type != JSMN_STRING) || (tokens[idx].size != 1)
-						|| (tokens[idx + 1].type != JSMN_STRING) || (tokens[idx + 1].size != 0)) {
-					return RSC_RSP_ERR_INTERNAL_ERROR;
-				}
-				len = tokens[idx].end - tokens[idx].start;
-				ms--;
-				val_type = 0;
-				if ((len == 4) && !strncmp("size", payload_data + tokens[idx].start, len)) {
-					val_type = 3;
-					val_ptr = (char*) &pRscUpd->ursc_size;
-					val_len = 0;
-				}
-				else if ((len == 3) && !strncmp("uri", payload_data + tokens[idx].start, len)) {
-					val_type = 2;
-					val_ptr = pRscUpd->ursc_uri;
-					val_len = sizeof(pRscUpd->ursc_uri) - 1;
-				}
-				else if ((len == 3) && !strncmp("md5", payload_data + tokens[idx].start, len)) {
-					val_type = 4;
-					val_ptr = (char*)pRscUpd->ursc_md5;
-					val_len = sizeof(pRscUpd->ursc_md5);
-				}
-
-				if (val_type) {
-					if (val_ptr) {
-						if (val_type == 2) {
-							len = tokens[idx + 1].end - tokens[idx + 1].start;
-							if (len > val_len) {
-								len = val_len;
-							}
-							strncpy(val_ptr, payload_data + tokens[idx + 1].start, len);
-							val_ptr[len] = 0;
-						}
-						else if (val_type == 3) {
-							if (1 != sscanf(payload_data + tokens[idx + 1].start, "%" SCNu32, (uint32_t*) val_ptr)) {
-								return RSC_RSP_ERR_INTERNAL_ERROR;
-							}
-						}
-						else if (val_type == 4) {
-							if ((tokens[idx + 1].end - tokens[idx + 1].start) == (val_len * 2)) {
-								if (get_md5FromString((const unsigned char*) (payload_data + tokens[idx + 1].start),
-										(unsigned char*) val_ptr, val_len)) {
-									//return 2;
-								}
-							}
-							else {
-								//return 2;
-							}
-						}
-						else {
-							return RSC_RSP_ERR_INTERNAL_ERROR;
-						}
-					}
-				}
-				idx += 2;
-				token_cnt -= 2;
-			}
-		}
-		else {
-			if ((tokens[idx].type != JSMN_STRING) || (tokens[idx].size != 1) || (tokens[idx + 1].size != 0)
-					|| ((tokens[idx + 1].type != JSMN_STRING) && (tokens[idx + 1].type != JSMN_PRIMITIVE))) {
-				return RSC_RSP_ERR_INTERNAL_ERROR;
-			}
-
-			val_type = 0;
-			if ((len == 2) && !strncmp("id", payload_data + tokens[idx].start, len)) {
-				// skip, already processed
-				val_type = 1;
-			}
-			else if ((len == 3) && !strncmp("old", payload_data + tokens[idx].start, len)) {
-				val_type = 2;
-				val_ptr = pRscUpd->ursc_vers_old;
-				val_len = sizeof(pRscUpd->ursc_vers_old) - 1;
-			}
-			else if ((len == 3) && !strncmp("new", payload_data + tokens[idx].start, len)) {
-				val_type = 2;
-				val_ptr = pRscUpd->ursc_vers_new;
-				val_len = sizeof(pRscUpd->ursc_vers_new) - 1;
-			}
-			else if ((len == 3) && !strncmp("cid", payload_data + tokens[idx].start, len)) {
-				// skip, already processed
-				val_type = 1;
-			}
-			if (val_type) {
-				if ((val_type == 2) && (val_ptr)) {
-					int len = tokens[idx + 1].end - tokens[idx + 1].start;
-					if (len > val_len) {
-						len = val_len;
-					}
-					strncpy(val_ptr, payload_data + tokens[idx + 1].start, len);
-					val_ptr[len] = 0;
-				}
-			}
-			idx += 2;
-			token_cnt -= 2;
-		}
-	}
+	pRscUpd->ursc_cid = *pCid;
 
 	if (pSetRsc->rsc_cb_ntfy) { // User callback function
 		LiveBooster_ResourceRespCode_t rsc_resp_code;
+		TRACE_SPAN_BEGIN("callback");
 		rsc_resp_code = pSetRsc->rsc_cb_ntfy(0, pRscUpd->ursc_obj_ptr, pRscUpd->ursc_vers_old, pRscUpd->ursc_vers_new,
 				pRscUpd->ursc_size);
+		TRACE_SPAN_END("callback");
 		if (rsc_resp_code) { // Refused by user
 			pRscUpd->ursc_cid = 0;
 			pRscUpd->ursc_obj_ptr = NULL;
@@ -429,11 +513,11 @@ LiveBooster_ResourceRespCode_t LiveBooster_msg_decode_rsc_req(const char* payloa
 		}
 	}
 
-	sprintf(traceDebug,"md5= %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
+	LB_TRACE_DEBUG("md5= %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x\n",
 			pRscUpd->ursc_md5[0], pRscUpd->ursc_md5[1], pRscUpd->ursc_md5[2], pRscUpd->ursc_md5[3],
 			pRscUpd->ursc_md5[4], pRscUpd->ursc_md5[5], pRscUpd->ursc_md5[6], pRscUpd->ursc_md5[7],
 			pRscUpd->ursc_md5[8], pRscUpd->ursc_md5[9], pRscUpd->ursc_md5[10], pRscUpd->ursc_md5[11],
-			pRscUpd->ursc_md5[12], pRscUpd->ursc_md5[13], pRscUpd->ursc_md5[14], pRscUpd->ursc_md5[15]); msgDebug->print(traceDebug);
+			pRscUpd->ursc_md5[12], pRscUpd->ursc_md5[13], pRscUpd->ursc_md5[14], pRscUpd->ursc_md5[15]);
 
 	pRscUpd->ursc_connected = 0;
 	pRscUpd->ursc_offset = 0;
@@ -442,131 +526,278 @@ LiveBooster_ResourceRespCode_t LiveBooster_msg_decode_rsc_req(const char* payloa
 }
 
 /* --------------------------------------------------------------------------------- */
-/* Decode a received JSON message to update configuration parameters
+/* Configuration update request :
+ * {"cfg":{"name":{"t":"type","v":value},...},"cid":N}
  */
-int  LiveBooster_msg_decode_params_req(const char* payload_data, uint32_t payload_len, const LiveBooster_SetOfParams_t* pSetCfg,
-		LiveBooster_SetofUpdatedParams_t* pSetCfgUpdate) {
-
-#define NB_TK_FOR_PARMS (5+6*LB_MAX_OF_PARSED_PARAMS+1)  //  6 tokens by parameter
-	int ret;
-	int token_cnt;
-	jsmn_parser parser;
-	jsmntok_t tokens[NB_TK_FOR_PARMS];
-	int idx;
-	int size;
-	const char* pc;
-	int len;
-
-	if ((pSetCfg == NULL) || (payload_data == NULL) || (payload_len == 0) || (pSetCfgUpdate == NULL)) {
-		return -1;
+typedef struct {
+	const LiveBooster_SetOfParams_t* pSetCfg;
+	LiveBooster_SetofUpdatedParams_t* pSetCfgUpdate;
+	const LiveBooster_Param_t* param_ptr;  /* parameter being parsed, NULL if not in the user list */
+	LiveBooster_JsonItem_t type;           /* its "t" (val NULL if not yet met) */
+	LiveBooster_JsonItem_t value;          /* its "v" (val NULL if not yet met) */
+	LiveBooster_JsonEvent_t value_ev;
+	uint8_t has_cid;
+	uint8_t in_cfg;   /* in the "cfg" object */
+	int8_t err;       /* first format error : the next parameters are ignored */
+} cfg_parser_t;
+
+/* End of a parameter object : apply it */
+static void cfg_apply(cfg_parser_t* cp) {
+	const LiveBooster_Param_t* param_ptr = cp->param_ptr;
+	LiveBooster_Type_t type;
+	int i;
+
+	if ((cp->type.val == NULL) || (cp->value.val == NULL)) {
+		cp->err = -2;
+		return;
+	}
+	if (param_ptr == NULL) {
+		return;
+	}
+	// Config Parameter Name is found in the user list
+	// Get the type of this config parameter
+	type = LB_getDataTypeFromStrL(cp->type.val, cp->type.val_len);
+	if (type == LB_TYPE_UNKNOWN) {
+		LB_TRACE_WARN(" Error type inconnu %d \n  ",type);
+	}
+	else if (type != param_ptr->parm_data.data_type) {
+		LB_TRACE_WARN(" type incoherant %d    %d \n  ", type, param_ptr->parm_data.data_type);
+	}
+	else if ((type == LB_TYPE_STRING_C) && (cp->value_ev != LB_JSON_STRING)) {
+		LB_TRACE_WARN(" type string incoherant %d    %d \n  ", type, cp->value_ev);
+	}
+	else {
+		updateCnfParam(&cp->value, cp->value_ev, param_ptr, cp->pSetCfg->param_callback, cp->pSetCfg->param_zero_copy);
+		i = (int) (param_ptr - cp->pSetCfg->param_set.param_ptr);
+		if ((cp->pSetCfgUpdate->updated_mask[i >> 5] & (1UL << (i & 31))) == 0) {
+			cp->pSetCfgUpdate->updated_mask[i >> 5] |= (1UL << (i & 31));
+			cp->pSetCfgUpdate->nb_of_params++;
+		}
 	}
+}
 
-	pSetCfgUpdate->cid = 0;
-	pSetCfgUpdate->nb_of_params = 0;
+static int cfg_item(void* ctx, LiveBooster_JsonEvent_t ev, const LiveBooster_JsonItem_t* item) {
+	cfg_parser_t* cp = (cfg_parser_t*) ctx;
 
-	memset(&tokens, 0, sizeof(tokens));
-	jsmn_init(&parser);
-	token_cnt = jsmn_parse(&parser, payload_data, payload_len, tokens, NB_TK_FOR_PARMS);
-	if (token_cnt < 0) {
-		return -1;
+	if (item->depth == 0) {
+		return ((ev == LB_JSON_OBJECT) || (ev == LB_JSON_OBJECT_END)) ? 0 : -1;
 	}
-#undef NB_TK_FOR_PARMS
-	if (token_cnt == 0) {
+	if (item->depth == 1) {
+		if (IS_KEY(item, "cid")) {
+			if ((ev != LB_JSON_PRIMITIVE) || LiveBooster_parse_i32(item->val, item->val_len, &cp->pSetCfgUpdate->cid)) {
+				return -1;
+			}
+			cp->has_cid = 1;
+		}
+		else if (IS_KEY(item, "cfg")) {
+			if (ev != LB_JSON_OBJECT) {
+				return -1;
+			}
+			cp->in_cfg = 1;
+		}
+		else if (ev == LB_JSON_OBJECT_END) {
+			cp->in_cfg = 0;
+		}
 		return 0;
 	}
-
-	if (token_cnt < 2) {
-		return -1;
+	if ((cp->in_cfg == 0) || cp->err) {
+		return 0;
 	}
 
-	if ((tokens[0].type != JSMN_OBJECT) || (tokens[0].size <= 0)) {
-		return -1;
+	if (item->depth == 2) {
+		// Parameter Name : { ... }
+		if (ev == LB_JSON_OBJECT) {
+			int i = LiveBooster_msg_find_name(cp->pSetCfg->param_index, cp->pSetCfg->param_slot_nb,
+					cp->pSetCfg->param_set.param_ptr, sizeof(LiveBooster_Param_t),
+					offsetof(LiveBooster_Param_t, parm_data.data_name), item->key, item->key_len);
+			cp->param_ptr = (i >= 0) ? &cp->pSetCfg->param_set.param_ptr[i] : NULL;
+			cp->type.val = NULL;
+			cp->value.val = NULL;
+		}
+		else if (ev == LB_JSON_OBJECT_END) {
+			cfg_apply(cp);
+		}
+		else {
+			cp->err = -2;
+		}
 	}
-
-	// Get the Correlation Id
-	ret = get_CorrelationId(&pSetCfgUpdate->cid, payload_data, &tokens[1], token_cnt);
-	if (ret) {
-		return -1;
+	else if (item->depth == 3) {
+		if (IS_KEY(item, "t") && (ev == LB_JSON_STRING)) {
+			cp->type = *item;
+		}
+		else if (IS_KEY(item, "v") && ((ev == LB_JSON_STRING) || (ev == LB_JSON_PRIMITIVE))) {
+			cp->value = *item;
+			cp->value_ev = ev;
+		}
+		else {
+			cp->err = -2;
+		}
 	}
+	return 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Decode a received JSON message to update configuration parameters
+ */
+int  LiveBooster_msg_decode_params_req(const char* payload_data, uint32_t payload_len, const LiveBooster_SetOfParams_t* pSetCfg,
+		LiveBooster_SetofUpdatedParams_t* pSetCfgUpdate) {
+	cfg_parser_t cp;
+	int ret;
 
-	if ((tokens[1].type != JSMN_STRING) || (tokens[1].size != 1) // should be 'cfg'
-			|| (tokens[2].type != JSMN_OBJECT) || (tokens[2].size < 0))  {
+	if ((pSetCfg == NULL) || (payload_data == NULL) || (payload_len == 0) || (pSetCfgUpdate == NULL)
+			|| (pSetCfgUpdate->updated_mask == NULL)) {
 		return -1;
 	}
 
-	ret = check_token(payload_data, &tokens[1], "cfg");
-	if (ret <= 0) {
+	pSetCfgUpdate->cid = 0;
+	pSetCfgUpdate->nb_of_params = 0;
+	memset(pSetCfgUpdate->updated_mask, 0, (pSetCfg->param_set.param_nb + 31) / 32 * sizeof(uint32_t));
+
+	memset(&cp, 0, sizeof(cp));
+	cp.pSetCfg = pSetCfg;
+	cp.pSetCfgUpdate = pSetCfgUpdate;
+
+	ret = LiveBooster_json_parse(payload_data, payload_len, cfg_item, &cp);
+	if ((ret != 0) || (cp.has_cid == 0)) {
+		pSetCfgUpdate->cid = 0;
 		return -1;
 	}
-	// skip the first tokens '{ "cfg" : {'
-	idx = 3;
-	token_cnt -= 3;
-
-	// Get the number of parameters
-	size = tokens[2].size;
-	// Now, get each configuration parameter
-	while (size > 0) {
-		if ((token_cnt < 6) || (tokens[idx].type != JSMN_STRING) // 0: should be the Parameter Name
-				|| (tokens[idx + 1].type != JSMN_OBJECT) // 1: should be {
-				|| (tokens[idx + 2].type != JSMN_STRING) // 2: Should be equal to "t"
-				|| (tokens[idx + 3].type != JSMN_STRING) // 3: Should be the parameter type : "u32" , "u16", ...
-				|| (tokens[idx + 4].type != JSMN_STRING) // 4: Should be equal to "v"
-														 // 5: Value : either JSMN_PRIMITIVE or JSMN_STRING
-				|| !((tokens[idx + 5].type == JSMN_PRIMITIVE) || (tokens[idx + 5].type == JSMN_STRING))) {
-			return -2;
-		}
-
-		ret = check_token(payload_data, &tokens[idx + 2], "t");
-		if (ret <= 0) {
-			return -2;
-		}
-
-		ret = check_token(payload_data, &tokens[idx + 4], "v");
-		if (ret <= 0) {
-			return -2;
-		}
-
-		// Parameter Name
-		len = tokens[idx].end - tokens[idx].start;
-		pc = payload_data + tokens[idx].start;
-
-		if (pSetCfg->param_set.param_nb) {
-			int i;
-			const LiveBooster_Param_t* param_ptr = pSetCfg->param_set.param_ptr;
-			for (i = 0; i < pSetCfg->param_set.param_nb; i++, param_ptr++) {
-				int param_name_len = strlen(param_ptr->parm_data.data_name);
-				if ((len == param_name_len) && (!strncmp(pc, param_ptr->parm_data.data_name, param_name_len))) {
-					// Config Parameter Name is found in the user list
-					// Get the type of this config parameter
-					LiveBooster_Type_t type = LB_getDataTypeFromStrL(payload_data + tokens[idx + 3].start,
-							tokens[idx + 3].end - tokens[idx + 3].start);
-					if (type == LB_TYPE_UNKNOWN) {
-						sprintf(traceDebug," Error type inconnu %d \n  ",type); msgDebug->print(traceDebug);
-					}
-					else if (type != param_ptr->parm_data.data_type) {
-						sprintf(traceDebug," type incoherant %d    %d \n  ", type, param_ptr->parm_data.data_type); msgDebug->print(traceDebug);
-					}
-					else if ((type == LB_TYPE_STRING_C) && (tokens[idx + 5].type != JSMN_STRING)) {
-						sprintf(traceDebug," type string incoherant %d    %d \n  ", type, tokens[idx + 5].type); msgDebug->print(traceDebug);
-					}
-					else {
-						ret = updateCnfParam(payload_data, &tokens[idx + 5], param_ptr, pSetCfg->param_callback);
-						if (pSetCfgUpdate->nb_of_params < LB_MAX_OF_PARSED_PARAMS) {
-							pSetCfgUpdate->tab_of_param_ptr[pSetCfgUpdate->nb_of_params++] = param_ptr;
-						}
-					}
-					break;
-				}
+	return cp.err;
+}
+
+
+/* --------------------------------------------------------------------------------- */
+/* Command request :
+ * {"req":"name","arg":{"name":value,...},"cid":N}
+ * The "arg" object is scanned a second time, to copy the arguments into the request block
+ * once its size is known.
+ */
+typedef struct {
+	const LiveBooster_SetofCommands_t* pSetCmd;
+	int32_t* pCid;
+	const LiveBooster_Command_t* cmd_ptr;  /* NULL if not registered by user */
+	uint8_t has_cid;
+	uint8_t has_req;
+	uint8_t in_arg;       /* in the "arg" object */
+	int8_t err;           /* first format error */
+	const char* arg_ptr;  /* "arg" object, from "{" to "}" */
+	uint32_t arg_len;
+	uint32_t args_nb;
+	uint32_t args_text_len;  /* names and values, each one with its ending NUL */
+} cmd_parser_t;
+
+static int cmd_item(void* ctx, LiveBooster_JsonEvent_t ev, const LiveBooster_JsonItem_t* item) {
+	cmd_parser_t* cp = (cmd_parser_t*) ctx;
+
+	if (item->depth == 0) {
+		return ((ev == LB_JSON_OBJECT) || (ev == LB_JSON_OBJECT_END)) ? 0 : -1;
+	}
+	if (item->depth == 1) {
+		if (IS_KEY(item, "cid")) {
+			if ((ev != LB_JSON_PRIMITIVE) || LiveBooster_parse_i32(item->val, item->val_len, cp->pCid)) {
+				return -1;
 			}
+			cp->has_cid = 1;
+		}
+		else if (IS_KEY(item, "req")) {
+			int idx;
+			if (ev != LB_JSON_STRING) {
+				cp->err = -2;
+				return 0;
+			}
+			// Is it registered by user ?
+			cp->has_req = 1;
+			idx = LiveBooster_msg_find_name(cp->pSetCmd->cmd_index, 2 * LB_MAX_OF_COMMANDS,
+					cp->pSetCmd->cmd_ptr, sizeof(LiveBooster_Command_t), offsetof(LiveBooster_Command_t, cmd_name),
+					item->val, item->val_len);
+			if (idx >= 0) {
+				cp->cmd_ptr = &cp->pSetCmd->cmd_ptr[idx];
+			}
+		}
+		else if (IS_KEY(item, "arg")) {
+			if (ev != LB_JSON_OBJECT) {
+				cp->err = -2;
+				return 0;
+			}
+			cp->in_arg = 1;
+			cp->arg_ptr = item->val;
+		}
+		else if ((ev == LB_JSON_OBJECT_END) && cp->in_arg) {
+			cp->in_arg = 0;
+			cp->arg_len = (uint32_t) (item->val + 1 - cp->arg_ptr);
 		}
-		size--;
-		token_cnt -= 6;
-		idx += 6;
 	}
+	else if (cp->in_arg) {
+		// Support only simple type - "name" : string or primitive value
+		if ((item->depth == 2) && ((ev == LB_JSON_STRING) || (ev == LB_JSON_PRIMITIVE))) {
+			cp->args_nb++;
+			cp->args_text_len += item->key_len + 1 + item->val_len + 1;
+		}
+		else {
+			cp->err = -2;
+		}
+	}
+	return 0;
+}
+
+typedef struct {
+	LiveBooster_CommandRequestBlock_t* pReqBlk;
+	char* pLine;  /* next free byte after the arguments */
+} cmd_args_copy_t;
+
+static int cmd_arg_copy(void* ctx, LiveBooster_JsonEvent_t ev, const LiveBooster_JsonItem_t* item) {
+	cmd_args_copy_t* ac = (cmd_args_copy_t*) ctx;
+	LiveBooster_CommandArg_t* pArgs;
+
+	if ((item->depth != 1) || ((ev != LB_JSON_STRING) && (ev != LB_JSON_PRIMITIVE))) {
+		return 0;
+	}
+	pArgs = (LiveBooster_CommandArg_t*) &ac->pReqBlk->args_array[ac->pReqBlk->hd.cmd_args_nb++];
 
+	pArgs->arg_name = ac->pLine;
+	memcpy(ac->pLine, item->key, item->key_len);
+	ac->pLine += item->key_len;
+	*ac->pLine++ = 0;
+
+	pArgs->arg_value = ac->pLine;
+	memcpy(ac->pLine, item->val, item->val_len);
+	ac->pLine += item->val_len;
+	*ac->pLine++ = 0;
+
+	pArgs->arg_type = (ev == LB_JSON_STRING) ? 1 : 0;
 	return 0;
 }
 
+#if LB_CMD_BLOCK_SZ > 0
+/* Command request block : only one at a time, released when the user callback returns */
+static union {
+	LiveBooster_CommandRequestBlock_t blk;
+	char buf[LB_CMD_BLOCK_SZ];
+} _LiveBooster_cmd_block;
+
+static uint8_t _LiveBooster_cmd_block_used;
+#endif
+
+static void* cmd_block_alloc(uint32_t len) {
+#if LB_CMD_BLOCK_SZ > 0
+	if (_LiveBooster_cmd_block_used || (len > sizeof(_LiveBooster_cmd_block))) {
+		return NULL;
+	}
+	_LiveBooster_cmd_block_used = 1;
+	return &_LiveBooster_cmd_block;
+#else
+	return malloc(len);
+#endif
+}
+
+static void cmd_block_free(void* p) {
+#if LB_CMD_BLOCK_SZ > 0
+	(void) p;
+	_LiveBooster_cmd_block_used = 0;
+#else
+	free(p);
+#endif
+}
 
 /* --------------------------------------------------------------------------------- */
 /*  */
@@ -574,166 +805,72 @@ int LiveBooster_msg_decode_cmd_req(const char* payload_data,
 		                           uint32_t payload_len,
 								   const LiveBooster_SetofCommands_t* pSetCmd,
 		                           int32_t* pCid) {
+	cmd_parser_t cp;
+	cmd_args_copy_t ac;
+	uint32_t len;
+	char* pm;
 	int ret;
-	int token_cnt;
-	jsmn_parser parser;
-	jsmntok_t tokens[20];
-	int idx;
-	int size;
-	const LiveBooster_Command_t* cmd_ptr;
 
 	if ((pSetCmd == NULL) || (payload_data == NULL) || (pCid == NULL)) {
 		return -1;
 	}
 
 	*pCid = 0;
-	sprintf(traceDebug,"===> LiveBooster_msg_decode_cmd_req  %s\n",payload_data); msgDebug->print(traceDebug);
+	LB_TRACE_DEBUG("===> LiveBooster_msg_decode_cmd_req  %.*s\n", (int) payload_len, payload_data);
 
-	memset(&tokens, 0, sizeof(tokens));
-	jsmn_init(&parser);
-	token_cnt = jsmn_parse(&parser, payload_data, payload_len, tokens, 20);
-	if (token_cnt < 0) {
-		return -1;
-	}
-	if (token_cnt == 0) {
-		return 0;
-	}
+	memset(&cp, 0, sizeof(cp));
+	cp.pSetCmd = pSetCmd;
+	cp.pCid = pCid;
 
-	if (token_cnt < 5) {
+	ret = LiveBooster_json_parse(payload_data, payload_len, cmd_item, &cp);
+	if ((ret != 0) || (cp.has_cid == 0)) {
 		return -1;
 	}
-
-	if ((tokens[0].type != JSMN_OBJECT) || (tokens[0].size <= 0)) {
-		return -1;
-	}
-
-	// Get the Correlation Id.
-	ret = get_CorrelationId(pCid, payload_data, &tokens[1], token_cnt - 1);
-	if (ret) {
-		return -1;
-	}
-
-	// Now, Check the first tokens
-	// Note: suppose that token[1]= "req" and token[3]= "arg", and so cid at the end !
-	if ((tokens[0].type != JSMN_OBJECT) || (tokens[0].size < 3) // at least 3 items : "req", "arg" and "cid"
-			|| (tokens[1].type != JSMN_STRING) || (tokens[1].size != 1) // expected : "req"
-			|| (tokens[2].type != JSMN_STRING) || (tokens[2].size != 0) // expected : name of request
-			) {
+	if (cp.err || (cp.has_req == 0) || (cp.arg_ptr == NULL)) {
 		return -2;
 	}
-
-	ret = check_token(payload_data, &tokens[1], "req");
-	if (ret <= 0) {
-		return -2;
-	}
-
-	// Is it registered by user ?
-	cmd_ptr = NULL;
-	size = tokens[2].end - tokens[2].start;
-	for (idx = 0; idx < pSetCmd->cmd_nb; idx++) {
-		if ((size == (int) strlen(pSetCmd->cmd_ptr[idx].cmd_name))
-				&& !strncmp(pSetCmd->cmd_ptr[idx].cmd_name, payload_data + tokens[2].start, size)) {
-			cmd_ptr = &pSetCmd->cmd_ptr[idx];
-			break;
-		}
-	}
-	if (cmd_ptr == NULL) { // not found in the set of commands
+	if (cp.cmd_ptr == NULL) { // not found in the set of commands
 		return -3;
 	}
 	if (pSetCmd->cmd_callback == NULL) { // No callback function !
 		return -4;
 	}
-	// Check the second token :  "arg" : { ... }
-	// TODO: position of 'arg' should be anywhere. (after or before 'cid')
-	if ((tokens[3].type != JSMN_STRING) || (tokens[3].size != 1) // expected : "arg"
-			|| (tokens[4].type != JSMN_OBJECT)  // expected :  ': {'
-			) {
-		return -2;
+
+	if (cp.args_nb > 0) {
+		len = sizeof(LiveBooster_CommandRequestBlock_t) + (cp.args_nb - 1) * sizeof(LiveBooster_CommandArg_t)
+				+ cp.args_text_len;
 	}
-	ret = check_token(payload_data, &tokens[3], "arg");
-	if (ret <= 0) {
-		return -2;
+	else {
+		len = sizeof(LiveBooster_CommandRequestHeader_t);
+	}
+#if LB_CMD_BLOCK_SZ > 0
+	if (len > sizeof(_LiveBooster_cmd_block)) {
+		LB_TRACE_ERROR("Command request block of %u bytes > LB_CMD_BLOCK_SZ %u\n",
+				(unsigned) len, (unsigned) sizeof(_LiveBooster_cmd_block));
+		return -7;
+	}
+#endif
+	pm = (char*) cmd_block_alloc(len);
+	if (pm == NULL) {
+		return -6;
 	}
 
-	// Get the number of arguments
-	size = tokens[4].size;
-
-	// Now, get each argument. Support only simple type - "name" : string or primitive value
-	idx = 5;
-	token_cnt -= 5;
-	if (size > 0) {
-		char* pm;
-		LiveBooster_CommandRequestBlock_t* pReqBlkWithArgs;
-		LiveBooster_CommandArg_t* pArgs;
-		char* pLine;
-
-		int len = sizeof(LiveBooster_CommandRequestBlock_t) + (size - 1) * sizeof(LiveBooster_CommandArg_t)
-				+ tokens[idx + (size * 2) + 1].end - tokens[idx].start + 1;
-		pm = (char*) malloc(len);
-		if (pm == NULL) {
-			return -6;
-		}
-
-		pReqBlkWithArgs = (LiveBooster_CommandRequestBlock_t*) pm;
-		pArgs = (LiveBooster_CommandArg_t*) pReqBlkWithArgs->args_array;
-		pLine = (char*) (pm + sizeof(LiveBooster_CommandRequestBlock_t)
-				+ (size - 1) * sizeof(LiveBooster_CommandArg_t));
-
-		pReqBlkWithArgs->hd.cmd_blk_len = len;
-		pReqBlkWithArgs->hd.cmd_ptr = cmd_ptr;
-		pReqBlkWithArgs->hd.cmd_cid = *pCid;
-		pReqBlkWithArgs->hd.cmd_args_nb = 0;
-
-		while ((token_cnt >= 2) && (size > 0)) {
-			if ((tokens[idx].type != JSMN_STRING) || (tokens[idx].size != 1) || (tokens[idx + 1].size != 0)
-					|| ((tokens[idx + 1].type != JSMN_STRING) && (tokens[idx + 1].type != JSMN_PRIMITIVE))) {
-				return -2;
-			}
-
-
-			pArgs->arg_name = pLine;
-			memcpy(pLine, payload_data + tokens[idx].start, tokens[idx].end - tokens[idx].start);
-			pLine += tokens[idx].end - tokens[idx].start;
-			*pLine++ = 0;
-
-			pArgs->arg_value = pLine;
-			memcpy(pLine, payload_data + tokens[idx + 1].start, tokens[idx + 1].end - tokens[idx + 1].start);
-			pLine += tokens[idx + 1].end - tokens[idx + 1].start;
-			*pLine++ = 0;
-
-			pArgs->arg_type = (tokens[idx + 1].type == JSMN_STRING) ? 1 : 0;
-
-			pArgs++;
-			pReqBlkWithArgs->hd.cmd_args_nb++;
-
-			size--;
-			idx += 2;
-			token_cnt -= 2;
-		}
-
-		if (size) {
-			return -2;
-		}
-
-		ret = pSetCmd->cmd_callback(pReqBlkWithArgs);
+	ac.pReqBlk = (LiveBooster_CommandRequestBlock_t*) pm;
+	ac.pReqBlk->hd.cmd_blk_len = len;
+	ac.pReqBlk->hd.cmd_ptr = cp.cmd_ptr;
+	ac.pReqBlk->hd.cmd_cid = *pCid;
+	ac.pReqBlk->hd.cmd_args_nb = 0;
 
-		free(pReqBlkWithArgs);
+	if (cp.args_nb > 0) {
+		ac.pLine = (char*) (pm + sizeof(LiveBooster_CommandRequestBlock_t)
+				+ (cp.args_nb - 1) * sizeof(LiveBooster_CommandArg_t));
+		LiveBooster_json_parse(cp.arg_ptr, cp.arg_len, cmd_arg_copy, &ac);
 	}
-	else {
-		LiveBooster_CommandRequestHeader_t* pReqWithoutArg = (LiveBooster_CommandRequestHeader_t*) malloc(
-				sizeof(LiveBooster_CommandRequestHeader_t));
-		if (pReqWithoutArg == NULL) {
-			return -6;
-		}
 
-		pReqWithoutArg->cmd_blk_len = sizeof(LiveBooster_CommandRequestHeader_t);
-		pReqWithoutArg->cmd_ptr = cmd_ptr;
-		pReqWithoutArg->cmd_cid = *pCid;
-		pReqWithoutArg->cmd_args_nb = 0;
+	TRACE_SPAN_BEGIN("callback");
+	ret = pSetCmd->cmd_callback(ac.pReqBlk);
+	TRACE_SPAN_END("callback");
 
-		ret = pSetCmd->cmd_callback(pReqWithoutArg);
-
-		free(pReqWithoutArg);
-	}
+	cmd_block_free(pm);
 	return ret;
 }
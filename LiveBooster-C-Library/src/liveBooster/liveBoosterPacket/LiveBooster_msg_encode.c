@@ -21,164 +21,216 @@
 /* --------------------------------------------------------------------------------- */
 /*  */
  const char* LiveBooster_msg_encode_status_buf(char* buf_ptr, uint32_t buf_len, const LiveBooster_ArrayOfData_t* pObjSet) {
-	int ret, i;
+	LiveBooster_JsonWriter_t w;
+	int ret = 0;
+	int i;
 	const LiveBooster_Data_t* data_ptr;
-	ret = LiveBooster_json_begin_section(buf_ptr, buf_len, "info");
-	if (ret) {
-		return NULL;
-	}
+
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	LiveBooster_json_begin_section(&w, "info");
 	data_ptr = pObjSet->data_ptr;
-	for (i = 0; i < pObjSet->data_nb; i++) {
-		ret = LiveBooster_json_add_item(data_ptr, buf_ptr, buf_len);
-		if (ret) {
-			return NULL;
-		}
+	for (i = 0; (i < pObjSet->data_nb) && (ret == 0); i++) {
+		ret = LiveBooster_json_add_item(&w, data_ptr);
 		data_ptr++;
 	}
-	ret = LiveBooster_json_end_section(buf_ptr, buf_len);
-	if (ret) {
-		return NULL;
+	if (ret == 0) {
+		ret = LiveBooster_json_end_section(&w);
+	}
+	return (ret == 0) ? buf_ptr : NULL;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+static void encode_gps(LiveBooster_JsonWriter_t* w, const LiveBooster_GpsFix_t* gps_ptr) {
+	if ((gps_ptr) && (gps_ptr->gps_valid)) {
+		LiveBooster_json_add_name_gps(w, "loc", gps_ptr->gps_lat, gps_ptr->gps_long);
 	}
-	return buf_ptr;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
 static const char* LiveBooster_msg_encode_data_buf(char* buf_ptr, uint32_t buf_len, const LiveBooster_SetOfData_t* pSetData) {
-	int ret;
+	LiveBooster_JsonWriter_t w;
+	int ret = 0;
+	int i;
+	const LiveBooster_Data_t* data_ptr;
 
-	ret = LiveBooster_json_begin(buf_ptr, buf_len);
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	w.precision = pSetData->precision;
+	LiveBooster_json_begin(&w);
 
-	if (ret == 0) {
-		// stream id
-		ret = LiveBooster_json_add_name_str("s", pSetData->stream_id, buf_ptr, buf_len);
-	}
+	// stream id
+	LiveBooster_json_add_name_str(&w, "s", pSetData->stream_id);
 
 	// timestamp
-	if ((ret == 0) && (pSetData->timestamp[0]))
-		ret = LiveBooster_json_add_name_str("ts", pSetData->timestamp, buf_ptr, buf_len);
+	if (pSetData->timestamp[0])
+		LiveBooster_json_add_name_str(&w, "ts", pSetData->timestamp);
 
 	// model
-	if ((ret == 0) && (pSetData->model[0]))
-		ret = LiveBooster_json_add_name_str("m", pSetData->model, buf_ptr, buf_len);
+	if (pSetData->model[0])
+		LiveBooster_json_add_name_str(&w, "m", pSetData->model);
 
 	// Add GPS localization
-	if ((ret == 0) && (pSetData->gps_ptr) && (pSetData->gps_ptr->gps_valid)) {
-		char msg[80];
-		snprintf(msg, sizeof(msg) - 1, "%3.6f,%3.6f", pSetData->gps_ptr->gps_lat, pSetData->gps_ptr->gps_long);
-		ret = LiveBooster_json_add_name_array("loc", msg, buf_ptr, buf_len);
+	encode_gps(&w, pSetData->gps_ptr);
+
+	LiveBooster_json_add_section_start(&w, "v");
+	data_ptr = pSetData->data_set.data_ptr;
+	for (i = 0; (i < pSetData->data_set.data_nb) && (ret == 0); i++) {
+		ret = LiveBooster_json_add_item(&w, data_ptr);
+		data_ptr++;
 	}
+	LiveBooster_json_add_section_end(&w);
+
+	if (pSetData->tags[0])
+		LiveBooster_json_add_name_array(&w, "t", pSetData->tags);
 
 	if (ret == 0)
-		ret = LiveBooster_json_add_section_start("v", buf_ptr, buf_len);
+		ret = LiveBooster_json_end(&w);
 
-	if (ret == 0) {
-		int i;
-		const LiveBooster_Data_t* data_ptr = pSetData->data_set.data_ptr;
-		for (i = 0; i < pSetData->data_set.data_nb; i++) {
-			ret = LiveBooster_json_add_item(data_ptr, buf_ptr, buf_len);
-			if (ret) {
-				break;
-			}
-			data_ptr++;
-		}
-	}
+	return (ret == 0) ? buf_ptr : NULL;
+}
 
-	if (ret == 0) {
-		ret = LiveBooster_json_add_section_end(buf_ptr, buf_len);
-	}
 
-	if ((ret == 0) && (pSetData->tags[0]))
-		ret = LiveBooster_json_add_name_array("t", pSetData->tags, buf_ptr, buf_len);
+#if LB_JSON_TMPL_SZ > 0
+/* --------------------------------------------------------------------------------- */
+/* Close the static text before a value slot */
+static int template_cut(LiveBooster_DataTemplate_t* tmpl, const LiveBooster_JsonWriter_t* w, uint32_t* mark, int8_t slot) {
+	if ((w->overflow) || (tmpl->slot_nb >= LB_JSON_TMPL_SLOTS)) {
+		return -1;
+	}
+	tmpl->slots[tmpl->slot_nb].text_len = (uint16_t)(w->len - *mark);
+	tmpl->slots[tmpl->slot_nb].slot = slot;
+	tmpl->slot_nb++;
+	*mark = w->len;
+	return 0;
+}
 
-	if (ret == 0)
-		ret = LiveBooster_json_end(buf_ptr, buf_len);
+/* --------------------------------------------------------------------------------- */
+/* Same message as LiveBooster_msg_encode_data_buf(), values left out */
+static int LiveBooster_msg_template_data_buf(LiveBooster_DataTemplate_t* tmpl, const LiveBooster_SetOfData_t* pSetData) {
+	LiveBooster_JsonWriter_t w;
+	uint32_t mark = 0;
+	int ret;
+	int i;
+	const LiveBooster_Data_t* data_ptr;
 
-	return (ret == 0) ? buf_ptr : NULL;
+	tmpl->slot_nb = 0;
+	LiveBooster_json_init(&w, tmpl->text, sizeof(tmpl->text));
+	LiveBooster_json_begin(&w);
+	LiveBooster_json_add_name_str(&w, "s", pSetData->stream_id);
+	if (pSetData->timestamp[0])
+		LiveBooster_json_add_name_str(&w, "ts", pSetData->timestamp);
+	if (pSetData->model[0])
+		LiveBooster_json_add_name_str(&w, "m", pSetData->model);
+	ret = template_cut(tmpl, &w, &mark, LB_TMPL_SLOT_GPS);
+
+	LiveBooster_json_add_section_start(&w, "v");
+	data_ptr = pSetData->data_set.data_ptr;
+	for (i = 0; (i < pSetData->data_set.data_nb) && (ret == 0); i++) {
+		ret = LiveBooster_json_add_item_name(&w, data_ptr);
+		if (ret == 0) {
+			ret = template_cut(tmpl, &w, &mark, (int8_t)i);
+		}
+		if (data_ptr->data_dim > 1) {
+			LiveBooster_json_add_raw(&w, "]", 1);
+		}
+		LiveBooster_json_add_raw(&w, ",", 1);
+		data_ptr++;
+	}
+	LiveBooster_json_add_section_end(&w);
+
+	if (pSetData->tags[0])
+		LiveBooster_json_add_name_array(&w, "t", pSetData->tags);
+
+	if ((ret == 0) && (LiveBooster_json_end(&w) == 0)) {
+		ret = template_cut(tmpl, &w, &mark, LB_TMPL_SLOT_END);
+	}
+	if (ret) {
+		tmpl->slot_nb = 0;
+	}
+	return (ret == 0) ? 0 : -1;
 }
 
+/* --------------------------------------------------------------------------------- */
+/* Static fragments copied as they are, values formatted in their slots */
+static const char* LiveBooster_msg_fill_data_buf(char* buf_ptr, uint32_t buf_len, const LiveBooster_SetOfData_t* pSetData) {
+	LiveBooster_JsonWriter_t w;
+	const LiveBooster_DataTemplate_t* tmpl = &pSetData->tmpl;
+	const char* text = tmpl->text;
+	int i;
+
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	w.precision = pSetData->precision;
+	for (i = 0; i < tmpl->slot_nb; i++) {
+		const LiveBooster_TmplSlot_t* slot = &tmpl->slots[i];
+		LiveBooster_json_add_raw(&w, text, slot->text_len);
+		text += slot->text_len;
+		if (slot->slot == LB_TMPL_SLOT_GPS) {
+			encode_gps(&w, pSetData->gps_ptr);
+		}
+		else if (slot->slot >= 0) {
+			LiveBooster_json_add_item_values(&w, &pSetData->data_set.data_ptr[slot->slot]);
+		}
+	}
+	/* the template is already closed */
+	return (LiveBooster_json_finish(&w) == 0) ? buf_ptr : NULL;
+}
+#endif
 
 /* --------------------------------------------------------------------------------- */
 /*  */
 static const char* LiveBooster_msg_encode_resources_buf(char* buf_ptr, uint32_t buf_len,
 		const LiveBooster_SetOfResources_t* pSetResources) {
-	int ret, i;
+	LiveBooster_JsonWriter_t w;
+	int i;
 	const LiveBooster_Resource_t* rsc_ptr;
 
-	ret = LiveBooster_json_begin_section(buf_ptr, buf_len, "rsc");
-	if (ret) {
-		return NULL;
-	}
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	LiveBooster_json_begin_section(&w, "rsc");
 	rsc_ptr = pSetResources->rsc_ptr;
 	for (i = 0; i < pSetResources->rsc_nb; i++) {
-		if (ret == 0) {
-			ret = LiveBooster_json_add_section_start(rsc_ptr->rsc_name, buf_ptr, buf_len);
-		}
-		if (ret == 0) {
-			ret = LiveBooster_json_add_name_str("v", rsc_ptr->rsc_version_ptr, buf_ptr, buf_len);
-		}
+		LiveBooster_json_add_section_start(&w, rsc_ptr->rsc_name);
+		LiveBooster_json_add_name_str(&w, "v", rsc_ptr->rsc_version_ptr);
 
 		// metadata section: empty
-		if (ret == 0) {
-			ret = LiveBooster_json_add_section_start("m", buf_ptr, buf_len);
-		}
-		if (ret == 0) {
-			ret = LiveBooster_json_add_section_end(buf_ptr, buf_len);
-		}
+		LiveBooster_json_add_section_start(&w, "m");
+		LiveBooster_json_add_section_end(&w);
 
-		if (ret == 0) {
-			ret = LiveBooster_json_add_section_end(buf_ptr, buf_len);
-		}
-		if (ret) {
-			return NULL;
-		}
+		LiveBooster_json_add_section_end(&w);
 		rsc_ptr++;
 	}
-	ret = LiveBooster_json_end_section(buf_ptr, buf_len);
-	if (ret) {
-		return NULL;
-	}
-	return buf_ptr;
+	return (LiveBooster_json_end_section(&w) == 0) ? buf_ptr : NULL;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
 const char* LiveBooster_msg_encode_params_all_buf(char* buf_ptr, uint32_t buf_len, const LiveBooster_ArrayOfParams_t* params_array,
 		int32_t cid) {
-	int ret, i;
+	LiveBooster_JsonWriter_t w;
+	int ret = 0;
+	int i;
 	const LiveBooster_Param_t* param_ptr;
-	ret = LiveBooster_json_begin_section(buf_ptr, buf_len, "cfg");
-	if (ret) {
-		return NULL;
-	}
+
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	LiveBooster_json_begin_section(&w, "cfg");
 	param_ptr = params_array->param_ptr;
-	for (i = 0; i < params_array->param_nb; i++) {
-		ret = LiveBooster_json_add_param(&param_ptr->parm_data, buf_ptr, buf_len);
-		if (ret) {
-			return NULL;
-		}
+	for (i = 0; (i < params_array->param_nb) && (ret == 0); i++) {
+		ret = LiveBooster_json_add_param(&w, &param_ptr->parm_data);
 		param_ptr++;
 	}
+	if (ret) {
+		return NULL;
+	}
 
 	if (cid) {
-		if (ret == 0) {
-			ret = LiveBooster_json_add_section_end(buf_ptr, buf_len);
-		}
-
-		if (ret == 0) {
-			ret = LiveBooster_json_add_name_int("cid", cid, buf_ptr, buf_len);
-		}
-		if (ret == 0) {
-			ret = LiveBooster_json_end(buf_ptr, buf_len);
-		}
+		LiveBooster_json_add_section_end(&w);
+		LiveBooster_json_add_name_int(&w, "cid", cid);
+		ret = LiveBooster_json_end(&w);
 	}
 	else {
-		ret = LiveBooster_json_end_section(buf_ptr, buf_len);
-		if (ret) {
-			return NULL;
-		}
+		ret = LiveBooster_json_end_section(&w);
 	}
-	return buf_ptr;
+	return (ret == 0) ? buf_ptr : NULL;
 }
 
 /* --------------------------------------------------------------------------------- */
@@ -188,34 +240,30 @@ static const char* LiveBooster_msg_encode_cmd_resp_buf(char* buf_ptr,
 													   int32_t cid,
 		                                               const LiveBooster_Data_t* data_ptr,
 		                                               int data_nb) {
-	int ret;
+	LiveBooster_JsonWriter_t w;
+	int ret = 0;
 
 	if (cid == 0) {
 		return NULL;
 	}
 
-	ret = LiveBooster_json_begin_section(buf_ptr, buf_len, "res");
+	LiveBooster_json_init(&w, buf_ptr, buf_len);
+	LiveBooster_json_begin_section(&w, "res");
 
-	if ((ret == 0) && (data_ptr) &&(data_nb > 0)) {
+	if ((data_ptr) &&(data_nb > 0)) {
 		int i;
 		const LiveBooster_Data_t* p_data = data_ptr;
-		for (i = 0; i < data_nb; i++) {
-			ret = LiveBooster_json_add_item(p_data, buf_ptr, buf_len);
-			if (ret) {
-				break;
-			}
+		for (i = 0; (i < data_nb) && (ret == 0); i++) {
+			ret = LiveBooster_json_add_item(&w, p_data);
 			p_data++;
 		}
 	}
 
-	if (ret == 0)
-		ret = LiveBooster_json_add_section_end(buf_ptr, buf_len);
+	LiveBooster_json_add_section_end(&w);
+	LiveBooster_json_add_name_int(&w, "cid", cid);
 
 	if (ret == 0)
-		ret = LiveBooster_json_add_name_int("cid", cid, buf_ptr, buf_len);
-
-	if (ret == 0)
-		ret = LiveBooster_json_end(buf_ptr, buf_len);
+		ret = LiveBooster_json_end(&w);
 
 	return ((ret == 0) ? buf_ptr : NULL);
 }
@@ -240,63 +288,51 @@ static const char* lib_rsc_res[] = {
 };
 
 const char* LiveBooster_msg_encode_rsc_result(int32_t cid, LiveBooster_ResourceRespCode_t result) {
-	int ret;
+	LiveBooster_JsonWriter_t w;
+	int res_idx = result;
 
 	if (cid == 0) {
 		return NULL;
 	}
 
-	ret = LiveBooster_json_begin(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	LiveBooster_json_init(&w, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	LiveBooster_json_begin(&w);
 
-	if (ret == 0) {
-		int res_idx = result;
-		if ((res_idx < 0) || (res_idx >= RCP_RSP_MAX))
-			res_idx = RSC_RSP_ERR_INTERNAL_ERROR;
-		ret = LiveBooster_json_add_name_str("res", lib_rsc_res[res_idx], _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
+	if ((res_idx < 0) || (res_idx >= RCP_RSP_MAX))
+		res_idx = RSC_RSP_ERR_INTERNAL_ERROR;
+	LiveBooster_json_add_name_str(&w, "res", lib_rsc_res[res_idx]);
+	LiveBooster_json_add_name_int(&w, "cid", cid);
 
-	if (ret == 0) {
-		ret = LiveBooster_json_add_name_int("cid", cid, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
-
-	if (ret == 0) {
-		ret = LiveBooster_json_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
-	return (ret == 0) ? _LiveBooster_msg_buf : NULL;
+	return (LiveBooster_json_end(&w) == 0) ? _LiveBooster_msg_buf : NULL;
 }
 
 
 /* --------------------------------------------------------------------------------- */
 /*  */
 const char* LiveBooster_msg_encode_rsc_error(char* error, char* errorDetails) {
-	int ret;
+	LiveBooster_JsonWriter_t w;
 
 	if ((error == NULL) || (errorDetails == NULL))  {
 		return NULL;
 	}
 
-	ret = LiveBooster_json_begin(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-
-	if (ret == 0) {
-		ret = LiveBooster_json_add_name_str("errorCode", error, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
+	LiveBooster_json_init(&w, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	LiveBooster_json_begin(&w);
+	LiveBooster_json_add_name_str(&w, "errorCode", error);
+	LiveBooster_json_add_name_str(&w, "errorDetails", errorDetails);
 
-	if (ret == 0) {
-		ret = LiveBooster_json_add_name_str("errorDetails", errorDetails, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
-
-	if (ret == 0) {
-		ret = LiveBooster_json_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
-	return (ret == 0) ? _LiveBooster_msg_buf : NULL;
+	return (LiveBooster_json_end(&w) == 0) ? _LiveBooster_msg_buf : NULL;
 }
 
 /* --------------------------------------------------------------------------------- */
 /*  */
-const char* LiveBooster_msg_encode_params_update(const LiveBooster_SetofUpdatedParams_t* pParamUpdateSet) {
-	int ret;
+const char* LiveBooster_msg_encode_params_update(const LiveBooster_ArrayOfParams_t* pParamSet,
+		                                            const LiveBooster_SetofUpdatedParams_t* pParamUpdateSet) {
+	LiveBooster_JsonWriter_t w;
+	int ret = 0;
+	int i;
 
-	if (pParamUpdateSet == NULL) {
+	if ((pParamSet == NULL) || (pParamUpdateSet == NULL)) {
 		return NULL;
 	}
 
@@ -304,39 +340,24 @@ const char* LiveBooster_msg_encode_params_update(const LiveBooster_SetofUpdatedP
 		return NULL;
 	}
 
-	if ((pParamUpdateSet->nb_of_params == 0) || (pParamUpdateSet->tab_of_param_ptr[0] == NULL)) {
+	if (pParamUpdateSet->nb_of_params == 0) {
 		return NULL;
 	}
 
-	ret = LiveBooster_json_begin_section(_LiveBooster_msg_buf, LB_JSON_BUF_SZ, "cfg");
+	LiveBooster_json_init(&w, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	LiveBooster_json_begin_section(&w, "cfg");
 
-	if (ret == 0) {
-		int i;
-		const LiveBooster_Param_t* param_ptr;
-		for (i = 0; i < pParamUpdateSet->nb_of_params; i++) {
-			param_ptr = pParamUpdateSet->tab_of_param_ptr[i];
-			if (param_ptr == NULL) {
-				break;
-			}
-			ret = LiveBooster_json_add_param(&param_ptr->parm_data, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-			if (ret) {
-				break;
-			}
-		}
-	}
-	if (ret == 0) {
-		ret = LiveBooster_json_add_section_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-		if (ret) {
+	for (i = 0; (i < pParamSet->param_nb) && (ret == 0); i++) {
+		if (pParamUpdateSet->updated_mask[i >> 5] & (1UL << (i & 31))) {
+			ret = LiveBooster_json_add_param(&w, &pParamSet->param_ptr[i].parm_data);
 		}
 	}
 
-	if (ret == 0) {
-		ret = LiveBooster_json_add_name_int("cid", pParamUpdateSet->cid, _LiveBooster_msg_buf,
-		LB_JSON_BUF_SZ);
-	}
+	LiveBooster_json_add_section_end(&w);
+	LiveBooster_json_add_name_int(&w, "cid", pParamUpdateSet->cid);
 
 	if (ret == 0) {
-		ret = LiveBooster_json_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+		ret = LiveBooster_json_end(&w);
 	}
 	return (ret == 0) ? _LiveBooster_msg_buf : NULL;
 }
@@ -348,46 +369,37 @@ static const char* lib_res[] = {
 	"Invalid",
 	"Bad format",
 	"Not supported",
-	"Not processed"
+	"Not processed",
+	NULL,
+	"Out of memory",
+	"Too large"
 };
 
 const char* LiveBooster_msg_encode_cmd_result(int32_t cid, int result) {
-	int ret;
+	LiveBooster_JsonWriter_t w;
 
 	if (cid == 0) {
 		return NULL;
 	}
 
-	ret = LiveBooster_json_begin_section(_LiveBooster_msg_buf, LB_JSON_BUF_SZ, "res");
+	LiveBooster_json_init(&w, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	LiveBooster_json_begin_section(&w, "res");
 
-	if (ret == 0) {
-		if (result < 0) {
-			int err_idx = -result - 1;
-			ret = LiveBooster_json_add_name_int("LiveBooster_err_code", result, _LiveBooster_msg_buf,
-			LB_JSON_BUF_SZ);
-
-			if ((ret == 0) && (err_idx >= 0) && (err_idx < 4)) {
-				ret = LiveBooster_json_add_name_str("LiveBooster_error", lib_res[err_idx], _LiveBooster_msg_buf,
-				LB_JSON_BUF_SZ);
-			}
-		}
-		else if (result >= 0) { // User code
-			ret = LiveBooster_json_add_name_str("Result", "OK", _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	if (result < 0) {
+		int err_idx = -result - 1;
+		LiveBooster_json_add_name_int(&w, "LiveBooster_err_code", result);
+		if ((err_idx >= 0) && (err_idx < (int) (sizeof(lib_res) / sizeof(lib_res[0]))) && lib_res[err_idx]) {
+			LiveBooster_json_add_name_str(&w, "LiveBooster_error", lib_res[err_idx]);
 		}
 	}
-
-	if (ret == 0) {
-		ret = LiveBooster_json_add_section_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
+	else { // User code
+		LiveBooster_json_add_name_str(&w, "Result", "OK");
 	}
 
-	if (ret == 0) {
-		ret = LiveBooster_json_add_name_int("cid", cid, _LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
+	LiveBooster_json_add_section_end(&w);
+	LiveBooster_json_add_name_int(&w, "cid", cid);
 
-	if (ret == 0) {
-		ret = LiveBooster_json_end(_LiveBooster_msg_buf, LB_JSON_BUF_SZ);
-	}
-	return (ret == 0) ? _LiveBooster_msg_buf : NULL;
+	return (LiveBooster_json_end(&w) == 0) ? _LiveBooster_msg_buf : NULL;
 }
 
 /* ================================================================================= */
@@ -430,11 +442,35 @@ const char* LiveBooster_msg_encode_data(const LiveBooster_SetOfData_t* pSetData)
 	if ((pSetData->data_set.data_nb == 0) || (pSetData->data_set.data_ptr == NULL))
 		return NULL;
 
+#if LB_JSON_TMPL_SZ > 0
+	if (pSetData->tmpl.slot_nb) {
+		return LiveBooster_msg_fill_data_buf(_LiveBooster_msg_buf, LB_JSON_BUF_SZ, pSetData);
+	}
+#endif
 	p_msg = LiveBooster_msg_encode_data_buf(_LiveBooster_msg_buf, LB_JSON_BUF_SZ, pSetData);
 
 	return p_msg;
 }
 
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_msg_template_data(LiveBooster_SetOfData_t* pSetData) {
+#if LB_JSON_TMPL_SZ > 0
+	if ((pSetData == NULL) || (pSetData->stream_id[0] == 0))
+		return -1;
+
+	if ((pSetData->data_set.data_nb == 0) || (pSetData->data_set.data_ptr == NULL)) {
+		pSetData->tmpl.slot_nb = 0;
+		return -1;
+	}
+
+	return LiveBooster_msg_template_data_buf(&pSetData->tmpl, pSetData);
+#else
+	(void)pSetData;
+	return -1;
+#endif
+}
+
 /* --------------------------------------------------------------------------------- */
 /*  */
 
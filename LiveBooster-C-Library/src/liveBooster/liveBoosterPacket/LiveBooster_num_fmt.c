@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the 'BSD-3-Clause'
+ * license which can be found in the file 'LICENSE.txt' in this package distribution
+ * or at 'https://opensource.org/licenses/BSD-3-Clause'.
+ */
+
+/**
+ * @file  LiveBooster_num_fmt.c
+ * @brief Integer and shortest round-trip float formatting, and the matching parsers
+ *
+ * Floats: the digits are computed in double, which carries 29 bits more than the float mantissa,
+ * for 1 to 9 significant digits until the decimal number reads back as the same float.
+ * Parsing is the reverse : up to 19 significant digits in 64 bits, scaled once in double.
+ * Neither depends on the C locale (decimal point) nor needs a NUL terminated input.
+ */
+
+#include <string.h>
+
+#include "LiveBooster_num_fmt.h"
+
+/* "00" to "99" */
+static const char _LiveBooster_digits2[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* --------------------------------------------------------------------------------- */
+/* Digits of "value", right-aligned before "end" : return the first one */
+static char* fmt_digits(char* end, uint64_t value) {
+	while (value >= 100) {
+		uint64_t q = value / 100;
+		end -= 2;
+		memcpy(end, &_LiveBooster_digits2[(value - q * 100) * 2], 2);
+		value = q;
+	}
+	if (value >= 10) {
+		end -= 2;
+		memcpy(end, &_LiveBooster_digits2[value * 2], 2);
+	}
+	else {
+		*--end = (char)('0' + value);
+	}
+	return end;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_fmt_u32(char* out, uint32_t value) {
+	char tmp[10];
+	char* p = fmt_digits(tmp + sizeof(tmp), value);
+	int len = (int)(tmp + sizeof(tmp) - p);
+	memcpy(out, p, len);
+	return len;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_fmt_i32(char* out, int32_t value) {
+	if (value < 0) {
+		*out = '-';
+		return 1 + LiveBooster_fmt_u32(out + 1, 0U - (uint32_t)value);
+	}
+	return LiveBooster_fmt_u32(out, (uint32_t)value);
+}
+
+static const double _LiveBooster_pow10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* --------------------------------------------------------------------------------- */
+/* x * 10^n (exact powers up to 1e22, a few double roundings beyond) */
+static double scale10(double x, int n) {
+	while (n > 22) {
+		x *= 1e22;
+		n -= 22;
+	}
+	while (n < -22) {
+		x /= 1e22;
+		n += 22;
+	}
+	return (n >= 0) ? x * _LiveBooster_pow10[n] : x / _LiveBooster_pow10[-n];
+}
+
+#if !defined(ARDUINO_ARCH_AVR)
+
+/* --------------------------------------------------------------------------------- */
+/* Decimal number "digits" * 10^exp10, digits without trailing zero */
+static int fmt_decimal(char* out, uint64_t digits, int exp10) {
+	char tmp[20];
+	char* p = fmt_digits(tmp + sizeof(tmp), digits);
+	int n = (int)(tmp + sizeof(tmp) - p);
+	int lead = exp10 + n - 1;   /* exponent of the first digit */
+	int len = 0;
+
+	if ((exp10 >= 0) && (exp10 <= 2)) {
+		/* integer, up to 2 zeros padded */
+		memcpy(out, p, n);
+		len = n;
+		while (exp10-- > 0) {
+			out[len++] = '0';
+		}
+	}
+	else if ((exp10 < 0) && (lead >= 0)) {
+		/* point inside the digits */
+		memcpy(out, p, lead + 1);
+		out[lead + 1] = '.';
+		memcpy(out + lead + 2, p + lead + 1, n - lead - 1);
+		len = n + 1;
+	}
+	else if ((exp10 < 0) && (lead >= -4)) {
+		/* leading zeros */
+		out[len++] = '0';
+		out[len++] = '.';
+		while (++lead < 0) {
+			out[len++] = '0';
+		}
+		memcpy(out + len, p, n);
+		len += n;
+	}
+	else {
+		/* exponent */
+		out[len++] = p[0];
+		if (n > 1) {
+			out[len++] = '.';
+			memcpy(out + len, p + 1, n - 1);
+			len += n - 1;
+		}
+		out[len++] = 'e';
+		if (lead < 0) {
+			out[len++] = '-';
+			lead = -lead;
+		}
+		len += LiveBooster_fmt_u32(out + len, (uint32_t)lead);
+	}
+	return len;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Number of "p" digits reading back as "value" (x = value, 10^k <= x < 10^(k+1)), or 0 */
+static uint32_t roundTrip(float value, double x, int k, int p) {
+	uint32_t d = (uint32_t)(scale10(x, p - 1 - k) + 0.5);
+	if ((float)scale10((double)d, k - p + 1) == value) {
+		return d;
+	}
+	if ((float)scale10((double)(d + 1), k - p + 1) == value) {
+		return d + 1;
+	}
+	if ((d > 1) && ((float)scale10((double)(d - 1), k - p + 1) == value)) {
+		return d - 1;
+	}
+	return 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_fmt_float(char* out, float value, int decimals) {
+	uint32_t bits;
+	double x;
+	uint64_t digits = 0;
+	int exp10 = 0;
+	int k;
+	int p, lo, hi;
+	int len = 0;
+
+	memcpy(&bits, &value, sizeof(bits));
+	if (((bits >> 23) & 0xFF) == 0xFF) {
+		memcpy(out, "null", 4);
+		return 4;
+	}
+	if (bits & 0x80000000UL) {
+		out[len++] = '-';
+		value = -value;
+	}
+	if (value == 0.0f) {
+		out[0] = '0';
+		return 1;
+	}
+	x = (double)value;
+
+	/* k : exponent of the first significant digit (estimated from the binary exponent) */
+	k = (int)(((int)((bits >> 23) & 0xFF) - 127) * 0.30103);
+	while (scale10(1.0, k) > x) {
+		k--;
+	}
+	while (scale10(1.0, k + 1) <= x) {
+		k++;
+	}
+
+	/* shortest : fewest digits p (1..9, 9 always read back) such that the closest number of p digits,
+	   or one of its neighbours when the float gaps are uneven (power of 2), reads back as the same float.
+	   Reading back is monotonic in p : binary search */
+	lo = 1;
+	hi = 9;
+	while (lo <= hi) {
+		uint32_t d;
+		p = (lo + hi) / 2;
+		d = roundTrip(value, x, k, p);
+		if (d) {
+			digits = d;
+			exp10 = k - p + 1;
+			hi = p - 1;
+		}
+		else {
+			lo = p + 1;
+		}
+	}
+	if (digits == 0) {   /* not expected */
+		digits = (uint64_t)(scale10(x, 8 - k) + 0.5);
+		exp10 = k - 8;
+	}
+	while ((digits % 10) == 0) {
+		digits /= 10;
+		exp10++;
+	}
+
+	/* rounded to "decimals" if more (and if it fits in 64 bits) */
+	if ((decimals >= 0) && (decimals <= LB_FMT_MAX_DECIMALS) && (exp10 < -decimals) &&
+		(x < scale10(1.0, 18 - decimals))) {
+		digits = (uint64_t)(scale10(x, decimals) + 0.5);
+		exp10 = -decimals;
+		if (digits == 0) {
+			out[0] = '0';
+			return 1;
+		}
+		while ((digits % 10) == 0) {
+			digits /= 10;
+			exp10++;
+		}
+	}
+
+	return len + fmt_decimal(out + len, digits, exp10);
+}
+
+#endif /* !ARDUINO_ARCH_AVR */
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_parse_u32(const char* s, uint32_t len, uint32_t* value) {
+	uint32_t v = 0;
+	uint32_t i;
+
+	if ((s == NULL) || (len == 0) || (len > LB_FMT_INT_SZ)) {
+		return -1;
+	}
+	for (i = 0; i < len; i++) {
+		uint32_t d = (uint32_t)(s[i] - '0');
+		if ((d > 9) || (v > (0xFFFFFFFFUL - d) / 10)) {
+			return -1;
+		}
+		v = v * 10 + d;
+	}
+	*value = v;
+	return 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_parse_i32(const char* s, uint32_t len, int32_t* value) {
+	uint32_t v;
+
+	if ((s != NULL) && (len > 1) && (*s == '-')) {
+		if (LiveBooster_parse_u32(s + 1, len - 1, &v) || (v > 0x80000000UL)) {
+			return -1;
+		}
+		*value = (int32_t)(0U - v);
+		return 0;
+	}
+	if (LiveBooster_parse_u32(s, len, &v) || (v > 0x7FFFFFFFUL)) {
+		return -1;
+	}
+	*value = (int32_t)v;
+	return 0;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* JSON number : -?digits(.digits)?([eE][+-]?digits)? */
+int LiveBooster_parse_float(const char* s, uint32_t len, float* value) {
+	const char* end = s + len;
+	uint64_t digits = 0;
+	int nd = 0;        /* significant digits kept in "digits" */
+	int exp10 = 0;
+	int neg = 0;
+	int seen = 0;
+	double x;
+
+	if ((s == NULL) || (len == 0)) {
+		return -1;
+	}
+	if (*s == '-') {
+		neg = 1;
+		s++;
+	}
+	for (; (s < end) && (*s >= '0') && (*s <= '9'); s++, seen = 1) {
+		if (nd < 19) {
+			digits = digits * 10 + (uint64_t)(*s - '0');
+			nd += (digits != 0);
+		}
+		else {
+			exp10++;   /* dropped digit */
+		}
+	}
+	if ((s < end) && (*s == '.')) {
+		for (s++; (s < end) && (*s >= '0') && (*s <= '9'); s++, seen = 1) {
+			if (nd < 19) {
+				digits = digits * 10 + (uint64_t)(*s - '0');
+				nd += (digits != 0);
+				exp10--;
+			}
+		}
+	}
+	if (!seen) {
+		return -1;
+	}
+	if ((s < end) && ((*s == 'e') || (*s == 'E'))) {
+		int eneg = 0;
+		int e = 0;
+		s++;
+		if ((s < end) && ((*s == '+') || (*s == '-'))) {
+			eneg = (*s++ == '-');
+		}
+		if (s == end) {
+			return -1;
+		}
+		for (; (s < end) && (*s >= '0') && (*s <= '9'); s++) {
+			if (e < 1000) {
+				e = e * 10 + (*s - '0');
+			}
+		}
+		exp10 += eneg ? -e : e;
+	}
+	if (s != end) {
+		return -1;
+	}
+
+	if (digits == 0) {
+		x = 0.0;
+	}
+	else if (exp10 + nd > 40) {
+		x = 1e300;         /* float overflow : infinity */
+	}
+	else if (exp10 + nd < -50) {
+		x = 0.0;           /* below the smallest denormal */
+	}
+	else {
+		x = scale10((double)digits, exp10);
+	}
+	*value = (float)(neg ? -x : x);
+	return 0;
+}
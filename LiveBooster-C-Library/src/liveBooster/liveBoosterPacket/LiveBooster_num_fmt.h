@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the 'BSD-3-Clause'
+ * license which can be found in the file 'LICENSE.txt' in this package distribution
+ * or at 'https://opensource.org/licenses/BSD-3-Clause'.
+ */
+
+/**
+ * @file   LiveBooster_num_fmt.h
+ * @brief  Number formatting for the JSON encoder, without snprintf,
+ *         and number parsing for the JSON decoder, without sscanf.
+ *
+ * The output is not NUL terminated : the functions return the number of written characters.
+ * The input of the parsers is (pointer, length), not NUL terminated.
+ */
+
+#ifndef __LiveBooster_num_fmt_H_
+#define __LiveBooster_num_fmt_H_
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Max length of a formatted int32_t / uint32_t ("-2147483648") */
+#define LB_FMT_INT_SZ     11
+
+/* Max length of a formatted float ("-1.2345678e-38", or 19 digits, point and sign with a precision) */
+#define LB_FMT_FLOAT_SZ   24
+
+/* Max number of decimals of LiveBooster_fmt_float() */
+#define LB_FMT_MAX_DECIMALS  9
+
+int LiveBooster_fmt_u32(char* out, uint32_t value);
+
+int LiveBooster_fmt_i32(char* out, int32_t value);
+
+#if !defined(ARDUINO_ARCH_AVR)
+/**
+ * Shortest decimal form which reads back as the same float ("0.1", "21.5", "1e-7", "3.4028235e38"),
+ * rounded to at most "decimals" decimals if it has more (0..LB_FMT_MAX_DECIMALS, -1 = no limit).
+ * NaN and infinities are written as "null" (not representable in JSON).
+ * (Not available on AVR, whose double has the float precision.)
+ */
+int LiveBooster_fmt_float(char* out, float value, int decimals);
+#endif
+
+/**
+ * Parse a decimal integer of exactly "len" characters (no sign, no space, no fraction).
+ * @return 0 if ok, -1 if it is not an integer or out of range.
+ */
+int LiveBooster_parse_u32(const char* s, uint32_t len, uint32_t* value);
+
+/**
+ * Same as LiveBooster_parse_u32, with an optional '-' sign.
+ */
+int LiveBooster_parse_i32(const char* s, uint32_t len, int32_t* value);
+
+/**
+ * Parse a JSON number of exactly "len" characters, independently of the C locale.
+ * Values written by LiveBooster_fmt_float() read back as the same float.
+ * @return 0 if ok, -1 if it is not a JSON number.
+ */
+int LiveBooster_parse_float(const char* s, uint32_t len, float* value);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __LiveBooster_num_fmt_H_ */
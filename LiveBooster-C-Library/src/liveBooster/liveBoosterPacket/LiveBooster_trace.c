@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the 'BSD-3-Clause'
+ * license which can be found in the file 'LICENSE.txt' in this package distribution
+ * or at 'https://opensource.org/licenses/BSD-3-Clause'.
+ */
+
+/**
+ * @file   LiveBooster_trace.c
+ * @brief  Traces of the library : immediate or deferred (binary ring buffer)
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "LiveBooster_trace.h"
+#include "LiveBooster_msg.h"
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_trace_text(const char* fmt, ...) {
+	va_list ap;
+	if (msgDebug == NULL) {
+		return;
+	}
+	va_start(ap, fmt);
+	vsnprintf(traceDebug, sizeof(traceDebug), fmt, ap);
+	va_end(ap);
+	msgDebug->print(traceDebug);
+}
+
+#if LB_TRACE_DEFERRED
+
+/* Ring of variable length records : format address, number of arguments, arguments (32 bits each) */
+#define TRACE_HDR_SZ   (sizeof(const char*) + 1)
+
+static uint8_t  _LiveBooster_trace_ring[LB_TRACE_RING_SZ];
+static uint32_t _LiveBooster_trace_head;  /* next write */
+static uint32_t _LiveBooster_trace_tail;  /* oldest record */
+static uint32_t _LiveBooster_trace_used;
+static uint32_t _LiveBooster_trace_lost;
+
+static void ring_write(const void* p, uint32_t n) {
+	uint32_t n1 = LB_TRACE_RING_SZ - _LiveBooster_trace_head;
+	if (n < n1) {
+		memcpy(&_LiveBooster_trace_ring[_LiveBooster_trace_head], p, n);
+		_LiveBooster_trace_head += n;
+	}
+	else {
+		memcpy(&_LiveBooster_trace_ring[_LiveBooster_trace_head], p, n1);
+		memcpy(_LiveBooster_trace_ring, (const uint8_t*) p + n1, n - n1);
+		_LiveBooster_trace_head = n - n1;
+	}
+}
+
+static void ring_read(void* p, uint32_t n) {
+	uint32_t n1 = LB_TRACE_RING_SZ - _LiveBooster_trace_tail;
+	if (n < n1) {
+		memcpy(p, &_LiveBooster_trace_ring[_LiveBooster_trace_tail], n);
+		_LiveBooster_trace_tail += n;
+	}
+	else {
+		memcpy(p, &_LiveBooster_trace_ring[_LiveBooster_trace_tail], n1);
+		memcpy((uint8_t*) p + n1, _LiveBooster_trace_ring, n - n1);
+		_LiveBooster_trace_tail = n - n1;
+	}
+}
+#endif
+
+/* --------------------------------------------------------------------------------- */
+/* Next conversion of "fmt" : return the address of its '%' (NULL at the end), and its number of '*' */
+static const char* trace_next_spec(const char* fmt, const char** conv, uint8_t* stars) {
+	const char* p;
+	while ((fmt = strchr(fmt, '%')) != NULL) {
+		if (fmt[1] == '%') {
+			fmt += 2;
+			continue;
+		}
+		*stars = 0;
+		for (p = fmt + 1; ((*p >= '0') && (*p <= '9')) || ((*p != 0) && (strchr("-+ #.*hlzjtL", *p) != NULL)); p++) {
+			if (*p == '*') {
+				(*stars)++;
+			}
+		}
+		if (*p == 0) {
+			return NULL;
+		}
+		*conv = p;
+		return fmt;
+	}
+	return NULL;
+}
+
+#if LB_TRACE_DEFERRED
+/* Kind of argument of a conversion */
+#define TRACE_INT     0
+#define TRACE_LONG    1
+#define TRACE_PTR     2
+#define TRACE_DOUBLE  3
+#define TRACE_LLONG   4  /* not cached (2 bits per argument) */
+
+static uint8_t trace_kind(const char* spec, const char* conv) {
+	uint8_t longs = 0;
+	for (spec++; spec < conv; spec++) {
+		if (*spec == 'l') {
+			longs++;
+		}
+		else if (*spec == 'j') {
+			longs = 2;
+		}
+		else if ((*spec == 'z') || (*spec == 't')) {
+			longs = (sizeof(size_t) == sizeof(unsigned int)) ? 0 : 1;
+		}
+	}
+	if ((*conv == 's') || (*conv == 'p')) {
+		return TRACE_PTR;
+	}
+	if (strchr("feEgG", *conv) != NULL) {
+		return TRACE_DOUBLE;
+	}
+	return (longs >= 2) ? TRACE_LLONG : longs;
+}
+
+static uint32_t trace_arg(va_list* ap, uint8_t kind) {
+	uint32_t v;
+	float f;
+	switch (kind) {
+	case TRACE_LONG:
+		return (uint32_t) va_arg(*ap, unsigned long);
+	case TRACE_PTR:
+		return (uint32_t) (uintptr_t) va_arg(*ap, const void*);
+	case TRACE_DOUBLE:
+		f = (float) va_arg(*ap, double);
+		memcpy(&v, &f, sizeof(uint32_t));
+		return v;
+	case TRACE_LLONG:
+		return (uint32_t) va_arg(*ap, unsigned long long);
+	default:
+		return (uint32_t) va_arg(*ap, unsigned int);
+	}
+}
+
+/* Kinds of the arguments of the call site, 2 bits each (or TRACE_SITE_SCAN) */
+static void trace_parse_site(LiveBooster_TraceSite_t* site, const char* fmt) {
+	const char* conv;
+	uint8_t stars;
+	uint8_t kind;
+	uint8_t nb = 0;
+
+	site->kinds = 0;
+	while ((fmt = trace_next_spec(fmt, &conv, &stars)) != NULL) {
+		kind = trace_kind(fmt, conv);
+		if ((nb + stars + 1 > LB_TRACE_MAX_ARGS) || (nb + stars + 1 > 16) || (kind == TRACE_LLONG)) {
+			site->state = TRACE_SITE_SCAN;
+			return;
+		}
+		nb += stars;  /* TRACE_INT */
+		site->kinds |= (uint32_t) kind << (2 * nb++);
+		fmt = conv + 1;
+	}
+	site->nb = nb;
+	site->state = TRACE_SITE_CACHED;
+}
+#endif
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+void LiveBooster_trace_defer(LiveBooster_TraceSite_t* site, const char* fmt, ...) {
+#if LB_TRACE_DEFERRED
+	uint8_t rec[TRACE_HDR_SZ + LB_TRACE_MAX_ARGS * sizeof(uint32_t)];
+	uint32_t args[LB_TRACE_MAX_ARGS];
+	uint8_t nb = 0;
+	uint32_t sz;
+	va_list ap;
+
+	if (site->state == 0) {
+		trace_parse_site(site, fmt);
+	}
+
+	va_start(ap, fmt);
+	if (site->state == TRACE_SITE_CACHED) {
+		uint32_t kinds = site->kinds;
+		for (; nb < site->nb; nb++, kinds >>= 2) {
+			args[nb] = trace_arg(&ap, (uint8_t) (kinds & 3));
+		}
+	}
+	else {
+		/* too many arguments or 64 bits ones : format scanned at each trace */
+		const char* p = fmt;
+		const char* conv;
+		uint8_t stars;
+		while (((p = trace_next_spec(p, &conv, &stars)) != NULL) && (nb + stars < LB_TRACE_MAX_ARGS)) {
+			while (stars--) {
+				args[nb++] = trace_arg(&ap, TRACE_INT);
+			}
+			args[nb++] = trace_arg(&ap, trace_kind(p, conv));
+			p = conv + 1;
+		}
+	}
+	va_end(ap);
+
+	sz = TRACE_HDR_SZ + nb * sizeof(uint32_t);
+	if (_LiveBooster_trace_used + sz > LB_TRACE_RING_SZ) {
+		_LiveBooster_trace_lost++;
+		return;
+	}
+	memcpy(rec, &fmt, sizeof(const char*));
+	rec[sizeof(const char*)] = nb;
+	memcpy(rec + TRACE_HDR_SZ, args, nb * sizeof(uint32_t));
+	ring_write(rec, sz);
+	_LiveBooster_trace_used += sz;
+#else
+	(void) site;
+	(void) fmt;
+#endif
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+int LiveBooster_trace_pop(LiveBooster_TraceRecord_t* rec) {
+#if LB_TRACE_DEFERRED
+	if (_LiveBooster_trace_used == 0) {
+		return -1;
+	}
+	ring_read(&rec->fmt, sizeof(const char*));
+	ring_read(&rec->nb, 1);
+	ring_read(rec->args, rec->nb * sizeof(uint32_t));
+	_LiveBooster_trace_used -= TRACE_HDR_SZ + rec->nb * sizeof(uint32_t);
+	return 0;
+#else
+	(void) rec;
+	return -1;
+#endif
+}
+
+/* --------------------------------------------------------------------------------- */
+/*  */
+uint32_t LiveBooster_trace_dropped(void) {
+#if LB_TRACE_DEFERRED
+	uint32_t n = _LiveBooster_trace_lost;
+	_LiveBooster_trace_lost = 0;
+	return n;
+#else
+	return 0;
+#endif
+}
+
+/* --------------------------------------------------------------------------------- */
+/* The conversions are formatted one by one, their length modifier being replaced by 'l' */
+int LiveBooster_trace_format(const LiveBooster_TraceRecord_t* rec, char* buf, uint32_t sz) {
+	const char* fmt = rec->fmt;
+	const char* conv = NULL;
+	const char* p;
+	uint32_t len = 0;
+	uint8_t stars = 0;
+	uint8_t i = 0;
+
+	if (sz == 0) {
+		return 0;
+	}
+	buf[0] = 0;
+	while (len + 1 < sz) {
+		char spec[24];
+		uint32_t n;
+		int32_t star_val = 0;
+		int w;
+
+		p = trace_next_spec(fmt, &conv, &stars);
+		/* text before the conversion ("%%" left as is) */
+		for (; (*fmt) && (fmt != p) && (len + 1 < sz); fmt++) {
+			buf[len++] = *fmt;
+			if ((fmt[0] == '%') && (fmt[1] == '%')) {
+				fmt++;
+			}
+		}
+		buf[len] = 0;
+		if ((p == NULL) || (fmt != p)) {
+			break;
+		}
+
+		/* copy of the conversion : '*' replaced by their value, without length modifier */
+		n = 0;
+		for (fmt = p; (fmt < conv) && (n + 12 < sizeof(spec)); fmt++) {
+			if (*fmt == '*') {
+				star_val = (i < rec->nb) ? (int32_t) rec->args[i++] : 0;
+				n += snprintf(spec + n, sizeof(spec) - n, "%ld", (long) star_val);
+			}
+			else if (strchr("hlzjtL", *fmt) == NULL) {
+				spec[n++] = *fmt;
+			}
+		}
+		fmt = conv + 1;
+
+		if (i >= rec->nb) {
+			w = snprintf(buf + len, sz - len, "?");
+		}
+		else if (*conv == 's') {
+			w = (stars) ? snprintf(buf + len, sz - len, "<%ld chars>", (long) star_val) : snprintf(buf + len, sz - len, "<str>");
+			i++;
+		}
+		else if (*conv == 'p') {
+			w = snprintf(buf + len, sz - len, "0x%lx", (unsigned long) rec->args[i++]);
+		}
+		else if (strchr("feEgG", *conv) != NULL) {
+			float f;
+			memcpy(&f, &rec->args[i++], sizeof(float));
+			spec[n++] = *conv;
+			spec[n] = 0;
+			w = snprintf(buf + len, sz - len, spec, (double) f);
+		}
+		else if (*conv == 'c') {
+			spec[n++] = 'c';
+			spec[n] = 0;
+			w = snprintf(buf + len, sz - len, spec, (int) rec->args[i++]);
+		}
+		else {
+			spec[n++] = 'l';
+			spec[n++] = *conv;
+			spec[n] = 0;
+			if ((*conv == 'd') || (*conv == 'i')) {
+				w = snprintf(buf + len, sz - len, spec, (long) (int32_t) rec->args[i++]);
+			}
+			else {
+				w = snprintf(buf + len, sz - len, spec, (unsigned long) rec->args[i++]);
+			}
+		}
+		if (w < 0) {
+			break;
+		}
+		len = ((uint32_t) w < sz - len) ? len + w : sz - 1;
+	}
+	return (int) len;
+}
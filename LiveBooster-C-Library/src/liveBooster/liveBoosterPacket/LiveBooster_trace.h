@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the 'BSD-3-Clause'
+ * license which can be found in the file 'LICENSE.txt' in this package distribution
+ * or at 'https://opensource.org/licenses/BSD-3-Clause'.
+ */
+
+/**
+ * @file   LiveBooster_trace.h
+ * @brief  Traces of the library, filtered at compile time.
+ *
+ * A trace above LB_LOG_LEVEL is compiled to nothing : its arguments are not even evaluated.
+ * The others are either formatted at once in traceDebug and printed by msgDebug (default),
+ * or, with LB_TRACE_DEFERRED = 1, only recorded as the address of their format and their raw
+ * arguments in a ring buffer. These records are formatted later by LiveBooster_FlushTraces()
+ * (low priority path), or read as they are by LiveBooster_trace_pop() to be decoded offline
+ * with the map file of the application.
+ *
+ * In the deferred mode, each argument is stored on 32 bits and a string argument is never read :
+ * "%s" is formatted as "<str>" and "%.*s" as "<N chars>". The kinds of the arguments of each call
+ * site are parsed from its format once, at its first trace (8 bytes per call site).
+ */
+
+#ifndef __LiveBooster_trace_H_
+#define __LiveBooster_trace_H_
+
+#include <stdint.h>
+
+#include "LiveBooster_config.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define LB_LOG_NONE   0
+#define LB_LOG_ERROR  1  /*!< Failures */
+#define LB_LOG_WARN   2  /*!< Refused or unexpected requests */
+#define LB_LOG_INFO   3  /*!< Connection steps and processing of the requests */
+#define LB_LOG_DEBUG  4  /*!< Dumps of the sent and received payloads */
+
+/**
+ * @brief Raw deferred trace record
+ */
+typedef struct {
+	const char* fmt;                       /*!< Format of the trace (address in the application image) */
+	uint8_t nb;                            /*!< Number of arguments */
+	uint32_t args[LB_TRACE_MAX_ARGS];      /*!< Arguments, in the order of the format */
+} LiveBooster_TraceRecord_t;
+
+/**
+ * @brief Call site of a deferred trace : kinds of its arguments, parsed from its format at the first trace
+ */
+typedef struct {
+	uint32_t kinds;  /*!< 2 bits per argument : int, long, pointer or double */
+	uint8_t nb;      /*!< Number of arguments */
+	uint8_t state;   /*!< 0 = not parsed, TRACE_SITE_CACHED, or TRACE_SITE_SCAN (format scanned at each trace) */
+} LiveBooster_TraceSite_t;
+
+#define TRACE_SITE_CACHED  1
+#define TRACE_SITE_SCAN    2
+
+/* Format the trace in traceDebug and print it */
+void LiveBooster_trace_text(const char* fmt, ...);
+
+/* Record the trace in the ring buffer : it is dropped (and counted) if the ring is full */
+void LiveBooster_trace_defer(LiveBooster_TraceSite_t* site, const char* fmt, ...);
+
+/* Remove the oldest record from the ring : return 0, or -1 if the ring is empty */
+int LiveBooster_trace_pop(LiveBooster_TraceRecord_t* rec);
+
+/* Format a record in "buf" : return the length of the text */
+int LiveBooster_trace_format(const LiveBooster_TraceRecord_t* rec, char* buf, uint32_t sz);
+
+/* Number of traces dropped because the ring was full (counter cleared) */
+uint32_t LiveBooster_trace_dropped(void);
+
+#if LB_TRACE_DEFERRED
+#define LB_TRACE_OUT(...)  do { static LiveBooster_TraceSite_t _lb_site; LiveBooster_trace_defer(&_lb_site, __VA_ARGS__); } while (0)
+#else
+#define LB_TRACE_OUT(...)  LiveBooster_trace_text(__VA_ARGS__)
+#endif
+
+#if LB_LOG_LEVEL >= LB_LOG_ERROR
+#define LB_TRACE_ERROR(...)  LB_TRACE_OUT(__VA_ARGS__)
+#else
+#define LB_TRACE_ERROR(...)  do { } while (0)
+#endif
+
+#if LB_LOG_LEVEL >= LB_LOG_WARN
+#define LB_TRACE_WARN(...)   LB_TRACE_OUT(__VA_ARGS__)
+#else
+#define LB_TRACE_WARN(...)   do { } while (0)
+#endif
+
+#if LB_LOG_LEVEL >= LB_LOG_INFO
+#define LB_TRACE_INFO(...)   LB_TRACE_OUT(__VA_ARGS__)
+#else
+#define LB_TRACE_INFO(...)   do { } while (0)
+#endif
+
+#if LB_LOG_LEVEL >= LB_LOG_DEBUG
+#define LB_TRACE_DEBUG(...)  LB_TRACE_OUT(__VA_ARGS__)
+#else
+#define LB_TRACE_DEBUG(...)  do { } while (0)
+#endif
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __LiveBooster_trace_H_ */
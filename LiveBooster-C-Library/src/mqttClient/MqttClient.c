@@ -17,39 +17,90 @@ static void NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage*
 }
 
 
-static int getNextPacketId(MQTTClient *c) {
-    return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
-}
+// readPacket(): packet larger than readbuf, consumed by readLargePacket() (not an MQTT packet type)
+#define LARGE_PACKET  16
 
-
-static int sendPacket(MQTTClient* c, int length)
+static int inflightFind(MQTTClient* c, unsigned short id)
 {
-    int rc = ERR_MQTT_SENT_PACKET;
-    int sent = 0;
+    int i;
 
-    while (sent < length )
+    if (c->inflight != NULL)
     {
-        rc = c->tcpLayer->write(c->tcpLayer, &c->buf[sent], length);
-        if (rc < 0)  // there was an error writing the data
-            break;
-        sent += rc;
+        for (i = 0; i < c->inflight->count; i++)
+        {
+            if (c->inflight->entries[i].id == id)
+                return i;
+        }
     }
-    if (sent == length)
+    return -1;
+}
+
+// The ids of the PUBLISH in flight, restored or kept from a previous session, are skipped
+static int getNextPacketId(MQTTClient *c) {
+    do
+        c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
+    while (inflightFind(c, c->next_packetid) >= 0);
+    return c->next_packetid;
+}
+
+
+// Send a packet made of "count" segments (updated in place), going on after the partial writes of the transport
+static int sendSegments(MQTTClient* c, SerialChunk* segments, int count)
+{
+    while (count > 0)
     {
-    	c->lastSentTimeInMs = c->timer->millis() + 1000*c->keepAliveIntervalInSec; // record the fact that we have MQTT_SUCCESSy sent the packet
-        rc = MQTT_SUCCESS;
+        int rc;
+        if (segments->size <= 0)
+        {
+            segments++;
+            count--;
+            continue;
+        }
+        if (c->tcpLayer->writeChunks)
+            rc = c->tcpLayer->writeChunks(c->tcpLayer, segments, count);
+        else
+            rc = c->tcpLayer->write(c->tcpLayer, (const unsigned char*)segments->buffer, segments->size);
+        if (rc <= 0)  // there was an error writing the data
+            return ERR_MQTT_SENT_PACKET;
+        while (rc > 0)  // skip what was sent
+        {
+            if (rc >= segments->size)
+            {
+                rc -= segments->size;
+                segments++;
+                count--;
+            }
+            else
+            {
+                segments->buffer += rc;
+                segments->size -= rc;
+                rc = 0;
+            }
+        }
     }
-    else
-        rc = ERR_MQTT_SENT_PACKET;
-    return rc;
+    c->lastSentTimeInMs = c->timer->millis() + 1000*c->keepAliveIntervalInSec; // record the fact that we have MQTT_SUCCESSy sent the packet
+    return MQTT_SUCCESS;
 }
 
-void MQTTClientInit(MQTTClient* c, SerialInterface* serial, TimerInterface* timer, DebugInterface *debug)
+static int sendPacket(MQTTClient* c, int length)
 {
-    HeraclesTcpClient__Init(&c->heraclesTcpClient, serial, timer, debug, 1);
+    SerialChunk segment;
+    segment.buffer = (const char*)c->buf;
+    segment.size = length;
+    return sendSegments(c, &segment, 1);
+}
+
+/* Send the packets kept by the TCP layer for coalescing */
+static int flushPackets(MQTTClient* c)
+{
+    if (c->tcpLayer->flush && !c->tcpLayer->flush(c->tcpLayer))
+        return ERR_MQTT_SENT_PACKET;
+    return MQTT_SUCCESS;
+}
 
+static void MQTTClientInitCommon(MQTTClient* c, TimerInterface* timer, DebugInterface *debug)
+{
 	int i;
-    c->tcpLayer = (TcpClientInterface*)&c->heraclesTcpClient;
     c->timer = timer;
 	c->debug = debug;
     c->lastSentTimeInMs = timer->millis();
@@ -61,69 +112,160 @@ void MQTTClientInit(MQTTClient* c, SerialInterface* serial, TimerInterface* time
     c->isconnected = 0;
     c->cleansession = 0;
     c->ping_outstanding = 0;
+    c->cycleDepth = 0;
+    c->readAheadStart = 0;
+    c->readAheadEnd = 0;
     c->defaultMessageHandler = NULL;
+    c->largeBuf = NULL;
+    c->largeBufSize = 0;
+    c->largeHandler = NULL;
+    c->largeQos = QOS0;
+    c->largeId = 0;
+    c->skippedMessages = 0;
+    c->inflight = NULL;
+    c->inflightWindow = 0;
+    c->inflightHandler = NULL;
 	c->next_packetid = 1;
 }
 
+void MQTTClientInit(MQTTClient* c, SerialInterface* serial, TimerInterface* timer, DebugInterface *debug)
+{
+    HeraclesTcpClient__Init(&c->heraclesTcpClient, serial, timer, debug, 1);
+    c->tcpLayer = (TcpClientInterface*)&c->heraclesTcpClient;
+    MQTTClientInitCommon(c, timer, debug);
+}
 
-static int decodePacket(MQTTClient* c, int* value, int timeout)
+void MQTTClientInitTransparent(MQTTClient* c, SerialInterface* serial, TimerInterface* timer, DebugInterface *debug)
 {
-    unsigned char i;
-    int multiplier = 1;
-    int len = 0;
-    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    HeraclesTransparentTcpClient__Init(&c->heraclesTransparentTcpClient, serial, timer, debug, 1);
+    c->tcpLayer = (TcpClientInterface*)&c->heraclesTransparentTcpClient;
+    MQTTClientInitCommon(c, timer, debug);
+}
 
-    *value = 0;
-    do
+
+#if MQTT_READ_AHEAD_SIZE < MQTT_DEFAULT_RECV_SIZE
+#error "MQTT_READ_AHEAD_SIZE shall hold a packet of MQTT_DEFAULT_RECV_SIZE bytes"
+#endif
+
+// Pull into the read-ahead buffer what the transport has available, waiting up to "timeout" for at least "need" bytes.
+// Return the number of bytes read.
+static int fillReadAhead(MQTTClient* c, int need, unsigned int timeout)
+{
+    int count = c->readAheadEnd - c->readAheadStart;
+    int room;
+    int n;
+
+    if (c->readAheadStart > 0)
     {
-        int rc = MQTTPACKET_READ_ERROR;
+        memmove(c->readAhead, c->readAhead + c->readAheadStart, count);
+        c->readAheadStart = 0;
+        c->readAheadEnd = count;
+    }
+    room = MQTT_READ_AHEAD_SIZE - count;
+    n = c->tcpLayer->available(c->tcpLayer);
+    if (n < need)
+        n = need;
+    if (n > room)
+        n = room;
+    if (n <= 0)
+        return 0;
+    n = c->tcpLayer->read(c->tcpLayer, c->readAhead + count, n, timeout);
+    if (n > 0)
+        c->readAheadEnd += n;
+    return (n > 0) ? n : 0;
+}
 
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
-        {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
-        }
-        rc = c->tcpLayer->read(c->tcpLayer, &i, 1, timeout);
-        if (rc != 1)
-            goto exit;
-        *value += (i & 127) * multiplier;
-        multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
-    return len;
+
+// Once its header byte is read, a packet is waited for in full even if the cycle deadline is reached:
+// a stream transport (transparent mode) delivers it byte by byte
+static unsigned int packetTailTimeout(MQTTClient* c)
+{
+    unsigned long now = c->timer->millis();
+    if ((c->timeOutInMs <= now) || (c->timeOutInMs - now < MQTT_PACKET_TAIL_TIMEOUT_IN_MS)) {
+        return MQTT_PACKET_TAIL_TIMEOUT_IN_MS;
+    }
+    return c->timeOutInMs - now;
+}
+
+
+// Wait up to the tail timeout for "need" bytes in the read-ahead buffer. Return 1 if they are there, else 0.
+static int ensureReadAhead(MQTTClient* c, int need)
+{
+    while (c->readAheadEnd - c->readAheadStart < need)
+    {
+        if (!fillReadAhead(c, need - (c->readAheadEnd - c->readAheadStart), packetTailTimeout(c)))
+            return 0;
+    }
+    return 1;
+}
+
+
+// Consume "n" bytes of the packet being read, as they come. Return 1, or 0 if they do not arrive.
+static int skipReadAhead(MQTTClient* c, int n)
+{
+    while (n > 0)
+    {
+        int k;
+        if (!ensureReadAhead(c, 1))
+            return 0;
+        k = c->readAheadEnd - c->readAheadStart;
+        if (k > n)
+            k = n;
+        c->readAheadStart += k;
+        n -= k;
+    }
+    return 1;
 }
 
 
+static int readLargePacket(MQTTClient* c, int len, int rem_len);
+
+// Frame the next packet of the read-ahead buffer into readbuf, reading the transport only when it lacks bytes.
+// A packet not received in full stays in the read-ahead buffer: the next call goes on with it.
 static int readPacket(MQTTClient* c)
 {
     MQTTHeader header = {0};
-    int len = 0;
+    unsigned char i;
+    int len = 1;        /* header byte and remaining length bytes */
     int rem_len = 0;
+    int multiplier = 1;
+    int rc = 0;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    unsigned int remainingTime = c->timeOutInMs - c->timer->millis();
-    int rc = c->tcpLayer->read(c->tcpLayer, c->readbuf, 1, remainingTime);
-    if (rc != 1) {
-        goto exit;
-    }
+    /* 1. the header byte.  This has the packet type in it */
+    if ((c->readAheadEnd == c->readAheadStart) && !fillReadAhead(c, 1, c->timeOutInMs - c->timer->millis()))
+        return rc;  /* nothing received */
+    TRACE_SPAN_BEGIN("read");  /* from the first byte of the packet */
 
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    remainingTime = c->timeOutInMs - c->timer->millis();
-    decodePacket(c, &rem_len, remainingTime);
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
+    /* 2. the remaining length.  This is variable in itself */
+    do
+    {
+        if (len > 4)
+        {
+            rc = MQTTPACKET_READ_ERROR; /* bad data */
+            goto exit;
+        }
+        if (!ensureReadAhead(c, len + 1))
+            goto exit;
+        i = c->readAhead[c->readAheadStart + len++];
+        rem_len += (i & 127) * multiplier;
+        multiplier *= 128;
+    } while ((i & 128) != 0);
 
     if (rem_len > (MQTT_DEFAULT_RECV_SIZE - len))
     {
-        rc = ERR_MQTT_BUFFER_OVERFLOW;
+        rc = readLargePacket(c, len, rem_len);
         goto exit;
     }
 
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    remainingTime = c->timeOutInMs - c->timer->millis();
-    if (rem_len > 0 && (rc = c->tcpLayer->read(c->tcpLayer, c->readbuf + len, rem_len, remainingTime) != rem_len)) {
-        rc = 0;
+    /* 3. the rest of the packet */
+    if (!ensureReadAhead(c, len + rem_len))
         goto exit;
+    memcpy(c->readbuf, c->readAhead + c->readAheadStart, len + rem_len);
+    c->readAheadStart += len + rem_len;
+    if (c->readAheadStart == c->readAheadEnd)
+    {
+        c->readAheadStart = 0;
+        c->readAheadEnd = 0;
     }
 
     header.byte = c->readbuf[0];
@@ -133,6 +275,7 @@ static int readPacket(MQTTClient* c)
     	c->lastReceivedTimeInMs = c->timer->millis() + 1000*c->keepAliveIntervalInSec;
     }
 exit:
+    TRACE_SPAN_END("read");
     return rc;
 }
 
@@ -168,6 +311,107 @@ static char isTopicMatched(char* topicFilter, MQTTString* topicName)
 }
 
 
+int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message);
+
+// Consume a packet larger than readbuf, whose fixed header ("len" bytes) is in the read-ahead buffer.
+// A PUBLISH is received in the large buffer if it fits, else streamed to the stream handler, else skipped:
+// the session goes on. The framing is only lost if the packet does not arrive in full (MQTTPACKET_READ_ERROR).
+static int readLargePacket(MQTTClient* c, int len, int rem_len)
+{
+    MQTTHeader header = {0};
+    MQTTString topicName = MQTTString_initializer;
+    MQTTMessage msg;
+    MessageData md;
+    int varLen = 0;     /* topic and packet id */
+    int offset = 0;
+    int deliver = 0;    /* 1: into largeBuf, 2: to largeHandler */
+
+    header.byte = c->readAhead[c->readAheadStart];
+    c->readAheadStart += len;
+    c->largeQos = QOS0;
+    if (header.bits.type == PUBLISH && ensureReadAhead(c, 2))
+    {
+        int idLen = (header.bits.qos > 0) ? 2 : 0;
+        varLen = 2 + ((c->readAhead[c->readAheadStart] << 8) | c->readAhead[c->readAheadStart + 1]) + idLen;
+        if (varLen > rem_len)
+            varLen = 0;     /* skipped as a whole */
+        else if (varLen > MQTT_DEFAULT_RECV_SIZE)
+        {
+            /* topic longer than readbuf: skipped, the packet id kept for the acknowledgement */
+            if (!skipReadAhead(c, varLen - idLen) || !ensureReadAhead(c, idLen))
+                return MQTTPACKET_READ_ERROR;
+            if (idLen)
+                c->largeId = (unsigned short)((c->readAhead[c->readAheadStart] << 8) | c->readAhead[c->readAheadStart + 1]);
+            c->readAheadStart += idLen;
+            c->largeQos = (enum QoS)header.bits.qos;
+        }
+        else if (!ensureReadAhead(c, varLen))
+            return MQTTPACKET_READ_ERROR;
+        else
+        {
+            memcpy(c->readbuf, c->readAhead + c->readAheadStart, varLen);
+            c->readAheadStart += varLen;
+            topicName.lenstring.data = (char*)c->readbuf + 2;
+            topicName.lenstring.len = varLen - 2 - idLen;
+            msg.qos = (enum QoS)header.bits.qos;
+            msg.retained = header.bits.retain;
+            msg.dup = header.bits.dup;
+            msg.id = idLen ? (unsigned short)((c->readbuf[varLen - 2] << 8) | c->readbuf[varLen - 1]) : 0;
+            msg.payload = NULL;
+            msg.payloadlen = rem_len - varLen;
+            c->largeQos = msg.qos;
+            c->largeId = msg.id;
+            NewMessageData(&md, &topicName, &msg);
+            if (c->largeBuf && msg.payloadlen <= c->largeBufSize)
+                deliver = 1;
+            else if (c->largeHandler && c->largeHandler(&md, 0, 0))
+                deliver = 2;
+        }
+    }
+    if (!deliver)
+        c->skippedMessages++;
+
+    /* the payload, as it comes */
+    rem_len -= varLen;
+    while (offset < rem_len)
+    {
+        int n;
+        if (!ensureReadAhead(c, 1))
+            return MQTTPACKET_READ_ERROR;
+        n = c->readAheadEnd - c->readAheadStart;
+        if (n > rem_len - offset)
+            n = rem_len - offset;
+        if (deliver == 1)
+            memcpy(c->largeBuf + offset, c->readAhead + c->readAheadStart, n);
+        else if (deliver == 2)
+        {
+            msg.payload = c->readAhead + c->readAheadStart;
+            if (!c->largeHandler(&md, offset, n))
+            {
+                deliver = 0;    /* the rest is skipped */
+                c->skippedMessages++;
+            }
+        }
+        c->readAheadStart += n;
+        offset += n;
+    }
+    if (c->readAheadStart == c->readAheadEnd)
+    {
+        c->readAheadStart = 0;
+        c->readAheadEnd = 0;
+    }
+
+    if (deliver == 1)
+    {
+        msg.payload = c->largeBuf;
+        deliverMessage(c, &topicName, &msg);
+    }
+    if (c->keepAliveIntervalInSec > 0)
+    	c->lastReceivedTimeInMs = c->timer->millis() + 1000*c->keepAliveIntervalInSec;
+    return LARGE_PACKET;
+}
+
+
 int deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 {
     int i;
@@ -211,13 +455,19 @@ int keepalive(MQTTClient* c)
     if ((c->timer->millis() >= c->lastSentTimeInMs) && (c->timer->millis() >= c->lastReceivedTimeInMs))
     {
     	if (c->ping_outstanding)
+        {
             rc = FAILURE_PINGRESP_NOT_RECEIVED; /* PINGRESP not received in keepalive interval */
+            c->stats.keepaliveFailures++;
+        }
         else
         {
             c->timeOutInMs = c->timer->millis() + 1000;
             int len = MQTTSerialize_pingreq(c->buf, MQTT_DEFAULT_SEND_SIZE);
             if (len > 0 && (rc = sendPacket(c, len)) == MQTT_SUCCESS) // send the ping packet
+            {
                 c->ping_outstanding = 1;
+                c->stats.pingreqs++;
+            }
         }
     }
 
@@ -235,6 +485,120 @@ void MQTTCleanSession(MQTTClient* c)
 }
 
 
+// Remove the PUBLISH in flight "i": the packets stored after it move down
+static void inflightRemove(MQTTInflightStore* s, int i)
+{
+    size_t offset = s->entries[i].offset;
+    size_t len = s->entries[i].len;
+
+    memmove(s->buf + offset, s->buf + offset + len, s->used - offset - len);
+    s->used -= len;
+    for (s->count--; i < s->count; i++)
+    {
+        s->entries[i] = s->entries[i + 1];
+        s->entries[i].offset -= len;
+    }
+}
+
+
+// Remove the PUBLISH in flight "i", from the persistence too, and report its completion
+static void inflightComplete(MQTTClient* c, int i, int rc)
+{
+    unsigned short id = c->inflight->entries[i].id;
+
+    inflightRemove(c->inflight, i);
+    if (c->inflight->persistence != NULL)
+        c->inflight->persistence->remove(id);
+    if (c->inflightHandler != NULL)
+        c->inflightHandler(id, rc);
+}
+
+
+static void inflightAck(MQTTClient* c, unsigned short id)
+{
+    int i = inflightFind(c, id);
+
+    if (i >= 0)
+    {
+        c->stats.pubacks++;
+        StatsHistogram_Add(&c->stats.pubackLatency, c->timer->millis() - c->inflight->entries[i].startMs);
+        inflightComplete(c, i, MQTT_SUCCESS);
+    }
+}
+
+
+// Send again the PUBLISH in flight "e", with the DUP flag
+static int inflightSend(MQTTClient* c, MQTTInflight* e)
+{
+    SerialChunk segment;
+
+    c->inflight->buf[e->offset] |= 0x08;  /* DUP flag of the fixed header */
+    segment.buffer = (const char*)c->inflight->buf + e->offset;
+    segment.size = e->len;
+    return sendSegments(c, &segment, 1);
+}
+
+
+// Send again with the DUP flag the PUBLISH in flight not acknowledged within MQTT_RETRY_TIMEOUT_IN_MS,
+// give up those already sent MQTT_RETRY_MAX more times
+static int inflightRetry(MQTTClient* c)
+{
+    unsigned long now = c->timer->millis();
+    int rc = MQTT_SUCCESS;
+    int i = 0;
+
+    while (i < c->inflight->count)
+    {
+        MQTTInflight* e = &c->inflight->entries[i];
+
+        if (now - e->sentMs < MQTT_RETRY_TIMEOUT_IN_MS)
+        {
+            i++;
+            continue;
+        }
+        if (e->retries >= MQTT_RETRY_MAX)
+        {
+            c->stats.pubackTimeouts++;
+            inflightComplete(c, i, ERR_MQTT_WAIT_FOR_PUBACT);
+            continue;
+        }
+        if ((rc = inflightSend(c, e)) != MQTT_SUCCESS)
+            break;
+        e->retries++;
+        e->sentMs = now;
+        c->stats.retransmissions++;
+        i++;
+    }
+    return rc;
+}
+
+
+// Once connected, the PUBLISH still in flight leave together with the DUP flag (one flush, no wait for
+// their PUBACK in between), with a new count of retransmissions
+static int inflightResend(MQTTClient* c)
+{
+    unsigned long now = c->timer->millis();
+    int rc = MQTT_SUCCESS;
+    int i;
+
+    TRACE_SPAN_BEGIN("resend");
+    for (i = 0; i < c->inflight->count; i++)
+    {
+        MQTTInflight* e = &c->inflight->entries[i];
+
+        if ((rc = inflightSend(c, e)) != MQTT_SUCCESS)
+            break;
+        e->retries = 0;
+        e->sentMs = now;
+        c->stats.resends++;
+    }
+    if (rc == MQTT_SUCCESS)
+        rc = flushPackets(c);
+    TRACE_SPAN_END("resend");
+    return rc;
+}
+
+
 void MQTTCloseSession(MQTTClient* c)
 {
     c->ping_outstanding = 0;
@@ -250,7 +614,10 @@ int cycle(MQTTClient* c)
         rc = MQTT_SUCCESS,
 		keepAliveRes = MQTT_SUCCESS;
 
-    int packet_type = readPacket(c);     /* read the socket, see what work is due */
+    int packet_type;
+
+    c->cycleDepth++;
+    packet_type = readPacket(c);     /* read the socket, see what work is due */
 
     switch (packet_type)
     {
@@ -261,10 +628,18 @@ int cycle(MQTTClient* c)
         case 0: /* timed out reading packet */
             break;
         case CONNACK:
-        case PUBACK:
         case SUBACK:
         case UNSUBACK:
             break;
+        case PUBACK: /* of a PUBLISH in flight, or waited for by MQTTPublish */
+            if (c->inflight != NULL && c->inflight->count > 0)
+            {
+                unsigned short mypacketid;
+                unsigned char dup, type;
+                if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, MQTT_DEFAULT_RECV_SIZE) == 1)
+                    inflightAck(c, mypacketid);
+            }
+            break;
         case PUBLISH:
         {
             MQTTString topicName;
@@ -308,6 +683,17 @@ int cycle(MQTTClient* c)
             break;
         }
 
+        case LARGE_PACKET: /* delivered or skipped, acknowledged all the same */
+            if (c->largeQos != QOS0)
+            {
+                len = MQTTSerialize_ack(c->buf, MQTT_DEFAULT_SEND_SIZE, (c->largeQos == QOS1) ? PUBACK : PUBREC, 0, c->largeId);
+                if (len <= 0 || sendPacket(c, len) != MQTT_SUCCESS)
+                {
+                    rc = FAILURE;
+                    goto exit;
+                }
+            }
+            break;
         case PUBCOMP:
             break;
         case PINGRESP:
@@ -315,13 +701,22 @@ int cycle(MQTTClient* c)
             break;
     }
 
+    // not while connecting: sent again all together once connected
+    if (c->isconnected && c->inflight != NULL && c->inflight->count > 0 && (rc = inflightRetry(c)) != MQTT_SUCCESS)
+        goto exit;
+
     keepAliveRes = keepalive(c);
     if (keepAliveRes != MQTT_SUCCESS) {
         //check only keep-alive FAILURE status so that previous FAILURE status can be considered as FAULT
         rc = keepAliveRes;
     }
+    else if (c->readAheadStart == c->readAheadEnd) {
+        // nothing more read ahead: the packets written while processing the previous ones leave together
+        rc = flushPackets(c);
+    }
 
 exit:
+    c->cycleDepth--;
     if (rc == MQTT_SUCCESS)
         rc = packet_type;
     else if (c->isconnected)
@@ -333,15 +728,24 @@ exit:
 int MQTTYield(MQTTClient* c, int timeout_ms)
 {
     int rc = MQTT_SUCCESS;
-    c->timeOutInMs = c->timer->millis() + timeout_ms;
+    unsigned long endOfYieldInMs = c->timer->millis() + timeout_ms;
 
 	do
     {
+        // restored on each cycle: a message handler publishing a response moves timeOutInMs
+        c->timeOutInMs = endOfYieldInMs;
         rc = cycle(c);
         if (rc < 0) {
             break;
         }
-  	} while (c->timer->millis() < c->timeOutInMs);
+  	} while (c->timer->millis() < endOfYieldInMs);
+
+    // nothing held for coalescing until the next yield
+    if (rc >= 0 && c->isconnected && flushPackets(c) != MQTT_SUCCESS)
+    {
+        MQTTCloseSession(c);
+        rc = ERR_MQTT_SENT_PACKET;
+    }
 
     return rc;
 }
@@ -351,6 +755,16 @@ int MQTTIsConnected(MQTTClient* client)
   return client->isconnected;
 }
 
+void MQTTGetStats(MQTTClient* c, MQTTStats* stats)
+{
+    *stats = c->stats;
+}
+
+void MQTTResetStats(MQTTClient* c)
+{
+    memset(&c->stats, 0, sizeof(c->stats));
+}
+
 int waitfor(MQTTClient* c, int packet_type)
 {
     int rc = FAILURE;
@@ -379,6 +793,8 @@ int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTC
 	}
 
 	/* At first, open TCP session to server */
+	c->readAheadStart = 0;
+	c->readAheadEnd = 0;
 	len = c->tcpLayer->connect (c->tcpLayer, host, port, sslEnabled);
 	if (len != 1) {
 		goto exit;
@@ -398,7 +814,7 @@ int MQTTConnectWithResults(MQTTClient* c, MQTTPacket_connectData* options, MQTTC
     if ((len = MQTTSerialize_connect(c->buf, MQTT_DEFAULT_SEND_SIZE, options)) <= 0) {
         goto exit;
     }
-    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS) { // send the connect packet
+    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS || (rc = flushPackets(c)) != MQTT_SUCCESS) { // send the connect packet
         goto exit; // there was a problem
     }
 
@@ -420,6 +836,8 @@ exit:
     {
         c->isconnected = 1;
         c->ping_outstanding = 0;
+        if (c->inflight != NULL && c->inflight->count > 0 && (rc = inflightResend(c)) != MQTT_SUCCESS)
+            MQTTCloseSession(c);
     }
 
     return rc;
@@ -433,6 +851,19 @@ int MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options, const char *host
 }
 
 
+void MQTTSetLargeBuffer(MQTTClient* c, unsigned char* buf, size_t size)
+{
+    c->largeBuf = buf;
+    c->largeBufSize = buf ? size : 0;
+}
+
+
+void MQTTSetStreamHandler(MQTTClient* c, streamHandler handler)
+{
+    c->largeHandler = handler;
+}
+
+
 int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler)
 {
     int rc = ERR_MQTT_SET_MESSAGE_HANDLER;
@@ -492,7 +923,7 @@ int MQTTSubscribeWithResults(MQTTClient* c, const char* topicFilter, enum QoS qo
     len = MQTTSerialize_subscribe(c->buf, MQTT_DEFAULT_SEND_SIZE, 0, getNextPacketId(c), 1, &topic, (int*)&qos_tab);
     if (len <= 0)
         goto exit;
-    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS) // send the subscribe packet
+    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS || (rc = flushPackets(c)) != MQTT_SUCCESS) // send the subscribe packet
         goto exit;             // there was a problem
 
     if (waitfor(c, SUBACK) == SUBACK)      // wait for suback
@@ -538,7 +969,7 @@ int MQTTUnsubscribe(MQTTClient* c, const char* topicFilter)
 
     if ((len = MQTTSerialize_unsubscribe(c->buf, MQTT_DEFAULT_SEND_SIZE, 0, getNextPacketId(c), 1, &topic)) <= 0)
         goto exit;
-    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS) // send the subscribe packet
+    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS || (rc = flushPackets(c)) != MQTT_SUCCESS) // send the subscribe packet
         goto exit; // there was a problem
 
     if (waitfor(c, UNSUBACK) == UNSUBACK)
@@ -560,43 +991,202 @@ exit:
 }
 
 
+int MQTTInflightStoreInit(MQTTInflightStore* store, unsigned char* buf, size_t size, PersistenceInterface* persistence)
+{
+    size_t len = 0;
+
+    store->buf = buf;
+    store->size = buf ? size : 0;
+    store->used = 0;
+    store->count = 0;
+    store->persistence = persistence;
+    if (persistence != NULL && store->size > 0)
+        len = persistence->load(buf, store->size);
+
+    // the saved PUBLISH, up to the first one not complete or not valid
+    while (store->used < len && store->count < MQTT_INFLIGHT_WINDOW)
+    {
+        MQTTInflight* e = &store->entries[store->count];
+        unsigned char* packet = buf + store->used;
+        unsigned char dup, retained;
+        int qos, payloadlen, remLen, headerLen;
+        MQTTString topic;
+        unsigned char* payload;
+
+        if (len - store->used < 6)  /* shortest QoS 1 PUBLISH: no overread of the remaining length */
+            break;
+        headerLen = 1 + MQTTPacket_decodeBuf(packet + 1, &remLen);
+        if (store->used + headerLen + remLen > len
+            || MQTTDeserialize_publish(&dup, &qos, &retained, &e->id, &topic, &payload, &payloadlen,
+                                       packet, headerLen + remLen) != 1
+            || qos != QOS1)
+            break;
+        e->len = headerLen + remLen;
+        e->offset = store->used;
+        e->retries = 0;
+        e->sentMs = 0;
+        e->startMs = 0;
+        // the loaded packets are forgotten by the persistence: saved again, so that each one is removed once
+        if (persistence->save(e->id, packet, e->len) < 0)
+            break;
+        store->used += e->len;
+        store->count++;
+    }
+    store->restored = store->count;
+    return store->count;
+}
+
+
+void MQTTSetInflightStore(MQTTClient* c, MQTTInflightStore* store, int window, publishCompleteHandler handler)
+{
+    c->inflight = (store != NULL && store->buf != NULL) ? store : NULL;
+    c->inflightWindow = (window < 1) ? 1 : (window > MQTT_INFLIGHT_WINDOW) ? MQTT_INFLIGHT_WINDOW : window;
+    c->inflightHandler = handler;
+    if (c->inflight != NULL)
+    {
+        // the latency of the restored PUBLISH counts from now
+        for (; store->restored > 0; store->restored--)
+            store->entries[store->restored - 1].startMs = c->timer->millis();
+    }
+}
+
+
+// QoS 1 PUBLISH serialized in the in-flight store, saved by the persistence and sent, without waiting for its PUBACK
+static int publishInflight(MQTTClient* c, MQTTString topic, MQTTMessage* message, unsigned long startMs)
+{
+    MQTTInflightStore* s = c->inflight;
+    MQTTInflight* e;
+    SerialChunk segment;
+    int len;
+    int rc;
+
+    if (s->count >= c->inflightWindow)
+        return ERR_MQTT_INFLIGHT_FULL;
+    TRACE_SPAN_BEGIN("serialize");
+    message->id = getNextPacketId(c);
+    len = MQTTSerialize_publish(s->buf + s->used, (int)(s->size - s->used),
+                                0, QOS1, message->retained, message->id, topic,
+                                (unsigned char*)message->payload, (int)message->payloadlen);
+    TRACE_SPAN_END("serialize");
+    if (len <= 0)
+        return ERR_MQTT_INFLIGHT_FULL;
+    if (s->persistence != NULL && s->persistence->save(message->id, s->buf + s->used, len) < 0)
+        return ERR_MQTT_INFLIGHT_FULL;
+
+    // in the store from now on: sent again on the next connection if this session fails
+    e = &s->entries[s->count++];
+    e->id = message->id;
+    e->len = len;
+    e->offset = s->used;
+    e->retries = 0;
+    e->sentMs = startMs;
+    e->startMs = startMs;
+    s->used += len;
+
+    segment.buffer = (const char*)s->buf + e->offset;
+    segment.size = len;
+    rc = sendSegments(c, &segment, 1);
+    // Outside of a cycle: no later packet to merge with
+    if (rc == MQTT_SUCCESS && c->cycleDepth == 0 && (rc = flushPackets(c)) == MQTT_SUCCESS)
+        StatsHistogram_Add(&c->stats.publishToSend, c->timer->millis() - startMs);
+    if (rc != MQTT_SUCCESS)
+    {
+        // accepted all the same: the session is closed, the PUBLISH waits for the next connection
+        MQTTCloseSession(c);
+        return MQTT_SUCCESS;
+    }
+    c->stats.publishes++;
+    e->sentMs = c->timer->millis();
+    return MQTT_SUCCESS;
+}
+
+
 int MQTTPublish(MQTTClient* c, const char* topicName, MQTTMessage* message)
 {
     int rc = ERR_MQTT_PUBLISH;
     MQTTString topic = MQTTString_initializer;
     topic.cstring = (char *)topicName;
-    int len = 0;
+    MQTTHeader header = {0};
+    SerialChunk segments[4];
+    unsigned char* ptr;
+    int topicLen;
+    int ack;
+    unsigned long startMs;
 
 	if (!c->isconnected)
 		    goto exit;
 
-    c->timeOutInMs = c->timer->millis() + ACK_COMMAND_TIMEOUT_IN_MS;
+    startMs = c->timer->millis();
+    if (message->qos == QOS1 && c->inflight != NULL)
+    {
+        // ERR_MQTT_INFLIGHT_FULL: the session goes on, to be published again after some PUBACK
+        return publishInflight(c, topic, message, startMs);
+    }
+    c->timeOutInMs = startMs + ACK_COMMAND_TIMEOUT_IN_MS;
 
+    TRACE_SPAN_BEGIN("serialize");
     if (message->qos == QOS1 || message->qos == QOS2)
         message->id = getNextPacketId(c);
 
-    len = MQTTSerialize_publish(c->buf, MQTT_DEFAULT_SEND_SIZE, 0, message->qos, message->retained, message->id,
-              topic, (unsigned char*)message->payload, message->payloadlen);
-    if (len <= 0)
-        goto exit;
-    if ((rc = sendPacket(c, len)) != MQTT_SUCCESS) // send the subscribe packet
+    /* fixed header and topic length, topic, packet id and payload are written as segments: the payload
+       (up to the size of the LiveBooster message buffer) is not copied into buf */
+    topicLen = MQTTstrlen(topic);
+    header.bits.type = PUBLISH;
+    header.bits.qos = message->qos;
+    header.bits.retain = message->retained;
+    ptr = c->buf;
+    writeChar(&ptr, header.byte);
+    ptr += MQTTPacket_encode(ptr, 2 + topicLen + ((message->qos > 0) ? 2 : 0) + (int)message->payloadlen);
+    writeInt(&ptr, topicLen);
+    segments[0].buffer = (const char*)c->buf;
+    segments[0].size = ptr - c->buf;
+    segments[1].buffer = topicName;
+    segments[1].size = topicLen;
+    segments[2].buffer = (const char*)ptr;
+    if (message->qos > 0)
+        writeInt(&ptr, message->id);
+    segments[2].size = ptr - (unsigned char*)segments[2].buffer;
+    segments[3].buffer = (const char*)message->payload;
+    segments[3].size = message->payloadlen;
+    TRACE_SPAN_END("serialize");
+    if ((rc = sendSegments(c, segments, 4)) != MQTT_SUCCESS) // send the publish packet
         goto exit; // there was a problem
+    // Outside of a cycle, or waiting for an ack: no later packet to merge with
+    if (c->cycleDepth == 0 || message->qos != QOS0)
+    {
+        if ((rc = flushPackets(c)) != MQTT_SUCCESS)
+            goto exit;
+        StatsHistogram_Add(&c->stats.publishToSend, c->timer->millis() - startMs);
+    }
+    c->stats.publishes++;
 
     if (message->qos == QOS1)
     {
-        if (waitfor(c, PUBACK) == PUBACK)
+        startMs = c->timer->millis();
+        TRACE_SPAN_BEGIN("PUBACK");
+        ack = waitfor(c, PUBACK);
+        TRACE_SPAN_END("PUBACK");
+        if (ack == PUBACK)
         {
             unsigned short mypacketid;
             unsigned char dup, type;
             if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, MQTT_DEFAULT_RECV_SIZE) != 1)
                 rc = ERR_MQTT_DESERIALIZE_ACK;
+            else
+            {
+                c->stats.pubacks++;
+                StatsHistogram_Add(&c->stats.pubackLatency, c->timer->millis() - startMs);
+            }
         }
         else
             rc = ERR_MQTT_WAIT_FOR_PUBACT;
     }
     else if (message->qos == QOS2)
     {
-        if (waitfor(c, PUBCOMP) == PUBCOMP)
+        TRACE_SPAN_BEGIN("PUBCOMP");
+        ack = waitfor(c, PUBCOMP);
+        TRACE_SPAN_END("PUBCOMP");
+        if (ack == PUBCOMP)
         {
             unsigned short mypacketid;
             unsigned char dup, type;
@@ -14,6 +14,10 @@
 #include "MQTTPacket/MQTTPacket.h"
 #include "../heraclesGsm/TcpClientInterface.h"
 #include "../heraclesGsm/HeraclesTcpClient.h"
+#include "../heraclesGsm/HeraclesTransparentTcpClient.h"
+#include "../stats/StatsHistogram.h"
+#include "../traceDebug/TraceSpan.h"
+#include "../persistence/PersistenceInterface.h"
 #include "../serial/SerialInterface.h"
 #include "../timer/TimerInterface.h"
 #include "../traceDebug/DebugInterface.h"
@@ -29,12 +33,32 @@ extern "C" {
 #define MQTT_DEFAULT_SEND_SIZE    (260)
 #define MQTT_DEFAULT_RECV_SIZE    (260)
 
+/* Read-ahead of the received stream: what the transport has available is pulled in one read,
+   then the packets are framed from this buffer (at least MQTT_DEFAULT_RECV_SIZE) */
+#ifndef MQTT_READ_AHEAD_SIZE
+#define MQTT_READ_AHEAD_SIZE      (512)
+#endif
+
 #define ACK_COMMAND_TIMEOUT_IN_MS  20000
 
+/* QoS 1 publications in flight (see MQTTSetInflightStore): max number of PUBLISH waiting for their PUBACK,
+   delay before a PUBLISH is sent again with the DUP flag, and number of these retransmissions */
+#ifndef MQTT_INFLIGHT_WINDOW
+#define MQTT_INFLIGHT_WINDOW       8
+#endif
+#ifndef MQTT_RETRY_TIMEOUT_IN_MS
+#define MQTT_RETRY_TIMEOUT_IN_MS   10000
+#endif
+#ifndef MQTT_RETRY_MAX
+#define MQTT_RETRY_MAX             3
+#endif
+#define MQTT_PACKET_TAIL_TIMEOUT_IN_MS  1000 /* rest of a packet once its header byte is received */
+
 enum QoS { QOS0, QOS1, QOS2, SUBFAIL=0x80 };
 
 /* all failure return codes must be negative */
 enum returnCodeMqtt {
+	                  ERR_MQTT_INFLIGHT_FULL = -22,
 	                  ERR_MQTT_SENT_PACKET = -21,
                       ERR_MQTT_DISCONNECT = -20,
 	                  ERR_MQTT_WAIT_FOR_PUBCOMP = -19,
@@ -81,12 +105,63 @@ typedef struct MQTTSubackData
 
 typedef void (*messageHandler)(MessageData*);
 
+/* Streaming of an inbound PUBLISH larger than MQTT_DEFAULT_RECV_SIZE: called first with "len" 0 (topic known,
+   message->payloadlen the total payload size), then for each chunk at "offset" (message->payload).
+   Return 0 to skip the rest of the message. */
+typedef int (*streamHandler)(MessageData*, size_t offset, size_t len);
+
+/* Completion of a QoS 1 publication in flight: MQTT_SUCCESS when its PUBACK is received,
+   ERR_MQTT_WAIT_FOR_PUBACT when not acknowledged after MQTT_RETRY_MAX retransmissions
+   (kept when the session is closed: sent again on the next connection) */
+typedef void (*publishCompleteHandler)(unsigned short id, int rc);
+
+/* QoS 1 PUBLISH waiting for its PUBACK: the packet is kept serialized in the in-flight store */
+typedef struct MQTTInflight
+{
+    unsigned short id;
+    size_t len;                /* of the packet, from "offset" in the store */
+    size_t offset;
+    unsigned char retries;
+    unsigned long sentMs;      /* last (re)transmission */
+    unsigned long startMs;     /* first transmission */
+} MQTTInflight;
+
+/* QoS 1 PUBLISH in flight, in order of transmission: owned by the application, it outlives the client sessions
+   (MQTTClientInit) and is mirrored by the optional persistence */
+typedef struct MQTTInflightStore
+{
+    unsigned char* buf;
+    size_t size;
+    size_t used;
+    MQTTInflight entries[MQTT_INFLIGHT_WINDOW];
+    int count;
+    int restored;              /* entries loaded from the persistence, not timestamped yet */
+    PersistenceInterface* persistence;
+} MQTTInflightStore;
+
+/* Counters of the client, kept by MQTTClientInit() (cleared by MQTTResetStats()) */
+typedef struct MQTTStats
+{
+    unsigned long publishes;            /* PUBLISH sent */
+    unsigned long pubacks;              /* PUBACK received for them (QoS 1) */
+    unsigned long pingreqs;             /* PINGREQ sent */
+    unsigned long keepaliveFailures;    /* PINGRESP not received within the keep alive interval */
+    unsigned long retransmissions;      /* PUBLISH in flight sent again with the DUP flag */
+    unsigned long pubackTimeouts;       /* PUBLISH in flight given up after MQTT_RETRY_MAX retransmissions */
+    unsigned long resends;              /* PUBLISH in flight sent again with the DUP flag on a (re)connection */
+    StatsHistogram publishToSend;       /* ms from the MQTTPublish() call to the packet handed to the network */
+    StatsHistogram pubackLatency;       /* ms from the PUBLISH sent to its PUBACK */
+} MQTTStats;
+
 typedef struct _MQTTClient
 {
     unsigned int next_packetid;
 
     unsigned char buf[MQTT_DEFAULT_SEND_SIZE];
     unsigned char readbuf[MQTT_DEFAULT_RECV_SIZE];
+    unsigned char readAhead[MQTT_READ_AHEAD_SIZE];
+    int readAheadStart;        /* first byte not framed yet */
+    int readAheadEnd;
 
     unsigned int keepAliveIntervalInSec;
     char ping_outstanding;
@@ -101,14 +176,30 @@ typedef struct _MQTTClient
 
     void (*defaultMessageHandler) (MessageData*);
 
+    /* inbound PUBLISH larger than readbuf: received in largeBuf if it fits, else streamed, else skipped */
+    unsigned char* largeBuf;
+    size_t largeBufSize;
+    streamHandler largeHandler;
+    enum QoS largeQos;         /* of the last large PUBLISH, acknowledged by cycle() */
+    unsigned short largeId;
+    unsigned long skippedMessages;
+
+    /* QoS 1 PUBLISH in flight (non blocking MQTTPublish if set) */
+    MQTTInflightStore* inflight;
+    int inflightWindow;
+    publishCompleteHandler inflightHandler;
+
     TimerInterface *timer;
     DebugInterface *debug;
 
     unsigned long lastSentTimeInMs;
     unsigned long lastReceivedTimeInMs;
     unsigned long timeOutInMs;
+    int cycleDepth;            /* > 0 while the received packets are processed: the written ones are flushed once idle */
+    MQTTStats stats;
 
     HeraclesTcpClient heraclesTcpClient;
+    HeraclesTransparentTcpClient heraclesTransparentTcpClient;
     TcpClientInterface *tcpLayer;
 
 } MQTTClient;
@@ -123,6 +214,9 @@ typedef struct _MQTTClient
  */
 void MQTTClientInit(MQTTClient* c, SerialInterface* serial, TimerInterface* timer, DebugInterface *debug);
 
+/* Same as MQTTClientInit, the MQTT connection using the transparent mode of the modem */
+void MQTTClientInitTransparent(MQTTClient* c, SerialInterface* serial, TimerInterface* timer, DebugInterface *debug);
+
 /** MQTT Connect - send an MQTT connect packet down the network and wait for a Connack
  *  The network object must be connected to the network endpoint before calling this
  *  @param client - the client object to use
@@ -156,13 +250,38 @@ int MQTTConnect(MQTTClient* client,
 		        unsigned int sslEnabled);
 
 /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
+ *  With an in-flight store (MQTTSetInflightStore), a QoS 1 publication returns once sent: message->id is
+ *  its packet id, given back to the completion handler by a later cycle. If its sending fails, the session is
+ *  closed and the publication waits in the store for the next connection.
  *  @param client - the client object to use
  *  @param topicName - the topic to publish to
  *  @param message - the message to send
- *  @return success code (= 0) or negative values if failure occurs
+ *  @return success code (= 0) or negative values if failure occurs (ERR_MQTT_INFLIGHT_FULL: window or store
+ *  full, or not saved by the persistence, the session goes on)
  */
 int MQTTPublish(MQTTClient* client, const char* topicName, MQTTMessage* message);
 
+/** MQTT InflightStoreInit - initialize a store of QoS 1 publications in flight, with the packets saved by
+ *  the persistence (those of the previous run of the application, sent again on the first connection)
+ *  @param store - the store object to initialize
+ *  @param buf - buffer of the PUBLISH in flight
+ *  @param size - size of buf
+ *  @param persistence - copy of the PUBLISH in flight, or NULL
+ *  @return the number of restored PUBLISH
+ */
+int MQTTInflightStoreInit(MQTTInflightStore* store, unsigned char* buf, size_t size, PersistenceInterface* persistence);
+
+/** MQTT SetInflightStore - make the QoS 1 publications non blocking: each PUBLISH is kept serialized in
+ *  "store" until its PUBACK, matched by the cycles (MQTTYield), and sent again with the DUP flag every
+ *  MQTT_RETRY_TIMEOUT_IN_MS. The store is kept when the session is closed: the PUBLISH still in flight are sent
+ *  again together with the DUP flag once connected (MQTTConnect). To be set after MQTTClientInit.
+ *  @param client - the client object to use
+ *  @param store - the PUBLISH in flight, or NULL to wait for each PUBACK in MQTTPublish
+ *  @param window - max number of PUBLISH in flight (1..MQTT_INFLIGHT_WINDOW)
+ *  @param handler - completion handler of the publications, or NULL
+ */
+void MQTTSetInflightStore(MQTTClient* c, MQTTInflightStore* store, int window, publishCompleteHandler handler);
+
 /** MQTT SetMessageHandler - set or remove a per topic message handler
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter set the message handler for
@@ -171,6 +290,21 @@ int MQTTPublish(MQTTClient* client, const char* topicName, MQTTMessage* message)
  */
 int MQTTSetMessageHandler(MQTTClient* c, const char* topicFilter, messageHandler messageHandler);
 
+/** MQTT SetLargeBuffer - buffer receiving the PUBLISH whose payload exceeds MQTT_DEFAULT_RECV_SIZE,
+ *  then delivered to the message handlers as the other ones
+ *  @param client - the client object to use
+ *  @param buf - the buffer, or NULL to remove it
+ *  @param size - size of buf
+ */
+void MQTTSetLargeBuffer(MQTTClient* c, unsigned char* buf, size_t size);
+
+/** MQTT SetStreamHandler - handler streaming the large PUBLISH which do not fit in the large buffer
+ *  (without large buffer nor stream handler, these messages are skipped and counted in skippedMessages)
+ *  @param client - the client object to use
+ *  @param handler - the stream handler, or NULL to remove it
+ */
+void MQTTSetStreamHandler(MQTTClient* c, streamHandler handler);
+
 /** MQTT Subscribe - send an MQTT subscribe packet and wait for suback before returning.
  *  @param client - the client object to use
  *  @param topicFilter - the topic filter to subscribe to
@@ -210,6 +344,18 @@ int MQTTDisconnect(MQTTClient* client);
  */
 int MQTTYield(MQTTClient* client, int time);
 
+/** MQTT GetStats - counters of the publications and of the keep alive
+ *  (PUBLISH coalesced during a cycle are handed to the network at the end of the cycle, not counted in publishToSend)
+ *  @param client - the client object to use
+ *  @param stats - copy of the counters
+ */
+void MQTTGetStats(MQTTClient* client, MQTTStats* stats);
+
+/** MQTT ResetStats - clear the counters
+ *  @param client - the client object to use
+ */
+void MQTTResetStats(MQTTClient* client);
+
 /** MQTT isConnected
  *  @param client - the client object to use
  *  @return truth value (= 1) indicating whether the client is connected to the server
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __PersistenceInterface_h
+#define __PersistenceInterface_h
+
+#include <stddef.h>
+
+/**
+ * @startuml
+ * interface Persistence {
+ *    +int save (id, packet, len)
+ *    +void remove (id)
+ *    +size_t load (buf, size)
+ * }
+ * @enduml
+ */
+
+/**
+ * Abstract interface for Persistence (optional): copy of the QoS 1 publications waiting for their PUBACK,
+ * restored after a restart of the device
+ */
+typedef struct _PersistenceInterface
+{
+
+    /*
+     * Save the serialized PUBLISH packet "id" ("len" bytes), before it is sent.
+     * Returns 0, or a negative value when it can not be saved (the message is not published).
+     */
+    int (* save) (unsigned short id, const unsigned char *packet, size_t len);
+
+    /*
+     * Remove the packet "id": acknowledged, or given up.
+     */
+    void (* remove) (unsigned short id);
+
+    /*
+     * Copy the saved packets to "buf", one after the other in the order of their saving, and forget them all:
+     * the packets still valid are saved again by the caller.
+     * Returns the number of bytes copied (the packets fitting in "size").
+     */
+    size_t (* load) (unsigned char *buf, size_t size);
+
+
+} PersistenceInterface;
+
+#endif
@@ -16,12 +16,28 @@
  *    +int available ()
  *    +char get ()
  *    +void write (buffer, size)
+ *    +int read (buffer, size, timeout) (optional)
+ *    +int count () (optional)
+ *    +void writeChunks (chunks, count) (optional)
  * }
  * @enduml
  */
 
+/**
+ * One buffer of a gather write.
+ */
+typedef struct _SerialChunk
+{
+    const char *buffer;
+    int size;
+} SerialChunk;
+
 /**
  * Abstract interface for serial communication
+ *
+ * The bulk methods (read, count, writeChunks) are optional: an implementation
+ * which does not provide them leaves them NULL (i.e. omitted from its initializer),
+ * and the library then falls back to available(), get() and write().
  */
 typedef struct _SerialInterface
 {
@@ -48,6 +64,22 @@ typedef struct _SerialInterface
      */
     void (* write) (const char *buffer, int size);
 
+    /**
+     * Optional. Read up to "size" bytes into "buffer", waiting at most "timeoutInMs"
+     * for the first byte. Return the number of bytes read (0 on timeout).
+     */
+    int (* read) (char *buffer, int size, unsigned long timeoutInMs);
+
+    /**
+     * Optional. Return the number of received bytes which can be read without waiting.
+     */
+    int (* count) ();
+
+    /**
+     * Optional. Send the "count" buffers of "chunks" in order, as one write() of their concatenation.
+     */
+    void (* writeChunks) (const SerialChunk *chunks, int count);
+
 } SerialInterface;
 
 #endif
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include "StatsHistogram.h"
+
+void StatsHistogram_Add(struct _StatsHistogram* const obj, unsigned long v) {
+    unsigned int i = 0;
+    unsigned long x = v;
+    while (x && (i < STATS_HISTOGRAM_BUCKETS - 1)) {
+        x >>= 1;
+        i++;
+    }
+    obj->buckets[i]++;
+    obj->count++;
+    obj->sum += v;
+    if (v > obj->max) {
+        obj->max = v;
+    }
+}
+
+unsigned long StatsHistogram_Percentile(const struct _StatsHistogram* const obj, unsigned int p) {
+    unsigned long rank;
+    unsigned long n = 0;
+    unsigned int i;
+
+    if (obj->count == 0) {
+        return 0;
+    }
+    if (p > 100) {
+        p = 100;
+    }
+    // ceil(count * p / 100), without overflow
+    rank = (obj->count / 100) * p + ((obj->count % 100) * p + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < STATS_HISTOGRAM_BUCKETS - 1; i++) {
+        n += obj->buckets[i];
+        if (n >= rank) {
+            unsigned long bound = (i == 0) ? 0 : (1UL << i) - 1;
+            return (bound < obj->max) ? bound : obj->max;
+        }
+    }
+    return obj->max;
+}
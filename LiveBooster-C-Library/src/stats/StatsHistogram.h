@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __StatsHistogram_h
+#define __StatsHistogram_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Histogram of measures (durations, throughputs...) with fixed power of 2 buckets:
+ * bucket 0 counts the zero values, bucket i the values in [2^(i-1), 2^i), and the
+ * last bucket all the larger ones. Adding a value costs a few shifts, without division.
+ */
+
+#ifndef STATS_HISTOGRAM_BUCKETS
+#define STATS_HISTOGRAM_BUCKETS  16   /* last bucket: 2^14 and above (16 s in milliseconds) */
+#endif
+
+typedef struct _StatsHistogram {
+    unsigned long count;
+    unsigned long sum;       /* wraps around, as the counters */
+    unsigned long max;
+    unsigned long buckets[STATS_HISTOGRAM_BUCKETS];
+} StatsHistogram;
+
+/**
+ * Count the value v.
+ */
+void StatsHistogram_Add(struct _StatsHistogram* const obj, unsigned long v);
+
+/**
+ * Return the upper bound of the bucket holding the p-th percentile (0..100) of the values
+ * (the largest value for the last bucket, 0 if there is no value).
+ */
+unsigned long StatsHistogram_Percentile(const struct _StatsHistogram* const obj, unsigned int p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,6 +15,7 @@
  *    +void timerInit ()
  *    +unsigned long millis ()
  *    +void delay (waitTimeInMs)
+ *    +unsigned long micros ()
  * }
  * @enduml
  */
@@ -40,6 +41,12 @@ typedef struct _TimerInterface
      */
     void (* delay) (unsigned long waitTimeInMs);
 
+    /**
+     * Returns the number of microseconds since the target/application began running (overflows as millis).
+     * Optional (NULL): only used to measure the short durations of the statistics (JSON encoding and decoding).
+     */
+    unsigned long (* micros) ();
+
 } TimerInterface;
 
 #endif
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __TraceInterface_h
+#define __TraceInterface_h
+
+/**
+ * @startuml
+ * interface Trace {
+ *    +void begin (name, timeUs)
+ *    +void end (name, timeUs)
+ * }
+ * @enduml
+ */
+
+/**
+ * Abstract interface for Trace (optional): spans of the publish and receive pipelines
+ */
+typedef struct _TraceInterface
+{
+
+    /*
+     * Begin of the span "name" (string constant), at "timeUs" microseconds (monotonic).
+     * The spans are nested: an end closes the last begun span.
+     */
+    void (* begin) (const char *name, unsigned long timeUs);
+
+    /*
+     * End of the span "name", at "timeUs" microseconds.
+     */
+    void (* end) (const char *name, unsigned long timeUs);
+
+
+} TraceInterface;
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include "TraceSpan.h"
+
+#include <stddef.h>
+
+TraceInterface* traceSpans = NULL;
+static TimerInterface* traceTimer = NULL;
+
+static unsigned long traceNow() {
+    return traceTimer->micros ? traceTimer->micros() : traceTimer->millis() * 1000UL;
+}
+
+void TraceSpan_Set(TraceInterface* trace, TimerInterface* timer) {
+    traceTimer = timer;
+    traceSpans = timer ? trace : NULL;
+}
+
+void TraceSpan_Begin(const char* name) {
+    if (traceSpans && traceSpans->begin) {
+        traceSpans->begin(name, traceNow());
+    }
+}
+
+void TraceSpan_End(const char* name) {
+    if (traceSpans && traceSpans->end) {
+        traceSpans->end(name, traceNow());
+    }
+}
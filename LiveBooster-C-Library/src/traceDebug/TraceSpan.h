@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __TraceSpan_h
+#define __TraceSpan_h
+
+#include "../timer/TimerInterface.h"
+#include "TraceInterface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Spans of the publish and receive pipelines, shared by the modem, MQTT and LiveBooster layers.
+ * Without trace interface, a span costs the test of a pointer; TRACE_SPANS 0 removes them at compile time.
+ */
+
+#ifndef TRACE_SPANS
+#define TRACE_SPANS  1
+#endif
+
+extern TraceInterface* traceSpans;
+
+/**
+ * Set the trace interface (NULL: no spans) and the timer of the timestamps
+ * (microseconds if the timer provides micros(), else milliseconds * 1000).
+ */
+void TraceSpan_Set(TraceInterface* trace, TimerInterface* timer);
+
+void TraceSpan_Begin(const char* name);
+void TraceSpan_End(const char* name);
+
+#if TRACE_SPANS
+#define TRACE_SPAN_BEGIN(name)  do { if (traceSpans) TraceSpan_Begin(name); } while (0)
+#define TRACE_SPAN_END(name)    do { if (traceSpans) TraceSpan_End(name); } while (0)
+#else
+#define TRACE_SPAN_BEGIN(name)  do { } while (0)
+#define TRACE_SPAN_END(name)    do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -100,7 +100,14 @@ int paramUdpdateCb (const LiveBooster_Param_t *ptrParam, const void *value, int
 	switch (ptrParam->parm_uref) {
 		case PARM_IDX_CFG_STR: {
 			PRINTF("PARM_IDX_CFG_STR\n");
-		    strcpy(appv_conf.cfg_str,(const char*)value);
+		    /* refused if it does not fit in cfg_str */
+		    if (len < (int) sizeof(appv_conf.cfg_str)) {
+		        memcpy(appv_conf.cfg_str, value, len);
+		        appv_conf.cfg_str[len] = 0;
+		    }
+		    else {
+		        paramIsOk = false;
+		    }
 			if (paramIsOk) {
 				return OK;
 			}
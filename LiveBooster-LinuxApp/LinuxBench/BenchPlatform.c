@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../LinuxImpl/LinuxSerialImpl.h"
+#include "../LinuxImpl/LinuxTimerImpl.h"
+#include "BenchPlatform.h"
+
+#define LB_SERV_HOST_NAME   "liveobjects.orange-business.com"
+#define BENCH_MAX_DELAY_MS  100
+
+int benchVerbose = 0;
+
+/* ===> Interfaces given to the library <=== */
+
+unsigned long benchSerialBytesIn = 0;
+unsigned long benchSerialBytesOut = 0;
+unsigned long benchSerialWrites = 0;
+
+static void benchSerialOpen() {
+    linuxSerialImpl.open();
+}
+
+static int benchSerialAvailable() {
+    return linuxSerialImpl.available();
+}
+
+static char benchSerialGet() {
+    benchSerialBytesIn++;
+    return linuxSerialImpl.get();
+}
+
+static void benchSerialWrite(const char *buffer, int size) {
+    benchSerialBytesOut += size;
+    benchSerialWrites++;
+    linuxSerialImpl.write(buffer, size);
+}
+
+static int benchSerialRead(char *buffer, int size, unsigned long timeoutInMs) {
+    int n = linuxSerialImpl.read(buffer, size, timeoutInMs);
+    if (n > 0) {
+        benchSerialBytesIn += n;
+    }
+    return n;
+}
+
+static int benchSerialCount() {
+    return linuxSerialImpl.count();
+}
+
+static void benchSerialWriteChunks(const SerialChunk *chunks, int count) {
+    int i;
+    for (i = 0; i < count; i++) {
+        benchSerialBytesOut += chunks[i].size;
+    }
+    benchSerialWrites++;
+    linuxSerialImpl.writeChunks(chunks, count);
+}
+
+SerialInterface benchSerial = {
+    benchSerialOpen,
+    benchSerialAvailable,
+    benchSerialGet,
+    benchSerialWrite,
+    benchSerialRead,
+    benchSerialCount,
+    benchSerialWriteChunks
+};
+
+static void benchTimerInit() {
+    linuxTimerImpl.timerInit();
+}
+
+static unsigned long benchMillis() {
+    return linuxTimerImpl.millis();
+}
+
+/* The emulated modem is ready at once : skip the long boot waits */
+static void benchDelay(unsigned long waitTimeInMs) {
+    linuxTimerImpl.delay((waitTimeInMs > BENCH_MAX_DELAY_MS) ? BENCH_MAX_DELAY_MS : waitTimeInMs);
+}
+
+static unsigned long benchMicros() {
+    return linuxTimerImpl.micros();
+}
+
+TimerInterface benchTimer = {
+    benchTimerInit,
+    benchMillis,
+    benchDelay,
+    benchMicros
+};
+
+static void benchPrint(const char *log) {
+    if (benchVerbose) {
+        fputs(log, stdout);
+    }
+}
+
+DebugInterface benchDebug = {
+    benchPrint
+};
+
+/* ===> Emulator and broker <=== */
+
+static void* emuThread(void* arg) {
+    HeraclesEmu__Run((HeraclesEmu*)arg);
+    return NULL;
+}
+
+void BenchPlatform__Config(BenchPlatform* platform) {
+    memset(&platform->emuConfig, 0, sizeof(platform->emuConfig));
+    platform->emuConfig.baudRate = 115200;
+}
+
+int BenchPlatform__Start(BenchPlatform* platform) {
+    platform->emuConfig.verbose = benchVerbose;
+    if (!MqttBrokerStub__Start(&platform->broker)) {
+        perror("MQTT broker stub");
+        return 0;
+    }
+    HeraclesEmu__AddRoute(&platform->emuConfig, LB_SERV_HOST_NAME, 0, "127.0.0.1", platform->broker.port);
+    if (!HeraclesEmu__Open(&platform->emu, &platform->emuConfig)) {
+        perror("Heracles emulator");
+        return 0;
+    }
+    setenv("LIVEBOOSTER_SERIAL_PORT", HeraclesEmu__PortName(&platform->emu), 1);
+    if (pthread_create(&platform->emuThread, NULL, emuThread, &platform->emu) != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+void BenchPlatform__Stop(BenchPlatform* platform) {
+    HeraclesEmu__Stop(&platform->emu);
+    pthread_join(platform->emuThread, NULL);
+    HeraclesEmu__Close(&platform->emu);
+    MqttBrokerStub__Stop(&platform->broker);
+}
+
+unsigned long long BenchPlatform__NowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static int compareValues(const void* a, const void* b) {
+    unsigned long long x = *(const unsigned long long*)a;
+    unsigned long long y = *(const unsigned long long*)b;
+    return (x > y) - (x < y);
+}
+
+unsigned long long BenchPlatform__Percentile(unsigned long long* values, int count, int percentile) {
+    if (count <= 0) {
+        return 0;
+    }
+    qsort(values, count, sizeof(*values), compareValues);
+    return values[(count * percentile) / 100 < count ? (count * percentile) / 100 : count - 1];
+}
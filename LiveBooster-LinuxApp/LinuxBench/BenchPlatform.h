@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __BenchPlatform_h
+#define __BenchPlatform_h
+
+#include "../LiveBooster-C-Library/LiveBooster.h"
+#include "../LinuxEmu/HeraclesEmu.h"
+#include "MqttBrokerStub.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Common platform of the end-to-end benchmarks:
+ * Heracles emulator (own thread) routed to a local MQTT broker stub, and the
+ * interfaces given to the library (serial with byte counters, timer skipping the
+ * modem boot waits, debug printing only in verbose mode).
+ */
+
+typedef struct _BenchPlatform {
+    HeraclesEmuConfig emuConfig;
+    HeraclesEmu emu;
+    MqttBrokerStub broker;
+    pthread_t emuThread;
+} BenchPlatform;
+
+extern SerialInterface benchSerial;
+extern TimerInterface benchTimer;
+extern DebugInterface benchDebug;
+
+/* serial bytes read / written by the library */
+extern unsigned long benchSerialBytesIn;
+extern unsigned long benchSerialBytesOut;
+/* serial write calls of the library */
+extern unsigned long benchSerialWrites;
+
+/* print the library traces and the AT traffic */
+extern int benchVerbose;
+
+/**
+ * Default configuration: 115200 bauds.
+ */
+void BenchPlatform__Config(BenchPlatform* platform);
+
+/**
+ * Start the broker stub and the emulator (LIVEBOOSTER_SERIAL_PORT is set to its pseudo-terminal).
+ * Return 1 on success, else 0.
+ */
+int BenchPlatform__Start(BenchPlatform* platform);
+
+/**
+ * Stop the emulator and the broker stub.
+ */
+void BenchPlatform__Stop(BenchPlatform* platform);
+
+/**
+ * Monotonic time in microseconds.
+ */
+unsigned long long BenchPlatform__NowUs(void);
+
+/**
+ * Sort "values" and return the given percentile (0..100).
+ */
+unsigned long long BenchPlatform__Percentile(unsigned long long* values, int count, int percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
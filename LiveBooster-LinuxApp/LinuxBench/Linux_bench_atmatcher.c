@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === AT response matcher benchmark ===
+ *
+ * Per-byte cost of the detection of the modem responses :
+ *  - "strstr" : former waitResponse() scanning (append one byte then strstr of each pattern over the line),
+ *  - "matcher byte" : AtMatcher fed one byte at a time,
+ *  - "matcher bulk" : AtMatcher fed with whole buffers.
+ *
+ * Usage : Linux_bench_atmatcher [-n iterations]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../LiveBooster-C-Library/src/heraclesGsm/AtMatcher.h"
+
+#define GSM_NL "\r\n"
+
+/* One exchange : the modem output and the responses expected by the caller */
+typedef struct {
+    const char* output;
+    const char* responses[5];
+} Exchange;
+
+static const Exchange exchanges[] = {
+    { GSM_NL "+CIPRXGET: 4,0,0" GSM_NL, { "+CIPRXGET:", "OK" GSM_NL, "ERROR" GSM_NL, 0, 0 } },
+    { GSM_NL "OK" GSM_NL, { "OK" GSM_NL, "ERROR" GSM_NL, 0, 0, 0 } },
+    { GSM_NL "+CIPSTATUS: 0,0,\"TCP\",\"liveobjects.orange-business.com\",\"8883\",\"CONNECTED\"" GSM_NL,
+      { ",\"CONNECTED\"", ",\"CLOSED\"", ",\"CLOSING\"", ",\"INITIAL\"", "ERROR" GSM_NL } },
+    { GSM_NL "> ", { ">", "OK" GSM_NL, "ERROR" GSM_NL, 0, 0 } },
+    { GSM_NL "DATA ACCEPT:0,120" GSM_NL, { "DATA ACCEPT:", "OK" GSM_NL, "ERROR" GSM_NL, 0, 0 } },
+    { GSM_NL "OK" GSM_NL GSM_NL "0, CONNECT OK" GSM_NL,
+      { "CONNECT OK" GSM_NL, "CONNECT FAIL" GSM_NL, "ALREADY CONNECT" GSM_NL, "ERROR" GSM_NL, "CLOSE OK" GSM_NL } },
+};
+#define EXCHANGE_NB (sizeof(exchanges) / sizeof(Exchange))
+
+static unsigned long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Former waitResponse() scanning */
+static int legacyMatch(const Exchange* ex) {
+    char dataBuffer[100];
+    char *data = dataBuffer;
+    const char* p;
+    int i;
+
+    dataBuffer[0] = 0;
+    for (p = ex->output; *p; p++) {
+        if (strlen(dataBuffer) == sizeof(dataBuffer) - 1) {
+            data = dataBuffer;
+        }
+        *data++ = *p;
+        *data = 0;
+        for (i = 0; i < 5; i++) {
+            if (ex->responses[i] && (strstr(dataBuffer, ex->responses[i]) != 0)) {
+                return i + 1;
+            }
+        }
+        if (strstr(dataBuffer, "+CIPRXGET:" GSM_NL) != 0) {
+            return 6;
+        }
+        if (strstr(dataBuffer, "CLOSED" GSM_NL) != 0) {
+            return 7;
+        }
+    }
+    return 0;
+}
+
+static void buildMatcher(AtMatcher* matcher, const Exchange* ex) {
+    int i;
+    AtMatcher_Init(matcher);
+    for (i = 0; i < 5; i++) {
+        AtMatcher_Add(matcher, ex->responses[i], (unsigned char)(i + 1));
+    }
+    AtMatcher_Add(matcher, "+CIPRXGET:" GSM_NL, 6);
+    AtMatcher_Add(matcher, "CLOSED" GSM_NL, 7);
+    AtMatcher_Build(matcher);
+}
+
+int main(int argc, char* argv[]) {
+    static AtMatcher matchers[EXCHANGE_NB];
+    size_t lengths[EXCHANGE_NB];
+    unsigned long long bytes = 0;
+    unsigned long long t0;
+    double legacyNs, byteNs, bulkNs, buildNs;
+    volatile int sink = 0;
+    int iterations = 200000;
+    int it;
+    size_t e;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            iterations = atoi(optarg);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (e = 0; e < EXCHANGE_NB; e++) {
+        int used;
+        const char* out = exchanges[e].output;
+        buildMatcher(&matchers[e], &exchanges[e]);
+        /* bytes actually scanned until the match, for both methods */
+        lengths[e] = strlen(out);
+        if (AtMatcher_Feed(&matchers[e], out, (int)lengths[e], &used) != legacyMatch(&exchanges[e])) {
+            fprintf(stderr, "Mismatch on exchange %u\n", (unsigned)e);
+            return 1;
+        }
+        lengths[e] = used;
+        bytes += used;
+    }
+    bytes *= iterations;
+
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        for (e = 0; e < EXCHANGE_NB; e++) {
+            sink += legacyMatch(&exchanges[e]);
+        }
+    }
+    legacyNs = (double)(nowNs() - t0);
+
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        for (e = 0; e < EXCHANGE_NB; e++) {
+            const char* p = exchanges[e].output;
+            AtMatcher_Reset(&matchers[e]);
+            while (!AtMatcher_Feed(&matchers[e], p++, 1, 0)) {
+            }
+            sink++;
+        }
+    }
+    byteNs = (double)(nowNs() - t0);
+
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        for (e = 0; e < EXCHANGE_NB; e++) {
+            AtMatcher_Reset(&matchers[e]);
+            sink += AtMatcher_Feed(&matchers[e], exchanges[e].output, (int)lengths[e], 0);
+        }
+    }
+    bulkNs = (double)(nowNs() - t0);
+
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        for (e = 0; e < EXCHANGE_NB; e++) {
+            buildMatcher(&matchers[e], &exchanges[e]);
+        }
+    }
+    buildNs = (double)(nowNs() - t0);
+
+    printf("bytes scanned          : %llu\n", bytes);
+    printf("strstr       ns/byte   : %.2f\n", legacyNs / bytes);
+    printf("matcher byte ns/byte   : %.2f\n", byteNs / bytes);
+    printf("matcher bulk ns/byte   : %.2f\n", bulkNs / bytes);
+    printf("matcher build ns/set   : %.1f\n", buildNs / ((double)iterations * EXCHANGE_NB));
+    return (sink == 0);
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === JSON decoding benchmark ===
+ *
+ * Cost of the decoding of the received messages against the size of the attached sets
+ * (10, 100 and 1000 configuration parameters, commands and resources by default) :
+ *  - name lookup alone : former linear strlen/strncmp scan versus the hash index built
+ *    at attach time (LiveBooster_msg_index_params, LiveBooster_msg_index_names / LiveBooster_msg_find_name),
+ *  - whole message : a configuration update of 10 parameters spread over the set,
+ *    a command request and a resource update request, both naming the last entry.
+ * This program is linked with a library built for sets of up to LB_MAX_OF_CFG_PARAMS,
+ * LB_MAX_OF_COMMANDS and LB_MAX_OF_RESOURCES = 1000 entries (see CMakeLists.txt).
+ *
+ * Usage : Linux_bench_decode [-n iterations] [-e entries]...
+*/
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_msg.h"
+
+#define ENTRIES_MAX   1000
+#define SIZES_MAX     8
+#define NAME_SZ       24
+#define CFG_UPDATED   10
+
+static unsigned long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* ===> Attached sets <=== */
+
+static char names[ENTRIES_MAX][NAME_SZ];
+static uint32_t values[ENTRIES_MAX];
+static LiveBooster_Param_t params[ENTRIES_MAX];
+static LiveBooster_Command_t commands[ENTRIES_MAX];
+static LiveBooster_Resource_t resources[ENTRIES_MAX];
+
+static LiveBooster_SetOfParams_t setParam;
+static LiveBooster_SetofUpdatedParams_t setUpdatedParam;
+static LiveBooster_SetofCommands_t setCmd;
+static LiveBooster_SetOfResources_t setRsc;
+static LiveBooster_SetOfUpdatedResource_t setUpdatedRsc;
+
+static int benchParam(const LiveBooster_Param_t* param_ptr, const void* val_ptr, int val_len) {
+    (void)param_ptr;
+    (void)val_ptr;
+    (void)val_len;
+    return 0;
+}
+
+static int benchCommand(const LiveBooster_CommandRequestBlock_t* pCmdReqBlk) {
+    return (pCmdReqBlk->hd.cmd_ptr == &commands[setCmd.cmd_nb - 1]) ? 0 : -1;
+}
+
+static void benchPrint(const char* log) {
+    (void)log;
+}
+
+static DebugInterface benchDebug = { benchPrint };
+
+/* Former lookup : strlen() and strncmp() of each name until found */
+static int legacyFindParam(const char* name, uint32_t len) {
+    int i;
+    for (i = 0; i < setParam.param_set.param_nb; i++) {
+        int param_name_len = strlen(params[i].parm_data.data_name);
+        if (((int)len == param_name_len) && (!strncmp(name, params[i].parm_data.data_name, param_name_len))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int attach(int nb) {
+    int i;
+    for (i = 0; i < nb; i++) {
+        snprintf(names[i], NAME_SZ, "entry_%d", i);
+        params[i].parm_uref = i;
+        params[i].parm_data.data_type = LB_TYPE_UINT32;
+        params[i].parm_data.data_name = names[i];
+        params[i].parm_data.data_value = &values[i];
+        params[i].parm_data.data_dim = 1;
+        commands[i].cmd_uref = i;
+        commands[i].cmd_name = names[i];
+        resources[i].rsc_uref = i;
+        resources[i].rsc_name = names[i];
+        resources[i].rsc_version_ptr = "1.0";
+        resources[i].rsc_version_sz = 4;
+    }
+    setParam.param_set.param_ptr = params;
+    setParam.param_set.param_nb = nb;
+    setParam.param_callback = benchParam;
+    setCmd.cmd_ptr = commands;
+    setCmd.cmd_nb = nb;
+    setCmd.cmd_callback = benchCommand;
+    setRsc.rsc_ptr = resources;
+    setRsc.rsc_nb = nb;
+    return LiveBooster_msg_index_params(&setParam, &setUpdatedParam, params, nb)
+        || LiveBooster_msg_index_names(setCmd.cmd_index, 2 * LB_MAX_OF_COMMANDS, commands,
+                                       sizeof(LiveBooster_Command_t), offsetof(LiveBooster_Command_t, cmd_name), nb)
+        || LiveBooster_msg_index_names(setRsc.rsc_index, 2 * LB_MAX_OF_RESOURCES, resources,
+                                       sizeof(LiveBooster_Resource_t), offsetof(LiveBooster_Resource_t, rsc_name), nb);
+}
+
+/* ===> Benchmark <=== */
+
+int main(int argc, char* argv[]) {
+    static char cfgMsg[CFG_UPDATED * 64 + 64];
+    char cmdMsg[128];
+    char rscMsg[256];
+    int sizes[SIZES_MAX] = { 10, 100, 1000 };
+    int sizesNb = 0;
+    int iterations = 20000;
+    volatile long sink = 0;
+    int opt;
+    int s;
+
+    while ((opt = getopt(argc, argv, "n:e:")) != -1) {
+        if (opt == 'n') {
+            iterations = atoi(optarg);
+        }
+        else if ((opt == 'e') && (sizesNb < SIZES_MAX)) {
+            sizes[sizesNb++] = atoi(optarg);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-n iterations] [-e entries]...\n", argv[0]);
+            return 1;
+        }
+    }
+    if (sizesNb == 0) {
+        sizesNb = 3;
+    }
+    msgDebug = &benchDebug;
+
+    printf("entries  lookup linear ns  lookup index ns  cfg ns/msg (%d params)  cmd ns/msg  rsc ns/msg\n", CFG_UPDATED);
+    for (s = 0; s < sizesNb; s++) {
+        int nb = sizes[s];
+        double linearNs, indexNs, cfgNs, cmdNs, rscNs;
+        unsigned long long t0;
+        int32_t cid;
+        int len;
+        int it;
+        int i;
+
+        if ((nb < 1) || (nb > ENTRIES_MAX) || attach(nb)) {
+            fprintf(stderr, "Invalid number of entries %d (1..%d)\n", nb, ENTRIES_MAX);
+            return 1;
+        }
+
+        /* messages : the updated parameters are spread over the set, the command and the resource are the last ones */
+        len = sprintf(cfgMsg, "{\"cfg\":{");
+        for (i = 0; i < CFG_UPDATED; i++) {
+            len += sprintf(cfgMsg + len, "%s\"%s\":{\"t\":\"u32\",\"v\":%d}", i ? "," : "",
+                           names[(nb - 1) - (i * nb) / CFG_UPDATED], i);
+        }
+        sprintf(cfgMsg + len, "},\"cid\":1}");
+        sprintf(cmdMsg, "{\"req\":\"%s\",\"arg\":{\"delay\":10},\"cid\":2}", names[nb - 1]);
+        sprintf(rscMsg, "{\"cid\":3,\"id\":\"%s\",\"old\":\"1.0\",\"new\":\"2.0\","
+                "\"m\":{\"size\":1024,\"uri\":\"http://localhost/rsc\",\"md5\":\"0123456789abcdef0123456789abcdef\"}}",
+                names[nb - 1]);
+
+        /* checks */
+        setUpdatedRsc.ursc_cid = 0;
+        if ((LiveBooster_msg_decode_params_req(cfgMsg, strlen(cfgMsg), &setParam, &setUpdatedParam) != 0)
+                || (setUpdatedParam.nb_of_params != ((nb < CFG_UPDATED) ? nb : CFG_UPDATED))
+                || (LiveBooster_msg_decode_cmd_req(cmdMsg, strlen(cmdMsg), &setCmd, &cid) != 0)
+                || (LiveBooster_msg_decode_rsc_req(rscMsg, strlen(rscMsg), &setRsc, &setUpdatedRsc, &cid) != RSC_RSP_OK)
+                || (setUpdatedRsc.ursc_obj_ptr != &resources[nb - 1])) {
+            fprintf(stderr, "Decoding failed with %d entries\n", nb);
+            return 1;
+        }
+        for (i = 0; i < nb; i++) {
+            if ((legacyFindParam(names[i], strlen(names[i])) != i)
+                    || (LiveBooster_msg_find_name(setParam.param_index, setParam.param_slot_nb, params,
+                            sizeof(LiveBooster_Param_t), offsetof(LiveBooster_Param_t, parm_data.data_name),
+                            names[i], strlen(names[i])) != i)) {
+                fprintf(stderr, "Lookup failed : %s\n", names[i]);
+                return 1;
+            }
+        }
+
+        /* lookup of every name in turn */
+        t0 = nowNs();
+        for (it = 0; it < iterations; it++) {
+            const char* name = names[it % nb];
+            sink += legacyFindParam(name, strlen(name));
+        }
+        linearNs = (double)(nowNs() - t0) / iterations;
+        t0 = nowNs();
+        for (it = 0; it < iterations; it++) {
+            const char* name = names[it % nb];
+            sink += LiveBooster_msg_find_name(setParam.param_index, setParam.param_slot_nb, params,
+                    sizeof(LiveBooster_Param_t), offsetof(LiveBooster_Param_t, parm_data.data_name), name, strlen(name));
+        }
+        indexNs = (double)(nowNs() - t0) / iterations;
+
+        /* whole messages */
+        t0 = nowNs();
+        for (it = 0; it < iterations; it++) {
+            sink += LiveBooster_msg_decode_params_req(cfgMsg, strlen(cfgMsg), &setParam, &setUpdatedParam);
+        }
+        cfgNs = (double)(nowNs() - t0) / iterations;
+        t0 = nowNs();
+        for (it = 0; it < iterations; it++) {
+            sink += LiveBooster_msg_decode_cmd_req(cmdMsg, strlen(cmdMsg), &setCmd, &cid);
+        }
+        cmdNs = (double)(nowNs() - t0) / iterations;
+        t0 = nowNs();
+        for (it = 0; it < iterations; it++) {
+            setUpdatedRsc.ursc_cid = 0;
+            sink += LiveBooster_msg_decode_rsc_req(rscMsg, strlen(rscMsg), &setRsc, &setUpdatedRsc, &cid);
+        }
+        rscNs = (double)(nowNs() - t0) / iterations;
+
+        printf("%7d  %16.1f  %15.1f  %22.0f  %10.0f  %10.0f\n", nb, linearNs, indexNs, cfgNs, cmdNs, rscNs);
+    }
+    return (sink == 0);
+}
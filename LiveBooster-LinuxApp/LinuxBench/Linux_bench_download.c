@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === Download benchmark ===
+ *
+ * Throughput of HeraclesTcpClient reads without hardware :
+ *  local TCP server -> Heracles emulator -> pseudo-terminal -> HeraclesTcpClient read().
+ *
+ * Usage : Linux_bench_download [-s bytes] [-r read_size] [-b baud] [-l latency_us] [-v]
+ *
+ * Reported values : throughput, AT+CIPRXGET=2 commands and serial bytes per KB of payload.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "BenchPlatform.h"
+#include "../LiveBooster-C-Library/src/heraclesGsm/HeraclesTcpClient.h"
+
+#define DOWNLOAD_HOST  "download.bench"
+#define DOWNLOAD_PORT  80
+
+/* ===> Source server : sends "size" bytes to the first client, then closes <=== */
+
+typedef struct {
+    int listenSock;
+    unsigned short port;
+    size_t size;
+    pthread_t thread;
+} SourceServer;
+
+static unsigned char patternByte(size_t i) {
+    return (unsigned char)(i % 251);
+}
+
+static void* sourceThread(void* arg) {
+    SourceServer* server = (SourceServer*)arg;
+    unsigned char block[4096];
+    size_t sent = 0;
+    int client = accept(server->listenSock, NULL, NULL);
+
+    if (client < 0) {
+        return NULL;
+    }
+    while (sent < server->size) {
+        size_t len = server->size - sent;
+        size_t i;
+        ssize_t n;
+        if (len > sizeof(block)) {
+            len = sizeof(block);
+        }
+        for (i = 0; i < len; i++) {
+            block[i] = patternByte(sent + i);
+        }
+        n = send(client, block, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if ((n < 0) && (errno == EINTR)) {
+                continue;
+            }
+            break;
+        }
+        sent += n;
+    }
+    /* let the emulator drain the socket before the close */
+    {
+        struct pollfd pfd;
+        pfd.fd = client;
+        pfd.events = POLLIN;
+        poll(&pfd, 1, 60000);
+    }
+    close(client);
+    return NULL;
+}
+
+static int sourceStart(SourceServer* server, size_t size) {
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    int one = 1;
+
+    server->size = size;
+    server->listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->listenSock < 0) {
+        return 0;
+    }
+    setsockopt(server->listenSock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((bind(server->listenSock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+            || (listen(server->listenSock, 1) != 0)
+            || (getsockname(server->listenSock, (struct sockaddr*)&addr, &addrLen) != 0)) {
+        close(server->listenSock);
+        return 0;
+    }
+    server->port = ntohs(addr.sin_port);
+    return (pthread_create(&server->thread, NULL, sourceThread, server) == 0);
+}
+
+/* ===> Benchmark <=== */
+
+static BenchPlatform platform;
+static HeraclesTcpClient client;
+
+int main(int argc, char* argv[]) {
+    SourceServer server;
+    unsigned char* buffer;
+    unsigned long long start, elapsed, lastData;
+    unsigned long bytesIn, bytesOut, ciprxget;
+    size_t size = 100 * 1024;
+    size_t total = 0;
+    size_t errors = 0;
+    int readSize = 1460;
+    int opt;
+
+    BenchPlatform__Config(&platform);
+    while ((opt = getopt(argc, argv, "s:r:b:l:v")) != -1) {
+        switch (opt) {
+            case 's':
+                size = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                readSize = atoi(optarg);
+                break;
+            case 'b':
+                platform.emuConfig.baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                platform.emuConfig.cmdLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 'v':
+                benchVerbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s bytes] [-r read_size] [-b baud] [-l latency_us] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (readSize <= 0) {
+        readSize = 1;
+    }
+    buffer = (unsigned char*)malloc(readSize);
+    if ((buffer == NULL) || !sourceStart(&server, size)) {
+        perror("source server");
+        return 1;
+    }
+    HeraclesEmu__AddRoute(&platform.emuConfig, DOWNLOAD_HOST, 0, "127.0.0.1", server.port);
+    if (!BenchPlatform__Start(&platform)) {
+        return 1;
+    }
+
+    HeraclesTcpClient__Init(&client, &benchSerial, &benchTimer, &benchDebug, 1);
+    if (client._.connect(&client._, DOWNLOAD_HOST, DOWNLOAD_PORT, 0) != 1) {
+        fprintf(stderr, "connect failed\n");
+        return 1;
+    }
+
+    bytesIn = benchSerialBytesIn;
+    bytesOut = benchSerialBytesOut;
+    ciprxget = platform.emu.stats.ciprxget;
+    start = BenchPlatform__NowUs();
+    lastData = start;
+    while (total < size) {
+        int i;
+        int n = client._.read(&client._, buffer, readSize, 1000);
+        unsigned long long now = BenchPlatform__NowUs();
+        for (i = 0; i < n; i++) {
+            if (buffer[i] != patternByte(total + i)) {
+                errors++;
+            }
+        }
+        total += n;
+        if (n > 0) {
+            lastData = now;
+        }
+        else if (now - lastData > 10000000ULL) {
+            fprintf(stderr, "no data for 10 s, stopping at %lu bytes\n", (unsigned long)total);
+            break;
+        }
+    }
+    elapsed = BenchPlatform__NowUs() - start;
+    bytesIn = benchSerialBytesIn - bytesIn;
+    bytesOut = benchSerialBytesOut - bytesOut;
+    ciprxget = platform.emu.stats.ciprxget - ciprxget;
+
+    if (total > 0) {
+        double kb = total / 1024.0;
+        printf("payload bytes     : %lu (%lu corrupted)\n", (unsigned long)total, (unsigned long)errors);
+        printf("baud rate         : %lu\n", platform.emuConfig.baudRate);
+        printf("read size         : %d\n", readSize);
+        printf("throughput (KB/s) : %.1f\n", kb * 1000000.0 / elapsed);
+        printf("CIPRXGET/KB       : %.1f\n", ciprxget / kb);
+        printf("serial bytes/KB   : %.1f (out %.1f, in %.1f)\n",
+               (bytesIn + bytesOut) / kb, bytesOut / kb, bytesIn / kb);
+    }
+
+    client._.stop(&client._);
+    shutdown(server.listenSock, SHUT_RDWR);
+    close(server.listenSock);
+    BenchPlatform__Stop(&platform);
+    free(buffer);
+    return (errors != 0);
+}
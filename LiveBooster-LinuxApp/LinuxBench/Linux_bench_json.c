@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === JSON encoding benchmark ===
+ *
+ * Cost of the encoding of a collected data message (LiveBooster_msg_encode_data()) with
+ * model, tags, GPS position and an array of 100 values, about 1 KB of JSON :
+ *  - "strlen/snprintf" : former LiveBooster_json_add_* functions, rescanning the buffer before each write,
+ *  - "writer" : LiveBooster_JsonWriter_t, single pass with cursor tracking,
+ *  - "template" : static fragments pre-rendered by LiveBooster_msg_template_data(), only the values formatted.
+ * The former encoding writes the floats with "%f" (6 decimals) : the message size of both is reported.
+ * "-d 1" gives a typical message of a few scalar values, "-f" an array of float values (2 decimals sensor).
+ *
+ * Then the number formatting alone, per value : snprintf "%f" / "%d" versus LiveBooster_fmt_float()
+ * (shortest round-trip) / LiveBooster_fmt_i32(). The shortest form is checked against strtof() and
+ * "%.<p>g" (same float read back, no shorter precision reading back) on random float bit patterns.
+ *
+ * Usage : Linux_bench_json [-n iterations] [-d dimension] [-f] [-c checked_floats]
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_msg.h"
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_num_fmt.h"
+
+#define DIM_MAX  127  /* data_dim is an int8_t */
+
+static unsigned long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Random float bit patterns (finite) : the shortest form reads back as the same float,
+   and no shorter "%.<p>g" does */
+static int checkFloats(int count) {
+    unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+    int i;
+    for (i = 0; i < count; i++) {
+        char out[LB_FMT_FLOAT_SZ + 1];
+        char ref[32];
+        uint32_t bits;
+        float value;
+        float back;
+        int len;
+        int digits = 0;
+        int p;
+        char* c;
+
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        bits = (uint32_t)(seed >> 32);
+        if (((bits >> 23) & 0xFF) == 0xFF) {
+            continue;
+        }
+        memcpy(&value, &bits, sizeof(value));
+        len = LiveBooster_fmt_float(out, value, -1);
+        out[len] = 0;
+        back = strtof(out, NULL);
+        if (memcmp(&back, &value, sizeof(value)) && !((value == 0.0f) && (back == 0.0f))) {
+            fprintf(stderr, "Round-trip failed: %.9g -> %s\n", value, out);
+            return 0;
+        }
+        /* significant digits : leading zeros of 0.00x and padding zeros of 71696540 excluded */
+        for (c = out; *c && (*c != 'e'); c++) {
+            digits += ((*c >= '0') && (*c <= '9'));
+        }
+        while ((--c >= out) && (*c == '0')) {
+            digits--;
+        }
+        for (c = out; (*c == '-') || (*c == '0') || (*c == '.'); c++) {
+            digits -= (*c == '0');
+        }
+        for (p = 1; p < digits; p++) {
+            /* a float has at most 9 significant digits : always complete in ref */
+            if ((snprintf(ref, sizeof(ref), "%.*g", p, value) < (int)sizeof(ref)) && (strtof(ref, NULL) == value)) {
+                fprintf(stderr, "Not shortest: %s (%s)\n", out, ref);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Former encoding : strlen() of the whole buffer then snprintf() for each write */
+static int legacyAddNameStr(const char* name, const char* value, char *pbuf, uint32_t sz) {
+    int len = sz - strlen(pbuf);
+    char* pcur = pbuf + strlen(pbuf);
+    return (snprintf(pcur, len, "\"%s\":\"%s\",", name, value) < 0) ? -1 : 0;
+}
+
+static int legacyClose(char *pbuf, uint32_t sz, const char* end) {
+    int len = sz - strlen(pbuf);
+    char* pcur = pbuf + strlen(pbuf);
+    if (*(pcur - 1) == ',') {
+        pcur--;
+        len++;
+    }
+    return (snprintf(pcur, len, "%s", end) < 0) ? -1 : 0;
+}
+
+static int legacyAddItem(const LiveBooster_Data_t* data_ptr, char *pbuf, uint32_t sz) {
+    short i;
+    short dim = data_ptr->data_dim;
+    const char* value = (const char*)data_ptr->data_value;
+    int len = sz - strlen(pbuf);
+    char* pcur = pbuf + strlen(pbuf);
+
+    if (snprintf(pcur, len, "\"%s\":", data_ptr->data_name) < 0) {
+        return -1;
+    }
+    len = sz - strlen(pbuf);
+    pcur = pbuf + strlen(pbuf);
+    if (len < 4) {
+        return -1;
+    }
+    if (dim > 1) {
+        *pcur++ = '[';
+        len--;
+    }
+    for (i = 0; i < dim; i++) {
+        switch (data_ptr->data_type) {
+        case LB_TYPE_INT32:
+            snprintf(pcur, len, "%"PRIi32",", *((const int32_t*)value));
+            value += sizeof(int32_t);
+            break;
+        case LB_TYPE_UINT32:
+            snprintf(pcur, len, "%"PRIu32",", *((const uint32_t*)value));
+            value += sizeof(uint32_t);
+            break;
+        case LB_TYPE_FLOAT:
+            snprintf(pcur, len, "%f,", *((const float*)value));
+            value += sizeof(float);
+            break;
+        default:
+            snprintf(pcur, len, "\"%s\",", value);
+            value += sizeof(char*);
+            break;
+        }
+        if (dim > 1) {
+            len = sz - strlen(pbuf);
+            pcur = pbuf + strlen(pbuf);
+            if (len < 2) {
+                return -1;
+            }
+        }
+    }
+    if (dim > 1) {
+        pcur--;
+        if ((*pcur != ',') || (len < 2)) {
+            return -1;
+        }
+        *pcur++ = ']';
+        *pcur++ = ',';
+        *pcur = 0;
+    }
+    return 0;
+}
+
+static const char* legacyEncodeData(char* buf, uint32_t sz, const LiveBooster_SetOfData_t* pSetData) {
+    int i;
+    int ret;
+    snprintf(buf, sz, "{");
+    ret = legacyAddNameStr("s", pSetData->stream_id, buf, sz);
+    if (ret == 0) {
+        ret = legacyAddNameStr("ts", pSetData->timestamp, buf, sz);
+    }
+    if (ret == 0) {
+        ret = legacyAddNameStr("m", pSetData->model, buf, sz);
+    }
+    if (ret == 0) {
+        int len = sz - strlen(buf);
+        char msg[80];
+        snprintf(msg, sizeof(msg) - 1, "%3.6f,%3.6f", pSetData->gps_ptr->gps_lat, pSetData->gps_ptr->gps_long);
+        ret = (snprintf(buf + strlen(buf), len, "\"%s\":[%s],", "loc", msg) < 0) ? -1 : 0;
+    }
+    if (ret == 0) {
+        int len = sz - strlen(buf);
+        /* (the former section start had a space after the colon, dropped by the writer) */
+        ret = (snprintf(buf + strlen(buf), len, "\"%s\":{", "v") < 0) ? -1 : 0;
+    }
+    for (i = 0; (i < pSetData->data_set.data_nb) && (ret == 0); i++) {
+        ret = legacyAddItem(&pSetData->data_set.data_ptr[i], buf, sz);
+    }
+    if (ret == 0) {
+        ret = legacyClose(buf, sz, "},");
+    }
+    if (ret == 0) {
+        int len = sz - strlen(buf);
+        ret = (snprintf(buf + strlen(buf), len, "\"%s\":[%s],", "t", pSetData->tags) < 0) ? -1 : 0;
+    }
+    if (ret == 0) {
+        ret = legacyClose(buf, sz, "}");
+    }
+    return (ret == 0) ? buf : NULL;
+}
+
+int main(int argc, char* argv[]) {
+    static int32_t values[DIM_MAX];
+    static float fvalues[DIM_MAX];
+    static char legacyBuf[4 * LB_JSON_BUF_SZ];   /* "%f" floats */
+    static float temperature = 21.5f;
+    static uint32_t counter = 4242;
+    static char state[] = "running";
+    static LiveBooster_Data_t data[] = {
+        { LB_TYPE_INT32, "samples", values, 100 },
+        { LB_TYPE_FLOAT, "temperature", &temperature, 1 },
+        { LB_TYPE_UINT32, "counter", &counter, 1 },
+        { LB_TYPE_STRING_C, "state", state, 1 }
+    };
+    static LiveBooster_GpsFix_t gps = { 1, 48.856613f, 2.352222f };
+    static LiveBooster_SetOfData_t setOfData;
+    static char writerBuf[LB_JSON_BUF_SZ];
+    unsigned long long t0;
+    double legacyNs, writerNs, templateNs;
+    double printfFloatNs, fmtFloatNs, printfIntNs, fmtIntNs;
+    unsigned long printfFloatBytes = 0, fmtFloatBytes = 0;
+    size_t legacyBytes;
+    int checked = 1000000;
+    const char* msg;
+    size_t bytes;
+    volatile size_t sink = 0;
+    int iterations = 100000;
+    int it;
+    int i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:fc:")) != -1) {
+        if (opt == 'n') {
+            iterations = atoi(optarg);
+        }
+        else if (opt == 'd') {
+            i = atoi(optarg);
+            data[0].data_dim = (int8_t)((i < 1) ? 1 : (i > DIM_MAX) ? DIM_MAX : i);
+        }
+        else if (opt == 'f') {
+            data[0].data_type = LB_TYPE_FLOAT;
+            data[0].data_value = fvalues;
+        }
+        else if (opt == 'c') {
+            checked = atoi(optarg);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-n iterations] [-d dimension] [-f] [-c checked_floats]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < DIM_MAX; i++) {
+        values[i] = (int32_t)((i * 7919123L) % 1000000L) - 500000L;
+        fvalues[i] = (float)((i * 7919L) % 100000L) / 100.0f - 500.0f;
+    }
+    setOfData.data_set.data_ptr = data;
+    setOfData.data_set.data_nb = sizeof(data) / sizeof(data[0]);
+    setOfData.gps_ptr = &gps;
+    strcpy(setOfData.stream_id, "urn:lo:nsid:LiveBooster:bench!samples");
+    strcpy(setOfData.model, "bench_v1");
+    strcpy(setOfData.tags, "\"bench\",\"linux\"");
+    strcpy(setOfData.timestamp, "2018-06-01T12:00:00Z");
+
+    /* the writer and the template give the same message */
+    msg = LiveBooster_msg_encode_data(&setOfData);
+    if ((msg == NULL) || (legacyEncodeData(legacyBuf, sizeof(legacyBuf), &setOfData) == NULL)) {
+        fprintf(stderr, "Message too large (LB_JSON_BUF_SZ %d)\n", LB_JSON_BUF_SZ);
+        return 1;
+    }
+    legacyBytes = strlen(legacyBuf);
+    strcpy(writerBuf, msg);
+    if (LiveBooster_msg_template_data(&setOfData) != 0) {
+        fprintf(stderr, "Template too large (LB_JSON_TMPL_SZ %d)\n", LB_JSON_TMPL_SZ);
+        return 1;
+    }
+    msg = LiveBooster_msg_encode_data(&setOfData);
+    if ((msg == NULL) || strcmp(msg, writerBuf)) {
+        fprintf(stderr, "Mismatch:\n%s\n%s\n", msg ? msg : "(null)", writerBuf);
+        return 1;
+    }
+    bytes = strlen(msg);
+
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        sink += (size_t)legacyEncodeData(legacyBuf, sizeof(legacyBuf), &setOfData);
+    }
+    legacyNs = (double)(nowNs() - t0) / iterations;
+
+    setOfData.tmpl.slot_nb = 0;
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        sink += (size_t)LiveBooster_msg_encode_data(&setOfData);
+    }
+    writerNs = (double)(nowNs() - t0) / iterations;
+
+    LiveBooster_msg_template_data(&setOfData);
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        sink += (size_t)LiveBooster_msg_encode_data(&setOfData);
+    }
+    templateNs = (double)(nowNs() - t0) / iterations;
+
+    /* number formatting alone */
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        char out[64];
+        printfFloatBytes += snprintf(out, sizeof(out), "%f", fvalues[it % DIM_MAX]);
+    }
+    printfFloatNs = (double)(nowNs() - t0) / iterations;
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        char out[LB_FMT_FLOAT_SZ];
+        fmtFloatBytes += LiveBooster_fmt_float(out, fvalues[it % DIM_MAX], -1);
+    }
+    fmtFloatNs = (double)(nowNs() - t0) / iterations;
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        char out[16];
+        sink += snprintf(out, sizeof(out), "%"PRIi32, values[it % DIM_MAX]);
+    }
+    printfIntNs = (double)(nowNs() - t0) / iterations;
+    t0 = nowNs();
+    for (it = 0; it < iterations; it++) {
+        char out[LB_FMT_INT_SZ];
+        sink += LiveBooster_fmt_i32(out, values[it % DIM_MAX]);
+    }
+    fmtIntNs = (double)(nowNs() - t0) / iterations;
+    if (!checkFloats(checked)) {
+        return 1;
+    }
+
+    printf("message bytes              : %u (%d values), former %u\n", (unsigned)bytes, data[0].data_dim + 3,
+           (unsigned)legacyBytes);
+    printf("strlen/snprintf ns/message : %.0f (%.2f ns/byte)\n", legacyNs, legacyNs / bytes);
+    printf("writer          ns/message : %.0f (%.2f ns/byte)\n", writerNs, writerNs / bytes);
+    printf("template        ns/message : %.0f (%.2f ns/byte)\n", templateNs, templateNs / bytes);
+    printf("float \"%%f\"       ns/value   : %.1f (%.2f bytes/value)\n", printfFloatNs,
+           (double)printfFloatBytes / iterations);
+    printf("float shortest   ns/value   : %.1f (%.2f bytes/value)\n", fmtFloatNs, (double)fmtFloatBytes / iterations);
+    printf("int32 \"%%d\"       ns/value   : %.1f\n", printfIntNs);
+    printf("int32 fmt        ns/value   : %.1f\n", fmtIntNs);
+    printf("float check                 : %d random floats read back, shortest\n", checked);
+    return (sink == 0);
+}
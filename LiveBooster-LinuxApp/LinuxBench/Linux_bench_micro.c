@@ -0,0 +1,518 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === Micro benchmarks of the codec hot paths ===
+ *
+ * Each case runs one function of the library on a realistic input of several sizes :
+ *  - LiveBooster_msg_encode_data : data message with 1, 16 and 100 values (model, tags and GPS position),
+ *    fully encoded ("encode_data") or from the pre-rendered template ("encode_data_tmpl"),
+ *  - LiveBooster_msg_encode_params_all : 4, 16 and 28 configuration parameters of mixed types,
+ *  - LiveBooster_msg_decode_params_req : update of 1, 8 and 32 parameters of a set of 32,
+ *  - LiveBooster_msg_decode_cmd_req : command request with 0, 4 and 16 arguments,
+ *  - LiveBooster_msg_decode_rsc_req : resource update request with an URI of 16 and 64 characters,
+ *  - MQTTSerialize_publish / MQTTDeserialize_publish : QoS 0 publication of 16, 256, 1024 and 4096 bytes,
+ *  - GsmFifo_Put (byte per byte, as the modem receive path) / GsmFifo_Get (one chunk) : 1, 16 and 63 bytes,
+ *  - b64_encode / b64_decode : 16, 256 and 4096 bytes of binary data,
+ *  - MD5Update : chunks of 64, 1024 and 16384 bytes (resource download).
+ *
+ * The number of operations of a case is calibrated to last about "-t" milliseconds; the best of "-r" runs
+ * is kept. The output is a tab separated table, one line per case and size, to compare releases :
+ *   case  size  iterations  ns_per_op  bytes_per_op
+ * "size" is the number of values, parameters, arguments or URI characters for the JSON functions, the number
+ * of bytes for the others. "bytes_per_op" is the size of the message, text or data produced or consumed by
+ * one operation. "-f name" only runs the cases whose name contains "name".
+ *
+ * Usage : Linux_bench_micro [-t milliseconds] [-r runs] [-f name]
+*/
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../LiveBooster-C-Library/src/heraclesGsm/GsmFifo.h"
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_code_b64.h"
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_md5.h"
+#include "../LiveBooster-C-Library/src/liveBooster/liveBoosterPacket/LiveBooster_msg.h"
+#include "../LiveBooster-C-Library/src/mqttClient/MQTTPacket/MQTTPacket.h"
+
+#define SIZES_MAX      4
+#define VALUES_MAX     100
+#define PARAMS_MAX     LB_MAX_OF_CFG_PARAMS
+#define ARGS_MAX       16
+#define DATA_MAX       4096
+#define MD5_CHUNK_MAX  16384
+#define NAME_SZ        24
+
+static unsigned long long nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void benchPrint(const char* log) {
+    (void)log;
+}
+
+static DebugInterface benchDebug = { benchPrint };
+
+/* Binary data of the MQTT, base64 and MD5 cases (pseudo random, not compressible) */
+static unsigned char data[MD5_CHUNK_MAX];
+static int dataLen;
+
+/* ===> LiveBooster_msg_encode_data <=== */
+
+static int32_t samples[VALUES_MAX];
+static float temperature = 21.5f;
+static uint32_t counter = 4242;
+static char state[] = "running";
+static LiveBooster_Data_t dataItems[] = {
+    { LB_TYPE_INT32, "samples", samples, 1 },
+    { LB_TYPE_FLOAT, "temperature", &temperature, 1 },
+    { LB_TYPE_UINT32, "counter", &counter, 1 },
+    { LB_TYPE_STRING_C, "state", state, 1 }
+};
+static LiveBooster_GpsFix_t gps = { 1, 48.856613f, 2.352222f };
+static LiveBooster_SetOfData_t setOfData;
+
+static int setupEncodeData(int size) {
+    int i;
+    for (i = 0; i < VALUES_MAX; i++) {
+        samples[i] = (int32_t)((i * 7919123L) % 1000000L) - 500000L;
+    }
+    dataItems[0].data_dim = (int8_t)size;
+    setOfData.data_set.data_ptr = dataItems;
+    setOfData.data_set.data_nb = sizeof(dataItems) / sizeof(dataItems[0]);
+    setOfData.gps_ptr = &gps;
+    setOfData.precision = -1;
+    strcpy(setOfData.stream_id, "urn:lo:nsid:LiveBooster:bench!samples");
+    strcpy(setOfData.model, "bench_v1");
+    strcpy(setOfData.tags, "\"bench\",\"linux\"");
+    strcpy(setOfData.timestamp, "2018-06-01T12:00:00Z");
+    setOfData.tmpl.slot_nb = 0;
+    return (size > VALUES_MAX) ? -1 : 0;
+}
+
+static int setupEncodeDataTmpl(int size) {
+    return (setupEncodeData(size) == 0) ? LiveBooster_msg_template_data(&setOfData) : -1;
+}
+
+static size_t opEncodeData(void) {
+    const char* msg = LiveBooster_msg_encode_data(&setOfData);
+    return msg ? strlen(msg) : 0;
+}
+
+/* ===> Configuration parameters <=== */
+
+static char paramNames[PARAMS_MAX][NAME_SZ];
+static int32_t paramI32[PARAMS_MAX];
+static uint32_t paramU32[PARAMS_MAX];
+static float paramF32[PARAMS_MAX];
+static char paramStr[PARAMS_MAX][NAME_SZ];
+static LiveBooster_Param_t params[PARAMS_MAX];
+static LiveBooster_ArrayOfParams_t arrayOfParams;
+static LiveBooster_SetOfParams_t setParam;
+static LiveBooster_SetofUpdatedParams_t setUpdatedParam;
+static char cfgMsg[PARAMS_MAX * 64 + 64];
+static int cfgLen;
+
+static int benchParam(const LiveBooster_Param_t* param_ptr, const void* val_ptr, int val_len) {
+    (void)param_ptr;
+    (void)val_ptr;
+    (void)val_len;
+    return 0;
+}
+
+/* Attach "nb" parameters : int32, uint32, float and string in turn */
+static int attachParams(int nb) {
+    int i;
+    for (i = 0; i < nb; i++) {
+        LiveBooster_Data_t* d = &params[i].parm_data;
+        snprintf(paramNames[i], NAME_SZ, "param_%d", i);
+        paramI32[i] = -1000 * i - 7;
+        paramU32[i] = 3600 * i + 60;
+        paramF32[i] = 0.25f * i + 19.5f;
+        snprintf(paramStr[i], NAME_SZ, "mode_%d", i);
+        params[i].parm_uref = i;
+        d->data_name = paramNames[i];
+        d->data_dim = 1;
+        switch (i % 4) {
+        case 0:
+            d->data_type = LB_TYPE_INT32;
+            d->data_value = &paramI32[i];
+            break;
+        case 1:
+            d->data_type = LB_TYPE_UINT32;
+            d->data_value = &paramU32[i];
+            break;
+        case 2:
+            d->data_type = LB_TYPE_FLOAT;
+            d->data_value = &paramF32[i];
+            break;
+        default:
+            d->data_type = LB_TYPE_STRING_C;
+            d->data_value = paramStr[i];
+            d->data_dim = NAME_SZ;
+            break;
+        }
+    }
+    arrayOfParams.param_ptr = params;
+    arrayOfParams.param_nb = nb;
+    setParam.param_set = arrayOfParams;
+    setParam.param_callback = benchParam;
+    return LiveBooster_msg_index_params(&setParam, &setUpdatedParam, params, nb);
+}
+
+static int setupEncodeParams(int size) {
+    return ((size > PARAMS_MAX) || attachParams(size)) ? -1 : 0;
+}
+
+static size_t opEncodeParams(void) {
+    const char* msg = LiveBooster_msg_encode_params_all(&arrayOfParams, 1234);
+    return msg ? strlen(msg) : 0;
+}
+
+static int setupDecodeParams(int size) {
+    static const char* types[4] = { "i32", "u32", "f64", "str" };
+    int i;
+
+    if ((size > PARAMS_MAX) || attachParams(PARAMS_MAX)) {
+        return -1;
+    }
+    /* the updated parameters are spread over the set */
+    cfgLen = sprintf(cfgMsg, "{\"cfg\":{");
+    for (i = 0; i < size; i++) {
+        int p = (i * PARAMS_MAX) / size;
+        cfgLen += sprintf(cfgMsg + cfgLen, "%s\"%s\":{\"t\":\"%s\",\"v\":", i ? "," : "", paramNames[p], types[p % 4]);
+        cfgLen += sprintf(cfgMsg + cfgLen, ((p % 4) == 3) ? "\"auto_%d\"}" : ((p % 4) == 2) ? "%d.75}" : "%d}", p + 10);
+    }
+    cfgLen += sprintf(cfgMsg + cfgLen, "},\"cid\":1}");
+    return ((LiveBooster_msg_decode_params_req(cfgMsg, cfgLen, &setParam, &setUpdatedParam) != 0)
+            || (setUpdatedParam.nb_of_params != size)) ? -1 : 0;
+}
+
+static size_t opDecodeParams(void) {
+    return (LiveBooster_msg_decode_params_req(cfgMsg, cfgLen, &setParam, &setUpdatedParam) == 0) ? (size_t)cfgLen : 0;
+}
+
+/* ===> Commands <=== */
+
+static LiveBooster_Command_t commands[] = {
+    { 1, "reboot", 0 }, { 2, "reset", 0 }, { 3, "start", 0 }, { 4, "stop", 0 }, { 5, "configure", 0 }
+};
+static LiveBooster_SetofCommands_t setCmd;
+static char cmdMsg[ARGS_MAX * 48 + 64];
+static int cmdLen;
+
+static int benchCommand(const LiveBooster_CommandRequestBlock_t* pCmdReqBlk) {
+    return (pCmdReqBlk->hd.cmd_ptr == &commands[4]) ? 0 : -1;
+}
+
+static int setupDecodeCmd(int size) {
+    int32_t cid;
+    int i;
+
+    if (size > ARGS_MAX) {
+        return -1;
+    }
+    setCmd.cmd_ptr = commands;
+    setCmd.cmd_nb = sizeof(commands) / sizeof(commands[0]);
+    setCmd.cmd_callback = benchCommand;
+    if (LiveBooster_msg_index_names(setCmd.cmd_index, 2 * LB_MAX_OF_COMMANDS, commands, sizeof(LiveBooster_Command_t),
+                                    offsetof(LiveBooster_Command_t, cmd_name), setCmd.cmd_nb)) {
+        return -1;
+    }
+    cmdLen = sprintf(cmdMsg, "{\"req\":\"configure\",\"arg\":{");
+    for (i = 0; i < size; i++) {
+        cmdLen += sprintf(cmdMsg + cmdLen, (i % 2) ? "%s\"label_%d\":\"zone %d\"" : "%s\"delay_%d\":%d",
+                          i ? "," : "", i, 100 * i + 5);
+    }
+    cmdLen += sprintf(cmdMsg + cmdLen, "},\"cid\":2}");
+    return LiveBooster_msg_decode_cmd_req(cmdMsg, cmdLen, &setCmd, &cid);
+}
+
+static size_t opDecodeCmd(void) {
+    int32_t cid;
+    return (LiveBooster_msg_decode_cmd_req(cmdMsg, cmdLen, &setCmd, &cid) == 0) ? (size_t)cmdLen : 0;
+}
+
+/* ===> Resources <=== */
+
+static LiveBooster_Resource_t resources[] = {
+    { 1, "firmware", "1.0", 4 }, { 2, "config", "1.0", 4 }, { 3, "image", "1.0", 4 }
+};
+static LiveBooster_SetOfResources_t setRsc;
+static LiveBooster_SetOfUpdatedResource_t setUpdatedRsc;
+static char rscMsg[256];
+static int rscLen;
+
+static int setupDecodeRsc(int size) {
+    char uri[80];
+    int32_t cid;
+    int len;
+
+    if ((size < 16) || (size >= (int)sizeof(uri))) {
+        return -1;
+    }
+    setRsc.rsc_ptr = resources;
+    setRsc.rsc_nb = sizeof(resources) / sizeof(resources[0]);
+    if (LiveBooster_msg_index_names(setRsc.rsc_index, 2 * LB_MAX_OF_RESOURCES, resources, sizeof(LiveBooster_Resource_t),
+                                    offsetof(LiveBooster_Resource_t, rsc_name), setRsc.rsc_nb)) {
+        return -1;
+    }
+    len = sprintf(uri, "http://lo/rsc/");
+    while (len < size) {
+        uri[len] = 'a' + (len % 26);
+        len++;
+    }
+    uri[len] = 0;
+    rscLen = sprintf(rscMsg, "{\"cid\":3,\"id\":\"firmware\",\"old\":\"1.0\",\"new\":\"2.0\","
+                     "\"m\":{\"size\":102400,\"uri\":\"%s\",\"md5\":\"0123456789abcdef0123456789abcdef\"}}", uri);
+    setUpdatedRsc.ursc_cid = 0;
+    return (LiveBooster_msg_decode_rsc_req(rscMsg, rscLen, &setRsc, &setUpdatedRsc, &cid) == RSC_RSP_OK) ? 0 : -1;
+}
+
+static size_t opDecodeRsc(void) {
+    int32_t cid;
+    setUpdatedRsc.ursc_cid = 0;
+    return (LiveBooster_msg_decode_rsc_req(rscMsg, rscLen, &setRsc, &setUpdatedRsc, &cid) == RSC_RSP_OK) ? (size_t)rscLen : 0;
+}
+
+/* ===> MQTT publication <=== */
+
+static unsigned char mqttBuf[DATA_MAX + 128];
+static int mqttLen;
+static MQTTString topic = MQTTString_initializer;
+
+static int setupSerialize(int size) {
+    if (size > DATA_MAX) {
+        return -1;
+    }
+    dataLen = size;
+    topic.cstring = "dev/data";
+    mqttLen = MQTTSerialize_publish(mqttBuf, sizeof(mqttBuf), 0, 0, 0, 0, topic, data, dataLen);
+    return (mqttLen > 0) ? 0 : -1;
+}
+
+static size_t opSerialize(void) {
+    int len = MQTTSerialize_publish(mqttBuf, sizeof(mqttBuf), 0, 0, 0, 0, topic, data, dataLen);
+    return (len > 0) ? (size_t)len : 0;
+}
+
+static size_t opDeserialize(void) {
+    unsigned char dup;
+    int qos;
+    unsigned char retained;
+    unsigned short packetid;
+    MQTTString topicName;
+    unsigned char* payload;
+    int payloadlen;
+
+    return (MQTTDeserialize_publish(&dup, &qos, &retained, &packetid, &topicName, &payload, &payloadlen,
+                                    mqttBuf, mqttLen) == 1) ? (size_t)mqttLen : 0;
+}
+
+/* ===> GsmFifo <=== */
+
+static GsmFifo fifo;
+
+static int setupFifo(int size) {
+    GsmFifo_Clear(&fifo);
+    dataLen = size;
+    return (size < FIFO_SIZE) && (GsmFifo_Write(&fifo, data, size) == size) ? 0 : -1;
+}
+
+/* The FIFO is emptied by moving its indexes back : only the function under test runs */
+static size_t opFifoPut(void) {
+    int n = 0;
+    int i;
+    fifo._r = 0;
+    fifo._w = 0;
+    for (i = 0; i < dataLen; i++) {
+        n += GsmFifo_Put(&fifo, data[i]);
+    }
+    return n;
+}
+
+static size_t opFifoGet(void) {
+    unsigned char out[FIFO_SIZE];
+    fifo._r = 0;
+    fifo._w = dataLen;
+    return GsmFifo_Get(&fifo, out, dataLen);
+}
+
+/* ===> Base64 <=== */
+
+static char b64Text[(DATA_MAX + 2) / 3 * 4 + 1];
+static char b64Out[DATA_MAX + 3];  /* b64_decode() requires room for whole quanta */
+static int b64Len;
+
+static int setupB64(int size) {
+    if (size > DATA_MAX) {
+        return -1;
+    }
+    dataLen = size;
+    b64_encode((const char*)data, b64Text, dataLen);
+    b64Len = strlen(b64Text);
+    return ((b64_decode(b64Text, b64Len, b64Out, sizeof(b64Out)) == dataLen) && !memcmp(b64Out, data, dataLen)) ? 0 : -1;
+}
+
+static size_t opB64Encode(void) {
+    b64_encode((const char*)data, b64Text, dataLen);
+    return dataLen;
+}
+
+static size_t opB64Decode(void) {
+    return (b64_decode(b64Text, b64Len, b64Out, sizeof(b64Out)) == dataLen) ? (size_t)b64Len : 0;
+}
+
+/* ===> MD5 <=== */
+
+static md5_context_t md5;
+
+static int setupMd5(int size) {
+    dataLen = size;
+    MD5Init(&md5);
+    return (size > MD5_CHUNK_MAX) ? -1 : 0;
+}
+
+static size_t opMd5Update(void) {
+    MD5Update(&md5, data, dataLen);
+    return dataLen;
+}
+
+/* ===> Benchmark <=== */
+
+typedef struct {
+    const char* name;
+    int (*setup)(int size);  /* prepare the input of "size" : return 0, or not 0 if it can not be run */
+    size_t (*op)(void);      /* one operation : return the bytes produced or consumed, 0 on error */
+    int sizesNb;
+    int sizes[SIZES_MAX];
+} BenchCase;
+
+static const BenchCase cases[] = {
+    { "encode_data", setupEncodeData, opEncodeData, 3, { 1, 16, 100 } },
+    { "encode_data_tmpl", setupEncodeDataTmpl, opEncodeData, 3, { 1, 16, 100 } },
+    { "encode_params_all", setupEncodeParams, opEncodeParams, 3, { 4, 16, 28 } },
+    { "decode_params_req", setupDecodeParams, opDecodeParams, 3, { 1, 8, 32 } },
+    { "decode_cmd_req", setupDecodeCmd, opDecodeCmd, 3, { 0, 4, 16 } },
+    { "decode_rsc_req", setupDecodeRsc, opDecodeRsc, 2, { 16, 64 } },
+    { "MQTTSerialize_publish", setupSerialize, opSerialize, 4, { 16, 256, 1024, 4096 } },
+    { "MQTTDeserialize_publish", setupSerialize, opDeserialize, 4, { 16, 256, 1024, 4096 } },
+    { "GsmFifo_Put", setupFifo, opFifoPut, 3, { 1, 16, 63 } },
+    { "GsmFifo_Get", setupFifo, opFifoGet, 3, { 1, 16, 63 } },
+    { "b64_encode", setupB64, opB64Encode, 3, { 16, 256, 4096 } },
+    { "b64_decode", setupB64, opB64Decode, 3, { 16, 256, 4096 } },
+    { "MD5Update", setupMd5, opMd5Update, 3, { 64, 1024, 16384 } }
+};
+
+/* Run "n" operations : return the elapsed time in ns, and the bytes of the last one */
+static unsigned long long runOps(const BenchCase* c, long n, size_t* bytes) {
+    volatile size_t sink = 0;
+    unsigned long long t0 = nowNs();
+    long i;
+    for (i = 0; i < n; i++) {
+        sink = c->op();
+    }
+    t0 = nowNs() - t0;
+    *bytes = sink;
+    return t0;
+}
+
+static int runCase(const BenchCase* c, int size, int targetMs, int runs) {
+    unsigned long long targetNs = (unsigned long long)targetMs * 1000000ULL;
+    unsigned long long elapsed;
+    double best = 0;
+    size_t bytes;
+    long n = 1;
+    int r;
+
+    if (c->setup(size) || (c->op() == 0)) {
+        fprintf(stderr, "%s : setup failed for size %d\n", c->name, size);
+        return -1;
+    }
+    /* calibration : about a tenth of the target duration */
+    while (((elapsed = runOps(c, n, &bytes)) < targetNs / 10) && (n < (1L << 30))) {
+        n *= 2;
+    }
+    if (elapsed) {
+        n = (long)((double)n * targetNs / elapsed);
+    }
+    if (n < 1) {
+        n = 1;
+    }
+    for (r = 0; r < runs; r++) {
+        double ns = (double)runOps(c, n, &bytes) / n;
+        if ((r == 0) || (ns < best)) {
+            best = ns;
+        }
+    }
+    if (bytes == 0) {
+        fprintf(stderr, "%s : operation failed for size %d\n", c->name, size);
+        return -1;
+    }
+    printf("%s\t%d\t%ld\t%.1f\t%u\n", c->name, size, n, best, (unsigned)bytes);
+    fflush(stdout);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = NULL;
+    unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+    int targetMs = 100;
+    int runs = 3;
+    int ret = 0;
+    unsigned int i;
+    int s;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:r:f:")) != -1) {
+        if (opt == 't') {
+            targetMs = atoi(optarg);
+        }
+        else if (opt == 'r') {
+            runs = atoi(optarg);
+        }
+        else if (opt == 'f') {
+            filter = optarg;
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-t milliseconds] [-r runs] [-f name]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (targetMs < 1) {
+        targetMs = 1;
+    }
+    if (runs < 1) {
+        runs = 1;
+    }
+    msgDebug = &benchDebug;
+    for (i = 0; i < sizeof(data); i++) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        data[i] = (unsigned char)(seed >> 56);
+    }
+
+    printf("case\tsize\titerations\tns_per_op\tbytes_per_op\n");
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (filter && !strstr(cases[i].name, filter)) {
+            continue;
+        }
+        for (s = 0; s < cases[i].sizesNb; s++) {
+            if (runCase(&cases[i], cases[i].sizes[s], targetMs, runs)) {
+                ret = 1;
+            }
+        }
+    }
+    return ret;
+}
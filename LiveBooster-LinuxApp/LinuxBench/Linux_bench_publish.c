@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === Publish benchmark ===
+ *
+ * End-to-end measure of LiveBooster_PushData() without hardware :
+ *  LiveBooster library -> pseudo-terminal -> Heracles emulator -> TCP -> local MQTT broker stub.
+ *
+ * Usage : Linux_bench_publish [-n messages] [-p text_bytes] [-b baud] [-l latency_us] [-a accept_us] [-q] [-r drop_every]
+ *                             [-s persistence_file] [-t] [-m] [-j trace.json] [-v]
+ *  -p : add a text of that length to the data set (larger publications)
+ *  -q : data published in QoS 1 (in flight until their PUBACK, LiveBooster_SetDataQos), all acknowledged at the end
+ *  -r : with -q, the broker drops the connection instead of acknowledging every drop_every-th message :
+ *       the benchmark connects again, the messages in flight are sent again (DUP flag) and still all acknowledged
+ *       (not with -t : in transparent mode, the modem reports the lost connection within the data)
+ *  -s : with -q, the messages in flight are also kept in that file (LiveBooster_SetPersistence), those left
+ *       by a previous run are sent again first
+ *  -a : delay of the "DATA ACCEPT" of each AT+CIPSEND (time for the modem to hand the data to the network)
+ *  -t : MQTT over a transparent connection (AT+CIPMODE=1)
+ *  -m : 27.010 multiplexer (AT+CMUX=0), AT commands and MQTT on separate channels
+ *  -j : spans of the pipeline written in the Chrome trace format (chrome://tracing, Perfetto)
+ *
+ * Reported values : published messages per second, p50/p99 latency of LiveBooster_PushData()
+ * and serial bytes (both directions) per message.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "BenchPlatform.h"
+#include "../LinuxImpl/LinuxTraceImpl.h"
+#include "../LinuxImpl/LinuxPersistenceImpl.h"
+
+/* ===> DATA <=== */
+
+static char deviceId[] = "urn:lo:nsid:LiveBooster:bench";
+
+static uint32_t measures_counter = 0;
+static int32_t  measures_temp = 20;
+static float    measures_volt = 5.0;
+static char     measures_text[1024];
+
+static LiveBooster_Data_t set_measures[] = {
+    { LB_TYPE_UINT32, "counter" ,        &measures_counter, 1 },
+    { LB_TYPE_INT32,  "temperature" ,    &measures_temp, 1 },
+    { LB_TYPE_FLOAT,  "battery_level" ,  &measures_volt, 1 },
+    { LB_TYPE_STRING_C, "text" ,         measures_text, 1 }      /* with -p only */
+};
+#define SET_MEASURES_NB (sizeof(set_measures) / sizeof(LiveBooster_Data_t))
+
+/* ===> Benchmark <=== */
+
+static BenchPlatform platform;
+static unsigned long acked;
+static unsigned long ackFailures;
+static unsigned long reconnections;
+
+static void dataAck(uint16_t msg_id, int result) {
+    (void)msg_id;
+    if (result == 0) {
+        acked++;
+    }
+    else {
+        ackFailures++;
+    }
+}
+
+/* Connection dropped by the broker (-r) : connect again, the messages in flight leave with the CONNACK */
+static int benchReconnect(void) {
+    int ret = -1;
+    int i;
+
+    for (i = 0; (i < 3) && (ret != 0); i++) {
+        ret = LiveBooster_Connect();
+    }
+    if (ret == 0) {
+        reconnections++;
+    }
+    return ret;
+}
+
+int main(int argc, char* argv[]) {
+    MqttBrokerStubStats brokerStats;
+    LiveBooster_Stats_t stats;
+    unsigned long long* latencies;
+    unsigned long long start, elapsed;
+    unsigned long long waitStart, waitUs;
+    int failed = 0;
+    unsigned long bytesIn, bytesOut, writes;
+    unsigned long cipsend;
+    int count = 100;
+    int handle;
+    int ret;
+    int i;
+    int opt;
+    int transparent = 0;
+    int multiplexing = 0;
+    int qos = 0;
+    unsigned long dropEvery = 0;
+    const char* persistencePath = NULL;
+    int restored = 0;
+    unsigned long windowFull = 0;
+    const char* tracePath = NULL;
+    int textLen = 0;
+
+    BenchPlatform__Config(&platform);
+    while ((opt = getopt(argc, argv, "n:p:b:l:a:j:r:s:qtmv")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'p':
+                textLen = atoi(optarg);
+                break;
+            case 'b':
+                platform.emuConfig.baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                platform.emuConfig.cmdLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                platform.emuConfig.acceptLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 'q':
+                qos = 1;
+                break;
+            case 'r':
+                dropEvery = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                persistencePath = optarg;
+                break;
+            case 't':
+                transparent = 1;
+                break;
+            case 'm':
+                multiplexing = 1;
+                break;
+            case 'j':
+                tracePath = optarg;
+                break;
+            case 'v':
+                benchVerbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n messages] [-p text_bytes] [-b baud] [-l latency_us] [-a accept_us] [-q] [-r drop_every]"
+                        " [-s persistence_file] [-t] [-m] [-j trace.json] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (count <= 0) {
+        count = 1;
+    }
+    if (!qos) {
+        dropEvery = 0;
+        persistencePath = NULL;
+    }
+    if (dropEvery && transparent) {
+        fprintf(stderr, "-r is not available with -t\n");
+        return 1;
+    }
+    latencies = (unsigned long long*)calloc(count, sizeof(*latencies));
+    if ((latencies == NULL) || !BenchPlatform__Start(&platform)) {
+        return 1;
+    }
+
+    /* 1 - LiveBooster session */
+    LiveBooster_Init(deviceId, 0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL, &benchSerial, &benchTimer, &benchDebug);
+    if (tracePath != NULL) {
+        if (linuxTraceOpen(tracePath) != 0) {
+            fprintf(stderr, "Cannot write %s\n", tracePath);
+            return 1;
+        }
+        LiveBooster_SetTrace(&linuxTraceImpl);
+    }
+    LiveBooster_SetTransparentMode(transparent);
+    if (LiveBooster_SetMultiplexing(multiplexing) != 0) {
+        fprintf(stderr, "Multiplexer not built (GSM_MUX_ENABLE)\n");
+        return 1;
+    }
+    LiveBooster_SetDataQos(qos, dataAck);
+    if (persistencePath != NULL) {
+        if (linuxPersistenceOpen(persistencePath) != 0) {
+            fprintf(stderr, "Cannot open %s\n", persistencePath);
+            return 1;
+        }
+        restored = LiveBooster_SetPersistence(&linuxPersistenceImpl);
+    }
+    if (textLen > (int)sizeof(measures_text) - 1) {
+        textLen = sizeof(measures_text) - 1;
+    }
+    memset(measures_text, 'x', (textLen > 0) ? textLen : 0);
+    handle = LiveBooster_AttachData("bench", "bench_v0", NULL, NULL, NULL, set_measures,
+                                    (textLen > 0) ? SET_MEASURES_NB : SET_MEASURES_NB - 1);
+    ret = LiveBooster_Connect();
+    if (ret != 0) {
+        fprintf(stderr, "LiveBooster_Connect failed (%d)\n", ret);
+        return 1;
+    }
+
+    MqttBrokerStub__DropEvery(&platform.broker, dropEvery);
+
+    /* 2 - Timed publications */
+    bytesIn = benchSerialBytesIn;
+    bytesOut = benchSerialBytesOut;
+    writes = benchSerialWrites;
+    cipsend = platform.emu.stats.cipsend;
+    LiveBooster_ResetStats();
+    start = BenchPlatform__NowUs();
+    for (i = 0; i < count; i++) {
+        unsigned long long t0 = BenchPlatform__NowUs();
+        measures_counter++;
+        ret = LiveBooster_PushData(handle);
+        while (ret < 0) {
+            if (ret == ERR_MQTT_INFLIGHT_FULL) {
+                /* QoS 1 window full : the PUBACK are matched by the cycle */
+                windowFull++;
+                ret = LiveBooster_Cycle(1);
+            }
+            else if ((dropEvery == 0) || ((ret = benchReconnect()) != 0)) {
+                break;
+            }
+            if (ret == 0) {
+                ret = LiveBooster_PushData(handle);
+            }
+        }
+        latencies[i] = BenchPlatform__NowUs() - t0;
+        if (ret < 0) {
+            fprintf(stderr, "LiveBooster_PushData failed (%d) at message %d\n", ret, i);
+            count = i;
+            failed = 1;
+            break;
+        }
+    }
+    /* QoS 1 : the last PUBACK (and those of the restored messages) */
+    while (qos && (acked + ackFailures < (unsigned long)(count + restored))) {
+        if ((LiveBooster_Cycle(10) != 0) && ((dropEvery == 0) || (benchReconnect() != 0))) {
+            break;
+        }
+    }
+
+    /* The clock stops once the broker has all the messages : LiveBooster_PushData() returns when its bytes are
+       written to the serial line (in transparent mode, no AT+CIPSEND answer to wait for). Time allowed : twice the
+       transmission of what was written at the emulated baud rate, plus 2 s. */
+    waitUs = 2000000ULL;
+    if (platform.emuConfig.baudRate > 0) {
+        waitUs += 2ULL * (benchSerialBytesOut - bytesOut) * 10ULL * 1000000ULL / platform.emuConfig.baudRate;
+    }
+    waitStart = BenchPlatform__NowUs();
+    do {
+        MqttBrokerStub__GetStats(&platform.broker, &brokerStats);
+        if (brokerStats.publishes >= (unsigned long)count) {
+            break;
+        }
+        usleep(1000);
+    } while (BenchPlatform__NowUs() - waitStart < waitUs);
+    elapsed = BenchPlatform__NowUs() - start;
+    bytesIn = benchSerialBytesIn - bytesIn;
+    bytesOut = benchSerialBytesOut - bytesOut;
+    writes = benchSerialWrites - writes;
+    cipsend = platform.emu.stats.cipsend - cipsend;
+    LiveBooster_GetStats(&stats);
+    if (brokerStats.publishes < (unsigned long)count) {
+        fprintf(stderr, "FAILED : the broker received %lu of the %d messages within %llu ms\n",
+                brokerStats.publishes, count, waitUs / 1000);
+        failed = 1;
+    }
+
+    if (count > 0) {
+        printf("messages          : %d (broker received %lu)\n", count, brokerStats.publishes);
+        printf("baud rate         : %lu\n", platform.emuConfig.baudRate);
+        printf("transport         : %s%s\n", transparent ? "transparent" : "AT+CIPSEND/CIPRXGET",
+               multiplexing ? ", 27.010 multiplexer" : "");
+        if (qos) {
+            printf("QoS 1             : %lu acknowledged, %lu failed, window full %lu times, PUBACK p50 %lu ms, p99 %lu ms\n",
+                   acked, ackFailures, windowFull, StatsHistogram_Percentile(&stats.mqtt.pubackLatency, 50),
+                   StatsHistogram_Percentile(&stats.mqtt.pubackLatency, 99));
+        }
+        if (dropEvery || persistencePath) {
+            printf("reconnections     : %lu (broker dropped %lu), %d restored, %lu sent again after connecting,"
+                   " broker received %lu DUP\n", reconnections, brokerStats.drops, restored, stats.mqtt.resends,
+                   brokerStats.duplicates);
+        }
+        printf("msgs/sec          : %.1f\n", count * 1000000.0 / elapsed);
+        printf("latency p50 (us)  : %llu\n", BenchPlatform__Percentile(latencies, count, 50));
+        printf("latency p99 (us)  : %llu\n", BenchPlatform__Percentile(latencies, count, 99));
+        printf("serial bytes/msg  : %.1f (out %.1f, in %.1f)\n",
+               (double)(bytesIn + bytesOut) / count, (double)bytesOut / count, (double)bytesIn / count);
+        printf("serial writes/msg : %.1f\n", (double)writes / count);
+        printf("CIPSEND/msg       : %.2f\n", (double)cipsend / count);
+        printf("library stats     : CIPSEND %lu (rtt p50 %lu ms, p99 %lu ms), serial out %lu in %lu,"
+               " publish to send p99 %lu ms, JSON encoding p50 %lu us\n",
+               stats.modem.commands[AT_FAMILY_CIPSEND],
+               StatsHistogram_Percentile(&stats.modem.rtt[AT_FAMILY_CIPSEND], 50),
+               StatsHistogram_Percentile(&stats.modem.rtt[AT_FAMILY_CIPSEND], 99),
+               stats.modem.serialOut, stats.modem.serialIn,
+               StatsHistogram_Percentile(&stats.mqtt.publishToSend, 99),
+               StatsHistogram_Percentile(&stats.client.json_encode, 50));
+        if (multiplexing) {
+            printf("multiplexer lost  : %lu bytes\n", stats.modem.muxLost);
+        }
+    }
+
+    LiveBooster_SetTrace(NULL);
+    linuxTraceClose();
+    BenchPlatform__Stop(&platform);
+    free(latencies);
+    return failed;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === Receive benchmark ===
+ *
+ * End-to-end measure of the downlink path without hardware : the local MQTT broker stub
+ * sends commands (topic "dev/cmd") while the application runs LiveBooster_Cycle().
+ *
+ * Usage : Linux_bench_receive [-n commands] [-k burst] [-s pad_bytes] [-b baud] [-l latency_us] [-t] [-m] [-j trace.json] [-v]
+ *  -k : commands sent at once by the broker (their responses are coalesced in one AT+CIPSEND)
+ *  -s : padding argument added to the commands, for messages larger than the MQTT receive buffer
+ *  -t : MQTT over a transparent connection (AT+CIPMODE=1)
+ *  -m : 27.010 multiplexer (AT+CMUX=0), AT commands and MQTT on separate channels
+ *  -j : spans of the pipeline written in the Chrome trace format (chrome://tracing, Perfetto)
+ *
+ * Reported values : p50/p99 latency between the sending of a command by the broker and
+ * the call of the command callback, p50/p99 round trip until the broker receives the command
+ * response ("dev/cmd/res"), serial bytes and AT commands per received command.
+ * With a burst, the latency and round trip are measured from the first command until the last one.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "BenchPlatform.h"
+#include "../LinuxImpl/LinuxTraceImpl.h"
+
+#define CMD_TIMEOUT_US  5000000ULL
+#define CMD_PAD_MAX     4096
+
+/* ===> COMMANDS <=== */
+
+static char deviceId[] = "urn:lo:nsid:LiveBooster:bench";
+
+static LiveBooster_Command_t set_commands[] = {
+    { 1, "ping", 0 }
+};
+#define SET_COMMANDS_NB (sizeof(set_commands) / sizeof(LiveBooster_Command_t))
+
+static volatile int lastCid = 0;
+
+static int benchCommand(const LiveBooster_CommandRequestBlock_t *pCmdReqBlk) {
+    lastCid = pCmdReqBlk->hd.cmd_cid;
+    return 0;
+}
+
+/* ===> Benchmark <=== */
+
+static BenchPlatform platform;
+
+int main(int argc, char* argv[]) {
+    MqttBrokerStubStats brokerStats;
+    unsigned long long* latencies;
+    unsigned long long* roundTrips;
+    unsigned long bytesIn, bytesOut;
+    unsigned long atCommands, ciprxget, ciprxgetPoll, cipsend;
+    unsigned long packets, sends, packets0, sends0;
+    int count = 50;
+    int burst = 1;
+    int pad = 0;
+    char* payload;
+    int received = 0;
+    int ret;
+    int i;
+    int opt;
+    int transparent = 0;
+    int multiplexing = 0;
+    const char* tracePath = NULL;
+
+    BenchPlatform__Config(&platform);
+    while ((opt = getopt(argc, argv, "n:k:s:b:l:j:tmv")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'k':
+                burst = atoi(optarg);
+                break;
+            case 's':
+                pad = atoi(optarg);
+                break;
+            case 'b':
+                platform.emuConfig.baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                platform.emuConfig.cmdLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                transparent = 1;
+                break;
+            case 'm':
+                multiplexing = 1;
+                break;
+            case 'j':
+                tracePath = optarg;
+                break;
+            case 'v':
+                benchVerbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n commands] [-k burst] [-s pad_bytes] [-b baud] [-l latency_us] [-t] [-m] [-j trace.json] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (count <= 0) {
+        count = 1;
+    }
+    if (burst <= 0) {
+        burst = 1;
+    }
+    if ((pad < 0) || (pad > CMD_PAD_MAX)) {
+        pad = (pad < 0) ? 0 : CMD_PAD_MAX;
+    }
+    latencies = (unsigned long long*)calloc(count, sizeof(*latencies));
+    roundTrips = (unsigned long long*)calloc(count, sizeof(*roundTrips));
+    payload = (char*)malloc(pad + 64);
+    if ((latencies == NULL) || (roundTrips == NULL) || (payload == NULL) || !BenchPlatform__Start(&platform)) {
+        return 1;
+    }
+
+    /* 1 - LiveBooster session */
+    LiveBooster_Init(deviceId, 0x0123456789ABCDEFULL, 0xFEDCBA9876543210ULL, &benchSerial, &benchTimer, &benchDebug);
+    if (tracePath != NULL) {
+        if (linuxTraceOpen(tracePath) != 0) {
+            fprintf(stderr, "Cannot write %s\n", tracePath);
+            return 1;
+        }
+        LiveBooster_SetTrace(&linuxTraceImpl);
+    }
+    LiveBooster_SetTransparentMode(transparent);
+    if (LiveBooster_SetMultiplexing(multiplexing) != 0) {
+        fprintf(stderr, "Multiplexer not built (GSM_MUX_ENABLE)\n");
+        return 1;
+    }
+    LiveBooster_AttachCommands(set_commands, SET_COMMANDS_NB, benchCommand);
+    ret = LiveBooster_Connect();
+    if (ret != 0) {
+        fprintf(stderr, "LiveBooster_Connect failed (%d)\n", ret);
+        return 1;
+    }
+
+    /* 2 - Timed commands */
+    bytesIn = benchSerialBytesIn;
+    bytesOut = benchSerialBytesOut;
+    atCommands = platform.emu.stats.atCommands;
+    ciprxget = platform.emu.stats.ciprxget;
+    ciprxgetPoll = platform.emu.stats.ciprxgetPoll;
+    cipsend = platform.emu.stats.cipsend;
+    LiveBooster_GetSendStats(&packets0, &sends0);
+    for (i = 0; i < count; i += burst) {
+        int n = (count - i < burst) ? count - i : burst;
+        unsigned long long t0;
+        unsigned long published;
+        int j;
+
+        /* idle link between two commands */
+        LiveBooster_Cycle(20);
+
+        MqttBrokerStub__GetStats(&platform.broker, &brokerStats);
+        published = brokerStats.publishes;
+        t0 = BenchPlatform__NowUs();
+        for (j = 0; j < n; j++) {
+            int len;
+            if (pad > 0) {
+                len = sprintf(payload, "{\"req\":\"ping\",\"arg\":{\"pad\":\"%0*d\"},\"cid\":%d}", pad, 0, i + j + 1);
+            }
+            else {
+                len = sprintf(payload, "{\"req\":\"ping\",\"arg\":{},\"cid\":%d}", i + j + 1);
+            }
+            MqttBrokerStub__Publish(&platform.broker, "dev/cmd", payload, len);
+        }
+        while ((lastCid != i + n) && (BenchPlatform__NowUs() - t0 < CMD_TIMEOUT_US)) {
+            LiveBooster_Cycle(1);
+        }
+        if (lastCid != i + n) {
+            fprintf(stderr, "Command %d not received\n", i + n);
+            break;
+        }
+        latencies[received] = BenchPlatform__NowUs() - t0;
+
+        /* the responses are published by the library after the callbacks */
+        MqttBrokerStub__GetStats(&platform.broker, &brokerStats);
+        while ((brokerStats.publishes < published + n) && (BenchPlatform__NowUs() - t0 < CMD_TIMEOUT_US)) {
+            LiveBooster_Cycle(1);
+            MqttBrokerStub__GetStats(&platform.broker, &brokerStats);
+        }
+        roundTrips[received] = BenchPlatform__NowUs() - t0;
+        for (j = 1; j < n; j++) {
+            latencies[received + j] = latencies[received];
+            roundTrips[received + j] = roundTrips[received];
+        }
+        received += n;
+    }
+    bytesIn = benchSerialBytesIn - bytesIn;
+    bytesOut = benchSerialBytesOut - bytesOut;
+    atCommands = platform.emu.stats.atCommands - atCommands;
+    ciprxget = platform.emu.stats.ciprxget - ciprxget;
+    ciprxgetPoll = platform.emu.stats.ciprxgetPoll - ciprxgetPoll;
+    cipsend = platform.emu.stats.cipsend - cipsend;
+    LiveBooster_GetSendStats(&packets, &sends);
+    packets -= packets0;
+    sends -= sends0;
+
+    if (received > 0) {
+        printf("commands          : %d\n", received);
+        printf("baud rate         : %lu\n", platform.emuConfig.baudRate);
+        printf("command size      : %d bytes\n", (int)strlen(payload));
+        printf("transport         : %s%s\n", transparent ? "transparent" : "AT+CIPSEND/CIPRXGET",
+               multiplexing ? ", 27.010 multiplexer" : "");
+        printf("latency p50 (us)  : %llu\n", BenchPlatform__Percentile(latencies, received, 50));
+        printf("latency p99 (us)  : %llu\n", BenchPlatform__Percentile(latencies, received, 99));
+        printf("round trip p50 (us): %llu\n", BenchPlatform__Percentile(roundTrips, received, 50));
+        printf("round trip p99 (us): %llu\n", BenchPlatform__Percentile(roundTrips, received, 99));
+        printf("serial bytes/cmd  : %.1f (out %.1f, in %.1f)\n",
+               (double)(bytesIn + bytesOut) / received, (double)bytesOut / received, (double)bytesIn / received);
+        printf("AT commands/cmd   : %.2f (CIPRXGET=2 %.2f, CIPRXGET=4 %.2f)\n", (double)atCommands / received,
+               (double)ciprxget / received, (double)ciprxgetPoll / received);
+        printf("CIPSEND/cmd       : %.2f (MQTT packets %lu, CIPSEND saved %lu)\n", (double)cipsend / received,
+               packets, packets - sends);
+    }
+
+    LiveBooster_SetTrace(NULL);
+    linuxTraceClose();
+    BenchPlatform__Stop(&platform);
+    free(latencies);
+    free(roundTrips);
+    free(payload);
+    return 0;
+}
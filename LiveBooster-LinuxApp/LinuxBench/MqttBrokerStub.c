@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "MqttBrokerStub.h"
+
+#define MQTT_CONNECT      1
+#define MQTT_PUBLISH      3
+#define MQTT_SUBSCRIBE    8
+#define MQTT_PINGREQ      12
+#define MQTT_DISCONNECT   14
+
+static void stubSend(MqttBrokerStub* stub, const unsigned char* data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(stub->client, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if ((n < 0) && (errno == EINTR)) {
+                continue;
+            }
+            return;
+        }
+        sent += n;
+    }
+}
+
+static void stubCloseClient(MqttBrokerStub* stub) {
+    if (stub->client >= 0) {
+        close(stub->client);
+    }
+    stub->client = -1;
+    stub->inLen = 0;
+}
+
+/* Process one control packet, "body" is the variable header and the payload */
+static void stubPacket(MqttBrokerStub* stub, unsigned char header, const unsigned char* body, size_t len) {
+    unsigned char ack[8 + 16];
+
+    pthread_mutex_lock(&stub->lock);
+    switch (header >> 4) {
+        case MQTT_CONNECT:
+            stub->stats.connects++;
+            ack[0] = 0x20; ack[1] = 2; ack[2] = 0; ack[3] = 0;
+            stubSend(stub, ack, 4);
+            break;
+
+        case MQTT_SUBSCRIBE: {
+            /* one granted QoS per topic filter */
+            size_t pos = 2;
+            size_t count = 0;
+            stub->stats.subscribes++;
+            ack[0] = 0x90;
+            ack[2] = body[0];
+            ack[3] = body[1];
+            while ((pos + 2 <= len) && (count < 16)) {
+                size_t topicLen = (body[pos] << 8) | body[pos + 1];
+                pos += 2 + topicLen;
+                if (pos >= len) {
+                    break;
+                }
+                ack[4 + count++] = body[pos++] & 0x03;
+            }
+            ack[1] = (unsigned char)(2 + count);
+            stubSend(stub, ack, 4 + count);
+            break;
+        }
+
+        case MQTT_PUBLISH: {
+            int qos = (header >> 1) & 0x03;
+            size_t topicLen = (len >= 2) ? (size_t)((body[0] << 8) | body[1]) : 0;
+            size_t offset = 2 + topicLen + ((qos > 0) ? 2 : 0);
+            stub->stats.publishes++;
+            if (header & 0x08) {
+                stub->stats.duplicates++;
+            }
+            if ((qos == 1) && !(header & 0x08) && stub->dropEvery && ((++stub->qos1Publishes % stub->dropEvery) == 0)) {
+                stub->stats.drops++;
+                pthread_mutex_unlock(&stub->lock);
+                stubCloseClient(stub);
+                return;
+            }
+            if (len >= offset) {
+                stub->stats.publishBytes += len - offset;
+            }
+            if ((qos == 1) && (len >= 4 + topicLen)) {
+                ack[0] = 0x40; ack[1] = 2; ack[2] = body[2 + topicLen]; ack[3] = body[3 + topicLen];
+                stubSend(stub, ack, 4);
+            }
+            break;
+        }
+
+        case MQTT_PINGREQ:
+            stub->stats.pings++;
+            ack[0] = 0xD0; ack[1] = 0;
+            stubSend(stub, ack, 2);
+            break;
+
+        case MQTT_DISCONNECT:
+            pthread_mutex_unlock(&stub->lock);
+            stubCloseClient(stub);
+            return;
+
+        default:
+            break;
+    }
+    pthread_mutex_unlock(&stub->lock);
+}
+
+/* Extract the complete packets from the input buffer */
+static void stubParse(MqttBrokerStub* stub) {
+    size_t pos = 0;
+
+    while (stub->client >= 0) {
+        size_t remaining = 0;
+        size_t multiplier = 1;
+        size_t i = pos + 1;
+        int complete = 0;
+
+        while (i < stub->inLen) {
+            unsigned char c = stub->in[i++];
+            remaining += (c & 0x7F) * multiplier;
+            multiplier <<= 7;
+            if ((c & 0x80) == 0) {
+                complete = 1;
+                break;
+            }
+        }
+        if (!complete || (i + remaining > stub->inLen)) {
+            break;
+        }
+        stubPacket(stub, stub->in[pos], stub->in + i, remaining);
+        pos = i + remaining;
+    }
+
+    if (stub->client < 0) {
+        return;
+    }
+    memmove(stub->in, stub->in + pos, stub->inLen - pos);
+    stub->inLen -= pos;
+    if (stub->inLen == sizeof(stub->in)) {
+        /* packet too large for the stub */
+        stubCloseClient(stub);
+    }
+}
+
+static void* stubThread(void* arg) {
+    MqttBrokerStub* stub = (MqttBrokerStub*)arg;
+
+    while (!stub->stopped) {
+        struct pollfd pfd;
+        pfd.fd = (stub->client >= 0) ? stub->client : stub->listenSock;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+
+        if (stub->client < 0) {
+            int one = 1;
+            stub->client = accept(stub->listenSock, NULL, NULL);
+            if (stub->client >= 0) {
+                setsockopt(stub->client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+        else {
+            ssize_t n = recv(stub->client, stub->in + stub->inLen, sizeof(stub->in) - stub->inLen, 0);
+            if (n <= 0) {
+                if ((n < 0) && (errno == EINTR)) {
+                    continue;
+                }
+                stubCloseClient(stub);
+                continue;
+            }
+            stub->inLen += n;
+            stubParse(stub);
+        }
+    }
+    return NULL;
+}
+
+int MqttBrokerStub__Start(MqttBrokerStub* stub) {
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    int one = 1;
+
+    memset(stub, 0, sizeof(*stub));
+    stub->client = -1;
+    stub->listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (stub->listenSock < 0) {
+        return 0;
+    }
+    setsockopt(stub->listenSock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if ((bind(stub->listenSock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+            || (listen(stub->listenSock, 1) != 0)
+            || (getsockname(stub->listenSock, (struct sockaddr*)&addr, &addrLen) != 0)) {
+        close(stub->listenSock);
+        return 0;
+    }
+    stub->port = ntohs(addr.sin_port);
+
+    pthread_mutex_init(&stub->lock, NULL);
+    if (pthread_create(&stub->thread, NULL, stubThread, stub) != 0) {
+        close(stub->listenSock);
+        return 0;
+    }
+    return 1;
+}
+
+int MqttBrokerStub__Publish(MqttBrokerStub* stub, const char* topic, const void* payload, size_t len) {
+    unsigned char packet[MQTT_BROKER_STUB_BUF_SZ];
+    size_t topicLen = strlen(topic);
+    size_t remaining = 2 + topicLen + len;
+    size_t pos = 1;
+    int ok = 0;
+
+    if (remaining + 5 > sizeof(packet)) {
+        return 0;
+    }
+    packet[0] = MQTT_PUBLISH << 4;
+    do {
+        unsigned char c = remaining & 0x7F;
+        remaining >>= 7;
+        packet[pos++] = c | (remaining ? 0x80 : 0);
+    } while (remaining);
+    packet[pos++] = (unsigned char)(topicLen >> 8);
+    packet[pos++] = (unsigned char)topicLen;
+    memcpy(packet + pos, topic, topicLen);
+    pos += topicLen;
+    memcpy(packet + pos, payload, len);
+    pos += len;
+
+    pthread_mutex_lock(&stub->lock);
+    if (stub->client >= 0) {
+        stubSend(stub, packet, pos);
+        ok = 1;
+    }
+    pthread_mutex_unlock(&stub->lock);
+    return ok;
+}
+
+void MqttBrokerStub__DropEvery(MqttBrokerStub* stub, unsigned long publishes) {
+    pthread_mutex_lock(&stub->lock);
+    stub->dropEvery = publishes;
+    stub->qos1Publishes = 0;
+    pthread_mutex_unlock(&stub->lock);
+}
+
+void MqttBrokerStub__GetStats(MqttBrokerStub* stub, MqttBrokerStubStats* stats) {
+    pthread_mutex_lock(&stub->lock);
+    *stats = stub->stats;
+    pthread_mutex_unlock(&stub->lock);
+}
+
+void MqttBrokerStub__Stop(MqttBrokerStub* stub) {
+    stub->stopped = 1;
+    pthread_join(stub->thread, NULL);
+    stubCloseClient(stub);
+    close(stub->listenSock);
+    pthread_mutex_destroy(&stub->lock);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __MqttBrokerStub_h
+#define __MqttBrokerStub_h
+
+#include <pthread.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Minimal MQTT 3.1.1 broker serving one client on the loopback interface.
+ * CONNECT, SUBSCRIBE, PUBLISH (QoS 0/1) and PINGREQ are acknowledged,
+ * received PUBLISH are only counted. PUBLISH can be sent to the client.
+ * The connection can be dropped instead of acknowledging a QoS 1 PUBLISH (lost link).
+ */
+
+#define MQTT_BROKER_STUB_BUF_SZ  8192
+
+typedef struct _MqttBrokerStubStats {
+    unsigned long connects;
+    unsigned long subscribes;
+    unsigned long publishes;       /* PUBLISH received */
+    unsigned long publishBytes;    /* payload bytes of the PUBLISH received */
+    unsigned long pings;
+    unsigned long duplicates;      /* PUBLISH received with the DUP flag */
+    unsigned long drops;           /* connections dropped (MqttBrokerStub__DropEvery) */
+} MqttBrokerStubStats;
+
+typedef struct _MqttBrokerStub {
+    MqttBrokerStubStats stats;
+    unsigned short port;
+    int listenSock;
+    int client;
+    volatile int stopped;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    unsigned char in[MQTT_BROKER_STUB_BUF_SZ];
+    size_t inLen;
+    unsigned long dropEvery;
+    unsigned long qos1Publishes;
+} MqttBrokerStub;
+
+/**
+ * Listen on 127.0.0.1 (ephemeral port) and serve in a new thread.
+ * Return 1 on success, else 0.
+ */
+int MqttBrokerStub__Start(MqttBrokerStub* stub);
+
+/**
+ * Send a PUBLISH (QoS 0) to the connected client.
+ * Return 1 on success, 0 if no client is connected or the message is too large.
+ */
+int MqttBrokerStub__Publish(MqttBrokerStub* stub, const char* topic, const void* payload, size_t len);
+
+/**
+ * Drop the connection instead of acknowledging every "publishes"-th QoS 1 PUBLISH (0: never), DUP not counted.
+ */
+void MqttBrokerStub__DropEvery(MqttBrokerStub* stub, unsigned long publishes);
+
+/**
+ * Copy the current counters.
+ */
+void MqttBrokerStub__GetStats(MqttBrokerStub* stub, MqttBrokerStubStats* stats);
+
+/**
+ * Stop the server thread and close the sockets.
+ */
+void MqttBrokerStub__Stop(MqttBrokerStub* stub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1405 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/**
+ * Software emulation of the SIM800 modem of the Heracles shield.
+ *
+ * Only the AT dialect used by HeraclesModem.c is implemented:
+ * modem setup (AT, E0, &F0, +CFUN, +CPIN?, +CREG?, +SAPBR, +CGATT, +CSTT, +CIICR, +CIFSR, ...),
+ * the TCP/IP application (+CIPSTART, +CIPSEND, +CIPRXGET, +CIPSTATUS, +CIPCLOSE), its transparent
+ * mode (+CIPMODE=1, "+++" escape sequence, ATO), the HTTP application (+HTTPINIT, +HTTPACTION=0, +HTTPREAD)
+ * and the 27.010 multiplexer (+CMUX=0 : SABM, DISC, UIH, MSC, CLD), each DLC having its own command line.
+ * The TCP links are bridged to real sockets, optionally redirected to local endpoints.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "HeraclesEmu.h"
+
+#define EMU_NL "\r\n"
+
+#define EMU_MAX_PARAMS 8
+
+#define EMU_HTTP_MAX_BODY  (4 * 1024 * 1024)
+
+enum EmuResult {
+    EMU_RES_OK = 0,    /* command done, final "OK" to be sent */
+    EMU_RES_ERROR,     /* command failed, final "ERROR" to be sent */
+    EMU_RES_DONE       /* command has sent its own final result */
+};
+
+static unsigned long long emuNowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void emuSleepUs(unsigned long long us) {
+    struct timespec ts;
+    ts.tv_sec = us / 1000000ULL;
+    ts.tv_nsec = (us % 1000000ULL) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+/* Hold the caller while "len" bytes are transmitted at the emulated line rate */
+static void emuPace(HeraclesEmu* emu, unsigned long long* lineFreeUs, size_t len) {
+    unsigned long long now;
+    if (emu->config.baudRate == 0) {
+        return;
+    }
+    now = emuNowUs();
+    if (*lineFreeUs < now) {
+        *lineFreeUs = now;
+    }
+    /* 10 bits per byte: start bit, 8 data bits, stop bit */
+    *lineFreeUs += (unsigned long long)len * 10ULL * 1000000ULL / emu->config.baudRate;
+    if (*lineFreeUs > now) {
+        emuSleepUs(*lineFreeUs - now);
+    }
+}
+
+static void emuWriteRaw(HeraclesEmu* emu, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    size_t left = len;
+
+    while (left > 0) {
+        ssize_t n = write(emu->master, p, left);
+        if (n < 0) {
+            if ((errno == EAGAIN) || (errno == EINTR)) {
+                struct pollfd pfd = { emu->master, POLLOUT, 0 };
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return;
+        }
+        p += n;
+        left -= n;
+    }
+    emu->stats.serialOut += len;
+    emuPace(emu, &emu->lineFreeUs, len);
+}
+
+/* --------------------------------------------------------------------------------- */
+/* 27.010 multiplexer (basic option) */
+
+#define EMU_MUX_FLAG  0xF9
+#define EMU_MUX_EA    0x01
+#define EMU_MUX_CR    0x02
+#define EMU_MUX_PF    0x10
+#define EMU_MUX_SABM  0x2F
+#define EMU_MUX_UA    0x63
+#define EMU_MUX_DM    0x0F
+#define EMU_MUX_DISC  0x43
+#define EMU_MUX_UIH   0xEF
+#define EMU_MUX_MSG_CLD  0xC1
+#define EMU_MUX_MSG_MSC  0xE1
+
+enum EmuMuxState {
+    EMU_MUX_HUNT = 0, EMU_MUX_ADDR, EMU_MUX_CTRL, EMU_MUX_LEN, EMU_MUX_LEN2, EMU_MUX_INFO, EMU_MUX_FCS, EMU_MUX_END
+};
+
+static unsigned char emuMuxFcs(const unsigned char* p, size_t len) {
+    unsigned char fcs = 0xFF;
+    int i;
+    while (len--) {
+        fcs ^= *p++;
+        for (i = 0; i < 8; i++) {
+            fcs = (fcs & 1) ? (unsigned char)((fcs >> 1) ^ 0xE0) : (unsigned char)(fcs >> 1);
+        }
+    }
+    return (unsigned char)(0xFF - fcs);
+}
+
+/* Send one frame ("cr" : C/R bit of the address, 0 for the commands of the modem) */
+static void emuMuxFrame(HeraclesEmu* emu, int dlci, int cr, unsigned char ctrl, const unsigned char* data, size_t len) {
+    unsigned char frame[HERACLES_EMU_MUX_N1 + 7];
+    size_t n = 0;
+    size_t hdrLen = (len > 127) ? 4 : 3;
+
+    frame[n++] = EMU_MUX_FLAG;
+    frame[n++] = (unsigned char)((dlci << 2) | (cr ? EMU_MUX_CR : 0) | EMU_MUX_EA);
+    frame[n++] = ctrl;
+    if (hdrLen == 3) {
+        frame[n++] = (unsigned char)((len << 1) | EMU_MUX_EA);
+    }
+    else {
+        frame[n++] = (unsigned char)((len & 0x7F) << 1);
+        frame[n++] = (unsigned char)(len >> 7);
+    }
+    memcpy(frame + n, data, len);
+    n += len;
+    frame[n++] = emuMuxFcs(frame + 1, hdrLen);
+    frame[n++] = EMU_MUX_FLAG;
+    emuWriteRaw(emu, frame, n);
+}
+
+/* Output of the current channel : framed in multiplexer mode */
+static void emuWrite(HeraclesEmu* emu, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+
+    if (emu->config.verbose) {
+        fprintf(stderr, "EMU >> %.*s\n", (int)len, (const char*)data);
+    }
+    if (!emu->cmux) {
+        emuWriteRaw(emu, data, len);
+        return;
+    }
+    while (len > 0) {
+        size_t n = (len < HERACLES_EMU_MUX_N1) ? len : HERACLES_EMU_MUX_N1;
+        emuMuxFrame(emu, emu->ch->dlci, 0, EMU_MUX_UIH, p, n);
+        p += n;
+        len -= n;
+    }
+}
+
+static void emuPrintf(HeraclesEmu* emu, const char* format, ...) {
+    char buffer[256];
+    int len;
+    va_list ap;
+
+    va_start(ap, format);
+    len = vsnprintf(buffer, sizeof(buffer), format, ap);
+    va_end(ap);
+
+    if (len > 0) {
+        emuWrite(emu, buffer, (len < (int)sizeof(buffer)) ? (size_t)len : sizeof(buffer) - 1);
+    }
+}
+
+/* --------------------------------------------------------------------------------- */
+/* TCP links */
+
+static int emuLinkIsUp(const HeraclesEmuLink* link) {
+    return link->connected && !(link->remoteClosed && (link->rxLen == 0));
+}
+
+static void emuLinkClose(HeraclesEmuLink* link) {
+    if (link->sock >= 0) {
+        close(link->sock);
+    }
+    link->sock = -1;
+    link->connected = 0;
+    link->remoteClosed = 0;
+    link->notified = 0;
+    link->rxLen = 0;
+    link->acceptCount = 0;
+}
+
+static int emuLinkConnect(HeraclesEmu* emu, HeraclesEmuLink* link, const char* host, unsigned short port) {
+    const char* targetHost = host;
+    unsigned short targetPort = port;
+    struct addrinfo hints;
+    struct addrinfo* res = NULL;
+    struct addrinfo* ai;
+    char service[8];
+    int i;
+    int one = 1;
+
+    for (i = 0; i < emu->config.routeCount; i++) {
+        const HeraclesEmuRoute* route = &emu->config.routes[i];
+        if (!strcasecmp(route->host, host) && ((route->port == 0) || (route->port == port))) {
+            targetHost = route->localHost;
+            targetPort = route->localPort;
+            break;
+        }
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", targetPort);
+    if (getaddrinfo(targetHost, service, &hints, &res) != 0) {
+        return 0;
+    }
+
+    link->sock = -1;
+    for (ai = res; ai != NULL; ai = ai->ai_next) {
+        int s = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (s < 0) {
+            continue;
+        }
+        if (connect(s, ai->ai_addr, ai->ai_addrlen) == 0) {
+            link->sock = s;
+            break;
+        }
+        close(s);
+    }
+    freeaddrinfo(res);
+
+    if (link->sock < 0) {
+        return 0;
+    }
+
+    setsockopt(link->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(link->sock, F_SETFL, fcntl(link->sock, F_GETFL) | O_NONBLOCK);
+
+    strncpy(link->host, host, sizeof(link->host) - 1);
+    link->host[sizeof(link->host) - 1] = 0;
+    link->port = port;
+    link->connected = 1;
+    link->remoteClosed = 0;
+    link->notified = 0;
+    link->rxLen = 0;
+    return 1;
+}
+
+static int emuLinkSend(HeraclesEmu* emu, HeraclesEmuLink* link, const unsigned char* data, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = send(link->sock, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if ((errno == EAGAIN) || (errno == EINTR)) {
+                struct pollfd pfd = { link->sock, POLLOUT, 0 };
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return 0;
+        }
+        sent += n;
+    }
+    emu->stats.tcpOut += len;
+    return 1;
+}
+
+static void emuLinkReceive(HeraclesEmu* emu, HeraclesEmuLink* link) {
+    ssize_t n = recv(link->sock, link->rx + link->rxLen, sizeof(link->rx) - link->rxLen, 0);
+    if (n > 0) {
+        link->rxLen += n;
+        emu->stats.tcpIn += n;
+    }
+    else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+        link->remoteClosed = 1;
+    }
+}
+
+static size_t emuLinkTake(HeraclesEmuLink* link, unsigned char* out, size_t size) {
+    size_t n = (size < link->rxLen) ? size : link->rxLen;
+    memcpy(out, link->rx, n);
+    memmove(link->rx, link->rx + n, link->rxLen - n);
+    link->rxLen -= n;
+    if (link->rxLen == 0) {
+        link->notified = 0;
+    }
+    return n;
+}
+
+/* Send the pending unsolicited result codes, only between two commands */
+static void emuSendUrc(HeraclesEmu* emu) {
+    int mux;
+    for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+        HeraclesEmuLink* link = &emu->links[mux];
+        if (!link->connected) {
+            continue;
+        }
+        while (link->acceptCount && (link->acceptUs[0] <= emuNowUs())) {
+            if (emu->cipmux) {
+                emuPrintf(emu, EMU_NL "DATA ACCEPT:%d,%d" EMU_NL, mux, (int)link->acceptLen[0]);
+            }
+            else {
+                emuPrintf(emu, EMU_NL "DATA ACCEPT:%d" EMU_NL, (int)link->acceptLen[0]);
+            }
+            link->acceptCount--;
+            memmove(link->acceptUs, link->acceptUs + 1, link->acceptCount * sizeof(link->acceptUs[0]));
+            memmove(link->acceptLen, link->acceptLen + 1, link->acceptCount * sizeof(link->acceptLen[0]));
+        }
+        if (link->rxLen && !link->notified) {
+            link->notified = 1;
+            if (emu->ciprxgetManual) {
+                if (emu->cipmux) {
+                    emuPrintf(emu, EMU_NL "+CIPRXGET: 1,%d" EMU_NL, mux);
+                }
+                else {
+                    emuPrintf(emu, EMU_NL "+CIPRXGET: 1" EMU_NL);
+                }
+                emu->stats.urc++;
+            }
+        }
+        if (link->remoteClosed && (link->notified != 2) && (link->rxLen == 0)) {
+            link->notified = 2;
+            if (emu->cipmux) {
+                emuPrintf(emu, EMU_NL "%d, CLOSED" EMU_NL, mux);
+            }
+            else {
+                emuPrintf(emu, EMU_NL "CLOSED" EMU_NL);
+            }
+            emu->stats.urc++;
+            emuLinkClose(link);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------- */
+/* AT command interpreter */
+
+/* Split "a,"b",c" into parameters (quotes removed). Return the number of parameters. */
+static int emuSplitParams(char* args, char* params[], int maxParams) {
+    int count = 0;
+    char* p = args;
+
+    while ((*p != 0) && (count < maxParams)) {
+        char* out;
+        while (*p == ' ') {
+            p++;
+        }
+        params[count++] = p;
+        out = p;
+        if (*p == '"') {
+            p++;
+            while ((*p != 0) && (*p != '"')) {
+                *out++ = *p++;
+            }
+            if (*p == '"') {
+                p++;
+            }
+            while ((*p != 0) && (*p != ',')) {
+                p++;
+            }
+        }
+        else {
+            while ((*p != 0) && (*p != ',')) {
+                out++;
+                p++;
+            }
+        }
+        if (*p == ',') {
+            p++;
+        }
+        *out = 0;
+    }
+    return count;
+}
+
+/* Return the mux designated by the first parameter (multi-IP mode) or 0 */
+static int emuGetMux(HeraclesEmu* emu, char* params[], int count, int* first) {
+    int mux = 0;
+    *first = 0;
+    if (emu->cipmux) {
+        if (count < 1) {
+            return -1;
+        }
+        mux = atoi(params[0]);
+        *first = 1;
+    }
+    if ((mux < 0) || (mux >= HERACLES_EMU_LINK_COUNT)) {
+        return -1;
+    }
+    return mux;
+}
+
+static enum EmuResult emuCipStart(HeraclesEmu* emu, char* args) {
+    char* params[EMU_MAX_PARAMS];
+    int count = emuSplitParams(args, params, EMU_MAX_PARAMS);
+    int first;
+    int mux = emuGetMux(emu, params, count, &first);
+    HeraclesEmuLink* link;
+
+    if ((mux < 0) || (count < first + 3) || strcasecmp(params[first], "TCP")) {
+        return EMU_RES_ERROR;
+    }
+    link = &emu->links[mux];
+    if (link->connected && !link->remoteClosed) {
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "%d, ALREADY CONNECT" EMU_NL, mux);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "ALREADY CONNECT" EMU_NL);
+        }
+        return EMU_RES_DONE;
+    }
+
+    if (emu->cipmode && emu->cipmux) {
+        return EMU_RES_ERROR;
+    }
+
+    emuLinkClose(link);  /* closed by the peer, not by AT+CIPCLOSE: its unread data is lost */
+    emuPrintf(emu, EMU_NL "OK" EMU_NL);
+    if (emuLinkConnect(emu, link, params[first + 1], (unsigned short)atoi(params[first + 2]))) {
+        if (emu->cipmode) {
+            /* transparent mode : data mode at once */
+            emuPrintf(emu, EMU_NL "CONNECT" EMU_NL);
+            emu->ch->dataMode = 1;
+            emu->ch->escPlus = 0;
+            emu->ch->lastInUs = emuNowUs();
+        }
+        else if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "%d, CONNECT OK" EMU_NL, mux);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "CONNECT OK" EMU_NL);
+        }
+    }
+    else {
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "%d, CONNECT FAIL" EMU_NL, mux);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "CONNECT FAIL" EMU_NL);
+        }
+    }
+    return EMU_RES_DONE;
+}
+
+static enum EmuResult emuCipSend(HeraclesEmu* emu, char* args) {
+    char* params[EMU_MAX_PARAMS];
+    int count = emuSplitParams(args, params, EMU_MAX_PARAMS);
+    int first;
+    int mux = emuGetMux(emu, params, count, &first);
+    int len;
+
+    emu->stats.cipsend++;
+    if (emu->cipmode || (mux < 0) || (count < first + 1) || !emuLinkIsUp(&emu->links[mux])) {
+        return EMU_RES_ERROR;
+    }
+    len = atoi(params[first]);
+    if ((len <= 0) || (len > HERACLES_EMU_MAX_SEND)) {
+        return EMU_RES_ERROR;
+    }
+
+    emu->ch->sendMux = mux;
+    emu->ch->sendLen = len;
+    emu->ch->sendGot = 0;
+    emuPrintf(emu, EMU_NL "> ");
+    return EMU_RES_DONE;
+}
+
+static void emuCipSendDone(HeraclesEmu* emu) {
+    int mux = emu->ch->sendMux;
+    int ok = emuLinkSend(emu, &emu->links[mux], emu->ch->sendBuf, emu->ch->sendLen);
+
+    if (emu->config.verbose) {
+        fprintf(stderr, "EMU << (%d bytes)\n", (int)emu->ch->sendLen);
+    }
+
+    if (!ok) {
+        /* the peer is gone: reported as CLOSED once the received data is read */
+        emu->links[mux].remoteClosed = 1;
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "%d, SEND FAIL" EMU_NL, mux);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "SEND FAIL" EMU_NL);
+        }
+    }
+    else if (emu->cipqsend && emu->config.acceptLatencyUs
+            && (emu->links[mux].acceptCount < HERACLES_EMU_ACCEPT_COUNT)) {
+        /* reported by emuSendUrc() once the data is "on the air" */
+        HeraclesEmuLink* link = &emu->links[mux];
+        link->acceptUs[link->acceptCount] = emuNowUs() + emu->config.acceptLatencyUs;
+        link->acceptLen[link->acceptCount] = emu->ch->sendLen;
+        link->acceptCount++;
+    }
+    else if (emu->cipqsend) {
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "DATA ACCEPT:%d,%d" EMU_NL, mux, (int)emu->ch->sendLen);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "DATA ACCEPT:%d" EMU_NL, (int)emu->ch->sendLen);
+        }
+    }
+    else {
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "%d, SEND OK" EMU_NL, mux);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "SEND OK" EMU_NL);
+        }
+    }
+    emu->ch->sendLen = 0;
+    emu->ch->sendGot = 0;
+}
+
+static enum EmuResult emuCipRxGet(HeraclesEmu* emu, char* args) {
+    char* params[EMU_MAX_PARAMS];
+    int count = emuSplitParams(args, params, EMU_MAX_PARAMS);
+    int mode;
+    int first;
+    int mux;
+    HeraclesEmuLink* link;
+
+    if (count < 1) {
+        return EMU_RES_ERROR;
+    }
+    mode = atoi(params[0]);
+    if ((mode == 0) || (mode == 1)) {
+        emu->ciprxgetManual = mode;
+        return EMU_RES_OK;
+    }
+
+    mux = emuGetMux(emu, params + 1, count - 1, &first);
+    first++;
+    if (mux < 0) {
+        return EMU_RES_ERROR;
+    }
+    link = &emu->links[mux];
+
+    if (mode == 4) {
+        emu->stats.ciprxgetPoll++;
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "+CIPRXGET: 4,%d,%d" EMU_NL, mux, (int)link->rxLen);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "+CIPRXGET: 4,%d" EMU_NL, (int)link->rxLen);
+        }
+        return EMU_RES_OK;
+    }
+
+    if ((mode == 2) || (mode == 3)) {
+        unsigned char data[HERACLES_EMU_MAX_RXGET];
+        int size = (count > first) ? atoi(params[first]) : 0;
+        size_t n;
+
+        emu->stats.ciprxget++;
+        if ((size <= 0) || (mode == 3)) {
+            return EMU_RES_ERROR;
+        }
+        if (size > HERACLES_EMU_MAX_RXGET) {
+            size = HERACLES_EMU_MAX_RXGET;
+        }
+        n = emuLinkTake(link, data, size);
+        if (emu->cipmux) {
+            emuPrintf(emu, EMU_NL "+CIPRXGET: 2,%d,%d,%d" EMU_NL, mux, (int)n, (int)link->rxLen);
+        }
+        else {
+            emuPrintf(emu, EMU_NL "+CIPRXGET: 2,%d,%d" EMU_NL, (int)n, (int)link->rxLen);
+        }
+        if (n) {
+            emuWrite(emu, data, n);
+        }
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        return EMU_RES_DONE;
+    }
+    return EMU_RES_ERROR;
+}
+
+static const char* emuLinkState(const HeraclesEmuLink* link) {
+    if (emuLinkIsUp(link)) {
+        return "CONNECTED";
+    }
+    return (link->host[0] != 0) ? "CLOSED" : "INITIAL";
+}
+
+static enum EmuResult emuCipStatus(HeraclesEmu* emu, char* args) {
+    int mux;
+    emu->stats.cipstatus++;
+
+    if (args != NULL) {
+        HeraclesEmuLink* link;
+        mux = atoi(args);
+        if ((mux < 0) || (mux >= HERACLES_EMU_LINK_COUNT)) {
+            return EMU_RES_ERROR;
+        }
+        link = &emu->links[mux];
+        emuPrintf(emu, EMU_NL "+CIPSTATUS: %d,0,\"TCP\",\"%s\",\"%u\",\"%s\"" EMU_NL,
+                  mux, link->host, link->port, emuLinkState(link));
+        return EMU_RES_OK;
+    }
+
+    emuPrintf(emu, EMU_NL "OK" EMU_NL EMU_NL "STATE: IP PROCESSING" EMU_NL);
+    for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+        HeraclesEmuLink* link = &emu->links[mux];
+        emuPrintf(emu, EMU_NL "C: %d,0,\"TCP\",\"%s\",\"%u\",\"%s\"" EMU_NL,
+                  mux, link->host, link->port, emuLinkState(link));
+    }
+    return EMU_RES_DONE;
+}
+
+/* The transparent connection is closed from another channel (multiplexer mode) */
+static void emuLeaveDataMode(HeraclesEmu* emu) {
+    int c;
+    for (c = 0; c < HERACLES_EMU_CHANNEL_COUNT; c++) {
+        emu->channels[c].dataMode = 0;
+        emu->channels[c].escPlus = 0;
+    }
+}
+
+static enum EmuResult emuCipClose(HeraclesEmu* emu, char* args) {
+    int mux = (emu->cipmux && args) ? atoi(args) : 0;
+    if ((mux < 0) || (mux >= HERACLES_EMU_LINK_COUNT) || !emu->links[mux].connected) {
+        return EMU_RES_ERROR;
+    }
+    emuLinkClose(&emu->links[mux]);
+    emuLeaveDataMode(emu);
+    if (emu->cipmux) {
+        emuPrintf(emu, EMU_NL "%d, CLOSE OK" EMU_NL, mux);
+    }
+    else {
+        emuPrintf(emu, EMU_NL "CLOSE OK" EMU_NL);
+    }
+    return EMU_RES_DONE;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* HTTP application */
+
+static void emuHttpFree(HeraclesEmu* emu) {
+    free(emu->httpBody);
+    emu->httpBody = NULL;
+    emu->httpLen = 0;
+}
+
+/* Blocking GET of emu->httpUrl ("http://host[:port]/path"). Return the HTTP status, 6xx on network error. */
+static int emuHttpGet(HeraclesEmu* emu) {
+    static HeraclesEmuLink link;
+    char host[HERACLES_EMU_HOST_SZ];
+    char request[512];
+    unsigned short port = 80;
+    const char* p = emu->httpUrl;
+    const char* path;
+    const char* end;
+    unsigned char* response = NULL;
+    size_t len = 0;
+    int status = 0;
+    size_t hostLen;
+
+    emuHttpFree(emu);
+    if (!strncasecmp(p, "http://", 7)) {
+        p += 7;
+    }
+    path = strchr(p, '/');
+    if (path == NULL) {
+        path = "/";
+        end = p + strlen(p);
+    }
+    else {
+        end = path;
+    }
+    hostLen = end - p;
+    if (memchr(p, ':', hostLen)) {
+        const char* colon = (const char*)memchr(p, ':', hostLen);
+        port = (unsigned short)atoi(colon + 1);
+        hostLen = colon - p;
+    }
+    if (hostLen >= sizeof(host)) {
+        return 603;  /* DNS error */
+    }
+    memcpy(host, p, hostLen);
+    host[hostLen] = 0;
+
+    memset(&link, 0, sizeof(link));
+    link.sock = -1;
+    if (!emuLinkConnect(emu, &link, host, port)) {
+        return 601;  /* network error */
+    }
+    snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", path, host);
+    if (!emuLinkSend(emu, &link, (const unsigned char*)request, strlen(request))) {
+        emuLinkClose(&link);
+        return 601;
+    }
+
+    /* read the whole response */
+    response = (unsigned char*)malloc(EMU_HTTP_MAX_BODY);
+    while (response && (len < EMU_HTTP_MAX_BODY)) {
+        struct pollfd pfd = { link.sock, POLLIN, 0 };
+        ssize_t n;
+        if (poll(&pfd, 1, 10000) <= 0) {
+            break;
+        }
+        n = recv(link.sock, response + len, EMU_HTTP_MAX_BODY - len, 0);
+        if (n <= 0) {
+            if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR))) {
+                continue;
+            }
+            break;
+        }
+        len += n;
+        emu->stats.tcpIn += n;
+    }
+    emuLinkClose(&link);
+
+    if (response && (sscanf((const char*)response, "HTTP/%*d.%*d %d", &status) == 1)) {
+        unsigned char* body = (unsigned char*)memmem(response, len, "\r\n\r\n", 4);
+        if (body) {
+            body += 4;
+            emu->httpLen = len - (body - response);
+            memmove(response, body, emu->httpLen);
+            emu->httpBody = response;
+            return status;
+        }
+    }
+    free(response);
+    return 601;
+}
+
+static enum EmuResult emuHttpCommand(HeraclesEmu* emu, const char* cmd, char* args) {
+    char* params[EMU_MAX_PARAMS];
+    int count = args ? emuSplitParams(args, params, EMU_MAX_PARAMS) : 0;
+
+    if (!strcasecmp(cmd, "+HTTPINIT")) {
+        if (emu->httpInit) {
+            return EMU_RES_ERROR;
+        }
+        emu->httpInit = 1;
+        emu->httpUrl[0] = 0;
+        return EMU_RES_OK;
+    }
+    if (!emu->httpInit) {
+        return EMU_RES_ERROR;
+    }
+    if (!strcasecmp(cmd, "+HTTPTERM")) {
+        emu->httpInit = 0;
+        emuHttpFree(emu);
+        return EMU_RES_OK;
+    }
+    if (!strcasecmp(cmd, "+HTTPPARA") && (count >= 2)) {
+        if (!strcasecmp(params[0], "URL")) {
+            strncpy(emu->httpUrl, params[1], sizeof(emu->httpUrl) - 1);
+            emu->httpUrl[sizeof(emu->httpUrl) - 1] = 0;
+        }
+        return EMU_RES_OK;
+    }
+    if (!strcasecmp(cmd, "+HTTPACTION") && (count >= 1) && (atoi(params[0]) == 0)) {
+        int status;
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        status = emuHttpGet(emu);
+        emuPrintf(emu, EMU_NL "+HTTPACTION: 0,%d,%lu" EMU_NL, status, (unsigned long)emu->httpLen);
+        return EMU_RES_DONE;
+    }
+    if (!strcasecmp(cmd, "+HTTPREAD")) {
+        size_t start = (count >= 2) ? strtoul(params[0], NULL, 10) : 0;
+        size_t size = (count >= 2) ? strtoul(params[1], NULL, 10) : emu->httpLen;
+        size_t n = 0;
+        emu->stats.httpReads++;
+        if (start < emu->httpLen) {
+            n = emu->httpLen - start;
+            if (n > size) {
+                n = size;
+            }
+        }
+        emuPrintf(emu, EMU_NL "+HTTPREAD: %lu" EMU_NL, (unsigned long)n);
+        if (n) {
+            emuWrite(emu, emu->httpBody + start, n);
+        }
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        return EMU_RES_DONE;
+    }
+    return EMU_RES_ERROR;
+}
+
+/* --------------------------------------------------------------------------------- */
+/* Transparent mode */
+
+/* Serial input in data mode : forwarded to link 0, except a "+++" preceded by a silence */
+static void emuDataInput(HeraclesEmu* emu, const unsigned char* data, size_t len) {
+    unsigned long long now = emuNowUs();
+    unsigned long long guardUs = (emu->config.escapeGuardMs ? emu->config.escapeGuardMs : 1000) * 1000ULL;
+    unsigned char out[512 + 3];
+    size_t outLen = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        unsigned char c = data[i];
+        if ((c == '+') && (emu->ch->escPlus < 3) && ((emu->ch->escPlus > 0) || (now - emu->ch->lastInUs >= guardUs))) {
+            emu->ch->escPlus++;
+            continue;
+        }
+        while (emu->ch->escPlus) {
+            out[outLen++] = '+';
+            emu->ch->escPlus--;
+        }
+        out[outLen++] = c;
+        if (outLen >= sizeof(out) - 3) {
+            emuLinkSend(emu, &emu->links[0], out, outLen);
+            outLen = 0;
+        }
+    }
+    if (outLen) {
+        emuLinkSend(emu, &emu->links[0], out, outLen);
+    }
+    emu->ch->lastInUs = now;
+}
+
+/* Data mode of the current channel : TCP data to the line, escape sequence and remote closing */
+static void emuDataMode(HeraclesEmu* emu) {
+    HeraclesEmuLink* link = &emu->links[0];
+    unsigned char data[4 * HERACLES_EMU_MUX_N1];
+    unsigned long long guardUs = (emu->config.escapeGuardMs ? emu->config.escapeGuardMs : 1000) * 1000ULL;
+
+    if ((emu->ch->escPlus == 3) && (emuNowUs() - emu->ch->lastInUs >= guardUs)) {
+        emu->ch->escPlus = 0;
+        emu->ch->dataMode = 0;
+        emu->stats.escapes++;
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        return;
+    }
+    if (link->rxLen && !emu->ch->flowOff) {
+        if (emu->cmux) {
+            /* a few frames at a time, so that a flow control of the host is seen in time */
+            size_t n = emuLinkTake(link, data, sizeof(data));
+            emuWrite(emu, data, n);
+        }
+        else {
+            emuWrite(emu, link->rx, link->rxLen);
+            link->rxLen = 0;
+        }
+    }
+    if (link->remoteClosed && (link->rxLen == 0)) {
+        emu->ch->dataMode = 0;
+        emuPrintf(emu, EMU_NL "CLOSED" EMU_NL);
+        emu->stats.urc++;
+        emuLinkClose(link);
+    }
+}
+
+/* Channels of the serial line (cmux = 0) or of the multiplexer */
+static void emuResetChannels(HeraclesEmu* emu, int cmux) {
+    int c;
+    memset(emu->channels, 0, sizeof(emu->channels));
+    for (c = 0; c < HERACLES_EMU_CHANNEL_COUNT; c++) {
+        emu->channels[c].dlci = c;
+    }
+    emu->channels[0].open = !cmux;
+    emu->cmux = cmux;
+    emu->muxState = EMU_MUX_HUNT;
+    emu->ch = &emu->channels[cmux ? 1 : 0];
+}
+
+/* Process one command of a command line ("+CIPSEND=0,10", "E0", ...) */
+static enum EmuResult emuCommand(HeraclesEmu* emu, char* cmd, int isLast) {
+    char* args = strchr(cmd, '=');
+    if (args != NULL) {
+        *args++ = 0;
+    }
+
+    if (!strcasecmp(cmd, "E0")) {
+        emu->echo = 0;
+    }
+    else if (!strcasecmp(cmd, "E1")) {
+        emu->echo = 1;
+    }
+    else if (!strcasecmp(cmd, "&F0") || !strcasecmp(cmd, "&F")) {
+        emu->echo = 1;
+    }
+    else if (!strcasecmp(cmd, "+CPIN?")) {
+        emuPrintf(emu, EMU_NL "+CPIN: READY" EMU_NL);
+    }
+    else if (!strcasecmp(cmd, "+CREG?")) {
+        emuPrintf(emu, EMU_NL "+CREG: 0,1" EMU_NL);
+    }
+    else if (!strcasecmp(cmd, "+CSQ")) {
+        emuPrintf(emu, EMU_NL "+CSQ: 20,0" EMU_NL);
+    }
+    else if (!strcasecmp(cmd, "+SAPBR") && args && !strcmp(args, "2,1")) {
+        emuPrintf(emu, EMU_NL "+SAPBR: 1,1,\"10.0.0.2\"" EMU_NL);
+    }
+    else if (!strcasecmp(cmd, "+CIFSR")) {
+        emuPrintf(emu, EMU_NL "10.0.0.2" EMU_NL);
+        if (isLast) {
+            return EMU_RES_DONE;
+        }
+    }
+    else if (!strcasecmp(cmd, "+CIPMUX") && args) {
+        emu->cipmux = atoi(args);
+    }
+    else if (!strcasecmp(cmd, "+CIPMODE") && args) {
+        emu->cipmode = atoi(args);
+    }
+    else if (!strcasecmp(cmd, "O")) {
+        /* ATO : back to data mode */
+        if (!emu->cipmode || !emu->links[0].connected) {
+            emuPrintf(emu, EMU_NL "NO CARRIER" EMU_NL);
+            return EMU_RES_DONE;
+        }
+        emuPrintf(emu, EMU_NL "CONNECT" EMU_NL);
+        emu->ch->dataMode = 1;
+        emu->ch->escPlus = 0;
+        emu->ch->lastInUs = emuNowUs();
+        return EMU_RES_DONE;
+    }
+    else if (!strcasecmp(cmd, "+CMUX") && args) {
+        /* basic option only : the multiplexer starts after the "OK" */
+        if (emu->cmux || (atoi(args) != 0)) {
+            return EMU_RES_ERROR;
+        }
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+        emuResetChannels(emu, 1);
+        return EMU_RES_DONE;
+    }
+    else if (!strncasecmp(cmd, "+HTTP", 5)) {
+        return emuHttpCommand(emu, cmd, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPQSEND") && args) {
+        emu->cipqsend = atoi(args);
+    }
+    else if (!strcasecmp(cmd, "+CIPSTART") && args) {
+        return emuCipStart(emu, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPSEND") && args) {
+        return emuCipSend(emu, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPRXGET") && args) {
+        return emuCipRxGet(emu, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPSTATUS")) {
+        return emuCipStatus(emu, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPCLOSE")) {
+        return emuCipClose(emu, args);
+    }
+    else if (!strcasecmp(cmd, "+CIPSHUT")) {
+        int mux;
+        for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+            emuLinkClose(&emu->links[mux]);
+            emu->links[mux].host[0] = 0;
+        }
+        emuLeaveDataMode(emu);
+        emuPrintf(emu, EMU_NL "SHUT OK" EMU_NL);
+        return EMU_RES_DONE;
+    }
+    /* any other setting (+CFUN, +CLTS, +CGACT, +CGATT, +CSTT, +CIICR, +CDNSCFG, +SSLOPT, +CIPSSL,
+     * ...) is accepted as is */
+    return EMU_RES_OK;
+}
+
+static void emuCommandLine(HeraclesEmu* emu, char* line) {
+    char* cmds;
+    enum EmuResult res = EMU_RES_OK;
+
+    while ((*line == ' ') || (*line == '\n')) {
+        line++;
+    }
+    if (*line == 0) {
+        return;
+    }
+    if (emu->echo) {
+        emuPrintf(emu, "%s\r", line);
+    }
+    if (strncasecmp(line, "AT", 2)) {
+        emuPrintf(emu, EMU_NL "ERROR" EMU_NL);
+        return;
+    }
+
+    emu->stats.atCommands++;
+    if (emu->config.cmdLatencyUs) {
+        emuSleepUs(emu->config.cmdLatencyUs);
+    }
+
+    /* Split the command line on ';' (outside quotes) */
+    cmds = line + 2;
+    while (*cmds != 0) {
+        char* end = cmds;
+        int quoted = 0;
+        int isLast;
+        while ((*end != 0) && ((*end != ';') || quoted)) {
+            if (*end == '"') {
+                quoted = !quoted;
+            }
+            end++;
+        }
+        isLast = (*end == 0);
+        *end = 0;
+
+        res = emuCommand(emu, cmds, isLast);
+        if (res != EMU_RES_OK) {
+            break;
+        }
+        cmds = isLast ? end : end + 1;
+    }
+
+    if (res == EMU_RES_OK) {
+        emuPrintf(emu, EMU_NL "OK" EMU_NL);
+    }
+    else if (res == EMU_RES_ERROR) {
+        emuPrintf(emu, EMU_NL "ERROR" EMU_NL);
+    }
+}
+
+static void emuMuxInput(HeraclesEmu* emu, const unsigned char* data, size_t len);
+
+static void emuSerialInput(HeraclesEmu* emu, const unsigned char* data, size_t len) {
+    size_t i;
+    for (i = 0; i < len; i++) {
+        unsigned char c = data[i];
+
+        /* the host ends its command lines with CR LF : the LF is not part of the CIPSEND payload */
+        if (emu->ch->lineEnd) {
+            emu->ch->lineEnd = 0;
+            if (c == '\n') {
+                continue;
+            }
+        }
+
+        if (emu->ch->dataMode) {
+            emuDataInput(emu, data + i, len - i);
+            return;
+        }
+
+        if (emu->ch->sendLen) {
+            /* payload of AT+CIPSEND */
+            size_t n = emu->ch->sendLen - emu->ch->sendGot;
+            if (n > len - i) {
+                n = len - i;
+            }
+            memcpy(emu->ch->sendBuf + emu->ch->sendGot, data + i, n);
+            emu->ch->sendGot += n;
+            i += n - 1;
+            if (emu->ch->sendGot == emu->ch->sendLen) {
+                emuCipSendDone(emu);
+            }
+            continue;
+        }
+
+        if (c == '\r') {
+            emu->ch->line[emu->ch->lineLen] = 0;
+            if (emu->config.verbose) {
+                fprintf(stderr, "EMU << %s\n", emu->ch->line);
+            }
+            int cmux = emu->cmux;
+            emuCommandLine(emu, emu->ch->line);
+            emu->ch->lineLen = 0;
+            emu->ch->lineEnd = 1;
+            if (emu->cmux != cmux) {
+                /* AT+CMUX : the next bytes are frames */
+                emuMuxInput(emu, data + i + 1, len - i - 1);
+                return;
+            }
+        }
+        else if ((c == '\n') && (emu->ch->lineLen == 0)) {
+            continue;
+        }
+        else if (emu->ch->lineLen < sizeof(emu->ch->line) - 1) {
+            emu->ch->line[emu->ch->lineLen++] = c;
+        }
+    }
+}
+
+/* Message of the host on the control channel (DLCI 0) */
+static void emuMuxMessage(HeraclesEmu* emu, const unsigned char* msg, size_t len) {
+    unsigned char type;
+    size_t valueLen;
+    unsigned char response[8];
+
+    if (len < 2) {
+        return;
+    }
+    type = msg[0];
+    valueLen = msg[1] >> 1;
+    if (!(type & EMU_MUX_CR) || (valueLen > len - 2) || (valueLen > sizeof(response) - 2)) {
+        return;   /* responses of the host are not expected */
+    }
+    response[0] = type & ~EMU_MUX_CR;
+    memcpy(response + 1, msg + 1, valueLen + 1);
+    if ((type & ~EMU_MUX_CR) == EMU_MUX_MSG_MSC) {
+        if (valueLen >= 2) {
+            int dlci = msg[2] >> 2;
+            if (dlci < HERACLES_EMU_CHANNEL_COUNT) {
+                emu->channels[dlci].flowOff = (msg[3] & 0x02) != 0;
+            }
+        }
+        emuMuxFrame(emu, 0, 0, EMU_MUX_UIH, response, valueLen + 2);
+    }
+    else if ((type & ~EMU_MUX_CR) == EMU_MUX_MSG_CLD) {
+        emuMuxFrame(emu, 0, 0, EMU_MUX_UIH, response, valueLen + 2);
+        emuResetChannels(emu, 0);
+    }
+}
+
+static void emuMuxDispatch(HeraclesEmu* emu) {
+    int dlci = emu->muxHdr[0] >> 2;
+    unsigned char type = emu->muxHdr[1] & ~EMU_MUX_PF;
+
+    emu->stats.muxFrames++;
+    if (dlci >= HERACLES_EMU_CHANNEL_COUNT) {
+        emuMuxFrame(emu, dlci, 1, EMU_MUX_DM | EMU_MUX_PF, NULL, 0);
+        return;
+    }
+    switch (type) {
+        case EMU_MUX_SABM:
+            emu->channels[dlci].open = 1;
+            emuMuxFrame(emu, dlci, 1, EMU_MUX_UA | EMU_MUX_PF, NULL, 0);
+            break;
+        case EMU_MUX_DISC:
+            emuMuxFrame(emu, dlci, 1, EMU_MUX_UA | EMU_MUX_PF, NULL, 0);
+            if (dlci == 0) {
+                emuResetChannels(emu, 0);
+            }
+            else {
+                emu->channels[dlci].open = 0;
+            }
+            break;
+        case EMU_MUX_UIH:
+            if (dlci == 0) {
+                emuMuxMessage(emu, emu->muxInfo, emu->muxLen);
+            }
+            else if (emu->channels[dlci].open) {
+                emu->ch = &emu->channels[dlci];
+                emuSerialInput(emu, emu->muxInfo, emu->muxLen);
+            }
+            else {
+                emuMuxFrame(emu, dlci, 1, EMU_MUX_DM | EMU_MUX_PF, NULL, 0);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Serial input in multiplexer mode */
+static void emuMuxInput(HeraclesEmu* emu, const unsigned char* data, size_t len) {
+    size_t i;
+    for (i = 0; (i < len) && emu->cmux; i++) {
+        unsigned char c = data[i];
+        switch (emu->muxState) {
+            case EMU_MUX_HUNT:
+                if (c == EMU_MUX_FLAG) {
+                    emu->muxState = EMU_MUX_ADDR;
+                }
+                break;
+            case EMU_MUX_ADDR:
+                if (c != EMU_MUX_FLAG) {
+                    emu->muxHdr[0] = c;
+                    emu->muxState = EMU_MUX_CTRL;
+                }
+                break;
+            case EMU_MUX_CTRL:
+                emu->muxHdr[1] = c;
+                emu->muxState = EMU_MUX_LEN;
+                break;
+            case EMU_MUX_LEN:
+                emu->muxHdr[2] = c;
+                emu->muxHdrLen = 3;
+                emu->muxLen = c >> 1;
+                emu->muxGot = 0;
+                if (!(c & EMU_MUX_EA)) {
+                    emu->muxState = EMU_MUX_LEN2;
+                }
+                else {
+                    emu->muxState = emu->muxLen ? EMU_MUX_INFO : EMU_MUX_FCS;
+                }
+                break;
+            case EMU_MUX_LEN2:
+                emu->muxHdr[3] = c;
+                emu->muxHdrLen = 4;
+                emu->muxLen |= (size_t)c << 7;
+                if (emu->muxLen > sizeof(emu->muxInfo)) {
+                    emu->muxState = EMU_MUX_HUNT;
+                }
+                else {
+                    emu->muxState = emu->muxLen ? EMU_MUX_INFO : EMU_MUX_FCS;
+                }
+                break;
+            case EMU_MUX_INFO: {
+                size_t n = emu->muxLen - emu->muxGot;
+                if (n > len - i) {
+                    n = len - i;
+                }
+                memcpy(emu->muxInfo + emu->muxGot, data + i, n);
+                emu->muxGot += n;
+                i += n - 1;
+                if (emu->muxGot == emu->muxLen) {
+                    emu->muxState = EMU_MUX_FCS;
+                }
+                break;
+            }
+            case EMU_MUX_FCS:
+                emu->muxState = (c == emuMuxFcs(emu->muxHdr, emu->muxHdrLen)) ? EMU_MUX_END : EMU_MUX_HUNT;
+                break;
+            case EMU_MUX_END:
+                emu->muxState = EMU_MUX_HUNT;
+                if (c == EMU_MUX_FLAG) {
+                    emu->muxState = EMU_MUX_ADDR;
+                    emuMuxDispatch(emu);
+                }
+                break;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------- */
+/* public API */
+
+int HeraclesEmu__AddRoute(HeraclesEmuConfig* config, const char* host, unsigned short port,
+                          const char* localHost, unsigned short localPort) {
+    HeraclesEmuRoute* route;
+    if (config->routeCount >= HERACLES_EMU_ROUTE_COUNT) {
+        return 0;
+    }
+    route = &config->routes[config->routeCount++];
+    strncpy(route->host, host, sizeof(route->host) - 1);
+    route->host[sizeof(route->host) - 1] = 0;
+    route->port = port;
+    strncpy(route->localHost, localHost, sizeof(route->localHost) - 1);
+    route->localHost[sizeof(route->localHost) - 1] = 0;
+    route->localPort = localPort;
+    return 1;
+}
+
+int HeraclesEmu__Open(HeraclesEmu* emu, const HeraclesEmuConfig* config) {
+    struct termios tty;
+    const char* name;
+    int mux;
+
+    memset(emu, 0, sizeof(*emu));
+    if (config) {
+        emu->config = *config;
+    }
+    emu->echo = 1;
+    emu->cipmux = 0;
+    emu->cipqsend = 0;
+    emu->ciprxgetManual = 0;
+    emuResetChannels(emu, 0);
+    for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+        emu->links[mux].sock = -1;
+    }
+
+    emu->master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (emu->master < 0) {
+        return 0;
+    }
+    if ((grantpt(emu->master) != 0) || (unlockpt(emu->master) != 0) || ((name = ptsname(emu->master)) == NULL)) {
+        close(emu->master);
+        return 0;
+    }
+    strncpy(emu->portName, name, sizeof(emu->portName) - 1);
+
+    /* Keep the slave opened (and raw) so that the master never reports a hang-up */
+    emu->slave = open(emu->portName, O_RDWR | O_NOCTTY);
+    if (emu->slave < 0) {
+        close(emu->master);
+        return 0;
+    }
+    if (tcgetattr(emu->slave, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(emu->slave, TCSANOW, &tty);
+    }
+    fcntl(emu->master, F_SETFL, fcntl(emu->master, F_GETFL) | O_NONBLOCK);
+    return 1;
+}
+
+const char* HeraclesEmu__PortName(HeraclesEmu* emu) {
+    return emu->portName;
+}
+
+/* Data of the transparent connection waiting for the line */
+static int emuOutputPending(HeraclesEmu* emu) {
+    int c;
+    for (c = 0; c < HERACLES_EMU_CHANNEL_COUNT; c++) {
+        if (emu->channels[c].dataMode && !emu->channels[c].flowOff && emu->links[0].rxLen) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Poll timeout (ms): short while a "DATA ACCEPT" is due */
+static int emuPollTimeout(HeraclesEmu* emu) {
+    int mux;
+    if (emuOutputPending(emu)) {
+        return 0;
+    }
+    for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+        if (emu->links[mux].acceptCount) {
+            return 1;
+        }
+    }
+    return 20;
+}
+
+int HeraclesEmu__Run(HeraclesEmu* emu) {
+    unsigned long long lineInFreeUs = 0;
+
+    while (!emu->stopped) {
+        struct pollfd fds[1 + HERACLES_EMU_LINK_COUNT];
+        int links[1 + HERACLES_EMU_LINK_COUNT];
+        HeraclesEmuChannel* urc;
+        int nfds = 0;
+        int mux;
+        int c;
+        int i;
+
+        fds[nfds].fd = emu->master;
+        fds[nfds].events = POLLIN;
+        links[nfds++] = -1;
+        for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+            HeraclesEmuLink* link = &emu->links[mux];
+            if (link->connected && !link->remoteClosed && (link->rxLen < sizeof(link->rx))) {
+                fds[nfds].fd = link->sock;
+                fds[nfds].events = POLLIN;
+                links[nfds++] = mux;
+            }
+        }
+
+        if (poll(fds, nfds, emuPollTimeout(emu)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (i = 1; i < nfds; i++) {
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                emuLinkReceive(emu, &emu->links[links[i]]);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            unsigned char buffer[512];
+            ssize_t n = read(emu->master, buffer, sizeof(buffer));
+            if (n > 0) {
+                emu->stats.serialIn += n;
+                emuPace(emu, &lineInFreeUs, n);
+                if (emu->cmux) {
+                    emuMuxInput(emu, buffer, n);
+                }
+                else {
+                    emuSerialInput(emu, buffer, n);
+                }
+            }
+        }
+
+        for (c = 0; c < HERACLES_EMU_CHANNEL_COUNT; c++) {
+            if (emu->channels[c].dataMode) {
+                emu->ch = &emu->channels[c];
+                emuDataMode(emu);
+            }
+        }
+        /* Unsolicited result codes are only sent while no command is in progress */
+        urc = &emu->channels[emu->cmux ? 1 : 0];
+        if (!urc->dataMode && (urc->lineLen == 0) && (urc->sendLen == 0)) {
+            emu->ch = urc;
+            emuSendUrc(emu);
+        }
+    }
+    return 0;
+}
+
+void HeraclesEmu__Stop(HeraclesEmu* emu) {
+    emu->stopped = 1;
+}
+
+void HeraclesEmu__Close(HeraclesEmu* emu) {
+    int mux;
+    for (mux = 0; mux < HERACLES_EMU_LINK_COUNT; mux++) {
+        emuLinkClose(&emu->links[mux]);
+    }
+    emuHttpFree(emu);
+    if (emu->slave >= 0) {
+        close(emu->slave);
+    }
+    if (emu->master >= 0) {
+        close(emu->master);
+    }
+    emu->slave = -1;
+    emu->master = -1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+#ifndef __HeraclesEmu_h
+#define __HeraclesEmu_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @startuml
+ *
+ * class HeraclesEmu {
+ *    +int open (config)
+ *    +const char* portName ()
+ *    +int run ()
+ *    +void stop ()
+ *    +void close ()
+ *    -master : pty
+ *    -links : HeraclesEmuLink[]
+ * }
+ *
+ * interface serial
+ * serial "1" -down-o HeraclesEmu : pseudo-terminal slave
+ *
+ * class HeraclesEmuLink {
+ *    -sock : TCP socket
+ *    -rx : received data
+ * }
+ * HeraclesEmu "1" o-- "0..6" HeraclesEmuLink
+ *
+ * class HeraclesEmuChannel {
+ *    -line : command line
+ *    -dataMode : transparent connection
+ * }
+ * HeraclesEmu "1" *-- "1..4" HeraclesEmuChannel : serial line or 27.010 DLCs
+ *
+ * @enduml
+ */
+
+#define HERACLES_EMU_LINK_COUNT   6
+#define HERACLES_EMU_ROUTE_COUNT  8
+#define HERACLES_EMU_HOST_SZ      64
+#define HERACLES_EMU_RX_SZ        (16 * 1024)
+#define HERACLES_EMU_MAX_RXGET    1460
+#define HERACLES_EMU_MAX_SEND     1460
+#define HERACLES_EMU_CHANNEL_COUNT 4
+#define HERACLES_EMU_MUX_N1       127
+#define HERACLES_EMU_ACCEPT_COUNT  8
+
+/**
+ * Redirection of a host (as given in AT+CIPSTART) to a local TCP endpoint.
+ * A route with a null port matches any port of the host.
+ */
+typedef struct _HeraclesEmuRoute {
+    char host[HERACLES_EMU_HOST_SZ];
+    unsigned short port;
+    char localHost[HERACLES_EMU_HOST_SZ];
+    unsigned short localPort;
+} HeraclesEmuRoute;
+
+typedef struct _HeraclesEmuConfig {
+    unsigned long baudRate;        /* emulated line rate in bits/s, 0 = no throttling */
+    unsigned long cmdLatencyUs;    /* processing time added to each AT command */
+    unsigned long acceptLatencyUs; /* delay of "DATA ACCEPT" after the AT+CIPSEND payload (AT+CIPQSEND=1) */
+    unsigned long escapeGuardMs;   /* silence around the "+++" escape sequence, 0 = 1000 ms */
+    int verbose;                   /* dump AT traffic on stderr */
+    int routeCount;
+    HeraclesEmuRoute routes[HERACLES_EMU_ROUTE_COUNT];
+} HeraclesEmuConfig;
+
+/**
+ * Counters of the serial traffic seen by the emulated modem.
+ */
+typedef struct _HeraclesEmuStats {
+    unsigned long atCommands;      /* command lines received */
+    unsigned long cipsend;         /* AT+CIPSEND commands */
+    unsigned long ciprxget;        /* AT+CIPRXGET=2 commands */
+    unsigned long ciprxgetPoll;    /* AT+CIPRXGET=4 commands */
+    unsigned long cipstatus;       /* AT+CIPSTATUS commands */
+    unsigned long urc;             /* unsolicited result codes sent */
+    unsigned long serialIn;        /* bytes received from the host */
+    unsigned long serialOut;       /* bytes sent to the host */
+    unsigned long tcpIn;           /* bytes received from the TCP endpoints */
+    unsigned long tcpOut;          /* bytes sent to the TCP endpoints */
+    unsigned long escapes;         /* "+++" escape sequences (transparent mode) */
+    unsigned long httpReads;       /* AT+HTTPREAD commands */
+    unsigned long muxFrames;       /* 27.010 frames received from the host */
+} HeraclesEmuStats;
+
+typedef struct _HeraclesEmuLink {
+    int sock;
+    int connected;
+    int remoteClosed;
+    int notified;
+    char host[HERACLES_EMU_HOST_SZ];
+    unsigned short port;
+    unsigned char rx[HERACLES_EMU_RX_SZ];
+    size_t rxLen;
+    /* "DATA ACCEPT" not reported yet */
+    unsigned long long acceptUs[HERACLES_EMU_ACCEPT_COUNT];
+    size_t acceptLen[HERACLES_EMU_ACCEPT_COUNT];
+    int acceptCount;
+} HeraclesEmuLink;
+
+/**
+ * Command interpreter of one line: the serial line, or one channel of the 27.010 multiplexer.
+ */
+typedef struct _HeraclesEmuChannel {
+    int dlci;                      /* 0 without multiplexer */
+    int open;                      /* DLC established (SABM) */
+    int flowOff;                   /* the host stopped the channel (MSC FC bit) */
+
+    char line[600];
+    size_t lineLen;
+    int lineEnd;
+
+    /* pending AT+CIPSEND payload */
+    int sendMux;
+    size_t sendLen;
+    size_t sendGot;
+    unsigned char sendBuf[HERACLES_EMU_MAX_SEND];
+
+    /* transparent mode (AT+CIPMODE=1) : the line is bridged to link 0 */
+    int dataMode;
+    int escPlus;                   /* '+' of a possible escape sequence, not forwarded yet */
+    unsigned long long lastInUs;   /* last input */
+} HeraclesEmuChannel;
+
+typedef struct _HeraclesEmu {
+    HeraclesEmuConfig config;
+    HeraclesEmuStats stats;
+    int master;
+    int slave;
+    char portName[64];
+    volatile int stopped;
+
+    /* AT command interpreter */
+    int echo;
+    int cipmux;
+    int cipqsend;
+    int ciprxgetManual;
+    int cipmode;
+
+    /* channels[0] : serial line; channels[1..] : DLCs of the 27.010 multiplexer (AT+CMUX=0) */
+    HeraclesEmuChannel channels[HERACLES_EMU_CHANNEL_COUNT];
+    HeraclesEmuChannel* ch;        /* channel of the command being processed */
+    int cmux;
+
+    /* frame being received in multiplexer mode */
+    int muxState;
+    unsigned char muxHdr[4];
+    size_t muxHdrLen;
+    size_t muxLen;
+    size_t muxGot;
+    unsigned char muxInfo[HERACLES_EMU_MUX_N1];
+
+    HeraclesEmuLink links[HERACLES_EMU_LINK_COUNT];
+
+    /* HTTP application (AT+HTTPINIT ... AT+HTTPTERM) */
+    int httpInit;
+    char httpUrl[256];
+    unsigned char* httpBody;
+    size_t httpLen;
+
+    /* line rate emulation */
+    unsigned long long lineFreeUs;
+} HeraclesEmu;
+
+/**
+ * Create the pseudo-terminal of the emulated modem.
+ * Return 1 on success, else 0.
+ */
+int HeraclesEmu__Open(HeraclesEmu* emu, const HeraclesEmuConfig* config);
+
+/**
+ * Return the path of the pseudo-terminal to be opened by the serial interface.
+ */
+const char* HeraclesEmu__PortName(HeraclesEmu* emu);
+
+/**
+ * Add a redirection of "host:port" (port 0 = any port) to "localHost:localPort".
+ * Hosts without route are resolved and connected as is.
+ * Return 1 on success, else 0.
+ */
+int HeraclesEmu__AddRoute(HeraclesEmuConfig* config, const char* host, unsigned short port,
+                          const char* localHost, unsigned short localPort);
+
+/**
+ * Serve the AT commands until HeraclesEmu__Stop() is called.
+ * Return 0 on normal stop, else -1.
+ */
+int HeraclesEmu__Run(HeraclesEmu* emu);
+
+/**
+ * Request the end of HeraclesEmu__Run() (may be called from another thread).
+ */
+void HeraclesEmu__Stop(HeraclesEmu* emu);
+
+/**
+ * Close the TCP links and the pseudo-terminal.
+ */
+void HeraclesEmu__Close(HeraclesEmu* emu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018 Orange
+ *
+ * This software is distributed under the terms and conditions of the GNU Lesser
+ * General Public License (LGPL-3.0) which can be found in the file 'LICENSE.txt'
+ * in this package distribution.
+ */
+
+/*
+ * === Heracles emulator ===
+ *
+ * Emulate the SIM800 modem of the Heracles shield on a pseudo-terminal.
+ *
+ * Usage : Heracles_emu [-b baud] [-l latency_us] [-a accept_us] [-v] [-r host[:port]=ip:port]...
+ *
+ * The path of the pseudo-terminal is printed on startup, the LiveBooster application uses it with:
+ *    LIVEBOOSTER_SERIAL_PORT=/dev/pts/N ./Linux_test
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HeraclesEmu.h"
+
+static HeraclesEmu emu;
+
+static void onSignal(int sig) {
+    (void)sig;
+    HeraclesEmu__Stop(&emu);
+}
+
+/* Parse "host[:port]=ip:port" */
+static int addRoute(HeraclesEmuConfig* config, char* arg) {
+    char* local = strchr(arg, '=');
+    char* port;
+    char* localPort;
+
+    if (local == NULL) {
+        return 0;
+    }
+    *local++ = 0;
+    localPort = strrchr(local, ':');
+    if (localPort == NULL) {
+        return 0;
+    }
+    *localPort++ = 0;
+    port = strchr(arg, ':');
+    if (port != NULL) {
+        *port++ = 0;
+    }
+    return HeraclesEmu__AddRoute(config, arg, (unsigned short)(port ? atoi(port) : 0),
+                                 local, (unsigned short)atoi(localPort));
+}
+
+int main(int argc, char* argv[]) {
+    HeraclesEmuConfig config;
+    int opt;
+
+    memset(&config, 0, sizeof(config));
+    while ((opt = getopt(argc, argv, "b:l:a:r:v")) != -1) {
+        switch (opt) {
+            case 'b':
+                config.baudRate = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                config.cmdLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                config.acceptLatencyUs = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                if (!addRoute(&config, optarg)) {
+                    fprintf(stderr, "Invalid route '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'v':
+                config.verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-b baud] [-l latency_us] [-a accept_us] [-v] [-r host[:port]=ip:port]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!HeraclesEmu__Open(&emu, &config)) {
+        perror("Heracles emulator");
+        return 1;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    printf("%s\n", HeraclesEmu__PortName(&emu));
+    fflush(stdout);
+
+    HeraclesEmu__Run(&emu);
+
+    fprintf(stderr, "AT commands : %lu (CIPSEND %lu, CIPRXGET %lu, CIPRXGET poll %lu, CIPSTATUS %lu)\n",
+            emu.stats.atCommands, emu.stats.cipsend, emu.stats.ciprxget, emu.stats.ciprxgetPoll, emu.stats.cipstatus);
+    fprintf(stderr, "Serial bytes: in %lu, out %lu - TCP bytes: in %lu, out %lu\n",
+            emu.stats.serialIn, emu.stats.serialOut, emu.stats.tcpIn, emu.stats.tcpOut);
+
+    HeraclesEmu__Close(&emu);
+    return 0;
+}
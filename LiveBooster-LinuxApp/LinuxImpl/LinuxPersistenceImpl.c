@@ -0,0 +1,145 @@
+#include "LinuxPersistenceImpl.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Log of the saved and removed packets: 'P' id length packet, or 'R' id (big-endian numbers).
+   Emptied once no packet is left in flight, and when loaded. Written with fflush only: the packets
+   survive a crash of the application, not a power loss (no fsync). */
+#define RECORD_PACKET  'P'
+#define RECORD_REMOVE  'R'
+
+static FILE *persistenceFile = NULL;
+static int persistencePackets = 0;
+
+int linuxPersistenceOpen (const char *path) {
+    persistenceFile = fopen(path, "r+b");
+    if (persistenceFile == NULL) {
+        persistenceFile = fopen(path, "w+b");
+    }
+    if (persistenceFile == NULL) {
+        return -1;
+    }
+    persistencePackets = 0;
+    return 0;
+}
+
+void linuxPersistenceClose () {
+    if (persistenceFile != NULL) {
+        fclose(persistenceFile);
+        persistenceFile = NULL;
+    }
+}
+
+static void linuxPersistenceTruncate () {
+    fflush(persistenceFile);
+    if (ftruncate(fileno(persistenceFile), 0) == 0) {
+        rewind(persistenceFile);
+    }
+}
+
+static int linuxPersistenceRecord (char type, unsigned short id, const unsigned char *packet, size_t len) {
+    unsigned char header[7];
+    size_t headerLen = 3;
+
+    header[0] = (unsigned char)type;
+    header[1] = (unsigned char)(id >> 8);
+    header[2] = (unsigned char)id;
+    if (packet != NULL) {
+        header[3] = (unsigned char)(len >> 24);
+        header[4] = (unsigned char)(len >> 16);
+        header[5] = (unsigned char)(len >> 8);
+        header[6] = (unsigned char)len;
+        headerLen = 7;
+    }
+    fseek(persistenceFile, 0, SEEK_END);
+    if ((fwrite(header, 1, headerLen, persistenceFile) != headerLen)
+            || ((packet != NULL) && (fwrite(packet, 1, len, persistenceFile) != len))
+            || (fflush(persistenceFile) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+int linuxPersistenceSave (unsigned short id, const unsigned char *packet, size_t len) {
+    if ((persistenceFile == NULL) || (linuxPersistenceRecord(RECORD_PACKET, id, packet, len) != 0)) {
+        return -1;
+    }
+    persistencePackets++;
+    return 0;
+}
+
+void linuxPersistenceRemove (unsigned short id) {
+    if (persistenceFile == NULL) {
+        return;
+    }
+    if ((persistencePackets > 0) && (--persistencePackets == 0)) {
+        /* nothing left in flight: the log starts again */
+        linuxPersistenceTruncate();
+    }
+    else {
+        linuxPersistenceRecord(RECORD_REMOVE, id, NULL, 0);
+    }
+}
+
+/* Replay the log up to its first incomplete record (at most MQTT_INFLIGHT_WINDOW packets in flight at a time),
+   then empty it: the packets kept by the caller are saved again */
+size_t linuxPersistenceLoad (unsigned char *buf, size_t size) {
+    struct {
+        unsigned short id;
+        size_t offset;
+        size_t len;
+    } packets[MQTT_INFLIGHT_WINDOW];
+    unsigned char header[7];
+    size_t used = 0;
+    int count = 0;
+    int i;
+
+    if (persistenceFile == NULL) {
+        return 0;
+    }
+    rewind(persistenceFile);
+    while (fread(header, 1, 3, persistenceFile) == 3) {
+        unsigned short id = (unsigned short)((header[1] << 8) | header[2]);
+
+        if (header[0] == RECORD_REMOVE) {
+            for (i = 0; (i < count) && (packets[i].id != id); i++) {
+            }
+            if (i < count) {
+                size_t len = packets[i].len;
+                memmove(buf + packets[i].offset, buf + packets[i].offset + len, used - packets[i].offset - len);
+                used -= len;
+                for (count--; i < count; i++) {
+                    packets[i] = packets[i + 1];
+                    packets[i].offset -= len;
+                }
+            }
+        }
+        else if ((header[0] == RECORD_PACKET) && (fread(header + 3, 1, 4, persistenceFile) == 4)) {
+            size_t len = ((size_t)header[3] << 24) | ((size_t)header[4] << 16) | ((size_t)header[5] << 8) | header[6];
+            if ((count == MQTT_INFLIGHT_WINDOW) || (used + len > size)
+                    || (fread(buf + used, 1, len, persistenceFile) != len)) {
+                break;
+            }
+            packets[count].id = id;
+            packets[count].offset = used;
+            packets[count].len = len;
+            count++;
+            used += len;
+        }
+        else {
+            break;
+        }
+    }
+
+    linuxPersistenceTruncate();
+    persistencePackets = 0;
+    return used;
+}
+
+PersistenceInterface linuxPersistenceImpl =
+{
+        linuxPersistenceSave,
+        linuxPersistenceRemove,
+        linuxPersistenceLoad
+};
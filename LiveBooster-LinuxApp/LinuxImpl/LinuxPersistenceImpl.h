@@ -0,0 +1,14 @@
+#ifndef __LinuxPersistenceImpl_h
+#define __LinuxPersistenceImpl_h
+
+#include "../LiveBooster-C-Library/LiveBooster.h"
+
+extern PersistenceInterface linuxPersistenceImpl;
+
+/* Keep the QoS 1 messages in flight in the file "path" (created if needed, kept between runs): return 0, or -1 */
+int linuxPersistenceOpen (const char *path);
+
+/* Close the file (the messages still in flight stay in it) */
+void linuxPersistenceClose ();
+
+#endif
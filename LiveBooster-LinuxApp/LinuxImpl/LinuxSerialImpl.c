@@ -4,25 +4,92 @@
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/uio.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 
 /* define PORTNAME   for heracles serial line)  */
 //#define PORTNAME "/dev/ttymxc5"  /* for UDOO Neo board       */
 #define PORTNAME "/dev/ttyAMA0"  /* for raspberry pi 3 board */
 
+/* environment variable overriding PORTNAME (i.e. pseudo-terminal of the Heracles emulator) */
+#define PORTNAME_ENV "LIVEBOOSTER_SERIAL_PORT"
+
 int fd = -1;
-int IsReceived = 0;
-char rcvd = 0;
+
+/* Userspace ring buffer of the received bytes: one read(2) for many bytes */
+#define RX_RING_SIZE 4096
+static unsigned char rxRing[RX_RING_SIZE];
+static unsigned int rxHead = 0;   /* next byte to be read */
+static unsigned int rxTail = 0;   /* next free slot */
+
+
+/* Move the bytes pending in the driver to the ring buffer, return the ring buffer count */
+static int linuxSerialFill () {
+    unsigned int used = rxTail - rxHead;
+
+    if (used == 0) {
+        rxHead = rxTail = 0;
+    }
+    if ((fd >= 0) && (used < RX_RING_SIZE)) {
+        struct iovec iov[2];
+        unsigned int w = rxTail % RX_RING_SIZE;
+        unsigned int r = rxHead % RX_RING_SIZE;
+        int iovcnt = 1;
+        ssize_t n;
+
+        iov[0].iov_base = &rxRing[w];
+        if (w >= r) {
+            iov[0].iov_len = RX_RING_SIZE - w;
+            iov[1].iov_base = &rxRing[0];
+            iov[1].iov_len = r;
+            iovcnt = (r > 0) ? 2 : 1;
+        }
+        else {
+            iov[0].iov_len = r - w;
+        }
+        n = readv (fd, iov, iovcnt);
+        if (n > 0) {
+            rxTail += n;
+        }
+    }
+    return rxTail - rxHead;
+}
+
+/* Copy up to "size" bytes from the ring buffer */
+static int linuxSerialPop (char *buffer, int size) {
+    int n = 0;
+    while ((n < size) && (rxHead != rxTail)) {
+        unsigned int r = rxHead % RX_RING_SIZE;
+        unsigned int chunk = RX_RING_SIZE - r;
+        if (chunk > rxTail - rxHead) {
+            chunk = rxTail - rxHead;
+        }
+        if (chunk > (unsigned int)(size - n)) {
+            chunk = size - n;
+        }
+        memcpy (buffer + n, &rxRing[r], chunk);
+        rxHead += chunk;
+        n += chunk;
+    }
+    return n;
+}
 
 
 void linuxSerialOpen () {
 
     if (fd < 0) {
-        fd = open (PORTNAME , O_RDWR | O_NOCTTY | O_SYNC);
+        const char* portName = getenv (PORTNAME_ENV);
+        if ((portName == NULL) || (*portName == 0)) {
+            portName = PORTNAME;
+        }
+
+        fd = open (portName , O_RDWR | O_NOCTTY | O_SYNC);
 
         if (fd < 0) {
-                printf ("error %d opening %s: %s", errno, PORTNAME , strerror (errno));
+                printf ("error %d opening %s: %s", errno, portName , strerror (errno));
                 return;
         }
 
@@ -63,32 +130,87 @@ void linuxSerialOpen () {
 }
 
 int linuxSerialAvailable () {
-
-    IsReceived = read (fd, &rcvd, 1);
-
-    if (IsReceived == 1) {
-        return IsReceived;
+    if (rxHead != rxTail) {
+        return 1;
     }
-    return 0;
+    return (linuxSerialFill () > 0);
 }
 
 char linuxSerialGet () {
+    char c = 0;
+    if ((rxHead != rxTail) || (linuxSerialFill () > 0)) {
+        linuxSerialPop (&c, 1);
+    }
+    return c;
+}
 
-    if (IsReceived == 1) {
-         IsReceived = 0;
-       return rcvd;
+void linuxSerialWrite (const char *buffer, int size) {
+    while (size > 0) {
+        ssize_t n = write (fd, buffer, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buffer += n;
+        size -= n;
     }
-    IsReceived = read (fd, &rcvd, 1);
+}
 
-    if (IsReceived == 1) {
-         IsReceived = 0;
-       return rcvd;
+int linuxSerialRead (char *buffer, int size, unsigned long timeoutInMs) {
+    int n = linuxSerialPop (buffer, size);
+
+    if ((n == 0) && (size > 0) && (fd >= 0)) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (linuxSerialFill () == 0) {
+            if (poll (&pfd, 1, (int)timeoutInMs) > 0) {
+                linuxSerialFill ();
+            }
+        }
+        n = linuxSerialPop (buffer, size);
     }
-    return 0;
+    return n;
 }
 
-void linuxSerialWrite (const char *buffer, int size) {
-    write (fd, buffer, size);
+int linuxSerialCount () {
+    return linuxSerialFill ();
+}
+
+void linuxSerialWriteChunks (const SerialChunk *chunks, int count) {
+    struct iovec iov[8];
+    int i = 0;
+
+    while (i < count) {
+        int iovcnt = 0;
+        ssize_t n;
+
+        /* one writev(2) per group of 8 buffers, a partial write is completed by write(2) */
+        while ((i + iovcnt < count) && (iovcnt < 8)) {
+            iov[iovcnt].iov_base = (void *)chunks[i + iovcnt].buffer;
+            iov[iovcnt].iov_len = chunks[i + iovcnt].size;
+            iovcnt++;
+        }
+        n = writev (fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        for (; iovcnt > 0; iovcnt--, i++) {
+            if ((size_t)n < (size_t)chunks[i].size) {
+                linuxSerialWrite (chunks[i].buffer + n, chunks[i].size - n);
+                n = 0;
+            }
+            else {
+                n -= chunks[i].size;
+            }
+        }
+    }
 }
 
 SerialInterface linuxSerialImpl =
@@ -96,5 +218,8 @@ SerialInterface linuxSerialImpl =
 		linuxSerialOpen,
 		linuxSerialAvailable,
 		linuxSerialGet,
-		linuxSerialWrite
+		linuxSerialWrite,
+		linuxSerialRead,
+		linuxSerialCount,
+		linuxSerialWriteChunks
 };
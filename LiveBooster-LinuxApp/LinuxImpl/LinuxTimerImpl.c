@@ -21,10 +21,17 @@ void linuxDelay (unsigned long waitTimeInMs) {
 	   usleep(waitTimeInMs * 1000);
 }
 
+unsigned long linuxMicros (){
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (unsigned long)ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
 TimerInterface linuxTimerImpl =
 {
 		linuxTimerInit,
 		linuxMillis,
-		linuxDelay
+		linuxDelay,
+		linuxMicros
 };
 
@@ -0,0 +1,46 @@
+#include "LinuxTraceImpl.h"
+#include <stdio.h>
+#include <unistd.h>
+
+static FILE *traceFile = NULL;
+static unsigned long traceEvents = 0;
+
+int linuxTraceOpen (const char *path) {
+    traceFile = fopen(path, "w");
+    if (traceFile == NULL) {
+        return -1;
+    }
+    traceEvents = 0;
+    fputs("[", traceFile);
+    return 0;
+}
+
+void linuxTraceClose () {
+    if (traceFile != NULL) {
+        fputs("\n]\n", traceFile);
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+}
+
+/* One "B" (begin) or "E" (end) event: the nesting gives the timeline of each thread */
+static void linuxTraceEvent (const char *name, char phase, unsigned long timeUs) {
+    if (traceFile != NULL) {
+        fprintf(traceFile, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":%d,\"tid\":1}",
+                traceEvents++ ? "," : "", name, phase, timeUs, (int)getpid());
+    }
+}
+
+void linuxTraceBegin (const char *name, unsigned long timeUs) {
+    linuxTraceEvent(name, 'B', timeUs);
+}
+
+void linuxTraceEnd (const char *name, unsigned long timeUs) {
+    linuxTraceEvent(name, 'E', timeUs);
+}
+
+TraceInterface linuxTraceImpl =
+{
+        linuxTraceBegin,
+        linuxTraceEnd
+};
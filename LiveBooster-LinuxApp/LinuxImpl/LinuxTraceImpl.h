@@ -0,0 +1,14 @@
+#ifndef __LinuxTraceImpl_h
+#define __LinuxTraceImpl_h
+
+#include "../LiveBooster-C-Library/LiveBooster.h"
+
+extern TraceInterface linuxTraceImpl;
+
+/* Write the spans to "path" in the Chrome trace event format (chrome://tracing, Perfetto): return 0, or -1 */
+int linuxTraceOpen (const char *path);
+
+/* Terminate and close the trace file */
+void linuxTraceClose ();
+
+#endif
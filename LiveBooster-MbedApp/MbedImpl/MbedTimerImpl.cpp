@@ -21,9 +21,14 @@ void mbedDelay (unsigned long waitTimeInMs) {
 	wait_ms(waitTimeInMs);
 }
 
+unsigned long mbedMicros (){
+	return us_ticker_read();
+}
+
 TimerInterface mbedTimerImpl =
 {
 		mbedTimerInit,
 		mbedMillis,
-		mbedDelay
+		mbedDelay,
+		mbedMicros
 };